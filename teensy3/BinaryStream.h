@@ -0,0 +1,134 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef BinaryStream_h
+#define BinaryStream_h
+#ifdef __cplusplus
+
+#include "Stream.h"
+#include "BufferedPrint.h"
+
+// BinaryWriter and BinaryReader send structured data as compact binary,
+// rather than text.  Integers and floats are fixed width little endian,
+// varints are LEB128 (signed ones zigzag encoded first) and blobs are a
+// varint length followed by the bytes.  Both keep a running CRC-16 (the
+// same as Modbus, see util/crc16.h) of everything passing through, so a
+// record can end with writeCrc() and be checked with checkCrc().
+//
+// Given a buffer, BinaryWriter collects a whole record with BufferedPrint,
+// and sends it when send() is called, the buffer fills, or it is destroyed.
+//
+//   uint8_t buf[64];
+//   BinaryWriter out(Serial1, buf, sizeof(buf));
+//   out.writeUInt16(id);
+//   out.writeFloat(temperature);
+//   out.writeVarint(count);
+//   out.writeCrc();
+//   out.send();
+//
+//   BinaryReader in(Serial1);
+//   uint16_t id = in.readUInt16();
+//   float temperature = in.readFloat();
+//   uint32_t count = in.readVarint();
+//   if (in.checkCrc()) ...	// also false if anything timed out
+//
+class BinaryWriter
+{
+public:
+	BinaryWriter(Print &output) : out_(output, nullptr, 0, false) {}
+	BinaryWriter(Print &output, uint8_t *buffer, size_t size)
+		: out_(output, buffer, size, false) {}
+	size_t writeUInt8(uint8_t n) { return writeBytes(&n, 1); }
+	size_t writeUInt16(uint16_t n) { return writeLE(n, 2); }
+	size_t writeUInt32(uint32_t n) { return writeLE(n, 4); }
+	size_t writeUInt64(uint64_t n) { return writeLE(n, 8); }
+	size_t writeInt8(int8_t n) { return writeUInt8(n); }
+	size_t writeInt16(int16_t n) { return writeUInt16(n); }
+	size_t writeInt32(int32_t n) { return writeUInt32(n); }
+	size_t writeInt64(int64_t n) { return writeUInt64(n); }
+	size_t writeFloat(float n);
+	size_t writeDouble(double n);
+	size_t writeVarint(uint64_t n);
+	size_t writeSignedVarint(int64_t n) { return writeVarint(((uint64_t)n << 1) ^ (uint64_t)(n >> 63)); }
+	size_t writeBlob(const void *data, size_t length);
+	size_t writeBytes(const void *data, size_t length);
+	// Append the CRC of everything written since the last resetCrc()
+	size_t writeCrc() { return writeUInt16(crc_); }
+	uint16_t crc() const { return crc_; }
+	void resetCrc() { crc_ = 0xFFFF; }
+	// Write all buffered data to the output.  Returns the number of bytes.
+	size_t send();
+	// Number of bytes waiting in the buffer
+	size_t buffered() const { return out_.buffered(); }
+	int getWriteError() { return out_.getWriteError(); }
+private:
+	size_t writeLE(uint64_t n, size_t length);
+	BufferedPrint out_;
+	uint16_t crc_ = 0xFFFF;
+};
+
+// Values which can not be read before the Stream's timeout are returned as
+// zero and set error(), which stays set until clearError().
+class BinaryReader
+{
+public:
+	BinaryReader(Stream &input) : input_(input) {}
+	uint8_t readUInt8() { uint8_t n = 0; readBytes(&n, 1); return n; }
+	uint16_t readUInt16() { return readLE(2); }
+	uint32_t readUInt32() { return readLE(4); }
+	uint64_t readUInt64() { return readLE(8); }
+	int8_t readInt8() { return readUInt8(); }
+	int16_t readInt16() { return readUInt16(); }
+	int32_t readInt32() { return readUInt32(); }
+	int64_t readInt64() { return readUInt64(); }
+	float readFloat();
+	double readDouble();
+	uint64_t readVarint();
+	int64_t readSignedVarint() { uint64_t n = readVarint(); return (int64_t)(n >> 1) ^ -(int64_t)(n & 1); }
+	// Read a blob into buffer, returning its length.  A blob longer than
+	// size is discarded after the first size bytes and sets error().
+	size_t readBlob(void *buffer, size_t size);
+	bool readBytes(void *buffer, size_t length);
+	// Read the CRC written by writeCrc() and compare it to the CRC of
+	// everything read since the last resetCrc()
+	bool checkCrc();
+	uint16_t crc() const { return crc_; }
+	void resetCrc() { crc_ = 0xFFFF; }
+	bool error() const { return error_; }
+	void clearError() { error_ = false; }
+private:
+	uint64_t readLE(size_t length);
+	Stream &input_;
+	uint16_t crc_ = 0xFFFF;
+	bool error_ = false;
+};
+
+#endif // __cplusplus
+#endif
@@ -0,0 +1,79 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "BufferedPrint.h"
+#include <string.h>
+
+size_t BufferedPrint::write(uint8_t b)
+{
+	if (size_ == 0) return output_.write(b);
+	buffer_[len_++] = b;
+	if (len_ >= size_ || (b == '\n' && send_on_newline_)) send_now();
+	return 1;
+}
+
+size_t BufferedPrint::write(const uint8_t *buffer, size_t size)
+{
+	if (buffer == nullptr || size == 0) return 0;
+	bool newline = send_on_newline_ && memchr(buffer, '\n', size) != nullptr;
+	if (size >= size_) {
+		// too large to gain anything from copying, pass it straight through
+		send_now();
+		size_t n = output_.write(buffer, size);
+		if (n < size) setWriteError();
+		return n;
+	}
+	size_t count = size;
+	while (size > 0) {
+		size_t n = size_ - len_;
+		if (n > size) n = size;
+		memcpy(buffer_ + len_, buffer, n);
+		len_ += n;
+		buffer += n;
+		size -= n;
+		if (len_ >= size_) send_now();
+	}
+	if (newline) send_now();
+	return count;
+}
+
+void BufferedPrint::send_now(void)
+{
+	if (len_ == 0) return;
+	size_t n = output_.write(buffer_, len_);
+	if (n < len_) setWriteError();
+	len_ = 0;
+}
+
+void BufferedPrint::flush()
+{
+	send_now();
+	output_.flush();
+}
@@ -113,6 +113,30 @@ void EventResponder::runFromInterrupt()
 	}
 }
 
+// Wait for any of the events in list to be triggered, or timeout milliseconds
+// (negative waits forever).  Returns the event, which is cleared, or nullptr.
+// yield() keeps running while waiting, so the events should be detached,
+// otherwise yield() calls their function and this never sees them.
+EventResponder * EventResponder::waitForEvent(EventResponder *list, int listsize, int timeout)
+{
+	uint32_t begin = millis();
+	while (1) {
+		for (int i = 0; i < listsize; i++) {
+			if (list[i]._triggered) {
+				list[i].clearEvent();
+				return list + i;
+			}
+		}
+		if (timeout >= 0 && millis() - begin >= (uint32_t)timeout) return nullptr;
+		yield();
+	}
+}
+
+bool EventResponder::waitForEvent(EventResponderRef event, int timeout)
+{
+	return waitForEvent(&event, 1, timeout) != nullptr;
+}
+
 bool EventResponder::clearEvent()
 {
 	bool ret = false;
@@ -187,7 +211,8 @@ void EventResponder::detachNoInterrupts()
 
 
 MillisTimer * MillisTimer::listWaiting = nullptr;
-MillisTimer * MillisTimer::listActive = nullptr;
+MillisTimer * MillisTimer::wheel[MILLISTIMER_WHEEL_LEVELS][MILLISTIMER_WHEEL_SLOTS];
+unsigned long MillisTimer::wheelTime = 0;
 
 void MillisTimer::begin(unsigned long milliseconds, EventResponderRef event)
 {
@@ -211,7 +236,7 @@ void MillisTimer::beginRepeating(unsigned long milliseconds, EventResponderRef e
 
 void MillisTimer::addToWaitingList()
 {
-	_prev = nullptr;
+	_pprev = nullptr;
 	bool irq = disableTimerInterrupt();
 	_next = listWaiting;
 	listWaiting = this; // TODO: use STREX to avoid interrupt disable
@@ -221,59 +246,49 @@ void MillisTimer::addToWaitingList()
 
 void MillisTimer::addToActiveList() // only called by runFromTimer()
 {
-	if (listActive == nullptr) {
-		// list is empty, easy case
-		_next = nullptr;
-		_prev = nullptr;
-		listActive = this;
-	} else if (_ms < listActive->_ms) {
-		// this timer triggers before any on the list
-		_next = listActive;
-		_prev = nullptr;
-		listActive->_prev = this;
-		// Decrement the next items wait time be our wait time as to properly handle waits for all other items...
-		listActive->_ms -= _ms;	
-		listActive = this;
-	} else {
-		// add this timer somewhere after the first already on the list
-		MillisTimer *timer = listActive;
-		while (timer->_next) {
-			_ms -= timer->_ms;
-			timer = timer->_next;
-			if (_ms < timer->_ms) {
-				// found the right place in the middle of list
-				_next = timer;
-				_prev = timer->_prev;
-				timer->_prev = this;
-				_prev->_next = this;
-				timer->_ms -= _ms;
-				_state = TimerActive;
-				return;
-			}
-		}
-		// add this time at the end of the list
-		_ms -= timer->_ms;
-		_next = nullptr;
-		_prev = timer;
-		timer->_next = this;
+	unsigned long delta = _ms - wheelTime;
+	unsigned long expire = _ms;
+	unsigned int level = 0;
+
+	if (delta >= (1ul << (MILLISTIMER_WHEEL_BITS * MILLISTIMER_WHEEL_LEVELS))) {
+		// too far in the future for the wheel, wait in its last slot
+		expire = wheelTime + (1ul << (MILLISTIMER_WHEEL_BITS * MILLISTIMER_WHEEL_LEVELS)) - 1;
+		delta = expire - wheelTime;
 	}
+	while (delta >= MILLISTIMER_WHEEL_SLOTS) {
+		delta >>= MILLISTIMER_WHEEL_BITS;
+		level++;
+	}
+	MillisTimer **slot = &wheel[level][(expire >> (MILLISTIMER_WHEEL_BITS * level))
+		& (MILLISTIMER_WHEEL_SLOTS - 1)];
+	_next = *slot;
+	if (_next) _next->_pprev = &_next;
+	_pprev = slot;
+	*slot = this;
 	_state = TimerActive;
 }
 
+// move all timers in one slot of a higher level down to lower levels
+void MillisTimer::cascade(unsigned int level)
+{
+	MillisTimer **slot = &wheel[level][(wheelTime >> (MILLISTIMER_WHEEL_BITS * level))
+		& (MILLISTIMER_WHEEL_SLOTS - 1)];
+	MillisTimer *timer = *slot;
+	*slot = nullptr;
+	while (timer) {
+		MillisTimer *next = timer->_next;
+		timer->addToActiveList();
+		timer = next;
+	}
+}
+
 void MillisTimer::end()
 {
 	bool irq = disableTimerInterrupt();
 	TimerStateType s = _state;
 	if (s == TimerActive) {
-		if (_next) {
-			_next->_prev = _prev;
-			_next->_ms += _ms;   // add in the rest of our timing to next entry...
-		}
-		if (_prev) {
-			_prev->_next = _next;
-		} else {
-			listActive = _next;
-		}
+		if (_next) _next->_pprev = _pprev;
+		*_pprev = _next;
 		_state = TimerOff;
 	} else if (s == TimerWaiting) {
 		if (listWaiting == this) {
@@ -295,24 +310,30 @@ void MillisTimer::end()
 
 void MillisTimer::runFromTimer()
 {
-	MillisTimer *timer = listActive;
-	while (timer) {
-		if (timer->_ms > 0) {
-			timer->_ms--;
-			break;
+	wheelTime++;
+	for (unsigned int level=1; level < MILLISTIMER_WHEEL_LEVELS; level++) {
+		if (wheelTime & ((1ul << (MILLISTIMER_WHEEL_BITS * level)) - 1)) break;
+		cascade(level);
+	}
+	// take all the timers expiring now, so end() or begin() from an
+	// event function can't disturb the wheel while we walk this list
+	MillisTimer **slot = &wheel[0][wheelTime & (MILLISTIMER_WHEEL_SLOTS - 1)];
+	MillisTimer *expired = *slot;
+	*slot = nullptr;
+	if (expired) expired->_pprev = &expired;
+	while (expired) {
+		MillisTimer *timer = expired;
+		expired = timer->_next;
+		if (expired) expired->_pprev = &expired;
+		if (timer->_reload) {
+			// restart first, so the event function may end() it
+			timer->_ms = wheelTime + timer->_reload;
+			timer->addToActiveList();
 		} else {
-			MillisTimer *next = timer->_next;
-			if (next) next->_prev = nullptr;
-			listActive = next;
 			timer->_state = TimerOff;
-			EventResponderRef event = *(timer->_event);
-			event.triggerEvent(0, timer);
-			if (timer->_reload) {
-				timer->_ms = timer->_reload;
-				timer->addToActiveList();
-			}
-			timer = listActive;
 		}
+		EventResponderRef event = *(timer->_event);
+		event.triggerEvent(0, timer);
 	}
 	bool irq = disableTimerInterrupt();
 	MillisTimer *waiting = listWaiting;
@@ -320,6 +341,7 @@ void MillisTimer::runFromTimer()
 	enableTimerInterrupt(irq);
 	while (waiting) {
 		MillisTimer *next = waiting->_next;
+		waiting->_ms += wheelTime + 1;
 		waiting->addToActiveList();
 		waiting = next;
 	}
@@ -37,6 +37,15 @@
 // Uncomment to enable 9 bit formats.  These are default disabled to save memory.
 //#define SERIAL_9BIT_SUPPORT
 //
+// Or uncomment only the ports which need 9 bits.  Those ports use 16 bit
+// buffers, while the others keep the smaller and faster 8 bit buffers.
+//#define SERIAL1_9BIT_SUPPORT
+//#define SERIAL2_9BIT_SUPPORT
+//#define SERIAL3_9BIT_SUPPORT
+//#define SERIAL4_9BIT_SUPPORT
+//#define SERIAL5_9BIT_SUPPORT
+//#define SERIAL6_9BIT_SUPPORT
+//
 // On Windows & Linux, this file is in Arduino's hardware/teensy/avr/cores/teensy3
 //   folder.  The Windows installer puts Arduino in C:\Program Files (x86)\Arduino
 // On Macintosh, you must control-click Arduino and select "Show Package Contents", then
@@ -66,7 +75,9 @@
 #define SERIAL_8N1_RXINV_TXINV 0x30
 #define SERIAL_8E1_RXINV_TXINV 0x36
 #define SERIAL_8O1_RXINV_TXINV 0x37
-#ifdef SERIAL_9BIT_SUPPORT
+#if defined(SERIAL_9BIT_SUPPORT) || defined(SERIAL1_9BIT_SUPPORT) || defined(SERIAL2_9BIT_SUPPORT) \
+  || defined(SERIAL3_9BIT_SUPPORT) || defined(SERIAL4_9BIT_SUPPORT) || defined(SERIAL5_9BIT_SUPPORT) \
+  || defined(SERIAL6_9BIT_SUPPORT)
 #define SERIAL_9N1 0x84
 #define SERIAL_9E1 0x8E
 #define SERIAL_9O1 0x8F
@@ -161,6 +172,8 @@ void serial_add_memory_for_read(void *buffer, size_t length);
 void serial_add_memory_for_write(void *buffer, size_t length);
 int serial_available(void);
 int serial_getchar(void);
+int serial_read(void *buf, unsigned int count);
+int serial_set_dma(uint8_t rx, uint8_t tx);
 int serial_peek(void);
 void serial_clear(void);
 void serial_print(const char *p);
@@ -184,6 +197,8 @@ void serial2_add_memory_for_read(void *buffer, size_t length);
 void serial2_add_memory_for_write(void *buffer, size_t length);
 int serial2_available(void);
 int serial2_getchar(void);
+int serial2_read(void *buf, unsigned int count);
+int serial2_set_dma(uint8_t rx, uint8_t tx);
 int serial2_peek(void);
 void serial2_clear(void);
 
@@ -203,6 +218,8 @@ void serial3_add_memory_for_read(void *buffer, size_t length);
 void serial3_add_memory_for_write(void *buffer, size_t length);
 int serial3_available(void);
 int serial3_getchar(void);
+int serial3_read(void *buf, unsigned int count);
+int serial3_set_dma(uint8_t rx, uint8_t tx);
 int serial3_peek(void);
 void serial3_clear(void);
 
@@ -222,6 +239,8 @@ void serial4_add_memory_for_read(void *buffer, size_t length);
 void serial4_add_memory_for_write(void *buffer, size_t length);
 int serial4_available(void);
 int serial4_getchar(void);
+int serial4_read(void *buf, unsigned int count);
+int serial4_set_dma(uint8_t rx, uint8_t tx);
 int serial4_peek(void);
 void serial4_clear(void);
 
@@ -241,6 +260,8 @@ void serial5_add_memory_for_read(void *buffer, size_t length);
 void serial5_add_memory_for_write(void *buffer, size_t length);
 int serial5_available(void);
 int serial5_getchar(void);
+int serial5_read(void *buf, unsigned int count);
+int serial5_set_dma(uint8_t rx, uint8_t tx);
 int serial5_peek(void);
 void serial5_clear(void);
 
@@ -260,6 +281,8 @@ void serial6_add_memory_for_read(void *buffer, size_t length);
 void serial6_add_memory_for_write(void *buffer, size_t length);
 int serial6_available(void);
 int serial6_getchar(void);
+int serial6_read(void *buf, unsigned int count);
+int serial6_set_dma(uint8_t rx, uint8_t tx);
 int serial6_peek(void);
 void serial6_clear(void);
 
@@ -295,11 +318,14 @@ public:
 	virtual int available(void)     { return serial_available(); }
 	virtual int peek(void)          { return serial_peek(); }
 	virtual int read(void)          { return serial_getchar(); }
+	virtual int read(uint8_t *buffer, size_t length) { return serial_read(buffer, length); }
 	virtual void flush(void)        { serial_flush(); }
 	virtual void clear(void)	{ serial_clear(); }
 	virtual int availableForWrite(void) { return serial_write_buffer_free(); }
  	virtual void addMemoryForRead(void *buffer, size_t length) {serial_add_memory_for_read(buffer, length);}
 	virtual void addMemoryForWrite(void *buffer, size_t length){serial_add_memory_for_write(buffer, length);}
+	// DMA instead of interrupts, Serial1 - Serial3 (and Serial4 on 3.5/3.6) only
+	virtual bool useDMA(bool rx = true, bool tx = true) { return serial_set_dma(rx, tx); }
 	using Print::write;
 	virtual size_t write(uint8_t c) { serial_putchar(c); return 1; }
 	virtual size_t write(unsigned long n)   { return write((uint8_t)n); }
@@ -349,11 +375,13 @@ public:
 	virtual int available(void)     { return serial2_available(); }
 	virtual int peek(void)          { return serial2_peek(); }
 	virtual int read(void)          { return serial2_getchar(); }
+	virtual int read(uint8_t *buffer, size_t length) { return serial2_read(buffer, length); }
 	virtual void flush(void)        { serial2_flush(); }
 	virtual void clear(void)	{ serial2_clear(); }
 	virtual int availableForWrite(void) { return serial2_write_buffer_free(); }
  	virtual void addMemoryForRead(void *buffer, size_t length) {serial2_add_memory_for_read(buffer, length);}
 	virtual void addMemoryForWrite(void *buffer, size_t length){serial2_add_memory_for_write(buffer, length);}
+	virtual bool useDMA(bool rx = true, bool tx = true) { return serial2_set_dma(rx, tx); }
 	using Print::write;
 	virtual size_t write(uint8_t c) { serial2_putchar(c); return 1; }
 	virtual size_t write(unsigned long n)   { return write((uint8_t)n); }
@@ -388,11 +416,13 @@ public:
 	virtual int available(void)     { return serial3_available(); }
 	virtual int peek(void)          { return serial3_peek(); }
 	virtual int read(void)          { return serial3_getchar(); }
+	virtual int read(uint8_t *buffer, size_t length) { return serial3_read(buffer, length); }
 	virtual void flush(void)        { serial3_flush(); }
 	virtual void clear(void)	{ serial3_clear(); }
 	virtual int availableForWrite(void) { return serial3_write_buffer_free(); }
  	virtual void addMemoryForRead(void *buffer, size_t length) {serial3_add_memory_for_read(buffer, length);}
 	virtual void addMemoryForWrite(void *buffer, size_t length){serial3_add_memory_for_write(buffer, length);}
+	virtual bool useDMA(bool rx = true, bool tx = true) { return serial3_set_dma(rx, tx); }
 	using Print::write;
 	virtual size_t write(uint8_t c) { serial3_putchar(c); return 1; }
 	virtual size_t write(unsigned long n)   { return write((uint8_t)n); }
@@ -427,11 +457,13 @@ public:
 	virtual int available(void)     { return serial4_available(); }
 	virtual int peek(void)          { return serial4_peek(); }
 	virtual int read(void)          { return serial4_getchar(); }
+	virtual int read(uint8_t *buffer, size_t length) { return serial4_read(buffer, length); }
 	virtual void flush(void)        { serial4_flush(); }
 	virtual void clear(void)	{ serial4_clear(); }
 	virtual int availableForWrite(void) { return serial4_write_buffer_free(); }
  	virtual void addMemoryForRead(void *buffer, size_t length) {serial4_add_memory_for_read(buffer, length);}
 	virtual void addMemoryForWrite(void *buffer, size_t length){serial4_add_memory_for_write(buffer, length);}
+	virtual bool useDMA(bool rx = true, bool tx = true) { return serial4_set_dma(rx, tx); }
 	using Print::write;
 	virtual size_t write(uint8_t c) { serial4_putchar(c); return 1; }
 	virtual size_t write(unsigned long n)   { return write((uint8_t)n); }
@@ -466,11 +498,13 @@ public:
 	virtual int available(void)     { return serial5_available(); }
 	virtual int peek(void)          { return serial5_peek(); }
 	virtual int read(void)          { return serial5_getchar(); }
+	virtual int read(uint8_t *buffer, size_t length) { return serial5_read(buffer, length); }
 	virtual void flush(void)        { serial5_flush(); }
 	virtual void clear(void)	{ serial5_clear(); }
 	virtual int availableForWrite(void) { return serial5_write_buffer_free(); }
  	virtual void addMemoryForRead(void *buffer, size_t length) {serial5_add_memory_for_read(buffer, length);}
 	virtual void addMemoryForWrite(void *buffer, size_t length){serial5_add_memory_for_write(buffer, length);}
+	virtual bool useDMA(bool rx = true, bool tx = true) { return serial5_set_dma(rx, tx); }
 	using Print::write;
 	virtual size_t write(uint8_t c) { serial5_putchar(c); return 1; }
 	virtual size_t write(unsigned long n)   { return write((uint8_t)n); }
@@ -512,11 +546,13 @@ public:
 	virtual int available(void)     { return serial6_available(); }
 	virtual int peek(void)          { return serial6_peek(); }
 	virtual int read(void)          { return serial6_getchar(); }
+	virtual int read(uint8_t *buffer, size_t length) { return serial6_read(buffer, length); }
 	virtual void flush(void)        { serial6_flush(); }
 	virtual void clear(void)	{ serial6_clear(); }
 	virtual int availableForWrite(void) { return serial6_write_buffer_free(); }
  	virtual void addMemoryForRead(void *buffer, size_t length) {serial6_add_memory_for_read(buffer, length);}
 	virtual void addMemoryForWrite(void *buffer, size_t length){serial6_add_memory_for_write(buffer, length);}
+	virtual bool useDMA(bool rx = true, bool tx = true) { return serial6_set_dma(rx, tx); }
 	using Print::write;
 	virtual size_t write(uint8_t c) { serial6_putchar(c); return 1; }
 	virtual size_t write(unsigned long n)   { return write((uint8_t)n); }
@@ -63,6 +63,7 @@ class Print
 	virtual void flush()				{ }
 	size_t write(const char *buffer, size_t size)	{ return write((const uint8_t *)buffer, size); }
 	size_t print(const String &s);
+	size_t print(const StringView &s)		{ return write((const uint8_t *)s.data(), s.length()); }
 	size_t print(char c)				{ return write((uint8_t)c); }
 	size_t print(const char s[])			{ return write(s); }
 	size_t print(const __FlashStringHelper *f)	{ return write((const char *)f); }
@@ -84,9 +85,11 @@ class Print
 	size_t print(uint64_t n, int base)		{ return printNumber64(n, base, 0); }
 
 	size_t print(double n, int digits = 2)		{ return printFloat(n, digits); }
+	size_t printScientific(double n, int digits = -1) { return printFloat(n, digits, DTOSTR_EXPONENT); }
 	size_t print(const Printable &obj)		{ return obj.printTo(*this); }
 	size_t println(void);
 	size_t println(const String &s)			{ return print(s) + println(); }
+	size_t println(const StringView &s)		{ return print(s) + println(); }
 	size_t println(char c)				{ return print(c) + println(); }
 	size_t println(const char s[])			{ return print(s) + println(); }
 	size_t println(const __FlashStringHelper *f)	{ return print(f) + println(); }
@@ -115,12 +118,12 @@ class Print
 	// https://forum.pjrc.com/threads/62473?p=256873&viewfull=1#post256873
 	int printf(const char *format, ...) /*__attribute__ ((format (printf, 2, 3)))*/;
 	int printf(const __FlashStringHelper *format, ...);
-	int vprintf(const char *format, va_list ap) { return vdprintf((int)this, format, ap); }
+	int vprintf(const char *format, va_list ap);
   protected:
 	void setWriteError(int err = 1) { write_error = err; }
   private:
 	int write_error;
-	size_t printFloat(double n, uint8_t digits);
+	size_t printFloat(double n, int digits, unsigned int flags = 0);
 #ifdef __MKL26Z64__
 	size_t printNumberDec(unsigned long n, uint8_t sign);
 	size_t printNumberHex(unsigned long n);
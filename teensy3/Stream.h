@@ -23,8 +23,19 @@
 #include <inttypes.h>
 #include "Print.h"
 
+// total length of the targets for findAny()
+#define FIND_ANY_MAX_LENGTH 120
+
+class EventResponder;
+
 enum LookaheadMode {SKIP_ALL, SKIP_NONE, SKIP_WHITESPACE};
 
+// getReadError() codes, parseArray() reports the first error on the line
+enum ParseError {PARSE_OK, PARSE_TIMEOUT, PARSE_INVALID, PARSE_RANGE, PARSE_TOO_MANY};
+
+// longest number parseArray() accepts, in characters
+#define PARSE_TOKEN_SIZE 40
+
 class Stream : public Print
 {
   public:
@@ -32,6 +43,9 @@ class Stream : public Print
 	virtual int available() = 0;
 	virtual int read() = 0;
 	virtual int peek() = 0;
+	// Read bytes which have already been received, up to length, without
+	// waiting.  Returns the number copied, which is zero if none are ready.
+	virtual int read(uint8_t *buffer, size_t length);
 
 	void setTimeout(unsigned long timeout) { _timeout = timeout; }
 	unsigned long getTimeout(void) { return _timeout; }
@@ -41,6 +55,7 @@ class Stream : public Print
 	bool find(const char *target, size_t length) { return findUntil(target, length, NULL, 0); }
 	bool find(const uint8_t *target, size_t length) { return find((const char *)target, length); }
 	bool find(const String &target, size_t length) { return find(target.c_str(), length); }
+	bool find(const StringView &target) { return find(target.data(), target.length()); }
 	bool find(char target) { return find(&target, 1); }
 	bool findUntil(const char *target, const char *terminator);
 	bool findUntil(const uint8_t *target, const char *terminator) { return findUntil((const char *)target, terminator); }
@@ -52,8 +67,17 @@ class Stream : public Print
 	bool findUntil(const String &target, size_t targetLen, const char *terminate, size_t termLen);
 	bool findUntil(const char *target, size_t targetLen, const String &terminate, size_t termLen);
 	bool findUntil(const String &target, size_t targetLen, const String &terminate, size_t termLen);
+	int findAny(const char * const *targets, size_t count);
+	template <size_t N> int findAny(const char * const (&targets)[N]) { return findAny(targets, N); }
 	long parseInt(LookaheadMode lookahead = SKIP_ALL, char ignore = '\x01');
 	float parseFloat(LookaheadMode lookahead = SKIP_ALL, char ignore = '\x01');
+	// Parse one line of numbers, separated by any of the separators, into
+	// values.  Returns how many were stored.  Numbers out of range are
+	// clamped and still stored, but other errors stop storing.
+	int parseArray(long *values, size_t count, const char *separators = ", \t", char terminator = '\n');
+	int parseArray(int *values, size_t count, const char *separators = ", \t", char terminator = '\n');
+	int parseArray(float *values, size_t count, const char *separators = ", \t", char terminator = '\n');
+	int parseArray(double *values, size_t count, const char *separators = ", \t", char terminator = '\n');
 	size_t readBytes(char *buffer, size_t length);
 	size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
 	size_t readBytesUntil(char terminator, char *buffer, size_t length);
@@ -64,9 +88,20 @@ class Stream : public Print
 	void clearReadError() { setReadError(0); }
   protected:
 	void setReadError(int err = 1) { read_error = err; }
+	// Streams able to signal received data trigger event when it arrives,
+	// until this is called with nullptr, and return true.  No Teensy 3
+	// stream does yet, and waitForEvent() does not sleep here, so waiting
+	// for data always busy-polls with yield().
+	virtual bool setReadEvent(EventResponder *event) { return false; }
+	bool waitForData(unsigned long startMillis);
 	int timedRead();
 	int timedPeek();
 	int peekNextDigit(LookaheadMode lookahead, bool detectDecimal);
+	int findRead(int &avail);
+	// Like read(buffer, length), but stops after the terminator is copied
+	virtual int readUntil(char terminator, uint8_t *buffer, size_t length);
+	int parseTokens(void *values, size_t count, const char *separators, char terminator,
+		int (*store)(const char *token, void *values, size_t index));
 
 	unsigned long _timeout;
   private:
@@ -0,0 +1,77 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef StringBuilder_h
+#define StringBuilder_h
+#ifdef __cplusplus
+
+#include "Print.h"
+
+// StringBuilder assembles a String from text and numbers, with all the
+// formatting of print(), into memory reserved once up front.  Numbers are
+// formatted by Print and appended without any temporary String objects.
+//
+//   StringBuilder json(64);
+//   json.append("{\"temp\":").append(temp, 1).append(",\"id\":").append(id).append('}');
+//   Serial.println(json.str());
+//   String s = json.release();	// take the String, no copying
+//
+class StringBuilder : public Print
+{
+public:
+	StringBuilder(unsigned int size = 0) { if (size) str_.reserve(size); }
+	// When the String can not grow, nothing is written, write() returns 0
+	// and getWriteError() is set
+	virtual size_t write(uint8_t b) { return write(&b, 1); }
+	virtual size_t write(const uint8_t *buffer, size_t size) {
+		unsigned int len = str_.length();
+		if (size == 0) return 0;
+		if (size > ~len || str_.append(StringView((const char *)buffer, size)).length() == len) {
+			setWriteError();
+			return 0;
+		}
+		return size;
+	}
+	using Print::write;
+	// Append anything print() accepts, with an optional base or digits
+	template <typename T> StringBuilder & append(const T &value) { print(value); return *this; }
+	template <typename T> StringBuilder & append(const T &value, int format) { print(value, format); return *this; }
+	const String & str(void) const { return str_; }
+	const char * c_str(void) const { return str_.c_str(); }
+	unsigned int length(void) const { return str_.length(); }
+	void clear(void) { str_ = ""; }
+	// Move the result out, leaving the StringBuilder empty
+	String release(void) { String s; s.move(str_); return s; }
+private:
+	String str_;
+};
+
+#endif // __cplusplus
+#endif // StringBuilder_h
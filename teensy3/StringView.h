@@ -0,0 +1,115 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef StringView_h
+#define StringView_h
+#ifdef __cplusplus
+
+#include <stddef.h>
+#include <string.h>
+
+class String;
+
+// StringView refers to part of a string owned by something else, like a
+// String, a char array or a string literal, without copying it.  It is
+// only a pointer and a length, so taking substrings, trimming and splitting
+// never allocate memory.  The text is not null terminated, and the view is
+// only valid while the original string is unchanged.
+//
+//   char line[64];
+//   Serial.readBytesUntil('\n', line, sizeof(line));
+//   StringView cmd(line);
+//   StringView name = cmd.token();	// "set led 13" -> "set"
+//   if (name == "set") {
+//     StringView what = cmd.token();	// "led"
+//     long pin;
+//     if (cmd.trim().toInt(pin)) ...	// 13
+//   }
+//
+class StringView
+{
+public:
+	constexpr StringView() : ptr(""), len(0) {}
+	constexpr StringView(const char *str, size_t length) : ptr(str), len(length) {}
+	StringView(const char *cstr) : ptr(cstr ? cstr : ""), len(cstr ? strlen(cstr) : 0) {}
+	StringView(const String &str);
+	const char * data() const { return ptr; }
+	size_t length() const { return len; }
+	bool isEmpty() const { return len == 0; }
+	const char * begin() const { return ptr; }
+	const char * end() const { return ptr + len; }
+	char charAt(unsigned int index) const { return index < len ? ptr[index] : 0; }
+	char operator [] (unsigned int index) const { return charAt(index); }
+
+	// search, returns -1 if not found
+	int indexOf(char ch, unsigned int fromIndex = 0) const;
+	int indexOf(const StringView &str, unsigned int fromIndex = 0) const;
+	int lastIndexOf(char ch) const;
+	int lastIndexOf(const StringView &str) const;
+	// same as String::substring, but without copying
+	StringView substring(unsigned int beginIndex) const { return substring(beginIndex, len); }
+	StringView substring(unsigned int beginIndex, unsigned int endIndex) const;
+	StringView trim() const;
+	// remove and return the text before the next separator, or everything
+	// if there is none.  Empty fields are returned, "a,,b" gives 3 fields.
+	StringView split(char separator);
+	// skip separators, then remove and return the next word.  Returns an
+	// empty view when no words remain.
+	StringView token(const char *separators = " \t\r\n");
+
+	// comparison
+	int compareTo(const StringView &str) const;
+	bool equals(const StringView &str) const { return len == str.len && memcmp(ptr, str.ptr, len) == 0; }
+	bool equalsIgnoreCase(const StringView &str) const;
+	bool startsWith(const StringView &prefix) const { return len >= prefix.len && memcmp(ptr, prefix.ptr, prefix.len) == 0; }
+	bool endsWith(const StringView &suffix) const { return len >= suffix.len && memcmp(ptr + len - suffix.len, suffix.ptr, suffix.len) == 0; }
+	friend bool operator == (const StringView &a, const StringView &b) { return a.equals(b); }
+	friend bool operator != (const StringView &a, const StringView &b) { return !a.equals(b); }
+	friend bool operator <  (const StringView &a, const StringView &b) { return a.compareTo(b) < 0; }
+	friend bool operator >  (const StringView &a, const StringView &b) { return a.compareTo(b) > 0; }
+	friend bool operator <= (const StringView &a, const StringView &b) { return a.compareTo(b) <= 0; }
+	friend bool operator >= (const StringView &a, const StringView &b) { return a.compareTo(b) >= 0; }
+
+	// parsing/conversion, same as String::toInt() and toFloat()
+	long toInt() const;
+	float toFloat() const { return toDouble(); }
+	double toDouble() const;
+	// strict parsing: true only if the whole view is a number
+	bool toInt(long &value, int base = 10) const;
+	bool toDouble(double &value) const;
+	bool toFloat(float &value) const;
+
+private:
+	const char *ptr;
+	size_t len;
+};
+
+#endif // __cplusplus
+#endif // StringView_h
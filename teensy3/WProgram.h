@@ -71,6 +71,9 @@
 #include "WCharacter.h"
 #include "WString.h"
 #include "elapsedMillis.h"
+#include "BufferedPrint.h"
+#include "BinaryStream.h"
+#include "StringBuilder.h"
 #include "IntervalTimer.h"
 #include "CrashReport.h"
 
@@ -21,6 +21,9 @@
 
 #include <Arduino.h>
 
+#ifndef STRING_GROW_MIN
+#define STRING_GROW_MIN 16
+#endif
 
 /*********************************************/
 /*  Constructors                             */
@@ -32,6 +35,12 @@ String::String(const char *cstr)
 	if (cstr) copy(cstr, strlen(cstr));
 }
 
+String::String(const StringView &str)
+{
+	init();
+	copy(str.data(), str.length());
+}
+
 String::String(const __FlashStringHelper *pgmstr)
 {
 	init();
@@ -122,13 +131,12 @@ String::String(unsigned long long value, unsigned char base)
 String::String(float num, unsigned char digits)
 {
 	init();
-	char buf[40];
-	*this = dtostrf(num, digits + 2, digits, buf);
+	appendFloat(num, digits);
 }
 
 String::~String()
 {
-	free(buffer);
+	if (!isInline) free(heap.buffer);
 }
 
 /*********************************************/
@@ -137,33 +145,82 @@ String::~String()
 
 inline void String::init(void)
 {
-	buffer = NULL;
-	capacity = 0;
+	heap.buffer = NULL;
+	heap.capacity = 0;
 	len = 0;
-	//flags = 0;
+	isInline = 0;
 }
 
 unsigned char String::reserve(unsigned int size)
 {
-	if (capacity >= size) return 1;
+	if (capacity() >= size) return 1;
 	if (changeBuffer(size)) {
-		if (len == 0) buffer[0] = 0;
+		if (len == 0) buffer()[0] = 0;
 		return 1;
 	}
 	return 0;
 }
 
-unsigned char String::changeBuffer(unsigned int maxStrLen)
+// appending grows the buffer by 1.5X (at least STRING_GROW_MIN bytes), so
+// building a String one piece at a time does not realloc on every append.
+// A String which still fits in sso[] stays there.  reserve() still
+// allocates exactly the requested size.
+unsigned char String::grow(unsigned int size)
 {
-	char *newbuffer = (char *)realloc(buffer, maxStrLen + 1);
-	if (newbuffer) {
-		buffer = newbuffer;
-		capacity = maxStrLen;
+	unsigned int cap = capacity();
+	if (cap >= size) return 1;
+	unsigned int newcap = cap + (cap >> 1);
+	if (newcap < cap + STRING_GROW_MIN) newcap = cap + STRING_GROW_MIN;
+	if (newcap < size || size < sizeof(sso)) newcap = size;
+	if (changeBuffer(newcap) || changeBuffer(size)) {
+		if (len == 0) buffer()[0] = 0;
 		return 1;
 	}
 	return 0;
 }
 
+void String::shrink_to_fit(void)
+{
+	if (!isInline && heap.buffer && heap.capacity > len) changeBuffer(len);
+}
+
+#ifdef STRING_DEBUG
+unsigned int String::reallocCount = 0;
+#endif
+
+// short strings live in the inline sso[] array, only longer ones use the heap
+unsigned char String::changeBuffer(unsigned int maxStrLen)
+{
+	if (maxStrLen < sizeof(sso)) {
+		if (!isInline) {
+			char *old = heap.buffer;
+			if (old) {
+				memcpy(sso, old, len + 1);
+				free(old);
+			}
+			isInline = 1;
+		}
+		return 1;
+	}
+	if (maxStrLen >= 0x80000000u) return 0; // len is 31 bits
+	#ifdef STRING_DEBUG
+	reallocCount++;
+	#endif
+	char *newbuffer;
+	if (isInline) {
+		newbuffer = (char *)malloc(maxStrLen + 1);
+		if (!newbuffer) return 0;
+		memcpy(newbuffer, sso, sizeof(sso));
+		isInline = 0;
+	} else {
+		newbuffer = (char *)realloc(heap.buffer, maxStrLen + 1);
+		if (!newbuffer) return 0;
+	}
+	heap.buffer = newbuffer;
+	heap.capacity = maxStrLen;
+	return 1;
+}
+
 /*********************************************/
 /*  Copy and Move                            */
 /*********************************************/
@@ -171,39 +228,39 @@ unsigned char String::changeBuffer(unsigned int maxStrLen)
 String & String::copy(const char *cstr, unsigned int length)
 {
 	if (length == 0) {
-		if (buffer) buffer[0] = 0;
+		if (buffer()) buffer()[0] = 0;
 		len = 0;
 		return *this;
 	}
 	if (!reserve(length)) {
-		if (buffer) {
-			free(buffer);
-			buffer = NULL;
-		}
-		len = capacity = 0;
+		if (!isInline) free(heap.buffer);
+		init();
 		return *this;
 	}
 	len = length;
-	strcpy(buffer, cstr);
+	memmove(buffer(), cstr, length);
+	buffer()[length] = 0;
 	return *this;
 }
 
 void String::move(String &rhs)
 {
 	if (&rhs == this) return;
-	if (buffer) free(buffer);
-	buffer = rhs.buffer;
-	capacity = rhs.capacity;
+	if (!isInline) free(heap.buffer);
+	if (rhs.isInline) {
+		memcpy(sso, rhs.sso, sizeof(sso));
+	} else {
+		heap = rhs.heap;
+	}
 	len = rhs.len;
-	rhs.buffer = NULL;
-	rhs.capacity = 0;
-	rhs.len = 0;
+	isInline = rhs.isInline;
+	rhs.init();
 }
 
 String & String::operator = (const String &rhs)
 {
 	if (this == &rhs) return *this;
-	return copy(rhs.buffer, rhs.len);
+	return copy(rhs.buffer(), rhs.len);
 }
 
 #if __cplusplus >= 201103L || defined(__GXX_EXPERIMENTAL_CXX0X__)
@@ -250,25 +307,24 @@ String & String::operator = (char c)
 
 String & String::append(const String &s)
 {
-	return append(s.buffer, s.len);
+	return append(s.buffer(), s.len);
 }
 
 String & String::append(const char *cstr, unsigned int length)
 {
-	unsigned int newlen = len + length;
-	bool self = false;
-	unsigned int buffer_offset; 
-	if ( (cstr >= buffer) && (cstr < (buffer+len) ) ) {
-		self = true;
-		buffer_offset = (unsigned int)(cstr-buffer);
+	unsigned int oldlen = len, newlen = oldlen + length;
+	char *buf = buffer();
+	if (length == 0) return *this;
+	if (newlen > capacity()) {
+		// appending part of this String, which grow() may move
+		bool self = (cstr >= buf) && (cstr < buf + oldlen);
+		unsigned int offset = cstr - buf;
+		if (!grow(newlen)) return *this;
+		buf = buffer();
+		if (self) cstr = buf + offset;
 	}
-	if (length == 0 || !reserve(newlen)) return *this;
-	if ( self ) {
-		memcpy(buffer + len, buffer+buffer_offset, length);
-		buffer[newlen] = 0;
-		}
-	else
-		strcpy(buffer + len, cstr);
+	memcpy(buf + oldlen, cstr, length);
+	buf[newlen] = 0;
 	len = newlen;
 	return *this;
 }
@@ -290,60 +346,60 @@ String & String::append(char c)
 
 String & String::append(int num)
 {
-	char buf[12];
-	ltoa((long)num, buf, 10);
-	append(buf, strlen(buf));
-	return *this;
+	return append((long)num);
 }
 
 String & String::append(unsigned int num)
 {
-	char buf[11];
-	ultoa((unsigned long)num, buf, 10);
-	append(buf, strlen(buf));
-	return *this;
+	return append((unsigned long)num);
 }
 
 String & String::append(long num)
 {
-	char buf[12];
-	ltoa(num, buf, 10);
-	append(buf, strlen(buf));
-	return *this;
+	char buf[11], *end = buf + sizeof(buf);
+	char *p = ultoa_end((num < 0) ? 0 - (unsigned long)num : (unsigned long)num, end, 10);
+	if (num < 0) *--p = '-';
+	return append(p, end - p);
 }
 
 String & String::append(unsigned long num)
 {
-	char buf[11];
-	ultoa(num, buf, 10);
-	append(buf, strlen(buf));
-	return *this;
+	char buf[10], *end = buf + sizeof(buf);
+	char *p = ultoa_end(num, end, 10);
+	return append(p, end - p);
 }
 
 String & String::append(long long num)
 {
-	char buf[22];
-	lltoa(num, buf, 10);
-	append(buf, strlen(buf));
-	return *this;
+	char buf[20], *end = buf + sizeof(buf);
+	char *p = ulltoa_end((num < 0) ? 0 - (unsigned long long)num : (unsigned long long)num, end, 10);
+	if (num < 0) *--p = '-';
+	return append(p, end - p);
 }
 
 String & String::append(unsigned long long num)
 {
-	char buf[21];
-	ulltoa(num, buf, 10);
-	append(buf, strlen(buf));
-	return *this;
+	char buf[20], *end = buf + sizeof(buf);
+	char *p = ulltoa_end(num, end, 10);
+	return append(p, end - p);
 }
 
 String & String::append(float num)
 {
-	char buf[30];
-	dtostrf(num, 4, 2, buf); 
-	append(buf, strlen(buf));
+	appendFloat(num, 2);
 	return *this;
 }
 
+void String::appendFloatWrite(void *arg, const char *s, size_t len)
+{
+	((String *)arg)->append(s, len);
+}
+
+void String::appendFloat(float num, int digits)
+{
+	dtostrw(num, digits, DTOSTR_FLOAT, appendFloatWrite, this);
+}
+
 
 /*********************************************/
 /*  Concatenate                              */
@@ -353,7 +409,7 @@ String & String::append(float num)
 StringSumHelper & operator + (const StringSumHelper &lhs, const String &rhs)
 {
 	StringSumHelper &a = const_cast<StringSumHelper&>(lhs);
-	a.append(rhs.buffer, rhs.len);
+	a.append(rhs.buffer(), rhs.len);
 	return a;
 }
 
@@ -371,6 +427,13 @@ StringSumHelper & operator + (const StringSumHelper &lhs, const __FlashStringHel
 	return a;
 }
 
+StringSumHelper & operator + (const StringSumHelper &lhs, const StringView &str)
+{
+	StringSumHelper &a = const_cast<StringSumHelper&>(lhs);
+	a.append(str.data(), str.length());
+	return a;
+}
+
 StringSumHelper & operator + (const StringSumHelper &lhs, char c)
 {
 	StringSumHelper &a = const_cast<StringSumHelper&>(lhs);
@@ -447,12 +510,12 @@ StringSumHelper & operator + (const StringSumHelper &lhs, double num)
 
 int String::compareTo(const String &s) const
 {
-	if (!buffer || !s.buffer) {
-		if (s.buffer && s.len > 0) return 0 - *(unsigned char *)s.buffer;
-		if (buffer && len > 0) return *(unsigned char *)buffer;
+	if (!buffer() || !s.buffer()) {
+		if (s.buffer() && s.len > 0) return 0 - *(unsigned char *)s.buffer();
+		if (buffer() && len > 0) return *(unsigned char *)buffer();
 		return 0;
 	}
-	return strcmp(buffer, s.buffer);
+	return strcmp(buffer(), s.buffer());
 }
 
 unsigned char String::equals(const String &s2) const
@@ -463,8 +526,8 @@ unsigned char String::equals(const String &s2) const
 unsigned char String::equals(const char *cstr) const
 {
 	if (len == 0) return (cstr == NULL || *cstr == 0);
-	if (cstr == NULL) return buffer[0] == 0;
-	return strcmp(buffer, cstr) == 0;
+	if (cstr == NULL) return buffer()[0] == 0;
+	return strcmp(buffer(), cstr) == 0;
 }
 
 unsigned char String::operator<(const String &rhs) const
@@ -492,8 +555,8 @@ unsigned char String::equalsIgnoreCase( const String &s2 ) const
 	if (this == &s2) return 1;
 	if (len != s2.len) return 0;
 	if (len == 0) return 1;
-	const char *p1 = buffer;
-	const char *p2 = s2.buffer;
+	const char *p1 = buffer();
+	const char *p2 = s2.buffer();
 	while (*p1) {
 		if (tolower(*p1++) != tolower(*p2++)) return 0;
 	} 
@@ -508,14 +571,14 @@ unsigned char String::startsWith( const String &s2 ) const
 
 unsigned char String::startsWith( const String &s2, unsigned int offset ) const
 {
-	if (offset > len - s2.len || !buffer || !s2.buffer) return 0;
-	return strncmp( &buffer[offset], s2.buffer, s2.len ) == 0;
+	if (offset > len - s2.len || !buffer() || !s2.buffer()) return 0;
+	return strncmp( &buffer()[offset], s2.buffer(), s2.len ) == 0;
 }
 
 unsigned char String::endsWith( const String &s2 ) const
 {
-	if ( len < s2.len || !buffer || !s2.buffer) return 0;
-	return strcmp(&buffer[len - s2.len], s2.buffer) == 0;
+	if ( len < s2.len || !buffer() || !s2.buffer()) return 0;
+	return strcmp(&buffer()[len - s2.len], s2.buffer()) == 0;
 }
 
 /*********************************************/
@@ -531,23 +594,23 @@ char String::charAt(unsigned int loc) const
 
 void String::setCharAt(unsigned int loc, char c) 
 {
-	if (loc < len) buffer[loc] = c;
+	if (loc < len) buffer()[loc] = c;
 }
 
 char & String::operator[](unsigned int index)
 {
 	static char dummy_writable_char;
-	if (index >= len || !buffer) {
+	if (index >= len || !buffer()) {
 		dummy_writable_char = 0;
 		return dummy_writable_char;
 	}
-	return buffer[index];
+	return buffer()[index];
 }
 
 char String::operator[]( unsigned int index ) const
 {
-	if (index >= len || !buffer) return 0;
-	return buffer[index];
+	if (index >= len || !buffer()) return 0;
+	return buffer()[index];
 }
 
 void String::getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index) const
@@ -559,7 +622,7 @@ void String::getBytes(unsigned char *buf, unsigned int bufsize, unsigned int ind
 	}
 	unsigned int n = bufsize - 1;
 	if (n > len - index) n = len - index;
-	strncpy((char *)buf, buffer + index, n);
+	strncpy((char *)buf, buffer() + index, n);
 	buf[n] = 0;
 }
 
@@ -575,9 +638,9 @@ int String::indexOf(char c) const
 int String::indexOf( char ch, unsigned int fromIndex ) const
 {
 	if (fromIndex >= len) return -1;
-	const char* temp = strchr(buffer + fromIndex, ch);
+	const char* temp = strchr(buffer() + fromIndex, ch);
 	if (temp == NULL) return -1;
-	return temp - buffer;
+	return temp - buffer();
 }
 
 int String::indexOf(const String &s2) const
@@ -588,9 +651,9 @@ int String::indexOf(const String &s2) const
 int String::indexOf(const String &s2, unsigned int fromIndex) const
 {
 	if (fromIndex >= len) return -1;
-	const char *found = strstr(buffer + fromIndex, s2.buffer);
+	const char *found = strstr(buffer() + fromIndex, s2.buffer());
 	if (found == NULL) return -1;
-	return found - buffer;
+	return found - buffer();
 }
 
 int String::lastIndexOf( char theChar ) const
@@ -601,12 +664,12 @@ int String::lastIndexOf( char theChar ) const
 int String::lastIndexOf(char ch, unsigned int fromIndex) const
 {
 	if (fromIndex >= len) return -1;
-	char tempchar = buffer[fromIndex + 1];
-	buffer[fromIndex + 1] = '\0';
-	char* temp = strrchr( buffer, ch );
-	buffer[fromIndex + 1] = tempchar;
+	char tempchar = buffer()[fromIndex + 1];
+	buffer()[fromIndex + 1] = '\0';
+	char* temp = strrchr( buffer(), ch );
+	buffer()[fromIndex + 1] = tempchar;
 	if (temp == NULL) return -1;
-	return temp - buffer;
+	return temp - buffer();
 }
 
 int String::lastIndexOf(const String &s2) const
@@ -619,10 +682,10 @@ int String::lastIndexOf(const String &s2, unsigned int fromIndex) const
   	if (s2.len == 0 || len == 0 || s2.len > len) return -1;
 	if (fromIndex >= len) fromIndex = len - 1;
 	int found = -1;
-	for (char *p = buffer; p <= buffer + fromIndex; p++) {
-		p = strstr(p, s2.buffer);
+	for (char *p = buffer(); p <= buffer() + fromIndex; p++) {
+		p = strstr(p, s2.buffer());
 		if (!p) break;
-		if ((unsigned int)(p - buffer) <= fromIndex) found = p - buffer;
+		if ((unsigned int)(p - buffer()) <= fromIndex) found = p - buffer();
 	}
 	return found;
 }
@@ -642,10 +705,10 @@ String String::substring(unsigned int left, unsigned int right) const
 	String out;
 	if (left > len) return out;
 	if (right > len) right = len;
-	char temp = buffer[right];  // save the replaced character
-	buffer[right] = '\0';	
-	out = buffer + left;  // pointer arithmetic
-	buffer[right] = temp;  //restore character
+	char temp = buffer()[right];  // save the replaced character
+	buffer()[right] = '\0';	
+	out = buffer() + left;  // pointer arithmetic
+	buffer()[right] = temp;  //restore character
 	return out;
 }
 
@@ -655,54 +718,97 @@ String String::substring(unsigned int left, unsigned int right) const
 
 String & String::replace(char find, char replace)
 {
-	if (!buffer) return *this;
-	for (char *p = buffer; *p; p++) {
+	if (!buffer()) return *this;
+	for (char *p = buffer(); *p; p++) {
 		if (*p == find) *p = replace;
 	}
 	return *this;
 }
 
+// number of match positions replace() remembers, so it doesn't search twice
+#ifndef STRING_REPLACE_MATCHES
+#define STRING_REPLACE_MATCHES 16
+#endif
+
 String & String::replace(const String& find, const String& replace)
 {
 	if (len == 0 || find.len == 0) return *this;
+	if (this == &find || this == &replace) {
+		String copy(*this);
+		return String::replace((this == &find) ? copy : find, (this == &replace) ? copy : replace);
+	}
 	int diff = replace.len - find.len;
-	char *readFrom = buffer;
-	char *foundAt;
-	if (diff == 0) {
-		while ((foundAt = strstr(readFrom, find.buffer)) != NULL) {
-			memcpy(foundAt, replace.buffer, replace.len);
-			readFrom = foundAt + replace.len;
-		}
-	} else if (diff < 0) {
-		char *writeTo = buffer;
-		while ((foundAt = strstr(readFrom, find.buffer)) != NULL) {
+	const char *readFrom = buffer();
+	const char *end = buffer() + len;
+	const char *foundAt;
+	if (diff <= 0) {
+		// result is not longer, so build it in place
+		char *writeTo = buffer();
+		while ((foundAt = (const char *)memmem(readFrom, end - readFrom, find.buffer(), find.len)) != NULL) {
 			unsigned int n = foundAt - readFrom;
-			memcpy(writeTo, readFrom, n);
+			memmove(writeTo, readFrom, n);
 			writeTo += n;
-			memcpy(writeTo, replace.buffer, replace.len);
+			memcpy(writeTo, replace.c_str(), replace.len);
 			writeTo += replace.len;
 			readFrom = foundAt + find.len;
-			len += diff;
 		}
-		strcpy(writeTo, readFrom);
+		if (readFrom == buffer()) return *this;
+		memmove(writeTo, readFrom, end - readFrom);
+		len = (writeTo - buffer()) + (end - readFrom);
+		buffer()[len] = 0;
+		return *this;
+	}
+	// count the matches, remembering where the first ones are
+	unsigned int match[STRING_REPLACE_MATCHES];
+	unsigned int count = 0;
+	while ((foundAt = (const char *)memmem(readFrom, end - readFrom, find.buffer(), find.len)) != NULL) {
+		if (count < STRING_REPLACE_MATCHES) match[count] = foundAt - buffer();
+		count++;
+		readFrom = foundAt + find.len;
+	}
+	if (count == 0) return *this;
+	unsigned int size = len + count * diff;
+	char *src, *dst;
+	if (size <= capacity()) {
+		// move the original to the end of the buffer, then build the
+		// result from the start.  Writing never passes reading.
+		src = buffer() + size - len;
+		memmove(src, buffer(), len);
+		dst = buffer();
 	} else {
-		unsigned int size = len; // compute size needed for result
-		while ((foundAt = strstr(readFrom, find.buffer)) != NULL) {
-			readFrom = foundAt + find.len;
-			size += diff;
-		}
-		if (size == len) return *this;
-		if (size > capacity && !changeBuffer(size)) return *this;
-		int index = len - 1;
-		while (index >= 0 && (index = lastIndexOf(find, index)) >= 0) {
-			readFrom = buffer + index + find.len;
-			memmove(readFrom + diff, readFrom, len - (readFrom - buffer));
-			len += diff;
-			buffer[len] = 0;
-			memcpy(buffer + index, replace.buffer, replace.len);
-			index--;
+		// copy to a new buffer of exactly the right size
+		#ifdef STRING_DEBUG
+		reallocCount++;
+		#endif
+		dst = (char *)malloc(size + 1);
+		if (!dst) return *this;
+		src = buffer();
+	}
+	char *writeTo = dst;
+	readFrom = src;
+	end = src + len;
+	for (unsigned int i=0; i < count; i++) {
+		if (i < STRING_REPLACE_MATCHES) {
+			foundAt = src + match[i];
+		} else {
+			foundAt = (const char *)memmem(readFrom, end - readFrom, find.buffer(), find.len);
 		}
+		unsigned int n = foundAt - readFrom;
+		memmove(writeTo, readFrom, n);
+		writeTo += n;
+		memcpy(writeTo, replace.c_str(), replace.len);
+		writeTo += replace.len;
+		readFrom = foundAt + find.len;
+	}
+	memmove(writeTo, readFrom, end - readFrom);
+	if (dst != buffer()) {
+		if (!isInline) free(heap.buffer);
+		heap.buffer = dst;
+		heap.capacity = size;
+		isInline = 0;
 	}
+	len = size;
+	buffer()[len] = 0;
 	return *this;
 }
 
@@ -710,7 +816,7 @@ String & String::remove(unsigned int index)
 {
 	if (index < len) {
 		len = index;
-		buffer[len] = 0;
+		buffer()[len] = 0;
 	}
 	return *this;
 }
@@ -720,16 +826,16 @@ String & String::remove(unsigned int index, unsigned int count)
 	if (index < len && count > 0) {
   		if (index + count > len) count = len - index;
 		len = len - count;
-		memmove(buffer + index, buffer + index + count, len - index);
-		buffer[len] = 0;
+		memmove(buffer() + index, buffer() + index + count, len - index);
+		buffer()[len] = 0;
 	}
 	return *this;
 }
 
 String & String::toLowerCase(void)
 {
-	if (!buffer) return *this;
-	for (char *p = buffer; *p; p++) {
+	if (!buffer()) return *this;
+	for (char *p = buffer(); *p; p++) {
 		*p = tolower(*p);
 	}
 	return *this;
@@ -737,8 +843,8 @@ String & String::toLowerCase(void)
 
 String & String::toUpperCase(void)
 {
-	if (!buffer) return *this;
-	for (char *p = buffer; *p; p++) {
+	if (!buffer()) return *this;
+	for (char *p = buffer(); *p; p++) {
 		*p = toupper(*p);
 	}
 	return *this;
@@ -746,14 +852,14 @@ String & String::toUpperCase(void)
 
 String & String::trim(void)
 {
-	if (!buffer || len == 0) return *this;
-	char *begin = buffer;
+	if (!buffer() || len == 0) return *this;
+	char *begin = buffer();
 	while (isspace(*begin)) begin++;
-	char *end = buffer + len - 1;
+	char *end = buffer() + len - 1;
 	while (isspace(*end) && end >= begin) end--;
 	len = end + 1 - begin;
-	if (begin > buffer) memcpy(buffer, begin, len);
-	buffer[len] = 0;
+	if (begin > buffer()) memcpy(buffer(), begin, len);
+	buffer()[len] = 0;
 	return *this;
 }
 
@@ -763,13 +869,13 @@ String & String::trim(void)
 
 long String::toInt(void) const
 {
-	if (buffer) return atol(buffer);
+	if (buffer()) return atol(buffer());
 	return 0;
 }
 
 float String::toFloat(void) const
 {
-	if (buffer) return strtof(buffer, (char **)NULL);
+	if (buffer()) return strtof(buffer(), (char **)NULL);
 	return 0.0;
 }
 
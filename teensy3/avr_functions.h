@@ -32,6 +32,7 @@
 #define _avr_functions_h_
 
 #include <inttypes.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -96,6 +97,10 @@ char * ultoa(unsigned long val, char *buf, int radix);
 char * ltoa(long val, char *buf, int radix);
 char * ulltoa(unsigned long long val, char *buf, int radix);
 char * lltoa(long long val, char *buf, int radix);
+// Convert to ASCII backwards, with the last digit just before "end" and no
+// null terminator.  Returns a pointer to the first digit.
+char * ultoa_end(unsigned long val, char *end, int radix);
+char * ulltoa_end(unsigned long long val, char *end, int radix);
 
 /* #if defined(__STRICT_ANSI__) || (defined(_NEWLIB_VERSION) && (__NEWLIB__ < 2 || __NEWLIB__ == 2 && __NEWLIB_MINOR__ < 2))
 static inline char * utoa(unsigned int val, char *buf, int radix) __attribute__((always_inline, unused));
@@ -105,6 +110,21 @@ static inline char * itoa(int val, char *buf, int radix) { return ltoa(val, buf,
 #endif */
 
 char * dtostrf(float val, int width, unsigned int precision, char *buf);
+#define DTOSTR_ALWAYS_SIGN 0x01	// space before positive numbers
+#define DTOSTR_PLUS_SIGN   0x02	// plus sign before positive numbers
+#define DTOSTR_UPPERCASE   0x04	// E, INF and NAN
+#define DTOSTR_EXPONENT    0x08	// dtostrn: d.ddde+xx rather than ddd.ddd
+#define DTOSTR_FLOAT       0x10	// dtostrn: value is a float, negative precision gives float digits
+char * dtostre(double val, char *buf, unsigned char precision, unsigned char flags);
+// Convert to text with "precision" digits after the decimal point.  Negative
+// precision gives the fewest digits which convert back to exactly the same
+// number.  Digits for a given precision are correctly rounded, ties to even.
+// Like snprintf, writes at most size bytes and returns the full length.
+int dtostrn(double val, char *buf, size_t size, int precision, unsigned int flags);
+// Same as dtostrn, but the text is given to "write" in pieces, so there is
+// no limit to its length.  Returns the full length.
+typedef void (*dtostr_write_t)(void *arg, const char *s, size_t len);
+size_t dtostrw(double val, int precision, unsigned int flags, dtostr_write_t write, void *arg);
 
 
 #ifdef __cplusplus
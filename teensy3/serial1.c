@@ -31,8 +31,14 @@
 #include "kinetis.h"
 #include "core_pins.h"
 #include "HardwareSerial.h"
+#include "serial_uart.h"
 #include <stddef.h>
 
+// 9 bit formats on Serial1 only, see HardwareSerial.h
+#if defined(SERIAL1_9BIT_SUPPORT) && !defined(SERIAL_9BIT_SUPPORT)
+#define SERIAL_9BIT_SUPPORT
+#endif
+
 ////////////////////////////////////////////////////////////////
 // Tunable parameters (relatively safe to edit these numbers)
 ////////////////////////////////////////////////////////////////
@@ -46,7 +52,208 @@
 #define RTS_HIGH_WATERMARK (SERIAL1_RX_BUFFER_SIZE-24) // RTS requests sender to pause
 #define RTS_LOW_WATERMARK  (SERIAL1_RX_BUFFER_SIZE-38) // RTS allows sender to resume
 #define IRQ_PRIORITY  64  // 0 = highest priority, 255 = lowest
+#ifndef SERIAL1_TX_FIFO_WATERMARK
+#define SERIAL1_TX_FIFO_WATERMARK  2 // FIFO only: TDRE interrupt at or below this many bytes
+#endif
+#ifndef SERIAL1_RX_FIFO_WATERMARK
+#define SERIAL1_RX_FIFO_WATERMARK  4 // FIFO only: RDRF interrupt at or above this many bytes
+#endif
+
+
+#if defined(KINETISK)
+
+#ifdef SERIAL_9BIT_SUPPORT
+#define BUFTYPE uint16_t
+#else
+#define BUFTYPE uint8_t
+#endif
+
+static volatile BUFTYPE tx_buffer[SERIAL1_TX_BUFFER_SIZE];
+static volatile BUFTYPE rx_buffer[SERIAL1_RX_BUFFER_SIZE];
+
+static const uint8_t rx_pins[] = {
+	0, 21,
+#if defined(__MK64FX512__) || defined(__MK66FX1M0__)
+	27,
+#endif
+};
+static const uint8_t tx_pins[] = {
+	1, 5,
+#if defined(__MK64FX512__) || defined(__MK66FX1M0__)
+	26,
+#endif
+};
+static const uint8_t cts_pins[] = {
+	18, 20,
+};
+
+static serial_uart_state_t state = {
+	.rx_total_size = SERIAL1_RX_BUFFER_SIZE,
+	.tx_total_size = SERIAL1_TX_BUFFER_SIZE,
+	.rts_low_watermark = RTS_LOW_WATERMARK,
+	.rts_high_watermark = RTS_HIGH_WATERMARK,
+	.rx_pin_num = 0,
+	.tx_pin_num = 1,
+};
+
+static void dma_rx_isr(void);
+static void dma_tx_isr(void);
+
+const serial_uart_t serial1_uart = {
+	.uart = &KINETISK_UART0,
+	.clock_gate = &SIM_SCGC4,
+	.clock_mask = SIM_SCGC4_UART0,
+	.irq = IRQ_UART0_STATUS,
+	.irq_error = IRQ_UART0_ERROR,
+	.irq_priority = IRQ_PRIORITY,
+#ifdef HAS_KINETISK_UART0_FIFO
+	.fifo = 1,
+	.tx_watermark = SERIAL1_TX_FIFO_WATERMARK,
+	.rx_watermark = SERIAL1_RX_FIFO_WATERMARK,
+#endif
+#ifdef SERIAL_9BIT_SUPPORT
+	.wide = 1,
+#endif
+	.rx_pin_count = sizeof(rx_pins),
+	.tx_pin_count = sizeof(tx_pins),
+	.cts_pin_count = sizeof(cts_pins),
+	.rx_pins = rx_pins,
+	.tx_pins = tx_pins,
+	.cts_pins = cts_pins,
+	.rts_low_offset = SERIAL1_RX_BUFFER_SIZE - RTS_LOW_WATERMARK,
+	.rts_high_offset = SERIAL1_RX_BUFFER_SIZE - RTS_HIGH_WATERMARK,
+	.rx_buffer = rx_buffer,
+	.tx_buffer = tx_buffer,
+	.rx_buffer_size = SERIAL1_RX_BUFFER_SIZE,
+	.tx_buffer_size = SERIAL1_TX_BUFFER_SIZE,
+	.dma_rx_source = DMAMUX_SOURCE_UART0_RX,
+	.dma_tx_source = DMAMUX_SOURCE_UART0_TX,
+	.dma_rx_isr = dma_rx_isr,
+	.dma_tx_isr = dma_tx_isr,
+	.state = &state,
+};
+
+void serial_begin(uint32_t divisor)
+{
+	serial_uart_begin(&serial1_uart, divisor);
+}
+
+void serial_format(uint32_t format)
+{
+	serial_uart_format(&serial1_uart, format);
+}
 
+void serial_end(void)
+{
+	serial_uart_end(&serial1_uart);
+}
+
+void serial_set_transmit_pin(uint8_t pin)
+{
+	serial_uart_set_transmit_pin(&serial1_uart, pin);
+}
+
+void serial_set_tx(uint8_t pin, uint8_t opendrain)
+{
+	serial_uart_set_tx(&serial1_uart, pin, opendrain);
+}
+
+void serial_set_rx(uint8_t pin)
+{
+	serial_uart_set_rx(&serial1_uart, pin);
+}
+
+int serial_set_rts(uint8_t pin)
+{
+	return serial_uart_set_rts(&serial1_uart, pin);
+}
+
+int serial_set_cts(uint8_t pin)
+{
+	return serial_uart_set_cts(&serial1_uart, pin);
+}
+
+void serial_putchar(uint32_t c)
+{
+	serial_uart_putchar(&serial1_uart, c);
+}
+
+void serial_write(const void *buf, unsigned int count)
+{
+	serial_uart_write(&serial1_uart, buf, count);
+}
+
+void serial_flush(void)
+{
+	serial_uart_flush(&serial1_uart);
+}
+
+int serial_write_buffer_free(void)
+{
+	return serial_uart_write_buffer_free(&serial1_uart);
+}
+
+int serial_available(void)
+{
+	return serial_uart_available(&serial1_uart);
+}
+
+int serial_getchar(void)
+{
+	return serial_uart_getchar(&serial1_uart);
+}
+
+int serial_read(void *buf, unsigned int count)
+{
+	return serial_uart_read(&serial1_uart, buf, count);
+}
+
+int serial_peek(void)
+{
+	return serial_uart_peek(&serial1_uart);
+}
+
+void serial_clear(void)
+{
+	serial_uart_clear(&serial1_uart);
+}
+
+void serial_add_memory_for_read(void *buffer, size_t length)
+{
+	serial_uart_add_memory_for_read(&serial1_uart, buffer, length);
+}
+
+void serial_add_memory_for_write(void *buffer, size_t length)
+{
+	serial_uart_add_memory_for_write(&serial1_uart, buffer, length);
+}
+
+int serial_set_dma(uint8_t rx, uint8_t tx)
+{
+	return serial_uart_set_dma(&serial1_uart, rx, tx);
+}
+
+void uart0_status_isr(void)
+{
+	serial_uart_isr(&serial1_uart);
+}
+
+void uart0_error_isr(void)
+{
+	serial_uart_isr(&serial1_uart);
+}
+
+static void dma_rx_isr(void)
+{
+	serial_uart_dma_rx_isr(&serial1_uart);
+}
+
+static void dma_tx_isr(void)
+{
+	serial_uart_dma_tx_isr(&serial1_uart);
+}
+
+#elif defined(KINETISL)
 
 ////////////////////////////////////////////////////////////////
 // changes not recommended below this point....
@@ -71,14 +278,6 @@ static size_t rts_low_watermark_ = RTS_LOW_WATERMARK;
 static size_t rts_high_watermark_ = RTS_HIGH_WATERMARK;
 
 static volatile uint8_t transmitting = 0;
-#if defined(KINETISK)
-  static volatile uint8_t *transmit_pin=NULL;
-  #define transmit_assert()   *transmit_pin = 1
-  #define transmit_deassert() *transmit_pin = 0
-  static volatile uint8_t *rts_pin=NULL;
-  #define rts_assert()        *rts_pin = 0
-  #define rts_deassert()      *rts_pin = 1
-#elif defined(KINETISL)
   static volatile uint8_t *transmit_pin=NULL;
   static uint8_t transmit_mask=0;
   #define transmit_assert()   *(transmit_pin+4) = transmit_mask;
@@ -87,7 +286,6 @@ static volatile uint8_t transmitting = 0;
   static uint8_t rts_mask=0;
   #define rts_assert()        *(rts_pin+8) = rts_mask;
   #define rts_deassert()      *(rts_pin+4) = rts_mask;
-#endif
 #if SERIAL1_TX_BUFFER_SIZE > 65535
 static volatile uint32_t tx_buffer_head = 0;
 static volatile uint32_t tx_buffer_tail = 0;
@@ -110,18 +308,12 @@ static volatile uint8_t rx_buffer_tail = 0;
 #endif
 static uint8_t rx_pin_num = 0;
 static uint8_t tx_pin_num = 1;
-#if defined(KINETISL)
 static uint8_t half_duplex_mode = 0;
-#endif
 
 // UART0 and UART1 are clocked by F_CPU, UART2 is clocked by F_BUS
 // UART0 has 8 byte fifo, UART1 and UART2 have 1 byte buffer
 
-#ifdef HAS_KINETISK_UART0_FIFO
-#define C2_ENABLE		UART_C2_TE | UART_C2_RE | UART_C2_RIE | UART_C2_ILIE
-#else
 #define C2_ENABLE		UART_C2_TE | UART_C2_RE | UART_C2_RIE
-#endif
 #define C2_TX_ACTIVE		C2_ENABLE | UART_C2_TIE
 #define C2_TX_COMPLETING	C2_ENABLE | UART_C2_TCIE
 #define C2_TX_INACTIVE		C2_ENABLE
@@ -143,45 +335,19 @@ void serial_begin(uint32_t divisor)
 	switch (rx_pin_num) {
 		case 0:  CORE_PIN0_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(3); break;
 		case 21: CORE_PIN21_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(3); break;
-		#if defined(KINETISL)
 		case 3:  CORE_PIN3_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(2); break;
 		case 25: CORE_PIN25_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(4); break;
-		#endif
-		#if defined(__MK64FX512__) || defined(__MK66FX1M0__)
-		case 27: CORE_PIN27_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(3); break;
-		#endif
 	}
 	switch (tx_pin_num) {
 		case 1:  CORE_PIN1_CONFIG = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(3); break;
 		case 5:  CORE_PIN5_CONFIG = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(3); break;
-		#if defined(KINETISL)
 		case 4:  CORE_PIN4_CONFIG = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(2); break;
 		case 24: CORE_PIN24_CONFIG = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(4); break;
-		#endif
-		#if defined(__MK64FX512__) || defined(__MK66FX1M0__)
-		case 26: CORE_PIN26_CONFIG = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(3); break;
-		#endif
 	}
-#if defined(HAS_KINETISK_UART0)
-	if (divisor < 32) divisor = 32;
-	UART0_BDH = (divisor >> 13) & 0x1F;
-	UART0_BDL = (divisor >> 5) & 0xFF;
-	UART0_C4 = divisor & 0x1F;
-#ifdef HAS_KINETISK_UART0_FIFO
-	UART0_C1 = UART_C1_ILT;
-	UART0_TWFIFO = 2; // tx watermark, causes S1_TDRE to set
-	UART0_RWFIFO = 4; // rx watermark, causes S1_RDRF to set
-	UART0_PFIFO = UART_PFIFO_TXFE | UART_PFIFO_RXFE;
-#else
-	UART0_C1 = 0;
-	UART0_PFIFO = 0;
-#endif
-#elif defined(HAS_KINETISL_UART0)
 	if (divisor < 1) divisor = 1;
 	UART0_BDH = (divisor >> 8) & 0x1F;
 	UART0_BDL = divisor & 0xFF;
 	UART0_C1 = 0;
-#endif
 	UART0_C2 = C2_TX_INACTIVE;
 	NVIC_SET_PRIORITY(IRQ_UART0_STATUS, IRQ_PRIORITY);
 	NVIC_ENABLE_IRQ(IRQ_UART0_STATUS);
@@ -191,6 +357,10 @@ void serial_format(uint32_t format)
 {
 	uint8_t c;
 
+#ifndef SERIAL_9BIT_SUPPORT
+	// 9 bit data needs 16 bit buffers, so fall back to the 8 bit format
+	if (format & 0x80) format &= (format & 0x08) ? ~0x88 : ~0x84;
+#endif
 	c = UART0_C1;
 	c = (c & ~0x13) | (format & 0x03);	// configure parity
 	if (format & 0x04) c |= 0x10;		// 9 bits (might include parity)
@@ -208,14 +378,12 @@ void serial_format(uint32_t format)
 	UART0_C4 = c;
 	use9Bits = format & 0x80;
 #endif
-#if defined(__MK64FX512__) || defined(__MK66FX1M0__) || defined(KINETISL)
 	// For T3.5/T3.6/TLC See about turning on 2 stop bit mode
 	if ( format & 0x100) {
 		uint8_t bdl = UART0_BDL;
 		UART0_BDH |= UART_BDH_SBNS;		// Turn on 2 stop bits - was turned off by set baud
 		UART0_BDL = bdl;		// Says BDH not acted on until BDL is written
 	}
-#endif
 	// process request for half duplex.
 	if ((format & SERIAL_HALF_DUPLEX) != 0) {
 		c = UART0_C1;
@@ -223,7 +391,6 @@ void serial_format(uint32_t format)
 		UART0_C1 = c;
 
 		// Lets try to make use of bitband address to set the direction for ue...
-		#if defined(KINETISL)
 		uint32_t pin_cfg = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(3) | PORT_PCR_PE;
 		if ((format & 0x20) == 0) pin_cfg |=  PORT_PCR_PS;  // if not inverted PU else leve as PD
 		switch (tx_pin_num) {
@@ -233,20 +400,9 @@ void serial_format(uint32_t format)
 			case 24: CORE_PIN24_CONFIG = pin_cfg; break;
 		}
 		half_duplex_mode = 1; 
-		#else
-		volatile uint32_t *reg = portConfigRegister(tx_pin_num);
-		uint32_t pin_cfg = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(3) | PORT_PCR_PE;
-		if ((format & 0x20) == 0) pin_cfg |=  PORT_PCR_PS;  // if not inverted PU else leve as PD
-		*reg = pin_cfg;
-		transmit_pin = (uint8_t*)GPIO_BITBAND_PTR(UART0_C3, C3_TXDIR_BIT);
-		#endif
 
 	} else {
-		#if defined(KINETISL)
 		half_duplex_mode = 0; 
-		#else
-		if (transmit_pin == (uint8_t*)GPIO_BITBAND_PTR(UART0_C3, C3_TXDIR_BIT)) transmit_pin = NULL;
-		#endif
 	}
 }
 
@@ -259,24 +415,14 @@ void serial_end(void)
 	switch (rx_pin_num) {
 		case 0:  CORE_PIN0_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1); break;
 		case 21: CORE_PIN21_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1); break;
-		#if defined(KINETISL)
 		case 3:  CORE_PIN3_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1); break;
 		case 25: CORE_PIN25_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1); break;
-		#endif
-		#if defined(__MK64FX512__) || defined(__MK66FX1M0__)
-		case 27: CORE_PIN27_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1); break;
-		#endif
 	}
 	switch (tx_pin_num & 127) {
 		case 1:  CORE_PIN1_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1); break;
 		case 5:  CORE_PIN5_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1); break;
-		#if defined(KINETISL)
 		case 4:  CORE_PIN4_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1); break;
 		case 24: CORE_PIN24_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1); break;
-		#endif
-		#if defined(__MK64FX512__) || defined(__MK66FX1M0__)
-		case 26: CORE_PIN26_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1); break;
-		#endif
 	}
 	UART0_S1;
 	UART0_D; // clear leftover error status
@@ -291,9 +437,7 @@ void serial_set_transmit_pin(uint8_t pin)
 	pinMode(pin, OUTPUT);
 	digitalWrite(pin, LOW);
 	transmit_pin = portOutputRegister(pin);
-	#if defined(KINETISL)
 	transmit_mask = digitalPinToBitMask(pin);
-	#endif
 }
 
 void serial_set_tx(uint8_t pin, uint8_t opendrain)
@@ -306,13 +450,8 @@ void serial_set_tx(uint8_t pin, uint8_t opendrain)
 		switch (tx_pin_num & 127) {
 			case 1:  CORE_PIN1_CONFIG = 0; break; // PTB17
 			case 5:  CORE_PIN5_CONFIG = 0; break; // PTD7
-			#if defined(KINETISL)
 			case 4:  CORE_PIN4_CONFIG = 0; break; // PTA2
 			case 24: CORE_PIN24_CONFIG = 0; break; // PTE20
-			#endif
-			#if defined(__MK64FX512__) || defined(__MK66FX1M0__)
-			case 26: CORE_PIN26_CONFIG = 0; break; //PTA14
-			#endif
 		}
 		if (opendrain) {
 			cfg = PORT_PCR_DSE | PORT_PCR_ODE;
@@ -322,13 +461,8 @@ void serial_set_tx(uint8_t pin, uint8_t opendrain)
 		switch (pin & 127) {
 			case 1:  CORE_PIN1_CONFIG = cfg | PORT_PCR_MUX(3); break;
 			case 5:  CORE_PIN5_CONFIG = cfg | PORT_PCR_MUX(3); break;
-			#if defined(KINETISL)
 			case 4:  CORE_PIN4_CONFIG = cfg | PORT_PCR_MUX(2); break;
 			case 24: CORE_PIN24_CONFIG = cfg | PORT_PCR_MUX(4); break;
-			#endif
-			#if defined(__MK64FX512__) || defined(__MK66FX1M0__)
-			case 26: CORE_PIN26_CONFIG = cfg | PORT_PCR_MUX(3); break;
-			#endif
 		}
 	}
 	tx_pin_num = pin;
@@ -341,24 +475,14 @@ void serial_set_rx(uint8_t pin)
 		switch (rx_pin_num) {
 			case 0:  CORE_PIN0_CONFIG = 0; break; // PTB16
 			case 21: CORE_PIN21_CONFIG = 0; break; // PTD6
-			#if defined(KINETISL)
 			case 3:  CORE_PIN3_CONFIG = 0; break; // PTA1
 			case 25: CORE_PIN25_CONFIG = 0; break; // PTE21
-			#endif
-			#if defined(__MK64FX512__) || defined(__MK66FX1M0__)
-			case 27: CORE_PIN27_CONFIG = 0; break; // PTA15
-			#endif
 		}
 		switch (pin) {
 			case 0:  CORE_PIN0_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(3); break;
 			case 21: CORE_PIN21_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(3); break;
-			#if defined(KINETISL)
 			case 3:  CORE_PIN3_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(2); break;
 			case 25: CORE_PIN25_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(4); break;
-			#endif
-			#if defined(__MK64FX512__) || defined(__MK66FX1M0__)
-			case 27: CORE_PIN27_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(3); break;
-			#endif
 		}
 	}
 	rx_pin_num = pin;
@@ -371,9 +495,7 @@ int serial_set_rts(uint8_t pin)
 	if (!(SIM_SCGC4 & SIM_SCGC4_UART0)) return 0;
 	if (pin < CORE_NUM_DIGITAL) {
 		rts_pin = portOutputRegister(pin);
-		#if defined(KINETISL)
 		rts_mask = digitalPinToBitMask(pin);
-		#endif
 		pinMode(pin, OUTPUT);
 		rts_assert();
 	} else {
@@ -396,21 +518,7 @@ int serial_set_rts(uint8_t pin)
 
 int serial_set_cts(uint8_t pin)
 {
-#if defined(KINETISK)
-	if (!(SIM_SCGC4 & SIM_SCGC4_UART0)) return 0;
-	if (pin == 18) {
-		CORE_PIN18_CONFIG = PORT_PCR_MUX(3) | PORT_PCR_PE; // weak pulldown
-	} else if (pin == 20) {
-		CORE_PIN20_CONFIG = PORT_PCR_MUX(3) | PORT_PCR_PE; // weak pulldown
-	} else {
-		UART0_MODEM &= ~UART_MODEM_TXCTSE;
-		return 0;
-	}
-	UART0_MODEM |= UART_MODEM_TXCTSE;
-	return 1;
-#else
 	return 0;
-#endif
 }
 
 void serial_putchar(uint32_t c)
@@ -419,7 +527,6 @@ void serial_putchar(uint32_t c)
 
 	if (!(SIM_SCGC4 & SIM_SCGC4_UART0)) return;
 	if (transmit_pin) transmit_assert();
-	#if defined(KINETISL)
 	if (half_duplex_mode) {
 		__disable_irq();
 		volatile uint32_t reg = UART0_C3;
@@ -427,7 +534,6 @@ void serial_putchar(uint32_t c)
 		UART0_C3 = reg;
 		__enable_irq();
 	}
-	#endif 
 	head = tx_buffer_head;
 	if (++head >= tx_buffer_total_size_) head = 0;
 	while (tx_buffer_tail == head) {
@@ -459,57 +565,11 @@ void serial_putchar(uint32_t c)
 	UART0_C2 = C2_TX_ACTIVE;
 }
 
-#ifdef HAS_KINETISK_UART0_FIFO
-void serial_write(const void *buf, unsigned int count)
-{
-	const uint8_t *p = (const uint8_t *)buf;
-	const uint8_t *end = p + count;
-	uint32_t head, n;
-
-	if (!(SIM_SCGC4 & SIM_SCGC4_UART0)) return;
-	if (transmit_pin) transmit_assert();
-	while (p < end) {
-		head = tx_buffer_head;
-		if (++head >= tx_buffer_total_size_) head = 0;
-		if (tx_buffer_tail == head) {
-			UART0_C2 = C2_TX_ACTIVE;
-			do {
-				int priority = nvic_execution_priority();
-				if (priority <= IRQ_PRIORITY) {
-					if ((UART0_S1 & UART_S1_TDRE)) {
-						uint32_t tail = tx_buffer_tail;
-						if (++tail >= tx_buffer_total_size_) tail = 0;
-						if (tail < SERIAL1_TX_BUFFER_SIZE) {
-							n = tx_buffer[tail];
-						} else {
-							n = tx_buffer_storage_[tail-SERIAL1_TX_BUFFER_SIZE];
-						}
-						if (use9Bits) UART0_C3 = (UART0_C3 & ~0x40) | ((n & 0x100) >> 2);
-						UART0_D = n;
-						tx_buffer_tail = tail;
-					}
-				} else if (priority >= 256) {
-					yield();
-				}
-			} while (tx_buffer_tail == head);
-		}
-		if (head < SERIAL1_TX_BUFFER_SIZE) {
-			tx_buffer[head] = *p++;
-		} else {
-			tx_buffer_storage_[head - SERIAL1_TX_BUFFER_SIZE] = *p++;
-		}
-		transmitting = 1;
-		tx_buffer_head = head;
-	}
-	UART0_C2 = C2_TX_ACTIVE;
-}
-#else
 void serial_write(const void *buf, unsigned int count)
 {
 	const uint8_t *p = (const uint8_t *)buf;
 	while (count-- > 0) serial_putchar(*p++);
 }
-#endif
 
 void serial_flush(void)
 {
@@ -576,12 +636,6 @@ int serial_peek(void)
 
 void serial_clear(void)
 {
-#ifdef HAS_KINETISK_UART0_FIFO
-	if (!(SIM_SCGC4 & SIM_SCGC4_UART0)) return;
-	UART0_C2 &= ~(UART_C2_RE | UART_C2_RIE | UART_C2_ILIE);
-	UART0_CFIFO = UART_CFIFO_RXFLUSH;
-	UART0_C2 |= (UART_C2_RE | UART_C2_RIE | UART_C2_ILIE);
-#endif
 	rx_buffer_head = rx_buffer_tail;
 	if (rts_pin) rts_assert();
 }
@@ -598,82 +652,6 @@ void uart0_status_isr(void)
 {
 	uint32_t head, tail, n;
 	uint8_t c;
-#ifdef HAS_KINETISK_UART0_FIFO
-	uint32_t newhead;
-	uint8_t avail;
-
-	if (UART0_S1 & (UART_S1_RDRF | UART_S1_IDLE)) {
-		__disable_irq();
-		avail = UART0_RCFIFO;
-		if (avail == 0) {
-			// The only way to clear the IDLE interrupt flag is
-			// to read the data register.  But reading with no
-			// data causes a FIFO underrun, which causes the
-			// FIFO to return corrupted data.  If anyone from
-			// Freescale reads this, what a poor design!  There
-			// write should be a write-1-to-clear for IDLE.
-			c = UART0_D;
-			// flushing the fifo recovers from the underrun,
-			// but there's a possible race condition where a
-			// new character could be received between reading
-			// RCFIFO == 0 and flushing the FIFO.  To minimize
-			// the chance, interrupts are disabled so a higher
-			// priority interrupt (hopefully) doesn't delay.
-			// TODO: change this to disabling the IDLE interrupt
-			// which won't be simple, since we already manage
-			// which transmit interrupts are enabled.
-			UART0_CFIFO = UART_CFIFO_RXFLUSH;
-			__enable_irq();
-		} else {
-			__enable_irq();
-			head = rx_buffer_head;
-			tail = rx_buffer_tail;
-			do {
-				if (use9Bits && (UART0_C3 & 0x80)) {
-					n = UART0_D | 0x100;
-				} else {
-					n = UART0_D;
-				}
-				newhead = head + 1;
-				if (newhead >= rx_buffer_total_size_) newhead = 0;
-				if (newhead != tail) {
-					head = newhead;
-					if (newhead < SERIAL1_RX_BUFFER_SIZE) {
-						rx_buffer[head] = n;
-					} else {
-						rx_buffer_storage_[head-SERIAL1_RX_BUFFER_SIZE] = n;
-					}
-				}
-			} while (--avail > 0);
-			rx_buffer_head = head;
-			if (rts_pin) {
-				int avail;
-				if (head >= tail) avail = head - tail;
-				else avail = rx_buffer_total_size_ + head - tail;
-				if (avail >= rts_high_watermark_) rts_deassert();
-			}
-		}
-	}
-	c = UART0_C2;
-	if ((c & UART_C2_TIE) && (UART0_S1 & UART_S1_TDRE)) {
-		head = tx_buffer_head;
-		tail = tx_buffer_tail;
-		do {
-			if (tail == head) break;
-			if (++tail >= tx_buffer_total_size_) tail = 0;
-			avail = UART0_S1;
-			if (tail < SERIAL1_TX_BUFFER_SIZE) {
-				n = tx_buffer[tail];
-			} else {
-				n = tx_buffer_storage_[tail-SERIAL1_TX_BUFFER_SIZE];
-			}
-			if (use9Bits) UART0_C3 = (UART0_C3 & ~0x40) | ((n & 0x100) >> 2);
-			UART0_D = n;
-		} while (UART0_TCFIFO < 8);
-		tx_buffer_tail = tail;
-		if (UART0_S1 & UART_S1_TDRE) UART0_C2 = C2_TX_COMPLETING;
-	}
-#else
 	if (UART0_S1 & UART_S1_RDRF) {
 		if (use9Bits && (UART0_C3 & 0x80)) {
 			n = UART0_D | 0x100;
@@ -710,11 +688,9 @@ void uart0_status_isr(void)
 			tx_buffer_tail = tail;
 		}
 	}
-#endif
 	if ((c & UART_C2_TCIE) && (UART0_S1 & UART_S1_TC)) {
 		transmitting = 0;
 		if (transmit_pin) transmit_deassert();
-		#if defined(KINETISL)
 		if (half_duplex_mode) {
 			__disable_irq();
 			volatile uint32_t reg = UART0_C3;
@@ -722,13 +698,55 @@ void uart0_status_isr(void)
 			UART0_C3 = reg;
 			__enable_irq();
 		}
-		#endif
 		UART0_C2 = C2_TX_INACTIVE;
 	}
 }
 
 
 
+void serial_add_memory_for_read(void *buffer, size_t length)
+{
+	rx_buffer_storage_ = (BUFTYPE*)buffer;
+	if (buffer) {
+		rx_buffer_total_size_ = SERIAL1_RX_BUFFER_SIZE + length;
+	} else {
+		rx_buffer_total_size_ = SERIAL1_RX_BUFFER_SIZE;
+	} 
+
+	rts_low_watermark_ = RTS_LOW_WATERMARK + length;
+	rts_high_watermark_ = RTS_HIGH_WATERMARK + length;
+}
+
+void serial_add_memory_for_write(void *buffer, size_t length)
+{
+	tx_buffer_storage_ = (BUFTYPE*)buffer;
+	if (buffer) {
+		tx_buffer_total_size_ = SERIAL1_TX_BUFFER_SIZE + length;
+	} else {
+		tx_buffer_total_size_ = SERIAL1_TX_BUFFER_SIZE;
+	} 
+}
+
+// no DMA on this port
+int serial_set_dma(uint8_t rx, uint8_t tx)
+{
+	return !rx && !tx;
+}
+
+int serial_read(void *buf, unsigned int count)
+{
+	uint8_t *p = (uint8_t *)buf;
+	unsigned int n = 0;
+	int c;
+
+	while (n < count && (c = serial_getchar()) >= 0) {
+		p[n++] = c;
+	}
+	return n;
+}
+
+#endif // KINETISL
+
 void serial_print(const char *p)
 {
 	while (*p) {
@@ -767,26 +785,3 @@ void serial_phex32(uint32_t n)
 	serial_phex(n >> 8);
 	serial_phex(n);
 }
-
-void serial_add_memory_for_read(void *buffer, size_t length)
-{
-	rx_buffer_storage_ = (BUFTYPE*)buffer;
-	if (buffer) {
-		rx_buffer_total_size_ = SERIAL1_RX_BUFFER_SIZE + length;
-	} else {
-		rx_buffer_total_size_ = SERIAL1_RX_BUFFER_SIZE;
-	} 
-
-	rts_low_watermark_ = RTS_LOW_WATERMARK + length;
-	rts_high_watermark_ = RTS_HIGH_WATERMARK + length;
-}
-
-void serial_add_memory_for_write(void *buffer, size_t length)
-{
-	tx_buffer_storage_ = (BUFTYPE*)buffer;
-	if (buffer) {
-		tx_buffer_total_size_ = SERIAL1_TX_BUFFER_SIZE + length;
-	} else {
-		tx_buffer_total_size_ = SERIAL1_TX_BUFFER_SIZE;
-	} 
-}
@@ -31,8 +31,14 @@
 #include "kinetis.h"
 #include "core_pins.h"
 #include "HardwareSerial.h"
+#include "serial_uart.h"
 #include <stddef.h>
 
+// 9 bit formats on Serial2 only, see HardwareSerial.h
+#if defined(SERIAL2_9BIT_SUPPORT) && !defined(SERIAL_9BIT_SUPPORT)
+#define SERIAL_9BIT_SUPPORT
+#endif
+
 ////////////////////////////////////////////////////////////////
 // Tunable parameters (relatively safe to edit these numbers)
 ////////////////////////////////////////////////////////////////
@@ -46,6 +52,214 @@
 #define RTS_HIGH_WATERMARK (SERIAL2_RX_BUFFER_SIZE-24) // RTS requests sender to pause
 #define RTS_LOW_WATERMARK  (SERIAL2_RX_BUFFER_SIZE-38) // RTS allows sender to resume
 #define IRQ_PRIORITY  64  // 0 = highest priority, 255 = lowest
+#ifndef SERIAL2_TX_FIFO_WATERMARK
+#define SERIAL2_TX_FIFO_WATERMARK  2 // FIFO only: TDRE interrupt at or below this many bytes
+#endif
+#ifndef SERIAL2_RX_FIFO_WATERMARK
+#define SERIAL2_RX_FIFO_WATERMARK  4 // FIFO only: RDRF interrupt at or above this many bytes
+#endif
+
+#if defined(KINETISK)
+
+#ifdef SERIAL_9BIT_SUPPORT
+#define BUFTYPE uint16_t
+#else
+#define BUFTYPE uint8_t
+#endif
+
+static volatile BUFTYPE tx_buffer[SERIAL2_TX_BUFFER_SIZE];
+static volatile BUFTYPE rx_buffer[SERIAL2_RX_BUFFER_SIZE];
+
+static const uint8_t rx_pins[] = {
+	9,
+#if defined(__MK20DX128__) || defined(__MK20DX256__)
+	26,
+#elif defined(__MK64FX512__) || defined(__MK66FX1M0__)
+	59,
+#endif
+};
+static const uint8_t tx_pins[] = {
+	10,
+#if defined(__MK20DX128__) || defined(__MK20DX256__)
+	31,
+#elif defined(__MK64FX512__) || defined(__MK66FX1M0__)
+	58,
+#endif
+};
+static const uint8_t cts_pins[] = {
+	23,
+#if defined(__MK64FX512__) || defined(__MK66FX1M0__)
+	60,
+#endif
+};
+
+static serial_uart_state_t state = {
+	.rx_total_size = SERIAL2_RX_BUFFER_SIZE,
+	.tx_total_size = SERIAL2_TX_BUFFER_SIZE,
+	.rts_low_watermark = RTS_LOW_WATERMARK,
+	.rts_high_watermark = RTS_HIGH_WATERMARK,
+	.rx_pin_num = 9,
+	.tx_pin_num = 10,
+};
+
+static void dma_rx_isr(void);
+static void dma_tx_isr(void);
+
+const serial_uart_t serial2_uart = {
+	.uart = &KINETISK_UART1,
+	.clock_gate = &SIM_SCGC4,
+	.clock_mask = SIM_SCGC4_UART1,
+	.irq = IRQ_UART1_STATUS,
+	.irq_error = IRQ_UART1_ERROR,
+	.irq_priority = IRQ_PRIORITY,
+#ifdef HAS_KINETISK_UART1_FIFO
+	.fifo = 1,
+	.tx_watermark = SERIAL2_TX_FIFO_WATERMARK,
+	.rx_watermark = SERIAL2_RX_FIFO_WATERMARK,
+#endif
+#ifdef SERIAL_9BIT_SUPPORT
+	.wide = 1,
+#endif
+	.rx_pin_count = sizeof(rx_pins),
+	.tx_pin_count = sizeof(tx_pins),
+	.cts_pin_count = sizeof(cts_pins),
+	.rx_pins = rx_pins,
+	.tx_pins = tx_pins,
+	.cts_pins = cts_pins,
+	.rts_low_offset = SERIAL2_RX_BUFFER_SIZE - RTS_LOW_WATERMARK,
+	.rts_high_offset = SERIAL2_RX_BUFFER_SIZE - RTS_HIGH_WATERMARK,
+	.rx_buffer = rx_buffer,
+	.tx_buffer = tx_buffer,
+	.rx_buffer_size = SERIAL2_RX_BUFFER_SIZE,
+	.tx_buffer_size = SERIAL2_TX_BUFFER_SIZE,
+	.dma_rx_source = DMAMUX_SOURCE_UART1_RX,
+	.dma_tx_source = DMAMUX_SOURCE_UART1_TX,
+	.dma_rx_isr = dma_rx_isr,
+	.dma_tx_isr = dma_tx_isr,
+	.state = &state,
+};
+
+void serial2_begin(uint32_t divisor)
+{
+	serial_uart_begin(&serial2_uart, divisor);
+}
+
+void serial2_format(uint32_t format)
+{
+	serial_uart_format(&serial2_uart, format);
+}
+
+void serial2_end(void)
+{
+	serial_uart_end(&serial2_uart);
+}
+
+void serial2_set_transmit_pin(uint8_t pin)
+{
+	serial_uart_set_transmit_pin(&serial2_uart, pin);
+}
+
+void serial2_set_tx(uint8_t pin, uint8_t opendrain)
+{
+	serial_uart_set_tx(&serial2_uart, pin, opendrain);
+}
+
+void serial2_set_rx(uint8_t pin)
+{
+	serial_uart_set_rx(&serial2_uart, pin);
+}
+
+int serial2_set_rts(uint8_t pin)
+{
+	return serial_uart_set_rts(&serial2_uart, pin);
+}
+
+int serial2_set_cts(uint8_t pin)
+{
+	return serial_uart_set_cts(&serial2_uart, pin);
+}
+
+void serial2_putchar(uint32_t c)
+{
+	serial_uart_putchar(&serial2_uart, c);
+}
+
+void serial2_write(const void *buf, unsigned int count)
+{
+	serial_uart_write(&serial2_uart, buf, count);
+}
+
+void serial2_flush(void)
+{
+	serial_uart_flush(&serial2_uart);
+}
+
+int serial2_write_buffer_free(void)
+{
+	return serial_uart_write_buffer_free(&serial2_uart);
+}
+
+int serial2_available(void)
+{
+	return serial_uart_available(&serial2_uart);
+}
+
+int serial2_getchar(void)
+{
+	return serial_uart_getchar(&serial2_uart);
+}
+
+int serial2_read(void *buf, unsigned int count)
+{
+	return serial_uart_read(&serial2_uart, buf, count);
+}
+
+int serial2_peek(void)
+{
+	return serial_uart_peek(&serial2_uart);
+}
+
+void serial2_clear(void)
+{
+	serial_uart_clear(&serial2_uart);
+}
+
+void serial2_add_memory_for_read(void *buffer, size_t length)
+{
+	serial_uart_add_memory_for_read(&serial2_uart, buffer, length);
+}
+
+void serial2_add_memory_for_write(void *buffer, size_t length)
+{
+	serial_uart_add_memory_for_write(&serial2_uart, buffer, length);
+}
+
+int serial2_set_dma(uint8_t rx, uint8_t tx)
+{
+	return serial_uart_set_dma(&serial2_uart, rx, tx);
+}
+
+void uart1_status_isr(void)
+{
+	serial_uart_isr(&serial2_uart);
+}
+
+void uart1_error_isr(void)
+{
+	serial_uart_isr(&serial2_uart);
+}
+
+static void dma_rx_isr(void)
+{
+	serial_uart_dma_rx_isr(&serial2_uart);
+}
+
+static void dma_tx_isr(void)
+{
+	serial_uart_dma_tx_isr(&serial2_uart);
+}
+
+#elif defined(KINETISL)
 
 ////////////////////////////////////////////////////////////////
 // changes not recommended below this point....
@@ -70,14 +284,6 @@ static size_t rts_low_watermark_ = RTS_LOW_WATERMARK;
 static size_t rts_high_watermark_ = RTS_HIGH_WATERMARK;
 
 static volatile uint8_t transmitting = 0;
-#if defined(KINETISK)
-  static volatile uint8_t *transmit_pin=NULL;
-  #define transmit_assert()   *transmit_pin = 1
-  #define transmit_deassert() *transmit_pin = 0
-  static volatile uint8_t *rts_pin=NULL;
-  #define rts_assert()        *rts_pin = 0
-  #define rts_deassert()      *rts_pin = 1
-#elif defined(KINETISL)
   static volatile uint8_t *transmit_pin=NULL;
   static uint8_t transmit_mask=0;
   #define transmit_assert()   *(transmit_pin+4) = transmit_mask;
@@ -86,7 +292,6 @@ static volatile uint8_t transmitting = 0;
   static uint8_t rts_mask=0;
   #define rts_assert()        *(rts_pin+8) = rts_mask;
   #define rts_deassert()      *(rts_pin+4) = rts_mask;
-#endif
 #if SERIAL2_TX_BUFFER_SIZE > 65535
 static volatile uint32_t tx_buffer_head = 0;
 static volatile uint32_t tx_buffer_tail = 0;
@@ -107,22 +312,12 @@ static volatile uint16_t rx_buffer_tail = 0;
 static volatile uint8_t rx_buffer_head = 0;
 static volatile uint8_t rx_buffer_tail = 0;
 #endif
-#if defined(KINETISK)
-static uint8_t rx_pin_num = 9;
-static uint8_t tx_pin_num = 10;
-#endif
-#if defined(KINETISL)
 static uint8_t half_duplex_mode = 0;
-#endif
 
 // UART0 and UART1 are clocked by F_CPU, UART2 is clocked by F_BUS
 // UART0 has 8 byte fifo, UART1 and UART2 have 1 byte buffer
 
-#ifdef HAS_KINETISK_UART1_FIFO
-#define C2_ENABLE		UART_C2_TE | UART_C2_RE | UART_C2_RIE | UART_C2_ILIE
-#else
 #define C2_ENABLE		UART_C2_TE | UART_C2_RE | UART_C2_RIE
-#endif
 #define C2_TX_ACTIVE		C2_ENABLE | UART_C2_TIE
 #define C2_TX_COMPLETING	C2_ENABLE | UART_C2_TCIE
 #define C2_TX_INACTIVE		C2_ENABLE
@@ -140,47 +335,12 @@ void serial2_begin(uint32_t divisor)
 	tx_buffer_head = 0;
 	tx_buffer_tail = 0;
 	transmitting = 0;
-#if defined(KINETISK)
-	switch (rx_pin_num) {
-		case 9: CORE_PIN9_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(3); break;
-		#if defined(__MK20DX128__) || defined(__MK20DX256__)    // T3.0, T3.1, T3.2
-		case 26: CORE_PIN26_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(3); break;
-		#elif defined(__MK64FX512__) || defined(__MK66FX1M0__)  // T3.5 or T3.6
-		case 59: CORE_PIN59_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(3); break;
-		#endif
-	}
-	switch (tx_pin_num) {
-		case 10: CORE_PIN10_CONFIG = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(3); break;
-		#if defined(__MK20DX128__) || defined(__MK20DX256__)    // T3.0, T3.1, T3.2
-		case 31: CORE_PIN31_CONFIG = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(3); break;
-		#elif defined(__MK64FX512__) || defined(__MK66FX1M0__)  // T3.5 or T3.6
-		case 58: CORE_PIN58_CONFIG = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(3); break;
-		#endif
-	}
-#elif defined(KINETISL)
 	CORE_PIN9_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(3);
 	CORE_PIN10_CONFIG = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(3);
-#endif
-#if defined(HAS_KINETISK_UART1)
-	if (divisor < 32) divisor = 32;
-	UART1_BDH = (divisor >> 13) & 0x1F;
-	UART1_BDL = (divisor >> 5) & 0xFF;
-	UART1_C4 = divisor & 0x1F;
-#ifdef HAS_KINETISK_UART1_FIFO
-	UART1_C1 = UART_C1_ILT;
-	UART1_TWFIFO = 2; // tx watermark, causes S1_TDRE to set
-	UART1_RWFIFO = 4; // rx watermark, causes S1_RDRF to set
-	UART1_PFIFO = UART_PFIFO_TXFE | UART_PFIFO_RXFE;
-#else
-	UART1_C1 = 0;
-	UART1_PFIFO = 0;
-#endif
-#elif defined(HAS_KINETISL_UART1)
 	if (divisor < 1) divisor = 1;
 	UART1_BDH = (divisor >> 8) & 0x1F;
 	UART1_BDL = divisor & 0xFF;
 	UART1_C1 = 0;
-#endif
 	UART1_C2 = C2_TX_INACTIVE;
 	NVIC_SET_PRIORITY(IRQ_UART1_STATUS, IRQ_PRIORITY);
 	NVIC_ENABLE_IRQ(IRQ_UART1_STATUS);
@@ -190,6 +350,10 @@ void serial2_format(uint32_t format)
 {
 	uint8_t c;
 
+#ifndef SERIAL_9BIT_SUPPORT
+	// 9 bit data needs 16 bit buffers, so fall back to the 8 bit format
+	if (format & 0x80) format &= (format & 0x08) ? ~0x88 : ~0x84;
+#endif
 	c = UART1_C1;
 	c = (c & ~0x13) | (format & 0x03);	// configure parity
 	if (format & 0x04) c |= 0x10;		// 9 bits (might include parity)
@@ -201,20 +365,12 @@ void serial2_format(uint32_t format)
 	c = UART1_C3 & ~0x10;
 	if (format & 0x20) c |= 0x10;		// tx invert
 	UART1_C3 = c;
-#if defined(SERIAL_9BIT_SUPPORT) && !defined(KINETISL)
-	c = UART1_C4 & 0x1F;
-	if (format & 0x08) c |= 0x20;		// 9 bit mode with parity (requires 10 bits)
-	UART1_C4 = c;
-	use9Bits = format & 0x80;
-#endif
-#if defined(__MK64FX512__) || defined(__MK66FX1M0__) || defined(KINETISL)
 	// For T3.5/T3.6/TLC See about turning on 2 stop bit mode
 	if ( format & 0x100) {
 		uint8_t bdl = UART1_BDL;
 		UART1_BDH |= UART_BDH_SBNS;		// Turn on 2 stop bits - was turned off by set baud
 		UART1_BDL = bdl;		// Says BDH not acted on until BDL is written
 	}
-#endif
 	// process request for half duplex.
 	if ((format & SERIAL_HALF_DUPLEX) != 0) {
 		c = UART1_C1;
@@ -222,26 +378,14 @@ void serial2_format(uint32_t format)
 		UART1_C1 = c;
 
 		// Lets try to make use of bitband address to set the direction for ue...
-		#if defined(KINETISL)
 		//CORE_PIN10_CONFIG = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(1) | PORT_PCR_PE | PORT_PCR_PS;
 		uint32_t pin_cfg = PORT_PCR_PE | PORT_PCR_PFE | PORT_PCR_MUX(3);
 		if ((format & 0x20) == 0) pin_cfg |=  PORT_PCR_PS;  // if not inverted PU else leve as PD
 		CORE_PIN10_CONFIG = pin_cfg;
 		half_duplex_mode = 1;
-		#else
-		volatile uint32_t *reg = portConfigRegister(tx_pin_num);
-		uint32_t pin_cfg = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(3) | PORT_PCR_PE;
-		if ((format & 0x20) == 0) pin_cfg |=  PORT_PCR_PS;  // if not inverted PU else leve as PD
-		*reg = pin_cfg;
-		transmit_pin = (uint8_t*)GPIO_BITBAND_PTR(UART1_C3, C3_TXDIR_BIT);
-		#endif
 
 	} else {
-		#if defined(KINETISL)
 		half_duplex_mode = 0;
-		#else
-		if (transmit_pin == (uint8_t*)GPIO_BITBAND_PTR(UART1_C3, C3_TXDIR_BIT)) transmit_pin = NULL;
-		#endif
 	}
 }
 
@@ -251,27 +395,8 @@ void serial2_end(void)
 	while (transmitting) yield();  // wait for buffered data to send
 	NVIC_DISABLE_IRQ(IRQ_UART1_STATUS);
 	UART1_C2 = 0;
-#if defined(KINETISK)
-	switch (rx_pin_num) {
-		case 9: CORE_PIN9_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1); break; // PTC3
-		#if defined(__MK20DX128__) || defined(__MK20DX256__)  // T3.0, T3.1, T3.2
-		case 26: CORE_PIN26_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1); break; // PTE1
-		#elif defined(__MK64FX512__) || defined(__MK66FX1M0__) // T3.5, T3.6
-		case 59: CORE_PIN59_CONFIG = 0; break;
-		#endif
-	}
-	switch (tx_pin_num & 127) {
-		case 10: CORE_PIN10_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1); break; // PTC4
-		#if defined(__MK20DX128__) || defined(__MK20DX256__)  // T3.0, T3.1, T3.2
-		case 31: CORE_PIN31_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1); break; // PTE0
-		#elif defined(__MK64FX512__) || defined(__MK66FX1M0__) // T3.5, T3.6
-		case 58: CORE_PIN58_CONFIG = 0; break;
-		#endif
-	}
-#elif defined(KINETISL)
 	CORE_PIN9_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1);  // PTC3
 	CORE_PIN10_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1); // PTC4
-#endif
 	UART1_S1;
 	UART1_D; // clear leftover error status
 	rx_buffer_head = 0;
@@ -285,69 +410,15 @@ void serial2_set_transmit_pin(uint8_t pin)
 	pinMode(pin, OUTPUT);
 	digitalWrite(pin, LOW);
 	transmit_pin = portOutputRegister(pin);
-	#if defined(KINETISL)
 	transmit_mask = digitalPinToBitMask(pin);
-	#endif
 }
 
 void serial2_set_tx(uint8_t pin, uint8_t opendrain)
 {
-	#if defined(KINETISK)
-	uint32_t cfg;
-
-	if (opendrain) pin |= 128;
-	if (pin == tx_pin_num) return;
-	if ((SIM_SCGC4 & SIM_SCGC4_UART1)) {
-		switch (tx_pin_num & 127) {
-			case 10: CORE_PIN10_CONFIG = 0; break; // PTC4
-			#if defined(__MK20DX128__) || defined(__MK20DX256__)  // T3.0, T3.1, T3.2
-			case 31: CORE_PIN31_CONFIG = 0; break; // PTE0
-			#elif defined(__MK64FX512__) || defined(__MK66FX1M0__) // T3.5, T3.6
-			case 58: CORE_PIN58_CONFIG = 0; break;
-			#endif
-		}
-		if (opendrain) {
-			cfg = PORT_PCR_DSE | PORT_PCR_ODE;
-		} else {
-			cfg = PORT_PCR_DSE | PORT_PCR_SRE;
-		}
-		switch (pin & 127) {
-			case 10: CORE_PIN10_CONFIG = cfg | PORT_PCR_MUX(3); break;
-			#if defined(__MK20DX128__) || defined(__MK20DX256__)  // T3.0, T3.1, T3.2
-			case 31: CORE_PIN31_CONFIG = cfg | PORT_PCR_MUX(3); break;
-			#elif defined(__MK64FX512__) || defined(__MK66FX1M0__) // T3.5, T3.6
-			case 58: CORE_PIN58_CONFIG = cfg | PORT_PCR_MUX(3); break;
-			#endif
-		}
-	}
-	tx_pin_num = pin;
-	#endif
 }
 
 void serial2_set_rx(uint8_t pin)
 {
-	#if defined(KINETISK)
-	if (pin == rx_pin_num) return;
-	if ((SIM_SCGC4 & SIM_SCGC4_UART1)) {
-		switch (rx_pin_num) {
-			case 9: CORE_PIN9_CONFIG = 0; break; // PTC3
-			#if defined(__MK20DX128__) || defined(__MK20DX256__)  // T3.0, T3.1, T3.2
-			case 26: CORE_PIN26_CONFIG = 0; break; // PTE1
-			#elif defined(__MK64FX512__) || defined(__MK66FX1M0__) // T3.5, T3.6
-			case 59: CORE_PIN59_CONFIG = 0; break;
-			#endif
-		}
-		switch (pin) {
-			case 9: CORE_PIN9_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(3); break;
-			#if defined(__MK20DX128__) || defined(__MK20DX256__)  // T3.0, T3.1, T3.2
-			case 26: CORE_PIN26_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(3); break;
-			#elif defined(__MK64FX512__) || defined(__MK66FX1M0__) // T3.5, T3.6
-			case 59: CORE_PIN59_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(3); break;
-			#endif
-		}
-	}
-	rx_pin_num = pin;
-	#endif
 }
 
 int serial2_set_rts(uint8_t pin)
@@ -355,9 +426,7 @@ int serial2_set_rts(uint8_t pin)
 	if (!(SIM_SCGC4 & SIM_SCGC4_UART1)) return 0;
 	if (pin < CORE_NUM_DIGITAL) {
 		rts_pin = portOutputRegister(pin);
-		#if defined(KINETISL)
 		rts_mask = digitalPinToBitMask(pin);
-		#endif
 		pinMode(pin, OUTPUT);
 		rts_assert();
 	} else {
@@ -379,23 +448,7 @@ int serial2_set_rts(uint8_t pin)
 
 int serial2_set_cts(uint8_t pin)
 {
-#if defined(KINETISK)
-	if (!(SIM_SCGC4 & SIM_SCGC4_UART1)) return 0;
-	if (pin == 23) {
-		CORE_PIN23_CONFIG = PORT_PCR_MUX(3) | PORT_PCR_PE; // weak pulldown
-	#if defined(__MK64FX512__) || defined(__MK66FX1M0__)  // on T3.5 or T3.6
-	} else if (pin == 60) {
-		CORE_PIN60_CONFIG = PORT_PCR_MUX(3) | PORT_PCR_PE; // weak pulldown
-	#endif
-	} else {
-		UART1_MODEM &= ~UART_MODEM_TXCTSE;
-		return 0;
-	}
-	UART1_MODEM |= UART_MODEM_TXCTSE;
-	return 1;
-#else
 	return 0;
-#endif
 }
 
 void serial2_putchar(uint32_t c)
@@ -404,7 +457,6 @@ void serial2_putchar(uint32_t c)
 
 	if (!(SIM_SCGC4 & SIM_SCGC4_UART1)) return;
 	if (transmit_pin) transmit_assert();
-	#if defined(KINETISL)
 	if (half_duplex_mode) {
 		__disable_irq();
 		volatile uint32_t reg = UART1_C3;
@@ -412,7 +464,6 @@ void serial2_putchar(uint32_t c)
 		UART1_C3 = reg;
 		__enable_irq();
 	}
-	#endif 
 	head = tx_buffer_head;
 	if (++head >= tx_buffer_total_size_) head = 0;
 	while (tx_buffer_tail == head) {
@@ -444,57 +495,11 @@ void serial2_putchar(uint32_t c)
 	UART1_C2 = C2_TX_ACTIVE;
 }
 
-#ifdef HAS_KINETISK_UART1_FIFO
-void serial2_write(const void *buf, unsigned int count)
-{
-	const uint8_t *p = (const uint8_t *)buf;
-	const uint8_t *end = p + count;
-	uint32_t head, n;
-
-	if (!(SIM_SCGC4 & SIM_SCGC4_UART1)) return;
-	if (transmit_pin) transmit_assert();
-	while (p < end) {
-		head = tx_buffer_head;
-		if (++head >= tx_buffer_total_size_) head = 0;
-		if (tx_buffer_tail == head) {
-			UART1_C2 = C2_TX_ACTIVE;
-			do {
-				int priority = nvic_execution_priority();
-				if (priority <= IRQ_PRIORITY) {
-					if ((UART1_S1 & UART_S1_TDRE)) {
-						uint32_t tail = tx_buffer_tail;
-						if (++tail >= tx_buffer_total_size_) tail = 0;
-						if (tail < SERIAL2_TX_BUFFER_SIZE) {
-							n = tx_buffer[tail];
-						} else {
-							n = tx_buffer_storage_[tail-SERIAL2_TX_BUFFER_SIZE];
-						}
-						if (use9Bits) UART1_C3 = (UART1_C3 & ~0x40) | ((n & 0x100) >> 2);
-						UART1_D = n;
-						tx_buffer_tail = tail;
-					}
-				} else if (priority >= 256) {
-					yield();
-				}
-			} while (tx_buffer_tail == head);
-		}
-		if (head < SERIAL2_TX_BUFFER_SIZE) {
-			tx_buffer[head] = *p++;
-		} else {
-			tx_buffer_storage_[head - SERIAL2_TX_BUFFER_SIZE] = *p++;
-		}
-		transmitting = 1;
-		tx_buffer_head = head;
-	}
-	UART1_C2 = C2_TX_ACTIVE;
-}
-#else
 void serial2_write(const void *buf, unsigned int count)
 {
 	const uint8_t *p = (const uint8_t *)buf;
 	while (count-- > 0) serial2_putchar(*p++);
 }
-#endif
 
 void serial2_flush(void)
 {
@@ -561,12 +566,6 @@ int serial2_peek(void)
 
 void serial2_clear(void)
 {
-#ifdef HAS_KINETISK_UART1_FIFO
-	if (!(SIM_SCGC4 & SIM_SCGC4_UART1)) return;
-	UART1_C2 &= ~(UART_C2_RE | UART_C2_RIE | UART_C2_ILIE);
-	UART1_CFIFO = UART_CFIFO_RXFLUSH;
-	UART1_C2 |= (UART_C2_RE | UART_C2_RIE | UART_C2_ILIE);
-#endif
 	rx_buffer_head = rx_buffer_tail;
 	if (rts_pin) rts_assert();
 }
@@ -583,82 +582,6 @@ void uart1_status_isr(void)
 {
 	uint32_t head, tail, n;
 	uint8_t c;
-#ifdef HAS_KINETISK_UART1_FIFO
-	uint32_t newhead;
-	uint8_t avail;
-
-	if (UART1_S1 & (UART_S1_RDRF | UART_S1_IDLE)) {
-		__disable_irq();
-		avail = UART1_RCFIFO;
-		if (avail == 0) {
-			// The only way to clear the IDLE interrupt flag is
-			// to read the data register.  But reading with no
-			// data causes a FIFO underrun, which causes the
-			// FIFO to return corrupted data.  If anyone from
-			// Freescale reads this, what a poor design!  There
-			// write should be a write-1-to-clear for IDLE.
-			c = UART1_D;
-			// flushing the fifo recovers from the underrun,
-			// but there's a possible race condition where a
-			// new character could be received between reading
-			// RCFIFO == 0 and flushing the FIFO.  To minimize
-			// the chance, interrupts are disabled so a higher
-			// priority interrupt (hopefully) doesn't delay.
-			// TODO: change this to disabling the IDLE interrupt
-			// which won't be simple, since we already manage
-			// which transmit interrupts are enabled.
-			UART1_CFIFO = UART_CFIFO_RXFLUSH;
-			__enable_irq();
-		} else {
-			__enable_irq();
-			head = rx_buffer_head;
-			tail = rx_buffer_tail;
-			do {
-				if (use9Bits && (UART1_C3 & 0x80)) {
-					n = UART1_D | 0x100;
-				} else {
-					n = UART1_D;
-				}
-				newhead = head + 1;
-				if (newhead >= rx_buffer_total_size_) newhead = 0;
-				if (newhead != tail) {
-					head = newhead;
-					if (newhead < SERIAL2_RX_BUFFER_SIZE) {
-						rx_buffer[head] = n;
-					} else {
-						rx_buffer_storage_[head-SERIAL2_RX_BUFFER_SIZE] = n;
-					}
-				}
-			} while (--avail > 0);
-			rx_buffer_head = head;
-			if (rts_pin) {
-				int avail;
-				if (head >= tail) avail = head - tail;
-				else avail = rx_buffer_total_size_ + head - tail;
-				if (avail >= rts_high_watermark_) rts_deassert();
-			}
-		}
-	}
-	c = UART1_C2;
-	if ((c & UART_C2_TIE) && (UART1_S1 & UART_S1_TDRE)) {
-		head = tx_buffer_head;
-		tail = tx_buffer_tail;
-		do {
-			if (tail == head) break;
-			if (++tail >= tx_buffer_total_size_) tail = 0;
-			avail = UART1_S1;
-			if (tail < SERIAL2_TX_BUFFER_SIZE) {
-				n = tx_buffer[tail];
-			} else {
-				n = tx_buffer_storage_[tail-SERIAL2_TX_BUFFER_SIZE];
-			}
-			if (use9Bits) UART1_C3 = (UART1_C3 & ~0x40) | ((n & 0x100) >> 2);
-			UART1_D = n;
-		} while (UART1_TCFIFO < 8);
-		tx_buffer_tail = tail;
-		if (UART1_S1 & UART_S1_TDRE) UART1_C2 = C2_TX_COMPLETING;
-	}
-#else
 	if (UART1_S1 & UART_S1_RDRF) {
 		if (use9Bits && (UART1_C3 & 0x80)) {
 			n = UART1_D | 0x100;
@@ -695,11 +618,9 @@ void uart1_status_isr(void)
 			tx_buffer_tail = tail;
 		}
 	}
-#endif
 	if ((c & UART_C2_TCIE) && (UART1_S1 & UART_S1_TC)) {
 		transmitting = 0;
 		if (transmit_pin) transmit_deassert();
-		#if defined(KINETISL)
 		if (half_duplex_mode) {
 			__disable_irq();
 			volatile uint32_t reg = UART1_C3;
@@ -707,7 +628,6 @@ void uart1_status_isr(void)
 			UART1_C3 = reg;
 			__enable_irq();
 		}
-		#endif		
 		UART1_C2 = C2_TX_INACTIVE;
 	}
 }
@@ -735,3 +655,22 @@ void serial2_add_memory_for_write(void *buffer, size_t length)
 	} 
 }
 
+// no DMA on this port
+int serial2_set_dma(uint8_t rx, uint8_t tx)
+{
+	return !rx && !tx;
+}
+
+int serial2_read(void *buf, unsigned int count)
+{
+	uint8_t *p = (uint8_t *)buf;
+	unsigned int n = 0;
+	int c;
+
+	while (n < count && (c = serial2_getchar()) >= 0) {
+		p[n++] = c;
+	}
+	return n;
+}
+
+#endif // KINETISL
@@ -31,8 +31,14 @@
 #include "kinetis.h"
 #include "core_pins.h"
 #include "HardwareSerial.h"
+#include "serial_uart.h"
 #include <stddef.h>
 
+// 9 bit formats on Serial3 only, see HardwareSerial.h
+#if defined(SERIAL3_9BIT_SUPPORT) && !defined(SERIAL_9BIT_SUPPORT)
+#define SERIAL_9BIT_SUPPORT
+#endif
+
 ////////////////////////////////////////////////////////////////
 // Tunable parameters (relatively safe to edit these numbers)
 ////////////////////////////////////////////////////////////////
@@ -48,6 +54,190 @@
 #define IRQ_PRIORITY  64  // 0 = highest priority, 255 = lowest
 
 
+#if defined(KINETISK)
+
+#ifdef SERIAL_9BIT_SUPPORT
+#define BUFTYPE uint16_t
+#else
+#define BUFTYPE uint8_t
+#endif
+
+static volatile BUFTYPE tx_buffer[SERIAL3_TX_BUFFER_SIZE];
+static volatile BUFTYPE rx_buffer[SERIAL3_RX_BUFFER_SIZE];
+
+static const uint8_t rx_pins[] = {
+	7,
+};
+static const uint8_t tx_pins[] = {
+	8,
+};
+static const uint8_t cts_pins[] = {
+	14,
+};
+
+static serial_uart_state_t state = {
+	.rx_total_size = SERIAL3_RX_BUFFER_SIZE,
+	.tx_total_size = SERIAL3_TX_BUFFER_SIZE,
+	.rts_low_watermark = RTS_LOW_WATERMARK,
+	.rts_high_watermark = RTS_HIGH_WATERMARK,
+	.rx_pin_num = 7,
+	.tx_pin_num = 8,
+};
+
+static void dma_rx_isr(void);
+static void dma_tx_isr(void);
+
+const serial_uart_t serial3_uart = {
+	.uart = &KINETISK_UART2,
+	.clock_gate = &SIM_SCGC4,
+	.clock_mask = SIM_SCGC4_UART2,
+	.irq = IRQ_UART2_STATUS,
+	.irq_error = IRQ_UART2_ERROR,
+	.irq_priority = IRQ_PRIORITY,
+#ifdef SERIAL_9BIT_SUPPORT
+	.wide = 1,
+#endif
+	.rx_pin_count = sizeof(rx_pins),
+	.tx_pin_count = sizeof(tx_pins),
+	.cts_pin_count = sizeof(cts_pins),
+	.rx_pins = rx_pins,
+	.tx_pins = tx_pins,
+	.cts_pins = cts_pins,
+	.rts_low_offset = SERIAL3_RX_BUFFER_SIZE - RTS_LOW_WATERMARK,
+	.rts_high_offset = SERIAL3_RX_BUFFER_SIZE - RTS_HIGH_WATERMARK,
+	.rx_buffer = rx_buffer,
+	.tx_buffer = tx_buffer,
+	.rx_buffer_size = SERIAL3_RX_BUFFER_SIZE,
+	.tx_buffer_size = SERIAL3_TX_BUFFER_SIZE,
+	.dma_rx_source = DMAMUX_SOURCE_UART2_RX,
+	.dma_tx_source = DMAMUX_SOURCE_UART2_TX,
+	.dma_rx_isr = dma_rx_isr,
+	.dma_tx_isr = dma_tx_isr,
+	.state = &state,
+};
+
+void serial3_begin(uint32_t divisor)
+{
+	serial_uart_begin(&serial3_uart, divisor);
+}
+
+void serial3_format(uint32_t format)
+{
+	serial_uart_format(&serial3_uart, format);
+}
+
+void serial3_end(void)
+{
+	serial_uart_end(&serial3_uart);
+}
+
+void serial3_set_transmit_pin(uint8_t pin)
+{
+	serial_uart_set_transmit_pin(&serial3_uart, pin);
+}
+
+void serial3_set_tx(uint8_t pin, uint8_t opendrain)
+{
+	serial_uart_set_tx(&serial3_uart, pin, opendrain);
+}
+
+void serial3_set_rx(uint8_t pin)
+{
+	serial_uart_set_rx(&serial3_uart, pin);
+}
+
+int serial3_set_rts(uint8_t pin)
+{
+	return serial_uart_set_rts(&serial3_uart, pin);
+}
+
+int serial3_set_cts(uint8_t pin)
+{
+	return serial_uart_set_cts(&serial3_uart, pin);
+}
+
+void serial3_putchar(uint32_t c)
+{
+	serial_uart_putchar(&serial3_uart, c);
+}
+
+void serial3_write(const void *buf, unsigned int count)
+{
+	serial_uart_write(&serial3_uart, buf, count);
+}
+
+void serial3_flush(void)
+{
+	serial_uart_flush(&serial3_uart);
+}
+
+int serial3_write_buffer_free(void)
+{
+	return serial_uart_write_buffer_free(&serial3_uart);
+}
+
+int serial3_available(void)
+{
+	return serial_uart_available(&serial3_uart);
+}
+
+int serial3_getchar(void)
+{
+	return serial_uart_getchar(&serial3_uart);
+}
+
+int serial3_read(void *buf, unsigned int count)
+{
+	return serial_uart_read(&serial3_uart, buf, count);
+}
+
+int serial3_peek(void)
+{
+	return serial_uart_peek(&serial3_uart);
+}
+
+void serial3_clear(void)
+{
+	serial_uart_clear(&serial3_uart);
+}
+
+void serial3_add_memory_for_read(void *buffer, size_t length)
+{
+	serial_uart_add_memory_for_read(&serial3_uart, buffer, length);
+}
+
+void serial3_add_memory_for_write(void *buffer, size_t length)
+{
+	serial_uart_add_memory_for_write(&serial3_uart, buffer, length);
+}
+
+int serial3_set_dma(uint8_t rx, uint8_t tx)
+{
+	return serial_uart_set_dma(&serial3_uart, rx, tx);
+}
+
+void uart2_status_isr(void)
+{
+	serial_uart_isr(&serial3_uart);
+}
+
+void uart2_error_isr(void)
+{
+	serial_uart_isr(&serial3_uart);
+}
+
+static void dma_rx_isr(void)
+{
+	serial_uart_dma_rx_isr(&serial3_uart);
+}
+
+static void dma_tx_isr(void)
+{
+	serial_uart_dma_tx_isr(&serial3_uart);
+}
+
+#elif defined(KINETISL)
+
 ////////////////////////////////////////////////////////////////
 // changes not recommended below this point....
 ////////////////////////////////////////////////////////////////
@@ -71,14 +261,6 @@ static size_t rts_low_watermark_ = RTS_LOW_WATERMARK;
 static size_t rts_high_watermark_ = RTS_HIGH_WATERMARK;
 
 static volatile uint8_t transmitting = 0;
-#if defined(KINETISK)
-  static volatile uint8_t *transmit_pin=NULL;
-  #define transmit_assert()   *transmit_pin = 1
-  #define transmit_deassert() *transmit_pin = 0
-  static volatile uint8_t *rts_pin=NULL;
-  #define rts_assert()        *rts_pin = 0
-  #define rts_deassert()      *rts_pin = 1
-#elif defined(KINETISL)
   static volatile uint8_t *transmit_pin=NULL;
   static uint8_t transmit_mask=0;
   #define transmit_assert()   *(transmit_pin+4) = transmit_mask;
@@ -87,7 +269,6 @@ static volatile uint8_t transmitting = 0;
   static uint8_t rts_mask=0;
   #define rts_assert()        *(rts_pin+8) = rts_mask;
   #define rts_deassert()      *(rts_pin+4) = rts_mask;
-#endif
 #if SERIAL3_TX_BUFFER_SIZE > 65535
 static volatile uint32_t tx_buffer_head = 0;
 static volatile uint32_t tx_buffer_tail = 0;
@@ -108,14 +289,10 @@ static volatile uint16_t rx_buffer_tail = 0;
 static volatile uint8_t rx_buffer_head = 0;
 static volatile uint8_t rx_buffer_tail = 0;
 #endif
-#if defined(KINETISL)
 static uint8_t rx_pin_num = 7;
-#endif
 static uint8_t tx_pin_num = 8;
 
-#if defined(KINETISL)
 static uint8_t half_duplex_mode = 0;
-#endif
 
 // UART0 and UART1 are clocked by F_CPU, UART2 is clocked by F_BUS
 // UART0 has 8 byte fifo, UART1 and UART2 have 1 byte buffer
@@ -138,10 +315,6 @@ void serial3_begin(uint32_t divisor)
 	tx_buffer_head = 0;
 	tx_buffer_tail = 0;
 	transmitting = 0;
-#if defined(KINETISK)
-	CORE_PIN7_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(3);
-	CORE_PIN8_CONFIG = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(3);
-#elif defined(KINETISL)
 	switch (rx_pin_num) {
 		case 7: CORE_PIN7_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(3); break;
 		case 6: CORE_PIN6_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(3); break;
@@ -150,20 +323,10 @@ void serial3_begin(uint32_t divisor)
 		case 8:  CORE_PIN8_CONFIG = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(3); break;
 		case 20: CORE_PIN20_CONFIG = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(3); break;
 	}
-#endif
-#if defined(HAS_KINETISK_UART2)
-	if (divisor < 32) divisor = 32;
-	UART2_BDH = (divisor >> 13) & 0x1F;
-	UART2_BDL = (divisor >> 5) & 0xFF;
-	UART2_C4 = divisor & 0x1F;
-	UART2_C1 = 0;
-	UART2_PFIFO = 0;
-#elif defined(HAS_KINETISL_UART2)
 	if (divisor < 1) divisor = 1;
 	UART2_BDH = (divisor >> 8) & 0x1F;
 	UART2_BDL = divisor & 0xFF;
 	UART2_C1 = 0;
-#endif
 	UART2_C2 = C2_TX_INACTIVE;
 	NVIC_SET_PRIORITY(IRQ_UART2_STATUS, IRQ_PRIORITY);
 	NVIC_ENABLE_IRQ(IRQ_UART2_STATUS);
@@ -173,6 +336,10 @@ void serial3_format(uint32_t format)
 {
 	uint8_t c;
 
+#ifndef SERIAL_9BIT_SUPPORT
+	// 9 bit data needs 16 bit buffers, so fall back to the 8 bit format
+	if (format & 0x80) format &= (format & 0x08) ? ~0x88 : ~0x84;
+#endif
 	c = UART2_C1;
 	c = (c & ~0x13) | (format & 0x03);	// configure parity
 	if (format & 0x04) c |= 0x10;		// 9 bits (might include parity)
@@ -184,20 +351,12 @@ void serial3_format(uint32_t format)
 	c = UART2_C3 & ~0x10;
 	if (format & 0x20) c |= 0x10;		// tx invert
 	UART2_C3 = c;
-#if defined(SERIAL_9BIT_SUPPORT) && !defined(KINETISL)
-	c = UART2_C4 & 0x1F;
-	if (format & 0x08) c |= 0x20;		// 9 bit mode with parity (requires 10 bits)
-	UART2_C4 = c;
-	use9Bits = format & 0x80;
-#endif
-#if defined(__MK64FX512__) || defined(__MK66FX1M0__) || defined(KINETISL)
 	// For T3.5/T3.6/TLC See about turning on 2 stop bit mode
 	if ( format & 0x100) {
 		uint8_t bdl = UART2_BDL;
 		UART2_BDH |= UART_BDH_SBNS;		// Turn on 2 stop bits - was turned off by set baud
 		UART2_BDL = bdl;		// Says BDH not acted on until BDL is written
 	}
-#endif
 	// process request for half duplex.
 	if ((format & SERIAL_HALF_DUPLEX) != 0) {
 		c = UART2_C1;
@@ -206,7 +365,6 @@ void serial3_format(uint32_t format)
 
 
 		// Lets try to make use of bitband address to set the direction for ue...
-		#if defined(KINETISL)
 		uint32_t pin_cfg = PORT_PCR_PE | PORT_PCR_PFE | PORT_PCR_MUX(3);
 		if ((format & 0x20) == 0) pin_cfg |=  PORT_PCR_PS;  // if not inverted PU else leve as PD
 		switch (tx_pin_num) {
@@ -214,20 +372,9 @@ void serial3_format(uint32_t format)
 			case 20: CORE_PIN20_CONFIG = pin_cfg; break;
 		}
 		half_duplex_mode = 1; 
-		#else
-		volatile uint32_t *reg = portConfigRegister(tx_pin_num);
-		uint32_t pin_cfg = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(3) | PORT_PCR_PE;
-		if ((format & 0x20) == 0) pin_cfg |=  PORT_PCR_PS;  // if not inverted PU else leve as PD
-		*reg = pin_cfg;
-		transmit_pin = (uint8_t*)GPIO_BITBAND_PTR(UART2_C3, C3_TXDIR_BIT);
-		#endif
 
 	} else {
-		#if defined(KINETISL)
 		half_duplex_mode = 0; 
-		#else
-		if (transmit_pin == (uint8_t*)GPIO_BITBAND_PTR(UART2_C3, C3_TXDIR_BIT)) transmit_pin = NULL;
-		#endif
 	}
 
 }
@@ -238,10 +385,6 @@ void serial3_end(void)
 	while (transmitting) yield();  // wait for buffered data to send
 	NVIC_DISABLE_IRQ(IRQ_UART2_STATUS);
 	UART2_C2 = 0;
-	#if defined(KINETISK)
-	CORE_PIN7_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1);
-	CORE_PIN8_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1);
-	#elif defined(KINETISL)
 	switch (rx_pin_num) {
 		case 7: CORE_PIN7_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1); break;
 		case 6: CORE_PIN6_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1); break;
@@ -250,7 +393,6 @@ void serial3_end(void)
 		case 8:  CORE_PIN8_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1); break;
 		case 20: CORE_PIN20_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1); break;
 	}
-	#endif	
 	UART2_S1;
 	UART2_D; // clear leftover error status
 	rx_buffer_head = 0;
@@ -264,9 +406,7 @@ void serial3_set_transmit_pin(uint8_t pin)
 	pinMode(pin, OUTPUT);
 	digitalWrite(pin, LOW);
 	transmit_pin = portOutputRegister(pin);
-	#if defined(KINETISL)
 	transmit_mask = digitalPinToBitMask(pin);
-	#endif
 }
 
 void serial3_set_tx(uint8_t pin, uint8_t opendrain)
@@ -278,9 +418,7 @@ void serial3_set_tx(uint8_t pin, uint8_t opendrain)
 	if ((SIM_SCGC4 & SIM_SCGC4_UART2)) {
 		switch (tx_pin_num & 127) {
 			case 8:  CORE_PIN8_CONFIG = 0; break; // PTD3
-	#if defined(KINETISL)
 			case 20: CORE_PIN20_CONFIG = 0; break; // PTD5
-	#endif
 		}
 		if (opendrain) {
 			cfg = PORT_PCR_DSE | PORT_PCR_ODE;
@@ -289,9 +427,7 @@ void serial3_set_tx(uint8_t pin, uint8_t opendrain)
 		}
 		switch (pin & 127) {
 			case 8:  CORE_PIN8_CONFIG = cfg | PORT_PCR_MUX(3); break;
-	#if defined(KINETISL)
 			case 20: CORE_PIN20_CONFIG = cfg | PORT_PCR_MUX(3); break;
-	#endif
 		}
 	}
 	tx_pin_num = pin;
@@ -299,7 +435,6 @@ void serial3_set_tx(uint8_t pin, uint8_t opendrain)
 
 void serial3_set_rx(uint8_t pin)
 {
-	#if defined(KINETISL)
 	if (pin == rx_pin_num) return;
 	if ((SIM_SCGC4 & SIM_SCGC4_UART2)) {
 		switch (rx_pin_num) {
@@ -312,7 +447,6 @@ void serial3_set_rx(uint8_t pin)
 		}
 	}
 	rx_pin_num = pin;
-	#endif
 }
 
 int serial3_set_rts(uint8_t pin)
@@ -320,9 +454,7 @@ int serial3_set_rts(uint8_t pin)
 	if (!(SIM_SCGC4 & SIM_SCGC4_UART2)) return 0;
 	if (pin < CORE_NUM_DIGITAL) {
 		rts_pin = portOutputRegister(pin);
-		#if defined(KINETISL)
 		rts_mask = digitalPinToBitMask(pin);
-		#endif
 		pinMode(pin, OUTPUT);
 		rts_assert();
 	} else {
@@ -343,19 +475,7 @@ int serial3_set_rts(uint8_t pin)
 
 int serial3_set_cts(uint8_t pin)
 {
-#if defined(KINETISK)
-	if (!(SIM_SCGC4 & SIM_SCGC4_UART2)) return 0;
-	if (pin == 14) {
-		CORE_PIN14_CONFIG = PORT_PCR_MUX(3) | PORT_PCR_PE; // weak pulldown
-	} else {
-		UART2_MODEM &= ~UART_MODEM_TXCTSE;
-		return 0;
-	}
-	UART2_MODEM |= UART_MODEM_TXCTSE;
-	return 1;
-#else
 	return 0;
-#endif
 }
 
 void serial3_putchar(uint32_t c)
@@ -364,7 +484,6 @@ void serial3_putchar(uint32_t c)
 
 	if (!(SIM_SCGC4 & SIM_SCGC4_UART2)) return;
 	if (transmit_pin) transmit_assert();
-	#if defined(KINETISL)
 	if (half_duplex_mode) {
 		__disable_irq();
 		volatile uint32_t reg = UART2_C3;
@@ -372,7 +491,6 @@ void serial3_putchar(uint32_t c)
 		UART2_C3 = reg;
 		__enable_irq();
 	}
-	#endif 
 	head = tx_buffer_head;
 	if (++head >= tx_buffer_total_size_) head = 0;
 	while (tx_buffer_tail == head) {
@@ -538,7 +656,6 @@ void uart2_status_isr(void)
 	if ((c & UART_C2_TCIE) && (UART2_S1 & UART_S1_TC)) {
 		transmitting = 0;
 		if (transmit_pin) transmit_deassert();
-		#if defined(KINETISL)
 		if (transmit_pin) transmit_deassert();
 		if (half_duplex_mode) {
 			__disable_irq();
@@ -547,7 +664,6 @@ void uart2_status_isr(void)
 			UART2_C3 = reg;
 			__enable_irq();
 		}
-		#endif
 		UART2_C2 = C2_TX_INACTIVE;
 	}
 }
@@ -575,3 +691,22 @@ void serial3_add_memory_for_write(void *buffer, size_t length)
 	} 
 }
 
+// no DMA on this port
+int serial3_set_dma(uint8_t rx, uint8_t tx)
+{
+	return !rx && !tx;
+}
+
+int serial3_read(void *buf, unsigned int count)
+{
+	uint8_t *p = (uint8_t *)buf;
+	unsigned int n = 0;
+	int c;
+
+	while (n < count && (c = serial3_getchar()) >= 0) {
+		p[n++] = c;
+	}
+	return n;
+}
+
+#endif // KINETISL
@@ -31,8 +31,14 @@
 #include "kinetis.h"
 #include "core_pins.h"
 #include "HardwareSerial.h"
+#include "serial_uart.h"
 #include <stddef.h>
 
+// 9 bit formats on Serial6 only, see HardwareSerial.h
+#if defined(SERIAL6_9BIT_SUPPORT) && !defined(SERIAL_9BIT_SUPPORT)
+#define SERIAL_9BIT_SUPPORT
+#endif
+
 #ifdef HAS_KINETISK_UART5
 
 ////////////////////////////////////////////////////////////////
@@ -49,409 +55,161 @@
 #define RTS_LOW_WATERMARK  (SERIAL6_RX_BUFFER_SIZE-38) // RTS allows sender to resume
 #define IRQ_PRIORITY  64  // 0 = highest priority, 255 = lowest
 
-
-////////////////////////////////////////////////////////////////
-// changes not recommended below this point....
-////////////////////////////////////////////////////////////////
-
 #ifdef SERIAL_9BIT_SUPPORT
-static uint8_t use9Bits = 0;
 #define BUFTYPE uint16_t
 #else
 #define BUFTYPE uint8_t
-#define use9Bits 0
 #endif
 
 static volatile BUFTYPE tx_buffer[SERIAL6_TX_BUFFER_SIZE];
 static volatile BUFTYPE rx_buffer[SERIAL6_RX_BUFFER_SIZE];
-static volatile BUFTYPE	*rx_buffer_storage_ = NULL;
-static volatile BUFTYPE	*tx_buffer_storage_ = NULL;
-
-static size_t tx_buffer_total_size_ = SERIAL6_TX_BUFFER_SIZE;
-static size_t rx_buffer_total_size_ = SERIAL6_RX_BUFFER_SIZE;
-static size_t rts_low_watermark_ = RTS_LOW_WATERMARK;
-static size_t rts_high_watermark_ = RTS_HIGH_WATERMARK;
-
-static volatile uint8_t transmitting = 0;
-static volatile uint8_t *transmit_pin=NULL;
-#define transmit_assert()   *transmit_pin = 1
-#define transmit_deassert() *transmit_pin = 0
-static volatile uint8_t *rts_pin=NULL;
-#define rts_assert()        *rts_pin = 0
-#define rts_deassert()      *rts_pin = 1
-#if SERIAL6_TX_BUFFER_SIZE > 65535
-static volatile uint32_t tx_buffer_head = 0;
-static volatile uint32_t tx_buffer_tail = 0;
-#elif SERIAL6_TX_BUFFER_SIZE > 255
-static volatile uint16_t tx_buffer_head = 0;
-static volatile uint16_t tx_buffer_tail = 0;
-#else
-static volatile uint8_t tx_buffer_head = 0;
-static volatile uint8_t tx_buffer_tail = 0;
-#endif
-#if SERIAL6_RX_BUFFER_SIZE > 65535
-static volatile uint32_t rx_buffer_head = 0;
-static volatile uint32_t rx_buffer_tail = 0;
-#elif SERIAL6_RX_BUFFER_SIZE > 255
-static volatile uint16_t rx_buffer_head = 0;
-static volatile uint16_t rx_buffer_tail = 0;
-#else
-static volatile uint8_t rx_buffer_head = 0;
-static volatile uint8_t rx_buffer_tail = 0;
-#endif
-
-static uint8_t tx_pin_num = 48;
-
-// UART0 and UART1 are clocked by F_CPU, UART2 is clocked by F_BUS
-// UART0 has 8 byte fifo, UART1 and UART2 have 1 byte buffer
 
-#define C2_ENABLE		UART_C2_TE | UART_C2_RE | UART_C2_RIE
-#define C2_TX_ACTIVE		C2_ENABLE | UART_C2_TIE
-#define C2_TX_COMPLETING	C2_ENABLE | UART_C2_TCIE
-#define C2_TX_INACTIVE		C2_ENABLE
-
-// BITBAND Support
-#define GPIO_BITBAND_ADDR(reg, bit) (((uint32_t)&(reg) - 0x40000000) * 32 + (bit) * 4 + 0x42000000)
-#define GPIO_BITBAND_PTR(reg, bit) ((uint32_t *)GPIO_BITBAND_ADDR((reg), (bit)))
-#define C3_TXDIR_BIT 5
+static const uint8_t rx_pins[] = {
+	47,
+};
+static const uint8_t tx_pins[] = {
+	48,
+};
+static const uint8_t cts_pins[] = {
+	56,
+};
+
+static serial_uart_state_t state = {
+	.rx_total_size = SERIAL6_RX_BUFFER_SIZE,
+	.tx_total_size = SERIAL6_TX_BUFFER_SIZE,
+	.rts_low_watermark = RTS_LOW_WATERMARK,
+	.rts_high_watermark = RTS_HIGH_WATERMARK,
+	.rx_pin_num = 47,
+	.tx_pin_num = 48,
+};
+
+const serial_uart_t serial6_uart = {
+	.uart = &KINETISK_UART5,
+	.clock_gate = &SIM_SCGC1,
+	.clock_mask = SIM_SCGC1_UART5,
+	.irq = IRQ_UART5_STATUS,
+	.irq_priority = IRQ_PRIORITY,
+#ifdef SERIAL_9BIT_SUPPORT
+	.wide = 1,
+#endif
+	.rx_pin_count = sizeof(rx_pins),
+	.tx_pin_count = sizeof(tx_pins),
+	.cts_pin_count = sizeof(cts_pins),
+	.rx_pins = rx_pins,
+	.tx_pins = tx_pins,
+	.cts_pins = cts_pins,
+	.rts_low_offset = SERIAL6_RX_BUFFER_SIZE - RTS_LOW_WATERMARK,
+	.rts_high_offset = SERIAL6_RX_BUFFER_SIZE - RTS_HIGH_WATERMARK,
+	.rx_buffer = rx_buffer,
+	.tx_buffer = tx_buffer,
+	.rx_buffer_size = SERIAL6_RX_BUFFER_SIZE,
+	.tx_buffer_size = SERIAL6_TX_BUFFER_SIZE,
+	.state = &state,
+};
 
 void serial6_begin(uint32_t divisor)
 {
-	SIM_SCGC1 |= SIM_SCGC1_UART5;	// turn on clock, TODO: use bitband
-	rx_buffer_head = 0;
-	rx_buffer_tail = 0;
-	tx_buffer_head = 0;
-	tx_buffer_tail = 0;
-	transmitting = 0;
-	CORE_PIN47_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(3);
-	CORE_PIN48_CONFIG = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(3);
-	if (divisor < 32) divisor = 32;
-	UART5_BDH = (divisor >> 13) & 0x1F;
-	UART5_BDL = (divisor >> 5) & 0xFF;
-	UART5_C4 = divisor & 0x1F;
-	UART5_C1 = 0;
-	UART5_PFIFO = 0;
-	UART5_C2 = C2_TX_INACTIVE;
-	NVIC_SET_PRIORITY(IRQ_UART5_STATUS, IRQ_PRIORITY);
-	NVIC_ENABLE_IRQ(IRQ_UART5_STATUS);
+	serial_uart_begin(&serial6_uart, divisor);
 }
 
 void serial6_format(uint32_t format)
 {
-	uint8_t c;
-
-	c = UART5_C1;
-	c = (c & ~0x13) | (format & 0x03);	// configure parity
-	if (format & 0x04) c |= 0x10;		// 9 bits (might include parity)
-	UART5_C1 = c;
-	if ((format & 0x0F) == 0x04) UART5_C3 |= 0x40; // 8N2 is 9 bit with 9th bit always 1
-	c = UART5_S2 & ~0x10;
-	if (format & 0x10) c |= 0x10;		// rx invert
-	UART5_S2 = c;
-	c = UART5_C3 & ~0x10;
-	if (format & 0x20) c |= 0x10;		// tx invert
-	UART5_C3 = c;
-#ifdef SERIAL_9BIT_SUPPORT
-	c = UART5_C4 & 0x1F;
-	if (format & 0x08) c |= 0x20;		// 9 bit mode with parity (requires 10 bits)
-	UART5_C4 = c;
-	use9Bits = format & 0x80;
-#endif
-	// For T3.5 See about turning on 2 stop bit mode
-	if ( format & 0x100) {
-		uint8_t bdl = UART5_BDL;
-		UART5_BDH |= UART_BDH_SBNS;		// Turn on 2 stop bits - was turned off by set baud
-		UART5_BDL = bdl;		// Says BDH not acted on until BDL is written
-	}
-	// process request for half duplex.
-	if ((format & SERIAL_HALF_DUPLEX) != 0) {
-		UART5_C1 |= UART_C1_LOOPS | UART_C1_RSRC;
-		volatile uint32_t *reg = portConfigRegister(tx_pin_num);
-		uint32_t pin_cfg = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(3) | PORT_PCR_PE;
-		if ((format & 0x20) == 0) pin_cfg |=  PORT_PCR_PS;  // if not inverted PU else leve as PD
-		*reg = pin_cfg;
-
-		// Lets try to make use of bitband address to set the direction for ue...
-		transmit_pin = (uint8_t*)GPIO_BITBAND_PTR(UART5_C3, C3_TXDIR_BIT);
-
-	} else {
-		if (transmit_pin == (uint8_t*)GPIO_BITBAND_PTR(UART5_C3, C3_TXDIR_BIT)) transmit_pin = NULL;
-	}
+	serial_uart_format(&serial6_uart, format);
 }
 
 void serial6_end(void)
 {
-	if (!(SIM_SCGC1 & SIM_SCGC1_UART5)) return;
-	while (transmitting) yield();  // wait for buffered data to send
-	NVIC_DISABLE_IRQ(IRQ_UART5_STATUS);
-	UART5_C2 = 0;
-	CORE_PIN47_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1);
-	CORE_PIN48_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1);
-	UART5_S1;
-	UART5_D; // clear leftover error status
-	rx_buffer_head = 0;
-	rx_buffer_tail = 0;
-	if (rts_pin) rts_deassert();
+	serial_uart_end(&serial6_uart);
 }
 
 void serial6_set_transmit_pin(uint8_t pin)
 {
-	while (transmitting) ;
-	pinMode(pin, OUTPUT);
-	digitalWrite(pin, LOW);
-	transmit_pin = portOutputRegister(pin);
+	serial_uart_set_transmit_pin(&serial6_uart, pin);
 }
 
 void serial6_set_tx(uint8_t pin, uint8_t opendrain)
 {
-	uint32_t cfg;
-
-	if (opendrain) pin |= 128;
-	if (pin == tx_pin_num) return;
-	if ((SIM_SCGC1 & SIM_SCGC1_UART5)) {
-		switch (tx_pin_num & 127) {
-			case 48:  CORE_PIN48_CONFIG = 0; break; // PTE24
-		}
-		if (opendrain) {
-			cfg = PORT_PCR_DSE | PORT_PCR_ODE;
-		} else {
-			cfg = PORT_PCR_DSE | PORT_PCR_SRE;
-		}
-		switch (pin & 127) {
-			case 48:  CORE_PIN48_CONFIG = cfg | PORT_PCR_MUX(3); break;
-		}
-	}
-	tx_pin_num = pin;
+	serial_uart_set_tx(&serial6_uart, pin, opendrain);
 }
 
 void serial6_set_rx(uint8_t pin)
 {
+	serial_uart_set_rx(&serial6_uart, pin);
 }
 
 int serial6_set_rts(uint8_t pin)
 {
-	if (!(SIM_SCGC1 & SIM_SCGC1_UART5)) return 0;
-	if (pin < CORE_NUM_DIGITAL) {
-		rts_pin = portOutputRegister(pin);
-		pinMode(pin, OUTPUT);
-		rts_assert();
-	} else {
-		rts_pin = NULL;
-		return 0;
-	}
-	return 1;
+	return serial_uart_set_rts(&serial6_uart, pin);
 }
 
 int serial6_set_cts(uint8_t pin)
 {
-	if (!(SIM_SCGC1 & SIM_SCGC1_UART5)) return 0;
-	if (pin == 56) {
-		CORE_PIN56_CONFIG = PORT_PCR_MUX(3) | PORT_PCR_PE; // weak pulldown
-	} else {
-		UART5_MODEM &= ~UART_MODEM_TXCTSE;
-		return 0;
-	}
-	UART5_MODEM |= UART_MODEM_TXCTSE;
-	return 1;
+	return serial_uart_set_cts(&serial6_uart, pin);
 }
 
 void serial6_putchar(uint32_t c)
 {
-	uint32_t head, n;
-
-	if (!(SIM_SCGC1 & SIM_SCGC1_UART5)) return;
-	if (transmit_pin) transmit_assert();
-	head = tx_buffer_head;
-	if (++head >= tx_buffer_total_size_) head = 0;
-	while (tx_buffer_tail == head) {
-		int priority = nvic_execution_priority();
-		if (priority <= IRQ_PRIORITY) {
-			if ((UART5_S1 & UART_S1_TDRE)) {
-				uint32_t tail = tx_buffer_tail;
-				if (++tail >= tx_buffer_total_size_) tail = 0;
-				if (tail < SERIAL6_TX_BUFFER_SIZE) {
-					n = tx_buffer[tail];
-				} else {
-					n = tx_buffer_storage_[tail-SERIAL6_TX_BUFFER_SIZE];
-				}
-				if (use9Bits) UART5_C3 = (UART5_C3 & ~0x40) | ((n & 0x100) >> 2);
-				UART5_D = n;
-				tx_buffer_tail = tail;
-			}
-		} else if (priority >= 256) {
-			yield(); // wait
-		}
-	}
-	if (head < SERIAL6_TX_BUFFER_SIZE) {
-		tx_buffer[head] = c;
-	} else {
-		tx_buffer_storage_[head - SERIAL6_TX_BUFFER_SIZE] = c;
-	}
-	transmitting = 1;
-	tx_buffer_head = head;
-	UART5_C2 = C2_TX_ACTIVE;
+	serial_uart_putchar(&serial6_uart, c);
 }
 
 void serial6_write(const void *buf, unsigned int count)
 {
-	const uint8_t *p = (const uint8_t *)buf;
-	while (count-- > 0) serial6_putchar(*p++);
+	serial_uart_write(&serial6_uart, buf, count);
 }
 
 void serial6_flush(void)
 {
-	while (transmitting) yield(); // wait
+	serial_uart_flush(&serial6_uart);
 }
 
 int serial6_write_buffer_free(void)
 {
-	uint32_t head, tail;
-
-	head = tx_buffer_head;
-	tail = tx_buffer_tail;
-	if (head >= tail) return tx_buffer_total_size_ - 1 - head + tail;
-	return tail - head - 1;
+	return serial_uart_write_buffer_free(&serial6_uart);
 }
 
 int serial6_available(void)
 {
-	uint32_t head, tail;
-
-	head = rx_buffer_head;
-	tail = rx_buffer_tail;
-	if (head >= tail) return head - tail;
-	return rx_buffer_total_size_ + head - tail;
+	return serial_uart_available(&serial6_uart);
 }
 
 int serial6_getchar(void)
 {
-	uint32_t head, tail;
-	int c;
-
-	head = rx_buffer_head;
-	tail = rx_buffer_tail;
-	if (head == tail) return -1;
-	if (++tail >= rx_buffer_total_size_) tail = 0;
-	if (tail < SERIAL6_RX_BUFFER_SIZE) {
-		c = rx_buffer[tail];
-	} else {
-		c = rx_buffer_storage_[tail-SERIAL6_RX_BUFFER_SIZE];
-	}
-	rx_buffer_tail = tail;
-	if (rts_pin) {
-		int avail;
-		if (head >= tail) avail = head - tail;
-		else avail = rx_buffer_total_size_ + head - tail;
-		if (avail <= rts_low_watermark_) rts_assert();
-	}
-	return c;
+	return serial_uart_getchar(&serial6_uart);
 }
 
-int serial6_peek(void)
+int serial6_read(void *buf, unsigned int count)
 {
-	uint32_t head, tail;
-
-	head = rx_buffer_head;
-	tail = rx_buffer_tail;
-	if (head == tail) return -1;
-	if (++tail >= rx_buffer_total_size_) tail = 0;
-	if (tail < SERIAL6_RX_BUFFER_SIZE) {
-		return rx_buffer[tail];
-	}
-	return rx_buffer_storage_[tail-SERIAL6_RX_BUFFER_SIZE];
+	return serial_uart_read(&serial6_uart, buf, count);
 }
 
-void serial6_clear(void)
+int serial6_peek(void)
 {
-	rx_buffer_head = rx_buffer_tail;
-	if (rts_pin) rts_assert();
+	return serial_uart_peek(&serial6_uart);
 }
 
-// status interrupt combines
-//   Transmit data below watermark  UART_S1_TDRE
-//   Transmit complete		    UART_S1_TC
-//   Idle line			    UART_S1_IDLE
-//   Receive data above watermark   UART_S1_RDRF
-//   LIN break detect		    UART_S2_LBKDIF
-//   RxD pin active edge	    UART_S2_RXEDGIF
-
-void uart5_status_isr(void)
+void serial6_clear(void)
 {
-	uint32_t head, tail, n;
-	uint8_t c;
-
-	if (UART5_S1 & UART_S1_RDRF) {
-		if (use9Bits && (UART5_C3 & 0x80)) {
-			n = UART5_D | 0x100;
-		} else {
-			n = UART5_D;
-		}
-		head = rx_buffer_head + 1;
-		if (head >= rx_buffer_total_size_) head = 0;
-		if (head != rx_buffer_tail) {
-			if (head < SERIAL6_RX_BUFFER_SIZE) {
-				rx_buffer[head] = n;
-			} else {
-				rx_buffer_storage_[head-SERIAL6_RX_BUFFER_SIZE] = n;
-			}
-
-			rx_buffer_head = head;
-		}
-		if (rts_pin) {
-			int avail;
-			tail = tx_buffer_tail;
-			if (head >= tail) avail = head - tail;
-			else avail = rx_buffer_total_size_ + head - tail;
-			if (avail >= rts_high_watermark_) rts_deassert();
-		}
-	}
-	c = UART5_C2;
-	if ((c & UART_C2_TIE) && (UART5_S1 & UART_S1_TDRE)) {
-		head = tx_buffer_head;
-		tail = tx_buffer_tail;
-		if (head == tail) {
-			UART5_C2 = C2_TX_COMPLETING;
-		} else {
-			if (++tail >= tx_buffer_total_size_) tail = 0;
-			if (tail < SERIAL6_TX_BUFFER_SIZE) {
-				n = tx_buffer[tail];
-			} else {
-				n = tx_buffer_storage_[tail-SERIAL6_TX_BUFFER_SIZE];
-			}
-			if (use9Bits) UART5_C3 = (UART5_C3 & ~0x40) | ((n & 0x100) >> 2);
-			UART5_D = n;
-			tx_buffer_tail = tail;
-		}
-	}
-	if ((c & UART_C2_TCIE) && (UART5_S1 & UART_S1_TC)) {
-		transmitting = 0;
-		if (transmit_pin) transmit_deassert();
-		UART5_C2 = C2_TX_INACTIVE;
-	}
+	serial_uart_clear(&serial6_uart);
 }
 
 void serial6_add_memory_for_read(void *buffer, size_t length)
 {
-	rx_buffer_storage_ = (BUFTYPE*)buffer;
-	if (buffer) {
-		rx_buffer_total_size_ = SERIAL6_RX_BUFFER_SIZE + length;
-	} else {
-		rx_buffer_total_size_ = SERIAL6_RX_BUFFER_SIZE;
-	} 
-
-	rts_low_watermark_ = RTS_LOW_WATERMARK + length;
-	rts_high_watermark_ = RTS_HIGH_WATERMARK + length;
+	serial_uart_add_memory_for_read(&serial6_uart, buffer, length);
 }
 
 void serial6_add_memory_for_write(void *buffer, size_t length)
 {
-	tx_buffer_storage_ = (BUFTYPE*)buffer;
-	if (buffer) {
-		tx_buffer_total_size_ = SERIAL6_TX_BUFFER_SIZE + length;
-	} else {
-		tx_buffer_total_size_ = SERIAL6_TX_BUFFER_SIZE;
-	} 
+	serial_uart_add_memory_for_write(&serial6_uart, buffer, length);
+}
+
+int serial6_set_dma(uint8_t rx, uint8_t tx)
+{
+	return serial_uart_set_dma(&serial6_uart, rx, tx);
 }
 
+void uart5_status_isr(void)
+{
+	serial_uart_isr(&serial6_uart);
+}
 
 #endif // HAS_KINETISK_UART5
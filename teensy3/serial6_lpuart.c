@@ -32,6 +32,11 @@
 #include "core_pins.h"
 #include "HardwareSerial.h"
 
+// 9 bit formats on Serial6 only, see HardwareSerial.h
+#if defined(SERIAL6_9BIT_SUPPORT) && !defined(SERIAL_9BIT_SUPPORT)
+#define SERIAL_9BIT_SUPPORT
+#endif
+
 #ifdef HAS_KINETISK_LPUART0
 
 #define GPIO_BITBAND_ADDR(reg, bit) (((uint32_t)&(reg) - 0x40000000) * 32 + (bit) * 4 + 0x42000000)
@@ -422,6 +427,18 @@ int serial6_getchar(void)
 	return c;
 }
 
+int serial6_read(void *buf, unsigned int count)
+{
+	uint8_t *p = (uint8_t *)buf;
+	unsigned int n = 0;
+	int c;
+
+	while (n < count && (c = serial6_getchar()) >= 0) {
+		p[n++] = c;
+	}
+	return n;
+}
+
 int serial6_peek(void)
 {
 	uint32_t head, tail;
@@ -532,5 +549,11 @@ void serial6_add_memory_for_write(void *buffer, size_t length)
 	} 
 }
 
+// no DMA on this port
+int serial6_set_dma(uint8_t rx, uint8_t tx)
+{
+	return !rx && !tx;
+}
+
 
 #endif // HAS_KINETISK_LPUART0
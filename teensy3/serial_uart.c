@@ -0,0 +1,977 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "kinetis.h"
+#include "core_pins.h"
+#include "HardwareSerial.h"
+#include "serial_uart.h"
+#include "DMAChannel.h"
+#include <string.h>
+
+#if defined(KINETISK)
+
+#define C2_ENABLE(s)		(UART_C2_TE | UART_C2_RE | UART_C2_RIE | C2_IDLE(s))
+#define C2_IDLE(s)		(((s)->fifo && !(s)->state->dma_rx) ? UART_C2_ILIE : 0)
+#define C2_TX_ACTIVE(s)		(C2_ENABLE(s) | UART_C2_TIE)
+#define C2_TX_COMPLETING(s)	(C2_ENABLE(s) | UART_C2_TCIE)
+#define C2_TX_INACTIVE(s)	C2_ENABLE(s)
+
+#define transmit_assert(st)	*(st)->transmit_pin = 1
+#define transmit_deassert(st)	*(st)->transmit_pin = 0
+#define rts_assert(st)		*(st)->rts_pin = 0
+#define rts_deassert(st)	*(st)->rts_pin = 1
+
+#define FIFO_SIZE 8
+
+// BITBAND Support
+#define GPIO_BITBAND_ADDR(reg, bit) (((uint32_t)&(reg) - 0x40000000) * 32 + (bit) * 4 + 0x42000000)
+#define GPIO_BITBAND_PTR(reg, bit) ((uint32_t *)GPIO_BITBAND_ADDR((reg), (bit)))
+#define C3_TXDIR_BIT 5
+
+// DMA channels are allocated with the same bitmask as DMAChannel
+#if DMA_NUM_CHANNELS <= 16
+#define DMA_MAX_CHANNELS	DMA_NUM_CHANNELS
+#else
+#define DMA_MAX_CHANNELS	16
+#endif
+#define DMA_MAX_COUNT		32767	// CITER without channel linking
+
+typedef struct __attribute__((packed, aligned(4))) {
+	volatile const void * volatile SADDR;
+	int16_t SOFF;
+	uint16_t ATTR;
+	uint32_t NBYTES;
+	int32_t SLAST;
+	volatile void * volatile DADDR;
+	int16_t DOFF;
+	volatile uint16_t CITER;
+	int32_t DLASTSGA;
+	volatile uint16_t CSR;
+	volatile uint16_t BITER;
+} dma_tcd_t;
+
+#define DMA_TCD(ch)		((dma_tcd_t *)&DMA_TCD0_SADDR + (ch))
+#define DMAMUX_CHCFG(ch)	((&DMAMUX0_CHCFG0)[ch])
+#define dma_running(channel)	(DMA_ERQ & (1 << ((channel) - 1)))
+
+static inline int clock_enabled(const serial_uart_t *s)
+{
+	return (*s->clock_gate & s->clock_mask) != 0;
+}
+
+static int pin_in_list(uint8_t pin, const uint8_t *list, uint8_t count)
+{
+	for (uint8_t i=0; i < count; i++) {
+		if (list[i] == pin) return 1;
+	}
+	return 0;
+}
+
+// Buffer element at index, which may be in the memory added by the user
+static inline uint32_t buffer_get(const serial_uart_t *s, volatile void *buffer,
+  volatile void *storage, size_t size, uint32_t index)
+{
+	if (index >= size) {
+		buffer = storage;
+		index -= size;
+	}
+	if (!s->wide) return ((volatile uint8_t *)buffer)[index];
+	return ((volatile uint16_t *)buffer)[index];
+}
+
+static inline void buffer_put(const serial_uart_t *s, volatile void *buffer,
+  volatile void *storage, size_t size, uint32_t index, uint32_t c)
+{
+	if (index >= size) {
+		buffer = storage;
+		index -= size;
+	}
+	if (!s->wide) ((volatile uint8_t *)buffer)[index] = c;
+	else ((volatile uint16_t *)buffer)[index] = c;
+}
+
+#define rx_get(s, index) buffer_get((s), (s)->rx_buffer, (s)->state->rx_storage, (s)->rx_buffer_size, (index))
+#define rx_put(s, index, c) buffer_put((s), (s)->rx_buffer, (s)->state->rx_storage, (s)->rx_buffer_size, (index), (c))
+#define tx_get(s, index) buffer_get((s), (s)->tx_buffer, (s)->state->tx_storage, (s)->tx_buffer_size, (index))
+#define tx_put(s, index, c) buffer_put((s), (s)->tx_buffer, (s)->state->tx_storage, (s)->tx_buffer_size, (index), (c))
+
+static inline uint32_t rx_data(const serial_uart_t *s)
+{
+	// 9th bit in C3 must be read before D
+	if (s->state->use9Bits && (s->uart->C3 & 0x80)) {
+		return s->uart->D | 0x100;
+	}
+	return s->uart->D;
+}
+
+static inline void tx_data(const serial_uart_t *s, uint32_t n)
+{
+	KINETISK_UART_t *uart = s->uart;
+	if (s->state->use9Bits) uart->C3 = (uart->C3 & ~0x40) | ((n & 0x100) >> 2);
+	uart->D = n;
+}
+
+static inline uint32_t rx_used(serial_uart_state_t *st, uint32_t head, uint32_t tail)
+{
+	if (head >= tail) return head - tail;
+	return st->rx_total_size + head - tail;
+}
+
+// With DMA receive, the last byte written is just before the DMA address.
+// The DMA laps, counted by its interrupt, are compared with the laps of
+// rx_tail to find whether unread data was overwritten.  If so, the oldest
+// bytes are discarded, keeping the newest full buffer.
+static uint32_t dma_rx_head(const serial_uart_t *s)
+{
+	serial_uart_state_t *st = s->state;
+	uint32_t ch = st->dma_rx - 1;
+	uint32_t size = s->rx_buffer_size;
+	uint32_t laps, pos, pending, unread;
+
+	do {
+		// a lap done but not yet counted by the interrupt shows in DMA_INT
+		laps = st->dma_rx_laps;
+		pending = DMA_INT & (1 << ch);
+		pos = (volatile uint8_t *)DMA_TCD(ch)->DADDR - (volatile uint8_t *)s->rx_buffer;
+	} while (pending != (DMA_INT & (1 << ch)) || laps != st->dma_rx_laps);
+	if (pending) laps++;
+	unread = (laps - st->dma_rx_tail_laps) * size + pos - 1 - st->rx_tail;
+	if (unread >= size) {
+		st->rx_dropped += unread - (size - 1);
+		st->rx_tail = pos;
+		st->dma_rx_tail_laps = laps - 1;
+	}
+	return pos ? pos - 1 : size - 1;
+}
+
+static inline uint32_t rx_head(const serial_uart_t *s)
+{
+	serial_uart_state_t *st = s->state;
+
+	if (st->dma_rx && dma_running(st->dma_rx)) return dma_rx_head(s);
+	return st->rx_head;
+}
+
+// rx_tail moves less than one lap per call, so wrapping is seen by it going down
+static inline void rx_set_tail(serial_uart_state_t *st, uint32_t tail)
+{
+	if (st->dma_rx && tail < st->rx_tail) st->dma_rx_tail_laps++;
+	st->rx_tail = tail;
+}
+
+// Returns 1 + channel, or 0 if all are in use
+static uint8_t dma_channel_alloc(void)
+{
+	uint32_t ch;
+
+	__disable_irq();
+	for (ch=0; ch < DMA_MAX_CHANNELS; ch++) {
+		if (!(dma_channel_allocated_mask & (1 << ch))) break;
+	}
+	if (ch >= DMA_MAX_CHANNELS) {
+		__enable_irq();
+		return 0;
+	}
+	dma_channel_allocated_mask |= (1 << ch);
+	__enable_irq();
+	SIM_SCGC7 |= SIM_SCGC7_DMA;
+	SIM_SCGC6 |= SIM_SCGC6_DMAMUX;
+#if DMA_NUM_CHANNELS <= 16
+	DMA_CR = DMA_CR_EMLM | DMA_CR_EDBG;
+#else
+	DMA_CR = DMA_CR_GRP1PRI | DMA_CR_EMLM | DMA_CR_EDBG;
+#endif
+	DMA_CERQ = ch;
+	DMA_CERR = ch;
+	DMA_CEEI = ch;
+	DMA_CINT = ch;
+	memset(DMA_TCD(ch), 0, sizeof(dma_tcd_t));
+	return ch + 1;
+}
+
+static void dma_channel_free(uint8_t channel)
+{
+	uint32_t ch = channel - 1;
+
+	DMA_CERQ = ch;
+	DMAMUX_CHCFG(ch) = 0;
+	__disable_irq();
+	dma_channel_allocated_mask &= ~(1 << ch);
+	__enable_irq();
+}
+
+// Receive DMA runs in a circle around rx_buffer, starting after rx_head.
+// Transmit DMA is started by tx_start() when there is data.
+static void dma_start(const serial_uart_t *s)
+{
+	KINETISK_UART_t *uart = s->uart;
+	serial_uart_state_t *st = s->state;
+	uint32_t ch;
+
+	if (st->dma_rx) {
+		ch = st->dma_rx - 1;
+		dma_tcd_t *tcd = DMA_TCD(ch);
+		uint32_t pos = st->rx_head + 1;
+		// count laps so unread data from rx_tail to rx_head is still unread
+		st->dma_rx_tail_laps = 0;
+		st->dma_rx_laps = (st->rx_head < st->rx_tail) ? 1 : 0;
+		if (pos >= s->rx_buffer_size) {
+			pos = 0;
+			st->dma_rx_laps++;
+		}
+		DMA_CERQ = ch;
+		DMAMUX_CHCFG(ch) = 0;
+		tcd->SADDR = &uart->D;
+		tcd->SOFF = 0;
+		tcd->ATTR = 0;
+		tcd->NBYTES = 1;
+		tcd->SLAST = 0;
+		tcd->DADDR = (volatile uint8_t *)s->rx_buffer + pos;
+		tcd->DOFF = 1;
+		tcd->CITER = s->rx_buffer_size - pos;
+		tcd->BITER = s->rx_buffer_size;
+		tcd->DLASTSGA = -(int32_t)s->rx_buffer_size;
+		tcd->CSR = DMA_TCD_CSR_INTMAJOR;
+		DMA_CINT = ch;
+		_VectorsRam[IRQ_DMA_CH0 + ch + 16] = s->dma_rx_isr;
+		NVIC_SET_PRIORITY(IRQ_DMA_CH0 + ch, s->irq_priority);
+		NVIC_ENABLE_IRQ(IRQ_DMA_CH0 + ch);
+		DMAMUX_CHCFG(ch) = s->dma_rx_source | DMAMUX_ENABLE;
+		DMA_SERQ = ch;
+		if (s->fifo) uart->RWFIFO = 1; // request every byte, none wait in the FIFO
+		uart->C5 |= UART_C5_RDMAS;
+		// overrun blocks the receiver until S1 and D are read, and with
+		// DMA there is no receive interrupt to do it
+		uart->C3 |= UART_C3_ORIE;
+		NVIC_SET_PRIORITY(s->irq_error, s->irq_priority);
+		NVIC_ENABLE_IRQ(s->irq_error);
+	}
+	if (st->dma_tx) {
+		ch = st->dma_tx - 1;
+		DMA_CERQ = ch;
+		st->dma_tx_count = 0;
+		DMAMUX_CHCFG(ch) = 0;
+		DMAMUX_CHCFG(ch) = s->dma_tx_source | DMAMUX_ENABLE;
+		_VectorsRam[IRQ_DMA_CH0 + ch + 16] = s->dma_tx_isr;
+		NVIC_SET_PRIORITY(IRQ_DMA_CH0 + ch, s->irq_priority);
+		NVIC_ENABLE_IRQ(IRQ_DMA_CH0 + ch);
+		uart->C5 |= UART_C5_TDMAS;
+	}
+	uart->C2 = C2_TX_INACTIVE(s);
+}
+
+// Back to interrupts.  Data already received stays in the buffer.
+static void dma_stop(const serial_uart_t *s)
+{
+	KINETISK_UART_t *uart = s->uart;
+	serial_uart_state_t *st = s->state;
+	uint32_t ch;
+
+	if (st->dma_rx) {
+		st->rx_head = rx_head(s);
+		ch = st->dma_rx - 1;
+		DMA_CERQ = ch;
+		NVIC_DISABLE_IRQ(IRQ_DMA_CH0 + ch);
+		NVIC_DISABLE_IRQ(s->irq_error);
+		uart->C3 &= ~UART_C3_ORIE;
+		uart->C5 &= ~UART_C5_RDMAS;
+		if (s->fifo) uart->RWFIFO = s->rx_watermark;
+	}
+	if (st->dma_tx) {
+		ch = st->dma_tx - 1;
+		DMA_CERQ = ch;
+		NVIC_DISABLE_IRQ(IRQ_DMA_CH0 + ch);
+		uart->C5 &= ~UART_C5_TDMAS;
+		st->dma_tx_count = 0;
+	}
+}
+
+// Transmit DMA sends from tx_tail up to tx_head, or to the end of the
+// buffer or the added memory, and interrupts when done to send the rest
+static void dma_tx_next(const serial_uart_t *s)
+{
+	serial_uart_state_t *st = s->state;
+	uint32_t ch = st->dma_tx - 1;
+	dma_tcd_t *tcd = DMA_TCD(ch);
+	uint32_t start, end;
+	volatile uint8_t *p;
+
+	start = st->tx_tail + 1;
+	if (start >= st->tx_total_size) start = 0;
+	end = (st->tx_head >= start) ? st->tx_head + 1 : st->tx_total_size;
+	if (start < s->tx_buffer_size) {
+		if (end > s->tx_buffer_size) end = s->tx_buffer_size;
+		p = (volatile uint8_t *)s->tx_buffer + start;
+	} else {
+		p = (volatile uint8_t *)st->tx_storage + start - s->tx_buffer_size;
+	}
+	if (end - start > DMA_MAX_COUNT) end = start + DMA_MAX_COUNT;
+	tcd->SADDR = p;
+	tcd->SOFF = 1;
+	tcd->ATTR = 0;
+	tcd->NBYTES = 1;
+	tcd->SLAST = 0;
+	tcd->DADDR = &s->uart->D;
+	tcd->DOFF = 0;
+	tcd->CITER = end - start;
+	tcd->BITER = end - start;
+	tcd->DLASTSGA = 0;
+	tcd->CSR = DMA_TCD_CSR_INTMAJOR | DMA_TCD_CSR_DREQ;
+	st->dma_tx_count = end - start;
+	DMA_SERQ = ch;
+	s->uart->C2 = C2_TX_ACTIVE(s);
+}
+
+// Begin sending new data in the transmit buffer
+static void tx_start(const serial_uart_t *s)
+{
+	serial_uart_state_t *st = s->state;
+
+	if (!st->dma_tx) {
+		s->uart->C2 = C2_TX_ACTIVE(s);
+		return;
+	}
+	__disable_irq();
+	if (st->dma_tx_count == 0 && st->tx_head != st->tx_tail) dma_tx_next(s);
+	__enable_irq();
+}
+
+void serial_uart_begin(const serial_uart_t *s, uint32_t divisor)
+{
+	KINETISK_UART_t *uart = s->uart;
+	serial_uart_state_t *st = s->state;
+
+	*s->clock_gate |= s->clock_mask;	// turn on clock, TODO: use bitband
+	st->rx_head = 0;
+	st->rx_tail = 0;
+	st->tx_head = 0;
+	st->tx_tail = 0;
+	st->transmitting = 0;
+	st->interrupt_count = 0;
+	st->interrupt_bytes = 0;
+	st->rx_overruns = 0;
+	st->rx_dropped = 0;
+	if (pin_in_list(st->rx_pin_num, s->rx_pins, s->rx_pin_count)) {
+		*portConfigRegister(st->rx_pin_num) = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(3);
+	}
+	if (pin_in_list(st->tx_pin_num & 127, s->tx_pins, s->tx_pin_count)) {
+		*portConfigRegister(st->tx_pin_num & 127) = PORT_PCR_DSE | PORT_PCR_MUX(3)
+			| ((st->tx_pin_num & 128) ? PORT_PCR_ODE : PORT_PCR_SRE);
+	}
+	if (divisor < 32) divisor = 32;
+	uart->BDH = (divisor >> 13) & 0x1F;
+	uart->BDL = (divisor >> 5) & 0xFF;
+	uart->C4 = divisor & 0x1F;
+	if (s->fifo) {
+		uart->C1 = UART_C1_ILT;
+		uart->TWFIFO = s->tx_watermark; // tx watermark, causes S1_TDRE to set
+		uart->RWFIFO = s->rx_watermark; // rx watermark, causes S1_RDRF to set
+		uart->PFIFO = UART_PFIFO_TXFE | UART_PFIFO_RXFE;
+	} else {
+		uart->C1 = 0;
+		uart->PFIFO = 0;
+	}
+	uart->C2 = C2_TX_INACTIVE(s);
+	if (st->dma_rx || st->dma_tx) dma_start(s);
+	NVIC_SET_PRIORITY(s->irq, s->irq_priority);
+	NVIC_ENABLE_IRQ(s->irq);
+}
+
+void serial_uart_format(const serial_uart_t *s, uint32_t format)
+{
+	KINETISK_UART_t *uart = s->uart;
+	serial_uart_state_t *st = s->state;
+	uint8_t c;
+
+	// 9 bit data needs 16 bit buffers, so fall back to the 8 bit format
+	if ((format & 0x80) && !s->wide) format &= (format & 0x08) ? ~0x88 : ~0x84;
+	c = uart->C1;
+	c = (c & ~0x13) | (format & 0x03);	// configure parity
+	if (format & 0x04) c |= 0x10;		// 9 bits (might include parity)
+	uart->C1 = c;
+	if ((format & 0x0F) == 0x04) uart->C3 |= 0x40; // 8N2 is 9 bit with 9th bit always 1
+	c = uart->S2 & ~0x10;
+	if (format & 0x10) c |= 0x10;		// rx invert
+	uart->S2 = c;
+	c = uart->C3 & ~0x10;
+	if (format & 0x20) c |= 0x10;		// tx invert
+	uart->C3 = c;
+	if (s->wide) {
+		c = uart->C4 & 0x1F;
+		if (format & 0x08) c |= 0x20;	// 9 bit mode with parity (requires 10 bits)
+		uart->C4 = c;
+		st->use9Bits = format & 0x80;
+	}
+#if defined(__MK64FX512__) || defined(__MK66FX1M0__)
+	// For T3.5/T3.6 See about turning on 2 stop bit mode
+	if ( format & 0x100) {
+		uint8_t bdl = uart->BDL;
+		uart->BDH |= UART_BDH_SBNS;	// Turn on 2 stop bits - was turned off by set baud
+		uart->BDL = bdl;		// Says BDH not acted on until BDL is written
+	}
+#endif
+	// process request for half duplex.
+	if ((format & SERIAL_HALF_DUPLEX) != 0) {
+		uart->C1 |= UART_C1_LOOPS | UART_C1_RSRC;
+		volatile uint32_t *reg = portConfigRegister(st->tx_pin_num & 127);
+		uint32_t pin_cfg = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(3) | PORT_PCR_PE;
+		if ((format & 0x20) == 0) pin_cfg |=  PORT_PCR_PS;  // if not inverted PU else leve as PD
+		*reg = pin_cfg;
+		// Lets try to make use of bitband address to set the direction for ue...
+		st->transmit_pin = (uint8_t*)GPIO_BITBAND_PTR(uart->C3, C3_TXDIR_BIT);
+	} else {
+		if (st->transmit_pin == (uint8_t*)GPIO_BITBAND_PTR(uart->C3, C3_TXDIR_BIT)) st->transmit_pin = NULL;
+	}
+}
+
+void serial_uart_end(const serial_uart_t *s)
+{
+	KINETISK_UART_t *uart = s->uart;
+	serial_uart_state_t *st = s->state;
+
+	if (!clock_enabled(s)) return;
+	while (st->transmitting) yield();  // wait for buffered data to send
+	NVIC_DISABLE_IRQ(s->irq);
+	dma_stop(s);
+	uart->C2 = 0;
+	if (pin_in_list(st->rx_pin_num, s->rx_pins, s->rx_pin_count)) {
+		*portConfigRegister(st->rx_pin_num) = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1);
+	}
+	if (pin_in_list(st->tx_pin_num & 127, s->tx_pins, s->tx_pin_count)) {
+		*portConfigRegister(st->tx_pin_num & 127) = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1);
+	}
+	uart->S1;
+	uart->D; // clear leftover error status
+	st->rx_head = 0;
+	st->rx_tail = 0;
+	if (st->rts_pin) rts_deassert(st);
+}
+
+void serial_uart_set_transmit_pin(const serial_uart_t *s, uint8_t pin)
+{
+	serial_uart_state_t *st = s->state;
+
+	while (st->transmitting) ;
+	pinMode(pin, OUTPUT);
+	digitalWrite(pin, LOW);
+	st->transmit_pin = portOutputRegister(pin);
+}
+
+void serial_uart_set_tx(const serial_uart_t *s, uint8_t pin, uint8_t opendrain)
+{
+	serial_uart_state_t *st = s->state;
+	uint32_t cfg;
+
+	if (opendrain) pin |= 128;
+	if (pin == st->tx_pin_num) return;
+	if (!pin_in_list(pin & 127, s->tx_pins, s->tx_pin_count)) return;
+	if (clock_enabled(s)) {
+		*portConfigRegister(st->tx_pin_num & 127) = 0;
+		if (opendrain) {
+			cfg = PORT_PCR_DSE | PORT_PCR_ODE;
+		} else {
+			cfg = PORT_PCR_DSE | PORT_PCR_SRE;
+		}
+		*portConfigRegister(pin & 127) = cfg | PORT_PCR_MUX(3);
+	}
+	st->tx_pin_num = pin;
+}
+
+void serial_uart_set_rx(const serial_uart_t *s, uint8_t pin)
+{
+	serial_uart_state_t *st = s->state;
+
+	if (pin == st->rx_pin_num) return;
+	if (!pin_in_list(pin, s->rx_pins, s->rx_pin_count)) return;
+	if (clock_enabled(s)) {
+		*portConfigRegister(st->rx_pin_num) = 0;
+		*portConfigRegister(pin) = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(3);
+	}
+	st->rx_pin_num = pin;
+}
+
+int serial_uart_set_rts(const serial_uart_t *s, uint8_t pin)
+{
+	serial_uart_state_t *st = s->state;
+
+	if (!clock_enabled(s)) return 0;
+	if (pin < CORE_NUM_DIGITAL && !st->dma_rx) {
+		st->rts_pin = portOutputRegister(pin);
+		pinMode(pin, OUTPUT);
+		rts_assert(st);
+	} else {
+		st->rts_pin = NULL;
+		return 0;
+	}
+	return 1;
+}
+
+int serial_uart_set_cts(const serial_uart_t *s, uint8_t pin)
+{
+	KINETISK_UART_t *uart = s->uart;
+
+	if (!clock_enabled(s)) return 0;
+	if (pin_in_list(pin, s->cts_pins, s->cts_pin_count)) {
+		*portConfigRegister(pin) = PORT_PCR_MUX(3) | PORT_PCR_PE; // weak pulldown
+	} else {
+		uart->MODEM &= ~UART_MODEM_TXCTSE;
+		return 0;
+	}
+	uart->MODEM |= UART_MODEM_TXCTSE;
+	return 1;
+}
+
+// Wait for the interrupt to make room in the transmit buffer, or move data
+// ourselves if called at or above the interrupt's priority
+static void tx_wait(const serial_uart_t *s, uint32_t head)
+{
+	serial_uart_state_t *st = s->state;
+
+	while (st->tx_tail == head) {
+		int priority = nvic_execution_priority();
+		if (priority <= s->irq_priority) {
+			if (st->dma_tx) {
+				// DMA keeps sending, but its interrupt can't run
+				serial_uart_dma_tx_isr(s);
+			} else if ((s->uart->S1 & UART_S1_TDRE)) {
+				uint32_t tail = st->tx_tail;
+				if (++tail >= st->tx_total_size) tail = 0;
+				tx_data(s, tx_get(s, tail));
+				st->tx_tail = tail;
+			}
+		} else if (priority >= 256) {
+			yield(); // wait
+		}
+	}
+}
+
+void serial_uart_putchar(const serial_uart_t *s, uint32_t c)
+{
+	serial_uart_state_t *st = s->state;
+	uint32_t head;
+
+	if (!clock_enabled(s)) return;
+	if (st->transmit_pin) transmit_assert(st);
+	head = st->tx_head;
+	if (++head >= st->tx_total_size) head = 0;
+	if (st->tx_tail == head) tx_wait(s, head);
+	tx_put(s, head, c);
+	st->transmitting = 1;
+	st->tx_head = head;
+	tx_start(s);
+}
+
+// Copy as much as fits into the transmit buffer at once, rather than
+// enabling the interrupt for every byte.
+void serial_uart_write(const serial_uart_t *s, const void *buf, unsigned int count)
+{
+	serial_uart_state_t *st = s->state;
+	const uint8_t *p = (const uint8_t *)buf;
+	const uint8_t *end = p + count;
+
+	if (!clock_enabled(s)) return;
+	if (st->transmit_pin) transmit_assert(st);
+	while (p < end) {
+		uint32_t head = st->tx_head;
+		uint32_t tail = st->tx_tail;
+		uint32_t space;
+		if (head >= tail) space = st->tx_total_size - 1 - head + tail;
+		else space = tail - head - 1;
+		if (space == 0) {
+			tx_start(s);
+			if (++head >= st->tx_total_size) head = 0;
+			tx_wait(s, head);
+			continue;
+		}
+		if (space > (uint32_t)(end - p)) space = end - p;
+		do {
+			if (++head >= st->tx_total_size) head = 0;
+			tx_put(s, head, *p++);
+		} while (--space > 0);
+		st->transmitting = 1;
+		st->tx_head = head;
+	}
+	tx_start(s);
+}
+
+void serial_uart_flush(const serial_uart_t *s)
+{
+	while (s->state->transmitting) yield(); // wait
+}
+
+int serial_uart_write_buffer_free(const serial_uart_t *s)
+{
+	serial_uart_state_t *st = s->state;
+	uint32_t head, tail;
+
+	head = st->tx_head;
+	tail = st->tx_tail;
+	if (head >= tail) return st->tx_total_size - 1 - head + tail;
+	return tail - head - 1;
+}
+
+int serial_uart_available(const serial_uart_t *s)
+{
+	serial_uart_state_t *st = s->state;
+	uint32_t head = rx_head(s);	// may move rx_tail, if DMA overwrote it
+
+	return rx_used(st, head, st->rx_tail);
+}
+
+int serial_uart_getchar(const serial_uart_t *s)
+{
+	serial_uart_state_t *st = s->state;
+	uint32_t head, tail;
+	int c;
+
+	head = rx_head(s);
+	tail = st->rx_tail;
+	if (head == tail) return -1;
+	if (++tail >= st->rx_total_size) tail = 0;
+	c = rx_get(s, tail);
+	rx_set_tail(st, tail);
+	if (st->rts_pin) {
+		if (rx_used(st, head, tail) <= st->rts_low_watermark) rts_assert(st);
+	}
+	return c;
+}
+
+// Copy everything already received, up to count bytes, in one call.
+// On 9 bit ports only the low 8 bits are stored.
+int serial_uart_read(const serial_uart_t *s, void *buf, unsigned int count)
+{
+	serial_uart_state_t *st = s->state;
+	uint8_t *p = (uint8_t *)buf;
+	uint32_t head, tail;
+	unsigned int n = 0;
+
+	head = rx_head(s);
+	tail = st->rx_tail;
+	while (n < count && tail != head) {
+		if (++tail >= st->rx_total_size) tail = 0;
+		p[n++] = rx_get(s, tail);
+	}
+	rx_set_tail(st, tail);
+	if (st->rts_pin) {
+		if (rx_used(st, head, tail) <= st->rts_low_watermark) rts_assert(st);
+	}
+	return n;
+}
+
+int serial_uart_peek(const serial_uart_t *s)
+{
+	serial_uart_state_t *st = s->state;
+	uint32_t head, tail;
+
+	head = rx_head(s);
+	tail = st->rx_tail;
+	if (head == tail) return -1;
+	if (++tail >= st->rx_total_size) tail = 0;
+	return rx_get(s, tail);
+}
+
+void serial_uart_clear(const serial_uart_t *s)
+{
+	serial_uart_state_t *st = s->state;
+	KINETISK_UART_t *uart = s->uart;
+
+	if (s->fifo) {
+		if (!clock_enabled(s)) return;
+		uart->C2 &= ~(UART_C2_RE | UART_C2_RIE | UART_C2_ILIE);
+		uart->CFIFO = UART_CFIFO_RXFLUSH;
+		uart->C2 |= (UART_C2_RE | UART_C2_RIE | C2_IDLE(s));
+	}
+	if (st->dma_rx && dma_running(st->dma_rx)) {
+		rx_set_tail(st, rx_head(s));
+	} else {
+		st->rx_head = st->rx_tail;
+	}
+	if (st->rts_pin) rts_assert(st);
+}
+
+void serial_uart_add_memory_for_read(const serial_uart_t *s, void *buffer, size_t length)
+{
+	serial_uart_state_t *st = s->state;
+
+	if (st->dma_rx) return; // DMA needs one contiguous buffer
+	st->rx_storage = buffer;
+	if (buffer) {
+		st->rx_total_size = s->rx_buffer_size + (s->wide ? length / 2 : length);
+	} else {
+		st->rx_total_size = s->rx_buffer_size;
+	}
+	st->rts_low_watermark = st->rx_total_size - s->rts_low_offset;
+	st->rts_high_watermark = st->rx_total_size - s->rts_high_offset;
+}
+
+void serial_uart_add_memory_for_write(const serial_uart_t *s, void *buffer, size_t length)
+{
+	serial_uart_state_t *st = s->state;
+
+	st->tx_storage = buffer;
+	if (buffer) {
+		st->tx_total_size = s->tx_buffer_size + (s->wide ? length / 2 : length);
+	} else {
+		st->tx_total_size = s->tx_buffer_size;
+	}
+}
+
+int serial_uart_set_dma(const serial_uart_t *s, uint8_t rx, uint8_t tx)
+{
+	serial_uart_state_t *st = s->state;
+	int running = clock_enabled(s);
+
+	if ((rx || tx) && (!s->dma_rx_source || s->wide)) return 0;
+	if (rx && (st->rts_pin || st->rx_storage || s->rx_buffer_size > DMA_MAX_COUNT)) return 0;
+	if (running) {
+		while (st->transmitting) yield();  // wait for buffered data to send
+		NVIC_DISABLE_IRQ(s->irq);
+		dma_stop(s);
+	}
+	if (rx && !st->dma_rx) {
+		st->dma_rx = dma_channel_alloc();
+	} else if (!rx && st->dma_rx) {
+		dma_channel_free(st->dma_rx);
+		st->dma_rx = 0;
+	}
+	if (tx && !st->dma_tx) {
+		st->dma_tx = dma_channel_alloc();
+	} else if (!tx && st->dma_tx) {
+		dma_channel_free(st->dma_tx);
+		st->dma_tx = 0;
+	}
+	if (running) {
+		s->uart->C2 = C2_TX_INACTIVE(s);
+		if (st->dma_rx || st->dma_tx) dma_start(s);
+		NVIC_ENABLE_IRQ(s->irq);
+	}
+	return (!rx || st->dma_rx) && (!tx || st->dma_tx);
+}
+
+// Receive DMA wrapped around to the start of rx_buffer
+void serial_uart_dma_rx_isr(const serial_uart_t *s)
+{
+	serial_uart_state_t *st = s->state;
+
+	DMA_CINT = st->dma_rx - 1;
+	st->dma_rx_laps++;
+	st->interrupt_count++;
+	st->interrupt_bytes += s->rx_buffer_size;
+}
+
+// Transmit DMA complete, also polled by tx_wait()
+void serial_uart_dma_tx_isr(const serial_uart_t *s)
+{
+	serial_uart_state_t *st = s->state;
+	uint32_t ch = st->dma_tx - 1;
+	uint32_t count = st->dma_tx_count;
+	uint32_t tail;
+
+	if (count == 0 || !(DMA_TCD(ch)->CSR & DMA_TCD_CSR_DONE)) return;
+	DMA_CINT = ch;
+	DMA_CDNE = ch;
+	tail = st->tx_tail + count;
+	if (tail >= st->tx_total_size) tail -= st->tx_total_size;
+	st->tx_tail = tail;
+	st->dma_tx_count = 0;
+	if (tail != st->tx_head) {
+		dma_tx_next(s);
+	} else {
+		s->uart->C2 = C2_TX_COMPLETING(s);
+	}
+	st->interrupt_count++;
+	st->interrupt_bytes += count;
+}
+
+void serial_uart_interrupt_stats(const serial_uart_t *s, uint32_t *interrupts, uint32_t *bytes)
+{
+	__disable_irq();
+	if (interrupts) *interrupts = s->state->interrupt_count;
+	if (bytes) *bytes = s->state->interrupt_bytes;
+	__enable_irq();
+}
+
+void serial_uart_rx_stats(const serial_uart_t *s, uint32_t *overruns, uint32_t *dropped)
+{
+	serial_uart_state_t *st = s->state;
+
+	if (st->dma_rx && dma_running(st->dma_rx)) (void)rx_head(s);
+	__disable_irq();
+	if (overruns) *overruns = st->rx_overruns;
+	if (dropped) *dropped = st->rx_dropped;
+	__enable_irq();
+}
+
+// status interrupt combines
+//   Transmit data below watermark  UART_S1_TDRE
+//   Transmit complete		    UART_S1_TC
+//   Idle line			    UART_S1_IDLE
+//   Receive data above watermark   UART_S1_RDRF
+//   LIN break detect		    UART_S2_LBKDIF
+//   RxD pin active edge	    UART_S2_RXEDGIF
+
+static uint32_t isr_receive(const serial_uart_t *s)
+{
+	KINETISK_UART_t *uart = s->uart;
+	serial_uart_state_t *st = s->state;
+	uint32_t head, tail, newhead, avail, n;
+	uint8_t s1;
+
+	if (st->dma_rx) return 0;
+	s1 = uart->S1;
+	if (s1 & UART_S1_OR) st->rx_overruns++; // cleared by reading D below
+	if (s->fifo) {
+		if (!(s1 & (UART_S1_RDRF | UART_S1_IDLE))) return 0;
+		__disable_irq();
+		avail = uart->RCFIFO;
+		if (avail == 0) {
+			// The only way to clear the IDLE interrupt flag is
+			// to read the data register.  But reading with no
+			// data causes a FIFO underrun, which causes the
+			// FIFO to return corrupted data.  If anyone from
+			// Freescale reads this, what a poor design!  There
+			// write should be a write-1-to-clear for IDLE.
+			(void)uart->D;
+			// flushing the fifo recovers from the underrun,
+			// but there's a possible race condition where a
+			// new character could be received between reading
+			// RCFIFO == 0 and flushing the FIFO.  To minimize
+			// the chance, interrupts are disabled so a higher
+			// priority interrupt (hopefully) doesn't delay.
+			// TODO: change this to disabling the IDLE interrupt
+			// which won't be simple, since we already manage
+			// which transmit interrupts are enabled.
+			uart->CFIFO = UART_CFIFO_RXFLUSH;
+			__enable_irq();
+			return 0;
+		}
+		__enable_irq();
+	} else {
+		if (!(s1 & UART_S1_RDRF)) return 0;
+		avail = 1;
+	}
+	head = st->rx_head;
+	tail = st->rx_tail;
+	n = avail;
+	do {
+		uint32_t c = rx_data(s);
+		newhead = head + 1;
+		if (newhead >= st->rx_total_size) newhead = 0;
+		if (newhead != tail) {
+			head = newhead;
+			rx_put(s, head, c);
+		} else {
+			st->rx_dropped++;
+		}
+	} while (--n > 0);
+	st->rx_head = head;
+	if (st->rts_pin) {
+		if (rx_used(st, head, tail) >= st->rts_high_watermark) rts_deassert(st);
+	}
+	return avail;
+}
+
+// With DMA receive, only the error interrupt sees an overrun.  Reading S1
+// then D clears it.  A byte still waiting for the DMA is lost by that read.
+// If none was waiting, reading D underflows the FIFO, so it is flushed as
+// in isr_receive().
+static void isr_dma_overrun(const serial_uart_t *s)
+{
+	KINETISK_UART_t *uart = s->uart;
+	serial_uart_state_t *st = s->state;
+	uint8_t s1 = uart->S1;
+
+	if (!(s1 & UART_S1_OR)) return;
+	__disable_irq();
+	if (s->fifo ? uart->RCFIFO > 0 : (s1 & UART_S1_RDRF)) {
+		(void)uart->D;
+		st->rx_dropped++;
+	} else {
+		(void)uart->D;
+		if (s->fifo) uart->CFIFO = UART_CFIFO_RXFLUSH;
+	}
+	__enable_irq();
+	st->rx_overruns++;
+}
+
+static uint32_t isr_transmit(const serial_uart_t *s)
+{
+	KINETISK_UART_t *uart = s->uart;
+	serial_uart_state_t *st = s->state;
+	uint32_t head, tail, count = 0;
+
+	head = st->tx_head;
+	tail = st->tx_tail;
+	if (s->fifo) {
+		do {
+			if (tail == head) break;
+			if (++tail >= st->tx_total_size) tail = 0;
+			(void)uart->S1;
+			tx_data(s, tx_get(s, tail));
+			count++;
+		} while (uart->TCFIFO < FIFO_SIZE);
+		st->tx_tail = tail;
+		if (uart->S1 & UART_S1_TDRE) uart->C2 = C2_TX_COMPLETING(s);
+	} else {
+		if (head == tail) {
+			uart->C2 = C2_TX_COMPLETING(s);
+		} else {
+			if (++tail >= st->tx_total_size) tail = 0;
+			tx_data(s, tx_get(s, tail));
+			st->tx_tail = tail;
+			count = 1;
+		}
+	}
+	return count;
+}
+
+void serial_uart_isr(const serial_uart_t *s)
+{
+	KINETISK_UART_t *uart = s->uart;
+	serial_uart_state_t *st = s->state;
+	uint32_t bytes;
+	uint8_t c;
+
+	if (st->dma_rx) isr_dma_overrun(s);
+	bytes = isr_receive(s);
+	c = uart->C2;
+	if ((c & UART_C2_TIE) && !st->dma_tx && (uart->S1 & UART_S1_TDRE)) {
+		bytes += isr_transmit(s);
+	}
+	if ((c & UART_C2_TCIE) && (uart->S1 & UART_S1_TC)) {
+		st->transmitting = 0;
+		if (st->transmit_pin) transmit_deassert(st);
+		uart->C2 = C2_TX_INACTIVE(s);
+	}
+	st->interrupt_count++;
+	st->interrupt_bytes += bytes;
+}
+
+#endif // KINETISK
@@ -0,0 +1,169 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Common driver for the Kinetis K UARTs used by serial1.c - serial6.c on
+// Teensy 3.x.  Each serialN.c file supplies the buffers and a description of
+// its UART and pins, then implements the serialN_* functions by calling these.
+// Teensy LC's UARTs and the LPUART used for Serial6 on Teensy 3.6 are a
+// different design and keep their own code.
+
+#ifndef serial_uart_h_
+#define serial_uart_h_
+
+#include "kinetis.h"
+#include <stddef.h>
+
+#if defined(KINETISK)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Things which change while running
+typedef struct {
+	volatile void *rx_storage;	// memory from serialN_add_memory_for_read()
+	volatile void *tx_storage;	// memory from serialN_add_memory_for_write()
+	size_t rx_total_size;
+	size_t tx_total_size;
+	size_t rts_low_watermark;
+	size_t rts_high_watermark;
+	volatile uint32_t rx_head;
+	volatile uint32_t rx_tail;
+	volatile uint32_t tx_head;
+	volatile uint32_t tx_tail;
+	volatile uint8_t transmitting;
+	volatile uint8_t *transmit_pin;
+	volatile uint8_t *rts_pin;
+	uint8_t rx_pin_num;
+	uint8_t tx_pin_num;		// bit 7 set for open drain
+	uint8_t use9Bits;
+	// measure interrupt load: interrupts serviced and bytes moved by them
+	volatile uint32_t interrupt_count;
+	volatile uint32_t interrupt_bytes;
+	volatile uint32_t rx_overruns;	// receiver overrun (OR) events, data lost in the UART
+	volatile uint32_t rx_dropped;	// bytes lost because the receive buffer was full
+	uint8_t dma_rx;			// 1 + DMA channel receiving, or 0 without DMA
+	uint8_t dma_tx;			// 1 + DMA channel transmitting, or 0 without DMA
+	volatile uint16_t dma_tx_count;	// bytes in the transmit DMA now running
+	volatile uint32_t dma_rx_laps;	// times receive DMA wrapped around rx_buffer
+	uint32_t dma_rx_tail_laps;	// times rx_tail wrapped, while DMA receives
+} serial_uart_state_t;
+
+// Fixed description of each port, normally in flash
+typedef struct {
+	KINETISK_UART_t *uart;
+	volatile uint32_t *clock_gate;	// SIM_SCGCx register
+	uint32_t clock_mask;
+	uint8_t irq;			// IRQ_UARTx_STATUS
+	uint8_t irq_error;		// IRQ_UARTx_ERROR, for overrun during DMA receive
+	uint8_t irq_priority;
+	uint8_t fifo;			// 1 if this UART has the 8 byte FIFOs
+	uint8_t tx_watermark;		// with FIFO, TDRE sets at or below this many bytes
+	uint8_t rx_watermark;		// with FIFO, RDRF sets at or above this many bytes
+	uint8_t wide;			// buffers are uint16_t, allowing 9 bit formats
+	uint8_t rx_pin_count;
+	uint8_t tx_pin_count;
+	uint8_t cts_pin_count;
+	const uint8_t *rx_pins;		// all pins use mux ALT3 on Teensy 3.x
+	const uint8_t *tx_pins;
+	const uint8_t *cts_pins;
+	uint16_t rts_low_offset;	// RTS allows sender to resume this far below full
+	uint16_t rts_high_offset;	// RTS requests sender to pause this far below full
+	volatile void *rx_buffer;
+	volatile void *tx_buffer;
+	size_t rx_buffer_size;
+	size_t tx_buffer_size;
+	uint8_t dma_rx_source;		// DMAMUX_SOURCE_UARTx_RX, or 0 if no DMA
+	uint8_t dma_tx_source;		// DMAMUX_SOURCE_UARTx_TX
+	void (*dma_rx_isr)(void);	// calls serial_uart_dma_rx_isr() for this port
+	void (*dma_tx_isr)(void);	// calls serial_uart_dma_tx_isr() for this port
+	serial_uart_state_t *state;
+} serial_uart_t;
+
+void serial_uart_begin(const serial_uart_t *s, uint32_t divisor);
+void serial_uart_format(const serial_uart_t *s, uint32_t format);
+void serial_uart_end(const serial_uart_t *s);
+void serial_uart_set_transmit_pin(const serial_uart_t *s, uint8_t pin);
+void serial_uart_set_rx(const serial_uart_t *s, uint8_t pin);
+void serial_uart_set_tx(const serial_uart_t *s, uint8_t pin, uint8_t opendrain);
+int serial_uart_set_rts(const serial_uart_t *s, uint8_t pin);
+int serial_uart_set_cts(const serial_uart_t *s, uint8_t pin);
+void serial_uart_putchar(const serial_uart_t *s, uint32_t c);
+void serial_uart_write(const serial_uart_t *s, const void *buf, unsigned int count);
+void serial_uart_flush(const serial_uart_t *s);
+int serial_uart_write_buffer_free(const serial_uart_t *s);
+int serial_uart_available(const serial_uart_t *s);
+int serial_uart_getchar(const serial_uart_t *s);
+int serial_uart_read(const serial_uart_t *s, void *buf, unsigned int count);
+int serial_uart_peek(const serial_uart_t *s);
+void serial_uart_clear(const serial_uart_t *s);
+void serial_uart_add_memory_for_read(const serial_uart_t *s, void *buffer, size_t length);
+void serial_uart_add_memory_for_write(const serial_uart_t *s, void *buffer, size_t length);
+void serial_uart_isr(const serial_uart_t *s);
+
+// Use DMA to receive and/or transmit, on UARTs with their own DMA requests
+// (UART0 - UART3).  Returns 1 if DMA is used for everything asked for.
+// The DMA channels stay allocated, across end() and begin(), until this is
+// called with rx and tx both 0.  DMA receive fills the receive buffer in a
+// circle, with one interrupt each time around.  If the program doesn't read
+// in time, the DMA overwrites unread data: the oldest bytes are discarded
+// and counted in rx_dropped when it next reads or checks available.  It
+// can't be used with 9 bit formats, RTS or serialN_add_memory_for_read().
+int serial_uart_set_dma(const serial_uart_t *s, uint8_t rx, uint8_t tx);
+void serial_uart_dma_rx_isr(const serial_uart_t *s);
+void serial_uart_dma_tx_isr(const serial_uart_t *s);
+
+// Number of interrupts serviced and bytes they moved since begin, to
+// measure the interrupt load of each port.
+void serial_uart_interrupt_stats(const serial_uart_t *s, uint32_t *interrupts, uint32_t *bytes);
+
+// Receive data lost since begin: overrun events in the UART, and bytes
+// discarded because the receive buffer was full, with or without DMA.
+void serial_uart_rx_stats(const serial_uart_t *s, uint32_t *overruns, uint32_t *dropped);
+
+extern const serial_uart_t serial1_uart;
+extern const serial_uart_t serial2_uart;
+extern const serial_uart_t serial3_uart;
+#ifdef HAS_KINETISK_UART3
+extern const serial_uart_t serial4_uart;
+#endif
+#ifdef HAS_KINETISK_UART4
+extern const serial_uart_t serial5_uart;
+#endif
+#ifdef HAS_KINETISK_UART5
+extern const serial_uart_t serial6_uart;
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // KINETISK
+#endif
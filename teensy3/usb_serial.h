@@ -93,6 +93,7 @@ public:
         void end() { /* TODO: flush output and shut down USB port */ };
         virtual int available() { return usb_serial_available(); }
         virtual int read() { return usb_serial_getchar(); }
+        virtual int read(uint8_t *buffer, size_t length) { return usb_serial_read(buffer, length); }
         virtual int peek() { return usb_serial_peekchar(); }
         virtual void flush() { usb_serial_flush_output(); }  // TODO: actually wait for data to leave USB...
         virtual void clear(void) { usb_serial_flush_input(); }
@@ -146,6 +147,7 @@ public:
         void end() { };
         virtual int available() { return 0; }
         virtual int read() { return -1; }
+        virtual int read(uint8_t *buffer, size_t length) { return 0; }
         virtual int peek() { return -1; }
         virtual void flush() { }
         virtual void clear() { }
@@ -95,6 +95,7 @@ public:
         void end() { /* TODO: flush output and shut down USB port */ };
         virtual int available() { return usb_serial3_available(); }
         virtual int read() { return usb_serial3_getchar(); }
+        virtual int read(uint8_t *buffer, size_t length) { return usb_serial3_read(buffer, length); }
         virtual int peek() { return usb_serial3_peekchar(); }
         virtual void flush() { usb_serial3_flush_output(); }  // TODO: actually wait for data to leave USB...
         virtual void clear(void) { usb_serial3_flush_input(); }
@@ -0,0 +1,165 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "BinaryStream.h"
+#include "util/crc16.h"
+#include <string.h>
+
+size_t BinaryWriter::writeBytes(const void *data, size_t length)
+{
+	const uint8_t *p = (const uint8_t *)data;
+	if (p == nullptr || length == 0) return 0;
+	crc_ = crc16_update_block(crc_, p, length);
+	return out_.write(p, length);
+}
+
+size_t BinaryWriter::writeLE(uint64_t n, size_t length)
+{
+	uint8_t buf[8];
+	for (size_t i = 0; i < length; i++) {
+		buf[i] = n;
+		n >>= 8;
+	}
+	return writeBytes(buf, length);
+}
+
+size_t BinaryWriter::writeFloat(float n)
+{
+	uint32_t bits;
+	memcpy(&bits, &n, 4);
+	return writeUInt32(bits);
+}
+
+size_t BinaryWriter::writeDouble(double n)
+{
+	uint64_t bits;
+	memcpy(&bits, &n, 8);
+	return writeUInt64(bits);
+}
+
+size_t BinaryWriter::writeVarint(uint64_t n)
+{
+	uint8_t buf[10];
+	size_t len = 0;
+	while (n >= 0x80) {
+		buf[len++] = n | 0x80;
+		n >>= 7;
+	}
+	buf[len++] = n;
+	return writeBytes(buf, len);
+}
+
+size_t BinaryWriter::writeBlob(const void *data, size_t length)
+{
+	if (data == nullptr) length = 0;
+	size_t n = writeVarint(length);
+	return n + writeBytes(data, length);
+}
+
+size_t BinaryWriter::send()
+{
+	size_t n = out_.buffered();
+	out_.send_now();
+	return n;
+}
+
+bool BinaryReader::readBytes(void *buffer, size_t length)
+{
+	size_t n = input_.readBytes((uint8_t *)buffer, length);
+	crc_ = crc16_update_block(crc_, (const uint8_t *)buffer, n);
+	if (n == length) return true;
+	memset((uint8_t *)buffer + n, 0, length - n);
+	error_ = true;
+	return false;
+}
+
+uint64_t BinaryReader::readLE(size_t length)
+{
+	uint8_t buf[8];
+	uint64_t n = 0;
+	readBytes(buf, length);
+	while (length > 0) n = (n << 8) | buf[--length];
+	return n;
+}
+
+float BinaryReader::readFloat()
+{
+	uint32_t bits = readUInt32();
+	float n;
+	memcpy(&n, &bits, 4);
+	return n;
+}
+
+double BinaryReader::readDouble()
+{
+	uint64_t bits = readUInt64();
+	double n;
+	memcpy(&n, &bits, 8);
+	return n;
+}
+
+uint64_t BinaryReader::readVarint()
+{
+	uint64_t n = 0;
+	for (unsigned int shift = 0; shift < 64; shift += 7) {
+		uint8_t b;
+		if (!readBytes(&b, 1)) return 0;
+		n |= (uint64_t)(b & 0x7F) << shift;
+		if (!(b & 0x80)) return n;
+	}
+	error_ = true; // more than 10 bytes is not a valid varint
+	return 0;
+}
+
+size_t BinaryReader::readBlob(void *buffer, size_t size)
+{
+	uint64_t length = readVarint();
+	if (error_) return 0;
+	if (length <= size) {
+		readBytes(buffer, length);
+		return length;
+	}
+	readBytes(buffer, size);
+	uint8_t discard[16];
+	for (uint64_t n = length - size; n > 0 && !error_; ) {
+		size_t chunk = (n < sizeof(discard)) ? n : sizeof(discard);
+		readBytes(discard, chunk);
+		n -= chunk;
+	}
+	error_ = true;
+	return size;
+}
+
+bool BinaryReader::checkCrc()
+{
+	uint16_t expected = crc_;
+	uint16_t n = readUInt16();
+	return !error_ && n == expected;
+}
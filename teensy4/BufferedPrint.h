@@ -0,0 +1,75 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef BufferedPrint_h
+#define BufferedPrint_h
+#ifdef __cplusplus
+
+#include "Print.h"
+
+// BufferedPrint collects many small writes, like those from print() and
+// println() of numbers and short strings, into a buffer you provide, and
+// passes them to another Print or Stream as one larger write.  The buffer
+// is sent when full, when a newline is written (unless disabled), when
+// send_now() or flush() is called, or when the BufferedPrint is destroyed.
+//
+//   uint8_t buf[128];
+//   BufferedPrint out(Serial1, buf, sizeof(buf));
+//   out.print("x=");
+//   out.println(x);	// Serial1 sees 1 write, rather than 3
+//
+class BufferedPrint : public Print
+{
+public:
+	BufferedPrint(Print &output, uint8_t *buffer, size_t size, bool sendOnNewline = true)
+		: output_(output), buffer_(buffer), size_(buffer ? size : 0),
+		  len_(0), send_on_newline_(sendOnNewline) {}
+	~BufferedPrint() { send_now(); }
+	virtual size_t write(uint8_t b);
+	virtual size_t write(const uint8_t *buffer, size_t size);
+	virtual int availableForWrite(void) { return size_ - len_; }
+	// Send buffered data, then wait for the output to finish transmitting
+	virtual void flush();
+	using Print::write;
+	// Send buffered data without waiting
+	void send_now(void);
+	// Number of bytes waiting in the buffer
+	size_t buffered(void) const { return len_; }
+	void sendOnNewline(bool enable) { send_on_newline_ = enable; }
+private:
+	Print &output_;
+	uint8_t *buffer_;
+	size_t size_;
+	size_t len_;
+	bool send_on_newline_;
+};
+
+#endif // __cplusplus
+#endif
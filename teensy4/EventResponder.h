@@ -169,7 +169,10 @@ public:
 	void * getContext() { return _context; }
 
 	// Wait for event(s) to occur.  These are most likely to be useful when
-	// used with a scheduler or RTOS.
+	// used with a scheduler or RTOS.  While waiting, yield() runs, and when
+	// no yield() events are pending the CPU sleeps (WFI) until the next
+	// interrupt, at least once per millisecond for SysTick.  A trigger from
+	// any interrupt ends the wait as soon as that interrupt returns.
 	bool waitForEvent(EventResponderRef event, int timeout);
 	EventResponder * waitForEvent(EventResponder *list, int listsize, int timeout);
 	static void runFromYield() {
@@ -236,6 +239,21 @@ private:
 	}
 };
 
+// Active MillisTimers are kept in a hierarchical timing wheel, so starting,
+// stopping and expiring a timer take the same time no matter how many are
+// running.  Level 0 has a slot for each of the next 64 milliseconds, level
+// 1 a slot for each 64 ms after that, and so on.  Longer timers move down
+// the levels as their time gets closer.
+#ifndef MILLISTIMER_WHEEL_BITS
+#if defined(KINETISL)
+#define MILLISTIMER_WHEEL_BITS 4	// 16 slots per level, 64K ms before cascading
+#else
+#define MILLISTIMER_WHEEL_BITS 6	// 64 slots per level, 4.6 hours before cascading
+#endif
+#endif
+#define MILLISTIMER_WHEEL_LEVELS 4
+#define MILLISTIMER_WHEEL_SLOTS (1 << MILLISTIMER_WHEEL_BITS)
+
 class MillisTimer
 {
 public:
@@ -251,10 +269,11 @@ public:
 private:
 	void addToWaitingList();
 	void addToActiveList();
-	unsigned long _ms = 0;
+	static void cascade(unsigned int level);
+	unsigned long _ms = 0;  // delay while waiting, expire time while active
 	unsigned long _reload = 0;
 	MillisTimer *_next = nullptr;
-	MillisTimer *_prev = nullptr;
+	MillisTimer **_pprev = nullptr; // pointer to this timer in its wheel slot
 	EventResponder *_event = nullptr;
 	enum TimerStateType {
 		TimerOff = 0,
@@ -263,7 +282,8 @@ private:
 	};
 	volatile TimerStateType _state = TimerOff;
 	static MillisTimer *listWaiting; // single linked list of waiting to start timers
-	static MillisTimer *listActive;  // double linked list of running timers
+	static MillisTimer *wheel[MILLISTIMER_WHEEL_LEVELS][MILLISTIMER_WHEEL_SLOTS];
+	static unsigned long wheelTime; // runFromTimer() count
 	static bool disableTimerInterrupt() {
 		uint32_t primask;
 		__asm__ volatile("mrs %0, primask\n" : "=r" (primask)::);
@@ -31,6 +31,7 @@
 #include "HardwareSerial.h"
 #include "core_pins.h"
 #include "Arduino.h"
+#include "EventResponder.h"
 //#include "debug/printf.h"
 
 /*typedef struct {
@@ -73,7 +74,8 @@ HardwareSerialIMXRT *HardwareSerialIMXRT::s_serials_with_serial_events[7];
 #endif
 
 // define our static objects
-uint8_t	HardwareSerialIMXRT::s_count_serials_with_serial_events = 0;
+uint8_t	HardwareSerialIMXRT::s_serial_events_enabled = 0;
+volatile uint8_t HardwareSerialIMXRT::s_serial_events_pending = 0;
 
 
 
@@ -82,6 +84,11 @@ uint8_t	HardwareSerialIMXRT::s_count_serials_with_serial_events = 0;
 #define CTRL_TX_COMPLETING	(CTRL_ENABLE | LPUART_CTRL_TCIE)
 #define CTRL_TX_INACTIVE	CTRL_ENABLE 
 
+// STAT flags cleared by writing 1, other bits of STAT are configuration
+#define STAT_W1C_FLAGS		(LPUART_STAT_LBKDIF | LPUART_STAT_RXEDGIF | LPUART_STAT_IDLE | LPUART_STAT_OR \
+				| LPUART_STAT_NF | LPUART_STAT_FE | LPUART_STAT_PF | LPUART_STAT_MA1F | LPUART_STAT_MA2F)
+#define DATA_ERROR_FLAGS	(LPUART_DATA_NOISY | LPUART_DATA_PARITYE | LPUART_DATA_FRETSC)
+
 // Copied from T3.x - probably should move to other location.
 int nvic_execution_priority(void)
 {
@@ -109,6 +116,9 @@ void HardwareSerialIMXRT::begin(uint32_t baud, uint16_t format)
 {
 	//printf("HardwareSerial begin\n");
 	IMXRT_LPUART_t *port = (IMXRT_LPUART_t *)port_addr;
+	// 9 bit data needs 16 bit buffers (SERIALn_9BIT_SUPPORT), so fall back
+	// to the 8 bit format rather than silently drop the 9th bit
+	if ((format & 0x80) && !buffer_16bit_) format &= (format & 0x08) ? ~0x88 : ~0x84;
 	float base = (float)UART_CLOCK / (float)baud;
 	float besterr = 1e20;
 	int bestdiv = 1;
@@ -133,6 +143,9 @@ void HardwareSerialIMXRT::begin(uint32_t baud, uint16_t format)
 	tx_buffer_tail_ = 0;
 	rts_low_watermark_ = rx_buffer_total_size_ - hardware->rts_low_watermark;
 	rts_high_watermark_ = rx_buffer_total_size_ - hardware->rts_high_watermark;
+	rx_frame_length_ = 0;
+	rx_idle_pending_ = 0;
+	clearStatistics();
 
 	transmitting_ = 0;
 
@@ -220,6 +233,9 @@ void HardwareSerialIMXRT::begin(uint32_t baud, uint16_t format)
 	// Now see if the user asked for Half duplex:
 	if (half_duplex_mode_) ctrl |= (LPUART_CTRL_LOOPS | LPUART_CTRL_RSRC);
 
+	// idle line length, if configured by setIdleCharacters()
+	ctrl |= idle_ctrl_;
+
 	// write out computed CTRL
 	port->CTRL = ctrl;
 
@@ -228,7 +244,7 @@ void HardwareSerialIMXRT::begin(uint32_t baud, uint16_t format)
 	if (format & 0x08) 	port->BAUD |= LPUART_BAUD_M10;
 
 	// Bit 4 RXINVERT 
-	uint32_t c = port->STAT & ~LPUART_STAT_RXINV;
+	uint32_t c = port->STAT & ~(LPUART_STAT_RXINV | STAT_W1C_FLAGS);
 	if (format & 0x10) c |= LPUART_STAT_RXINV;		// rx invert
 	port->STAT = c;
 
@@ -453,9 +469,9 @@ int HardwareSerialIMXRT::available(void)
 
 void HardwareSerialIMXRT::addMemoryForRead(void *buffer, size_t length)
 {
-	rx_buffer_storage_ = (BUFTYPE*)buffer;
+	rx_buffer_storage_ = buffer;
 	if (buffer) {
-		rx_buffer_total_size_ = rx_buffer_size_ + length;
+		rx_buffer_total_size_ = rx_buffer_size_ + (buffer_16bit_ ? length / 2 : length);
 	} else {
 		rx_buffer_total_size_ = rx_buffer_size_;
 	} 
@@ -465,13 +481,89 @@ void HardwareSerialIMXRT::addMemoryForRead(void *buffer, size_t length)
 	rx_buffer_tail_ = 0;
 	rts_low_watermark_ = rx_buffer_total_size_ - hardware->rts_low_watermark;
 	rts_high_watermark_ = rx_buffer_total_size_ - hardware->rts_high_watermark;
+
+	// timestamps must cover the whole receive buffer
+	if (rx_timestamp_length_ < rx_buffer_total_size_) {
+		rx_timestamp_buffer_ = nullptr;
+		rx_timestamp_length_ = 0;
+	}
+}
+
+bool HardwareSerialIMXRT::addTimestampsForRead(uint32_t *buffer, size_t length)
+{
+	if (buffer && length < rx_buffer_total_size_) return false;
+	__disable_irq();
+	rx_timestamp_buffer_ = buffer;
+	rx_timestamp_length_ = buffer ? length : 0;
+	__enable_irq();
+	return true;
+}
+
+void HardwareSerialIMXRT::setIdleCharacters(uint8_t count)
+{
+	uint32_t cfg = 0;
+	while (cfg < 7 && (2u << cfg) <= count) cfg++;
+	idle_ctrl_ = LPUART_CTRL_IDLECFG(cfg) | LPUART_CTRL_ILT;
+}
+
+bool HardwareSerialIMXRT::idleDetected(uint32_t *cycles, uint32_t *length)
+{
+	if (!rx_idle_pending_) return false;
+	__disable_irq();
+	if (cycles) *cycles = rx_idle_cycles_;
+	if (length) *length = rx_idle_frame_length_;
+	rx_idle_pending_ = 0;
+	__enable_irq();
+	return true;
+}
+
+void HardwareSerialIMXRT::getStatistics(statistics_t &stats)
+{
+	__disable_irq();
+	stats = stats_;
+	__enable_irq();
+}
+
+void HardwareSerialIMXRT::clearStatistics(void)
+{
+	__disable_irq();
+	stats_ = statistics_t();
+	__enable_irq();
+}
+
+size_t HardwareSerialIMXRT::printStatistics(Print &p)
+{
+	statistics_t stats;
+	getStatistics(stats);
+	size_t count = 0;
+	count += p.print("Serial");
+	count += p.print(hardware->serial_index + 1);
+	count += p.print(": rx dropped=");
+	count += p.print(stats.rx_dropped);
+	count += p.print(", overrun=");
+	count += p.print(stats.overrun);
+	count += p.print(", framing=");
+	count += p.print(stats.framing);
+	count += p.print(", noise=");
+	count += p.print(stats.noise);
+	count += p.print(", parity=");
+	count += p.println(stats.parity);
+	count += p.print("  rx buffer peak ");
+	count += p.print(stats.rx_high_water);
+	count += p.print(" of ");
+	count += p.print(rx_buffer_total_size_ - 1);
+	count += p.print(", tx buffer peak ");
+	count += p.print(stats.tx_high_water);
+	count += p.print(" of ");
+	count += p.println(tx_buffer_total_size_ - 1);
+	return count;
 }
 
 void HardwareSerialIMXRT::addMemoryForWrite(void *buffer, size_t length)
 {
-	tx_buffer_storage_ = (BUFTYPE*)buffer;
+	tx_buffer_storage_ = buffer;
 	if (buffer) {
-		tx_buffer_total_size_ = tx_buffer_size_ + length;
+		tx_buffer_total_size_ = tx_buffer_size_ + (buffer_16bit_ ? length / 2 : length);
 	} else {
 		tx_buffer_total_size_ = tx_buffer_size_;
 	} 
@@ -493,13 +585,13 @@ int HardwareSerialIMXRT::peek(void)
 		if (head == tail) {
 			// Still empty Now check for stuff in FIFO Queue.
 			int c = -1;	// assume nothing to return
-			if (port->WATER & 0x7000000) {
-				c = port->DATA & 0x3ff;		// Use only up to 10 bits of data
+			if (!rx_timestamp_buffer_ && (port->WATER & 0x7000000)) {
+				c = rx_fifo_read(port);
 				// But we don't want to throw it away...
 				// since queue is empty, just going to reset to front of queue...
 				rx_buffer_head_ = 1;
 				rx_buffer_tail_ = 0; 
-				rx_buffer_[1] = c;
+				rx_buffer_put(1, c);
 			}
 			__enable_irq();
 			return c;
@@ -508,11 +600,7 @@ int HardwareSerialIMXRT::peek(void)
 
 	} 
 	if (++tail >= rx_buffer_total_size_) tail = 0;
-	if (tail < rx_buffer_size_) {
-		return rx_buffer_[tail];
-	} else {
-		return rx_buffer_storage_[tail-rx_buffer_size_];
-	}
+	return rx_buffer_get(tail);
 }
 
 int HardwareSerialIMXRT::read(void)
@@ -529,8 +617,8 @@ int HardwareSerialIMXRT::read(void)
 		if (head == tail) {
 			// Still empty Now check for stuff in FIFO Queue.
 			c = -1;	// assume nothing to return
-			if (port->WATER & 0x7000000) {
-				c = port->DATA & 0x3ff;		// Use only up to 10 bits of data
+			if (!rx_timestamp_buffer_ && (port->WATER & 0x7000000)) {
+				c = rx_fifo_read(port);
 			}
 			__enable_irq();
 			return c;
@@ -539,11 +627,7 @@ int HardwareSerialIMXRT::read(void)
 
 	}
 	if (++tail >= rx_buffer_total_size_) tail = 0;
-	if (tail < rx_buffer_size_) {
-		c = rx_buffer_[tail];
-	} else {
-		c = rx_buffer_storage_[tail-rx_buffer_size_];
-	}
+	c = rx_buffer_get(tail);
 	rx_buffer_tail_ = tail;
 	if (rts_pin_baseReg_) {
 		uint32_t avail;
@@ -555,6 +639,114 @@ int HardwareSerialIMXRT::read(void)
 	return c;
 }	
 
+int HardwareSerialIMXRT::read(uint8_t *buffer, size_t length)
+{
+	return readBuffer(buffer, length, -1);
+}
+
+int HardwareSerialIMXRT::readUntil(char terminator, uint8_t *buffer, size_t length)
+{
+	return readBuffer(buffer, length, (uint8_t)terminator);
+}
+
+// copy whole spans of the receive buffer, stopping after terminator if >= 0
+int HardwareSerialIMXRT::readBuffer(uint8_t *buffer, size_t length, int terminator)
+{
+	uint32_t head = rx_buffer_head_;
+	uint32_t tail = rx_buffer_tail_;
+	size_t count = 0;
+	bool found = false;
+
+	while (count < length && tail != head && !found) {
+		uint32_t index = tail + 1;
+		if (index >= rx_buffer_total_size_) index = 0;
+		// a span ends at head, at the end of the buffer, or where the added memory begins
+		uint32_t end = (head >= index) ? head + 1 : rx_buffer_total_size_;
+		if (index < rx_buffer_size_ && end > rx_buffer_size_) end = rx_buffer_size_;
+		size_t n = end - index;
+		if (n > length - count) n = length - count;
+		volatile void *data = rx_buffer_;
+		uint32_t offset = index;
+		if (offset >= rx_buffer_size_) {
+			data = rx_buffer_storage_;
+			offset -= rx_buffer_size_;
+		}
+		if (!buffer_16bit_) {
+			const uint8_t *p = (const uint8_t *)data + offset;
+			if (terminator >= 0) {
+				const uint8_t *t = (const uint8_t *)memchr(p, terminator, n);
+				if (t) {
+					n = t - p + 1;
+					found = true;
+				}
+			}
+			memcpy(buffer + count, p, n);
+		} else {
+			const volatile uint16_t *p = (const volatile uint16_t *)data + offset;
+			for (size_t i = 0; i < n; i++) {
+				uint8_t c = p[i];
+				buffer[count + i] = c;
+				if (c == terminator) {
+					n = i + 1;
+					found = true;
+					break;
+				}
+			}
+		}
+		count += n;
+		tail = index + n - 1;
+	}
+	if (count > 0) {
+		rx_buffer_tail_ = tail;
+		if (rts_pin_baseReg_) {
+			uint32_t avail;
+			if (head >= tail) avail = head - tail;
+			else avail = rx_buffer_total_size_ + head - tail;
+			if (avail <= rts_low_watermark_) rts_assert();
+		}
+	}
+	// anything which arrived since, or is still waiting in the FIFO
+	while (count < length && !found) {
+		int c = HardwareSerialIMXRT::read();
+		if (c < 0) break;
+		buffer[count++] = c;
+		if (c == terminator) found = true;
+	}
+	return count;
+}
+
+// Take one byte directly from the FIFO, when the buffer is empty.  Counted
+// like the interrupt does, so idleDetected() lengths and statistics include it.
+uint32_t HardwareSerialIMXRT::rx_fifo_read(IMXRT_LPUART_t *port)
+{
+	uint32_t n = port->DATA;
+	if (n & DATA_ERROR_FLAGS) {
+		if (n & LPUART_DATA_FRETSC) stats_.framing++;
+		if (n & LPUART_DATA_NOISY) stats_.noise++;
+		if (n & LPUART_DATA_PARITYE) stats_.parity++;
+	}
+	rx_last_cycles_ = ARM_DWT_CYCCNT;
+	rx_frame_length_++;
+	return n & 0x3ff;		// Use only up to 10 bits of data
+}
+
+int HardwareSerialIMXRT::readTimestamped(uint32_t &cycles)
+{
+	uint32_t tail = rx_buffer_tail_;
+	if (rx_timestamp_buffer_) {
+		// read() leaves bytes in the FIFO for the interrupt while recording
+		if (tail == rx_buffer_head_) {
+			cycles = ARM_DWT_CYCCNT;
+			return -1;
+		}
+		if (++tail >= rx_buffer_total_size_) tail = 0;
+		cycles = rx_timestamp_buffer_[tail];
+	} else {
+		cycles = ARM_DWT_CYCCNT;	// not recording
+	}
+	return read();
+}
+
 void HardwareSerialIMXRT::flush(void)
 {
 	while (transmitting_) yield(); // wait
@@ -588,11 +780,7 @@ size_t HardwareSerialIMXRT::write9bit(uint32_t c)
 			if ((port->STAT & LPUART_STAT_TDRE)) {
 				uint32_t tail = tx_buffer_tail_;
 				if (++tail >= tx_buffer_total_size_) tail = 0;
-				if (tail < tx_buffer_size_) {
-					n = tx_buffer_[tail];
-				} else {
-					n = tx_buffer_storage_[tail-tx_buffer_size_];
-				}
+				n = tx_buffer_get(tail);
 				port->DATA  = n;
 				tx_buffer_tail_ = tail;
 			}
@@ -603,14 +791,13 @@ size_t HardwareSerialIMXRT::write9bit(uint32_t c)
 	}
 	//digitalWrite(5, LOW);
 	//Serial.printf("WR %x %d %d %d %x %x\n", c, head, tx_buffer_size_,  tx_buffer_total_size_, (uint32_t)tx_buffer_, (uint32_t)tx_buffer_storage_);
-	if (head < tx_buffer_size_) {
-		tx_buffer_[head] = c;
-	} else {
-		tx_buffer_storage_[head - tx_buffer_size_] = c;
-	}
+	tx_buffer_put(head, c);
 	__disable_irq();
 	transmitting_ = 1;
 	tx_buffer_head_ = head;
+	uint32_t tail = tx_buffer_tail_;
+	uint32_t used = (head >= tail) ? head - tail : tx_buffer_total_size_ + head - tail;
+	if (used > stats_.tx_high_water) stats_.tx_high_water = used;
 	port->CTRL |= LPUART_CTRL_TIE; // (may need to handle this issue)BITBAND_SET_BIT(LPUART0_CTRL, TIE_BIT);
 	__enable_irq();
 	//digitalWrite(3, LOW);
@@ -618,48 +805,79 @@ size_t HardwareSerialIMXRT::write9bit(uint32_t c)
 }
 
 void HardwareSerialIMXRT::IRQHandler()
+{
+	// pick the buffer width once per interrupt, not once per byte
+	if (buffer_16bit_) IRQHandlerT<uint16_t>();
+	else IRQHandlerT<uint8_t>();
+}
+
+template <typename T>
+void HardwareSerialIMXRT::IRQHandlerT()
 {
 	//digitalWrite(4, HIGH);
 	IMXRT_LPUART_t *port = (IMXRT_LPUART_t *)port_addr;
 	uint32_t head, tail, n;
 	uint32_t ctrl;
 
+	// Count and clear receive errors.  Per byte errors are also flagged in DATA.
+	uint32_t stat = port->STAT;
+	if (stat & (LPUART_STAT_OR | LPUART_STAT_NF | LPUART_STAT_FE | LPUART_STAT_PF)) {
+		if (stat & LPUART_STAT_OR) stats_.overrun++;
+		port->STAT = (stat & ~STAT_W1C_FLAGS)
+			| (stat & (LPUART_STAT_OR | LPUART_STAT_NF | LPUART_STAT_FE | LPUART_STAT_PF));
+	}
+
 	// See if we have stuff to read in.
-	// Todo - Check idle. 
-	if (port->STAT & (LPUART_STAT_RDRF | LPUART_STAT_IDLE)) {
+	if (stat & (LPUART_STAT_RDRF | LPUART_STAT_IDLE)) {
 		// See how many bytes or pending. 
 		//digitalWrite(5, HIGH);
+		const uint32_t cycles = ARM_DWT_CYCCNT;
 		uint8_t avail = (port->WATER >> 24) & 0x7;
 		if (avail) {
 			uint32_t newhead;
 			head = rx_buffer_head_;
 			tail = rx_buffer_tail_;
+			rx_last_cycles_ = cycles;
+			rx_frame_length_ += avail;
 			do {
-				n = port->DATA & 0x3ff;		// Use only up to 10 bits of data
+				n = port->DATA;
+				if (n & DATA_ERROR_FLAGS) {
+					if (n & LPUART_DATA_FRETSC) stats_.framing++;
+					if (n & LPUART_DATA_NOISY) stats_.noise++;
+					if (n & LPUART_DATA_PARITYE) stats_.parity++;
+				}
+				n &= 0x3ff;		// Use only up to 10 bits of data
 				newhead = head + 1;
 
 				if (newhead >= rx_buffer_total_size_) newhead = 0;
 				if (newhead != rx_buffer_tail_) {
 					head = newhead;
-					if (newhead < rx_buffer_size_) {
-						rx_buffer_[head] = n;
-					} else {
-						rx_buffer_storage_[head-rx_buffer_size_] = n;
-					}
+					rx_buffer_put<T>(head, n);
+					if (rx_timestamp_buffer_) rx_timestamp_buffer_[head] = cycles;
+				} else {
+					stats_.rx_dropped++;
 				}
 			} while (--avail > 0) ;
 			rx_buffer_head_ = head;
+			s_serial_events_pending |= (1 << hardware->serial_index);
+			if (rx_event_) rx_event_->triggerEvent();
+			uint32_t used;
+			if (head >= tail) used = head - tail;
+			else used = rx_buffer_total_size_ + head - tail;
+			if (used > stats_.rx_high_water) stats_.rx_high_water = used;
 			if (rts_pin_baseReg_) {
-				uint32_t avail;
-				if (head >= tail) avail = head - tail;
-				else avail = rx_buffer_total_size_ + head - tail;
-				if (avail >= rts_high_watermark_) rts_deassert();
+				if (used >= rts_high_watermark_) rts_deassert();
 			}
 		}
 
-		// If it was an idle status clear the idle
+		// If it was an idle status, note the end of packet and clear the idle
 		if (port->STAT & LPUART_STAT_IDLE) {
-			port->STAT |= LPUART_STAT_IDLE;	// writing a 1 to idle should clear it. 
+			rx_idle_cycles_ = cycles;
+			rx_idle_frame_length_ = rx_frame_length_;
+			rx_frame_length_ = 0;
+			rx_idle_pending_ = 1;
+			// writing a 1 clears idle, without clearing errors which latched since
+			port->STAT = (port->STAT & ~STAT_W1C_FLAGS) | LPUART_STAT_IDLE;
 		}
 		//digitalWrite(5, LOW);
 
@@ -676,11 +894,7 @@ void HardwareSerialIMXRT::IRQHandler()
 		do {
 			if (head == tail) break;
 			if (++tail >= tx_buffer_total_size_) tail = 0;
-			if (tail < tx_buffer_size_) {
-				n = tx_buffer_[tail];
-			} else {
-				n = tx_buffer_storage_[tail-tx_buffer_size_];
-			}
+			n = tx_buffer_get<T>(tail);
 			port->DATA = n;
 		} while (((port->WATER >> 8) & 0x7) < 4); 	// need to computer properly
 		tx_buffer_tail_ = tail;
@@ -709,10 +923,12 @@ void HardwareSerialIMXRT::IRQHandler()
 
 
 void HardwareSerialIMXRT::addToSerialEventsList() {
-	for (uint8_t i = 0; i < s_count_serials_with_serial_events; i++) {
-		if (s_serials_with_serial_events[i] == this) return; // already in the list.
-	}
-	s_serials_with_serial_events[s_count_serials_with_serial_events++] = this;
+	const uint8_t mask = 1 << hardware->serial_index;
+	s_serials_with_serial_events[hardware->serial_index] = this;
+	__disable_irq();
+	s_serial_events_enabled |= mask;
+	s_serial_events_pending |= mask;  // check once, in case data arrived before begin
+	__enable_irq();
 	yield_active_check_flags |= YIELD_CHECK_HARDWARE_SERIAL;
 }
 
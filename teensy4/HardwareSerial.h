@@ -36,6 +36,17 @@
 // Uncomment to enable 9 bit formats.  These are default disabled to save memory.
 //#define SERIAL_9BIT_SUPPORT
 //
+// Or uncomment only the ports which need 9 bits.  Those ports use 16 bit
+// buffers, while the others keep the smaller and faster 8 bit buffers.
+//#define SERIAL1_9BIT_SUPPORT
+//#define SERIAL2_9BIT_SUPPORT
+//#define SERIAL3_9BIT_SUPPORT
+//#define SERIAL4_9BIT_SUPPORT
+//#define SERIAL5_9BIT_SUPPORT
+//#define SERIAL6_9BIT_SUPPORT
+//#define SERIAL7_9BIT_SUPPORT
+//#define SERIAL8_9BIT_SUPPORT
+//
 // On Windows & Linux, this file is in Arduino's hardware/teensy/avr/cores/teensy3
 //   folder.  The Windows installer puts Arduino in C:\Program Files (x86)\Arduino
 // On Macintosh, you must control-click Arduino and select "Show Package Contents", then
@@ -64,7 +75,9 @@
 #define SERIAL_8N1_RXINV_TXINV 0x30
 #define SERIAL_8E1_RXINV_TXINV 0x36
 #define SERIAL_8O1_RXINV_TXINV 0x37
-#ifdef SERIAL_9BIT_SUPPORT
+#if defined(SERIAL_9BIT_SUPPORT) || defined(SERIAL1_9BIT_SUPPORT) || defined(SERIAL2_9BIT_SUPPORT) \
+  || defined(SERIAL3_9BIT_SUPPORT) || defined(SERIAL4_9BIT_SUPPORT) || defined(SERIAL5_9BIT_SUPPORT) \
+  || defined(SERIAL6_9BIT_SUPPORT) || defined(SERIAL7_9BIT_SUPPORT) || defined(SERIAL8_9BIT_SUPPORT)
 #define SERIAL_9N1 0x84
 #define SERIAL_9E1 0x8E
 #define SERIAL_9O1 0x8F
@@ -162,6 +175,7 @@ public:
 	virtual int available(void) = 0;
 	virtual int peek(void) = 0;
 	virtual int read(void) = 0;
+	using Stream::read;
 	virtual void flush(void) = 0;
 	virtual int availableForWrite(void) = 0;
 	virtual size_t write(uint8_t) = 0;
@@ -197,11 +211,30 @@ public:
 		const uint16_t rts_high_watermark;
 		const uint8_t xbar_out_lpuartX_trig_input;
 	} hardware_t;
+
+	typedef struct {
+		uint32_t rx_dropped;	// bytes discarded because the receive buffer was full
+		uint32_t overrun;		// hardware FIFO overruns (data lost before the interrupt ran)
+		uint32_t framing;		// bytes received with a framing error
+		uint32_t noise;			// bytes received with noise detected
+		uint32_t parity;		// bytes received with a parity error
+		uint16_t rx_high_water;	// most bytes ever waiting in the receive buffer
+		uint16_t tx_high_water;	// most bytes ever waiting in the transmit buffer
+	} statistics_t;
 public:
+	// 8 bit buffers
+	constexpr HardwareSerialIMXRT(uintptr_t myport, const hardware_t *myhardware,
+		volatile uint8_t *_tx_buffer, size_t _tx_buffer_size, 
+		volatile uint8_t *_rx_buffer, size_t _rx_buffer_size) :
+		port_addr(myport), hardware(myhardware), buffer_16bit_(0),
+		tx_buffer_(_tx_buffer), rx_buffer_(_rx_buffer), tx_buffer_size_(_tx_buffer_size),  rx_buffer_size_(_rx_buffer_size),
+		tx_buffer_total_size_(_tx_buffer_size), rx_buffer_total_size_(_rx_buffer_size) {
+	}
+	// 16 bit buffers, for 9 bit formats
 	constexpr HardwareSerialIMXRT(uintptr_t myport, const hardware_t *myhardware,
-		volatile BUFTYPE *_tx_buffer, size_t _tx_buffer_size, 
-		volatile BUFTYPE *_rx_buffer, size_t _rx_buffer_size) :
-		port_addr(myport), hardware(myhardware),
+		volatile uint16_t *_tx_buffer, size_t _tx_buffer_size, 
+		volatile uint16_t *_rx_buffer, size_t _rx_buffer_size) :
+		port_addr(myport), hardware(myhardware), buffer_16bit_(1),
 		tx_buffer_(_tx_buffer), rx_buffer_(_rx_buffer), tx_buffer_size_(_tx_buffer_size),  rx_buffer_size_(_rx_buffer_size),
 		tx_buffer_total_size_(_tx_buffer_size), rx_buffer_total_size_(_rx_buffer_size) {
 	}
@@ -222,6 +255,10 @@ public:
 	virtual size_t write(uint8_t c);
 	// Reads the next received byte, or returns -1 if nothing has been received.
 	virtual int read(void);
+	// Reads up to length bytes which have already been received, without
+	// waiting.  Returns the number of bytes read, zero if none.  With 9 and
+	// 10 bit formats only the low 8 bits are kept, use read() for all of them.
+	virtual int read(uint8_t *buffer, size_t length);
 	// Configures a digital pin to be HIGH while transmitting.  Typically this
 	// pin is used to control the DE and RE' pins of an 8 pin RS485 transceiver
 	// chip, which transmits when DE is high and receives when RE' is low.
@@ -255,7 +292,8 @@ public:
 	// serial hardware and the available() and read() functions. This is useful
 	// when your program must spend lengthy times performing other work, like
 	// writing to a SD card, before it can return to reading the incoming serial
-	// data.  The buffer array must be a global or static variable.
+	// data.  The buffer array must be a global or static variable.  For ports
+	// with 9 bit support, the buffer must be uint16_t and length is in bytes.
 	void addMemoryForRead(void *buffer, size_t length);
 	// Increase the amount of buffer memory between print(), write() and actual
 	// hardware serial transmission. This can be useful when your program needs
@@ -269,6 +307,34 @@ public:
 		addMemoryForWrite(buffer, length);
 	}
 	size_t write9bit(uint32_t c);
+	// Record the ARM_DWT_CYCCNT value when each byte is taken from the serial
+	// hardware.  The buffer needs one uint32_t for every byte of receive buffer,
+	// including memory given to addMemoryForRead().  Bytes which arrive together
+	// in the hardware FIFO share a timestamp.  While recording, read() and peek()
+	// leave bytes in the FIFO for the interrupt (at the FIFO watermark or idle
+	// line) rather than taking them without a timestamp.  Use NULL to stop.
+	bool addTimestampsForRead(uint32_t *buffer, size_t length);
+	// Reads the next received byte, like read(), and gives the ARM_DWT_CYCCNT
+	// value when it was received.  Returns -1 if nothing has been received.
+	int readTimestamped(uint32_t &cycles);
+	// Configure the number of idle characters (1, 2, 4, 8 ... 128) the receive
+	// line must be quiet before idleDetected() reports the end of a packet.  Idle
+	// time is counted from the stop bit.  Must be called before begin().
+	void setIdleCharacters(uint8_t count);
+	// Returns true once each time the receive line goes idle after receiving,
+	// which normally marks the end of a packet (Modbus RTU, DMX, etc).  The
+	// optional cycles is set to the ARM_DWT_CYCCNT value when idle was detected,
+	// and length to the number of bytes received since the prior idle.
+	bool idleDetected(uint32_t *cycles=nullptr, uint32_t *length=nullptr);
+	// Returns the ARM_DWT_CYCCNT value when data was most recently received.
+	uint32_t lastReceiveCycles(void) { return rx_last_cycles_; }
+	// Get counts of dropped bytes, receive errors and the most buffer memory
+	// used since begin() or clearStatistics().  Useful to tell whether lost
+	// data is caused by the serial line or by a program not reading quickly.
+	void getStatistics(statistics_t &stats);
+	void clearStatistics(void);
+	// Print a readable summary of getStatistics() to Serial, a file, etc.
+	size_t printStatistics(Print &p);
 	
 	// Event Handler functions and data
 	static uint8_t serial_event_handlers_active;
@@ -294,11 +360,19 @@ public:
 
 	operator bool()			{ return true; }
 
+	// Called by yield().  Only ports whose interrupt received data since the
+	// last call are checked, rather than polling available() on every port.
 	static inline void processSerialEventsList() {
-		for (uint8_t i = 0; i < s_count_serials_with_serial_events; i++) {
-			s_serials_with_serial_events[i]->doYieldCode();
+		uint32_t pending = s_serial_events_pending & s_serial_events_enabled;
+		while (pending) {
+			uint32_t index = __builtin_ctz(pending);
+			pending &= pending - 1;
+			s_serials_with_serial_events[index]->doYieldCode();
 		}
 	}
+protected:
+	virtual int readUntil(char terminator, uint8_t *buffer, size_t length);
+	virtual bool setReadEvent(EventResponder *event) { rx_event_ = event; return true; }
 private:
 	const uintptr_t port_addr;
 	const hardware_t * const hardware;
@@ -306,10 +380,12 @@ private:
 	uint8_t				tx_pin_index_ = 0x0;
 	uint8_t				half_duplex_mode_ = 0; // are we in half duplex mode?
 
-	volatile BUFTYPE 	*tx_buffer_;
-	volatile BUFTYPE 	*rx_buffer_;
-	volatile BUFTYPE	*rx_buffer_storage_ = nullptr;
-	volatile BUFTYPE	*tx_buffer_storage_ = nullptr;
+	const uint8_t		buffer_16bit_;	// buffers hold uint16_t for 9 bit formats
+
+	volatile void 		*tx_buffer_;
+	volatile void 		*rx_buffer_;
+	volatile void		*rx_buffer_storage_ = nullptr;
+	volatile void		*tx_buffer_storage_ = nullptr;
 	size_t				tx_buffer_size_;
 	size_t				rx_buffer_size_;
 	size_t				tx_buffer_total_size_;
@@ -322,6 +398,17 @@ private:
 	volatile uint16_t 	rx_buffer_head_ = 0;
 	volatile uint16_t 	rx_buffer_tail_ = 0;
 
+	volatile uint32_t	*rx_timestamp_buffer_ = nullptr;
+	size_t				rx_timestamp_length_ = 0;
+	uint32_t			idle_ctrl_ = 0;
+	volatile uint32_t	rx_last_cycles_ = 0;
+	volatile uint32_t	rx_idle_cycles_ = 0;
+	volatile uint32_t	rx_frame_length_ = 0;
+	volatile uint32_t	rx_idle_frame_length_ = 0;
+	volatile uint8_t	rx_idle_pending_ = 0;
+	EventResponder * volatile rx_event_ = nullptr;
+	statistics_t		stats_ = {};
+
 	volatile uint32_t 	*transmit_pin_baseReg_ = 0;
 	uint32_t 			transmit_pin_bitmask_ = 0;
 
@@ -330,8 +417,59 @@ private:
 
   	inline void rts_assert();
   	inline void rts_deassert();
+	int readBuffer(uint8_t *buffer, size_t length, int terminator);
+	uint32_t rx_fifo_read(IMXRT_LPUART_t *port);
+
+	// Access buffer element at index, which may be in the added memory.
+	// T is uint8_t or uint16_t, so the ISR resolves the width once, not per byte.
+	template <typename T>
+	static inline uint32_t buffer_get(volatile void *buffer, volatile void *storage,
+	  size_t size, uint32_t index) {
+		if (index >= size) {
+			buffer = storage;
+			index -= size;
+		}
+		return ((volatile T *)buffer)[index];
+	}
+	template <typename T>
+	static inline void buffer_put(volatile void *buffer, volatile void *storage,
+	  size_t size, uint32_t index, uint32_t c) {
+		if (index >= size) {
+			buffer = storage;
+			index -= size;
+		}
+		((volatile T *)buffer)[index] = c;
+	}
+	template <typename T> inline uint32_t rx_buffer_get(uint32_t index) {
+		return buffer_get<T>(rx_buffer_, rx_buffer_storage_, rx_buffer_size_, index);
+	}
+	template <typename T> inline void rx_buffer_put(uint32_t index, uint32_t c) {
+		buffer_put<T>(rx_buffer_, rx_buffer_storage_, rx_buffer_size_, index, c);
+	}
+	template <typename T> inline uint32_t tx_buffer_get(uint32_t index) {
+		return buffer_get<T>(tx_buffer_, tx_buffer_storage_, tx_buffer_size_, index);
+	}
+	template <typename T> inline void tx_buffer_put(uint32_t index, uint32_t c) {
+		buffer_put<T>(tx_buffer_, tx_buffer_storage_, tx_buffer_size_, index, c);
+	}
+	// Single access from non-ISR code, which checks the buffer width at runtime
+	inline uint32_t rx_buffer_get(uint32_t index) {
+		return buffer_16bit_ ? rx_buffer_get<uint16_t>(index) : rx_buffer_get<uint8_t>(index);
+	}
+	inline void rx_buffer_put(uint32_t index, uint32_t c) {
+		if (buffer_16bit_) rx_buffer_put<uint16_t>(index, c);
+		else rx_buffer_put<uint8_t>(index, c);
+	}
+	inline uint32_t tx_buffer_get(uint32_t index) {
+		return buffer_16bit_ ? tx_buffer_get<uint16_t>(index) : tx_buffer_get<uint8_t>(index);
+	}
+	inline void tx_buffer_put(uint32_t index, uint32_t c) {
+		if (buffer_16bit_) tx_buffer_put<uint16_t>(index, c);
+		else tx_buffer_put<uint8_t>(index, c);
+	}
 
 	void IRQHandler();
+	template <typename T> void IRQHandlerT();
 	friend void IRQHandler_Serial1();
 	friend void IRQHandler_Serial2();
 	friend void IRQHandler_Serial3();
@@ -345,10 +483,25 @@ private:
 	#else	
 	static HardwareSerialIMXRT 	*s_serials_with_serial_events[7];
 	#endif
-	static uint8_t 			s_count_serials_with_serial_events;
+	// bitmasks by serial_index: ports with a serialEvent, and ports with new data
+	static uint8_t 			s_serial_events_enabled;
+	static volatile uint8_t	s_serial_events_pending;
 	void addToSerialEventsList(); 
 	inline void doYieldCode()  {
-		if (available()) (*hardware->_serialEvent)();
+		const uint8_t mask = 1 << hardware->serial_index;
+		__disable_irq();
+		s_serial_events_pending &= ~mask;
+		__enable_irq();
+		if (available()) {
+			yield_statistics.serial_events++;
+			(*hardware->_serialEvent)();
+			// if serialEvent left data unread, call it again on the next yield
+			if (available()) {
+				__disable_irq();
+				s_serial_events_pending |= mask;
+				__enable_irq();
+			}
+		}
 	}
 
 
@@ -47,8 +47,13 @@ void IRQHandler_Serial1()
 
 
 // Serial1
+#ifdef SERIAL1_9BIT_SUPPORT
+static uint16_t tx_buffer1[SERIAL1_TX_BUFFER_SIZE];
+static uint16_t rx_buffer1[SERIAL1_RX_BUFFER_SIZE];
+#else
 static BUFTYPE tx_buffer1[SERIAL1_TX_BUFFER_SIZE];
 static BUFTYPE rx_buffer1[SERIAL1_RX_BUFFER_SIZE];
+#endif
 
 const HardwareSerialIMXRT::hardware_t UART6_Hardware = {
 	0, IRQ_LPUART6, &IRQHandler_Serial1, 
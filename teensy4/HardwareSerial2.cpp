@@ -47,8 +47,13 @@ void IRQHandler_Serial2()
 
 
 // Serial2
+#ifdef SERIAL2_9BIT_SUPPORT
+static uint16_t tx_buffer2[SERIAL2_TX_BUFFER_SIZE];
+static uint16_t rx_buffer2[SERIAL2_RX_BUFFER_SIZE];
+#else
 static BUFTYPE tx_buffer2[SERIAL2_TX_BUFFER_SIZE];
 static BUFTYPE rx_buffer2[SERIAL2_RX_BUFFER_SIZE];
+#endif
 
 #ifndef ARDUINO_TEENSY_MICROMOD
 static HardwareSerialIMXRT::hardware_t UART4_Hardware = {
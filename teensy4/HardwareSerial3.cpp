@@ -45,8 +45,13 @@ void IRQHandler_Serial3()
 }
 
 // Serial3
+#ifdef SERIAL3_9BIT_SUPPORT
+static uint16_t tx_buffer3[SERIAL3_TX_BUFFER_SIZE];
+static uint16_t rx_buffer3[SERIAL3_RX_BUFFER_SIZE];
+#else
 static BUFTYPE tx_buffer3[SERIAL3_TX_BUFFER_SIZE];
 static BUFTYPE rx_buffer3[SERIAL3_RX_BUFFER_SIZE];
+#endif
 
 static HardwareSerialIMXRT::hardware_t UART2_Hardware = {
 	2, IRQ_LPUART2, &IRQHandler_Serial3, 
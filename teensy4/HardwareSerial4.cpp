@@ -46,8 +46,13 @@ void IRQHandler_Serial4()
 }
 
 // Serial4
+#ifdef SERIAL4_9BIT_SUPPORT
+static uint16_t tx_buffer4[SERIAL4_TX_BUFFER_SIZE];
+static uint16_t rx_buffer4[SERIAL4_RX_BUFFER_SIZE];
+#else
 static BUFTYPE tx_buffer4[SERIAL4_TX_BUFFER_SIZE];
 static BUFTYPE rx_buffer4[SERIAL4_RX_BUFFER_SIZE];
+#endif
 
 #ifndef ARDUINO_TEENSY_MICROMOD
 static HardwareSerialIMXRT::hardware_t UART3_Hardware = {
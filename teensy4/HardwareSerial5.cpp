@@ -45,8 +45,13 @@ void IRQHandler_Serial5()
 	Serial5.IRQHandler();
 }
 // Serial5
+#ifdef SERIAL5_9BIT_SUPPORT
+static uint16_t tx_buffer5[SERIAL5_TX_BUFFER_SIZE];
+static uint16_t rx_buffer5[SERIAL5_RX_BUFFER_SIZE];
+#else
 static BUFTYPE tx_buffer5[SERIAL5_TX_BUFFER_SIZE];
 static BUFTYPE rx_buffer5[SERIAL5_RX_BUFFER_SIZE];
+#endif
 
 static HardwareSerialIMXRT::hardware_t UART8_Hardware = {
 	4, IRQ_LPUART8, &IRQHandler_Serial5, 
@@ -46,8 +46,13 @@ void IRQHandler_Serial6()
 
 
 // Serial6
+#ifdef SERIAL6_9BIT_SUPPORT
+static uint16_t tx_buffer6[SERIAL6_TX_BUFFER_SIZE];
+static uint16_t rx_buffer6[SERIAL6_RX_BUFFER_SIZE];
+#else
 static BUFTYPE tx_buffer6[SERIAL6_TX_BUFFER_SIZE];
 static BUFTYPE rx_buffer6[SERIAL6_RX_BUFFER_SIZE];
+#endif
 
 static HardwareSerialIMXRT::hardware_t UART1_Hardware = {
 	5, IRQ_LPUART1, &IRQHandler_Serial6, 
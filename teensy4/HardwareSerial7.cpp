@@ -45,8 +45,13 @@ void IRQHandler_Serial7()
 }
 
 // Serial7
+#ifdef SERIAL7_9BIT_SUPPORT
+static uint16_t tx_buffer7[SERIAL7_TX_BUFFER_SIZE];
+static uint16_t rx_buffer7[SERIAL7_RX_BUFFER_SIZE];
+#else
 static BUFTYPE tx_buffer7[SERIAL7_TX_BUFFER_SIZE];
 static BUFTYPE rx_buffer7[SERIAL7_RX_BUFFER_SIZE];
+#endif
 
 static HardwareSerialIMXRT::hardware_t UART7_Hardware = {
 	6, IRQ_LPUART7, &IRQHandler_Serial7, 
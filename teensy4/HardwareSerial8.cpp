@@ -47,8 +47,13 @@ void IRQHandler_Serial8()
 
 
 // Serial8
+#ifdef SERIAL8_9BIT_SUPPORT
+static uint16_t tx_buffer8[SERIAL8_TX_BUFFER_SIZE];
+static uint16_t rx_buffer8[SERIAL8_RX_BUFFER_SIZE];
+#else
 static BUFTYPE tx_buffer8[SERIAL8_TX_BUFFER_SIZE];
 static BUFTYPE rx_buffer8[SERIAL8_RX_BUFFER_SIZE];
+#endif
 
 static HardwareSerialIMXRT::hardware_t UART5_Hardware = {
 	7, IRQ_LPUART5, &IRQHandler_Serial8, 
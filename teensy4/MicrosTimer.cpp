@@ -0,0 +1,160 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "MicrosTimer.h"
+#include "imxrt.h"
+
+MicrosTimer * MicrosTimer::queue = nullptr;
+
+static bool disableTimerInterrupt()
+{
+	uint32_t primask;
+	__asm__ volatile("mrs %0, primask\n" : "=r" (primask)::);
+	__disable_irq();
+	return (primask == 0) ? true : false;
+}
+
+static void enableTimerInterrupt(bool doit)
+{
+	if (doit) __enable_irq();
+}
+
+// GPT2 counts the 24 MHz peripheral clock (the same as PIT) and never
+// resets, so deadlines are just future counts.  Compare channel 1
+// interrupts when the count reaches the nearest deadline.
+static void gpt2_start(void (*isr)(void))
+{
+	CCM_CCGR0 |= CCM_CCGR0_GPT2_BUS(CCM_CCGR_ON) | CCM_CCGR0_GPT2_SERIAL(CCM_CCGR_ON);
+	GPT2_CR = 0;
+	GPT2_PR = 0;
+	GPT2_SR = 0x3F;
+	GPT2_IR = GPT_IR_OF1IE;
+	GPT2_CR = GPT_CR_EN | GPT_CR_FRR | GPT_CR_CLKSRC(1);
+	attachInterruptVector(IRQ_GPT2, isr);
+	NVIC_ENABLE_IRQ(IRQ_GPT2);
+}
+
+// insert into the queue, after any others with the same deadline
+void MicrosTimer::insert()
+{
+	MicrosTimer **p = &queue;
+	while (*p && (int32_t)((*p)->_deadline - _deadline) <= 0) {
+		p = &(*p)->_next;
+	}
+	_next = *p;
+	*p = this;
+	_active = true;
+}
+
+void MicrosTimer::remove()
+{
+	MicrosTimer **p = &queue;
+	while (*p) {
+		if (*p == this) {
+			*p = _next;
+			break;
+		}
+		p = &(*p)->_next;
+	}
+	_active = false;
+}
+
+bool MicrosTimer::run(uint32_t now, uint32_t *next)
+{
+	MicrosTimer *timer;
+	while ((timer = queue) != nullptr && (int32_t)(timer->_deadline - now) <= 0) {
+		queue = timer->_next;
+		uint32_t late = now - timer->_deadline;
+		timer->_count++;
+		timer->_lateSum += late;
+		if (late > timer->_lateMax) timer->_lateMax = late;
+		if (timer->_period) {
+			// restart before calling, so the function may end() or begin()
+			if (late >= timer->_period) {
+				uint32_t skip = late / timer->_period;
+				timer->_missed += skip;
+				timer->_deadline += skip * timer->_period;
+			}
+			timer->_deadline += timer->_period;
+			timer->insert();
+		} else {
+			timer->_active = false;
+		}
+		timer->_funct();
+	}
+	if (!timer) return false;
+	*next = timer->_deadline;
+	return true;
+}
+
+void MicrosTimer::isr()
+{
+	uint32_t next;
+	GPT2_SR = GPT_SR_OF1;
+	while (run(GPT2_CNT, &next)) {
+		GPT2_OCR1 = next;
+		// if the count passed the deadline while setting it, run again
+		if ((int32_t)(next - GPT2_CNT) > 0) break;
+	}
+	asm("dsb");
+}
+
+bool MicrosTimer::beginCycles(callback_t funct, uint32_t cycles, uint32_t period)
+{
+	static bool started = false;
+	bool irq = disableTimerInterrupt();
+	if (_active) remove();
+	if (!started) {
+		gpt2_start(&isr);
+		started = true;
+	}
+	_funct = funct;
+	_period = period;
+	_deadline = GPT2_CNT + cycles;
+	insert();
+	if (queue == this) {
+		GPT2_OCR1 = _deadline;
+		if ((int32_t)(_deadline - GPT2_CNT) <= 0) NVIC_SET_PENDING(IRQ_GPT2);
+	}
+	enableTimerInterrupt(irq);
+	return true;
+}
+
+void MicrosTimer::end()
+{
+	bool irq = disableTimerInterrupt();
+	if (_active) remove();
+	enableTimerInterrupt(irq);
+}
+
+void MicrosTimer::priority(uint8_t n)
+{
+	NVIC_SET_PRIORITY(IRQ_GPT2, n);
+}
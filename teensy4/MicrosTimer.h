@@ -0,0 +1,131 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifdef __cplusplus
+#ifndef MicrosTimer_h_
+#define MicrosTimer_h_
+
+#include <stdint.h>
+#include <type_traits>
+#include "inplace_function.h"
+
+// MicrosTimer runs a function at precise intervals, or once after a
+// delay, like IntervalTimer.  But any number of MicrosTimers may be used,
+// because they all share one hardware timer (GPT2) instead of taking one
+// of the 4 PIT channels each.  Waiting timers are kept in a list sorted by
+// deadline, and GPT2's compare register is set to the nearest one.
+// Functions run from the GPT2 interrupt.
+//
+//   MicrosTimer blink, pulse;
+//   blink.begin(toggleLED, 250);		// every 250 us
+//   pulse.beginOnce(endPulse, 12.5);		// once, 12.5 us from now
+//
+// Times are measured in 24 MHz cycles.  Each timer also records how late
+// its function was called compared to its deadline, to measure jitter.
+class MicrosTimer {
+private:
+	static const int32_t MAX_PERIOD = INT32_MAX / 24;
+public:
+	using callback_t = teensy::inplace_function<void(void), 16>;
+	MicrosTimer() {
+	}
+	~MicrosTimer() {
+		end();
+	}
+	// Call a function repeatedly.  The period is in microseconds, integer
+	// or float.  Returns false if the period is too short or too long.
+	template <typename period_t>
+	bool begin(callback_t funct, period_t period) {
+		uint32_t cycles = cyclesFromPeriod(period);
+		return cycles >= 17 ? beginCycles(funct, cycles, cycles) : false;
+	}
+	// Call a function once, after a delay in microseconds.
+	template <typename period_t>
+	bool beginOnce(callback_t funct, period_t delay) {
+		uint32_t cycles = cyclesFromPeriod(delay);
+		return cycles > 0 ? beginCycles(funct, cycles, 0) : false;
+	}
+	// Change the period.  The current interval completes as configured.
+	template <typename period_t>
+	void update(period_t period) {
+		uint32_t cycles = cyclesFromPeriod(period);
+		if (cycles >= 17 && _period) _period = cycles;
+	}
+	// Stop calling the function.
+	void end();
+	bool isActive() const {
+		return _active;
+	}
+	// Jitter statistics: how many times the function was called, the
+	// average and worst lateness in 24 MHz cycles, and how many periods
+	// were skipped because the previous call ran too late.
+	uint32_t callCount() const { return _count; }
+	uint32_t lateMax() const { return _lateMax; }
+	uint32_t lateAverage() const { return _count ? _lateSum / _count : 0; }
+	uint32_t missedCount() const { return _missed; }
+	void clearStats() { _count = 0; _lateMax = 0; _lateSum = 0; _missed = 0; }
+	// Set the GPT2 interrupt priority, shared by all MicrosTimers.
+	static void priority(uint8_t n);
+	// Call the functions of all timers due at "now" (the GPT2 count) and
+	// restart the repeating ones.  Returns false if no timer is waiting,
+	// or true with the next deadline in "next".  Used by the interrupt,
+	// and does not touch the hardware, so it can be tested on a PC.
+	static bool run(uint32_t now, uint32_t *next);
+private:
+	bool beginCycles(callback_t funct, uint32_t cycles, uint32_t period);
+	void insert();
+	void remove();
+	static void isr();
+	callback_t _funct;
+	uint32_t _deadline = 0;
+	uint32_t _period = 0; // 0 for beginOnce()
+	MicrosTimer *_next = nullptr;
+	volatile bool _active = false;
+	uint32_t _count = 0;
+	uint32_t _lateMax = 0;
+	uint32_t _missed = 0;
+	uint64_t _lateSum = 0;
+	static MicrosTimer *queue; // waiting timers, nearest deadline first
+
+	template <typename period_t>
+	uint32_t cyclesFromPeriod(period_t period) {
+		static_assert(std::is_arithmetic_v<period_t>, "Period must be arithmetic");
+
+		if (period < 0 || period > MAX_PERIOD)
+			return 0;
+		if constexpr (std::is_integral_v<period_t>)
+			return 24 * period;
+		if constexpr (std::is_floating_point_v<period_t>)
+			return 24.0f * period + 0.5f;
+	}
+};
+
+#endif
+#endif
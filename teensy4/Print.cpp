@@ -38,6 +38,7 @@
 
 #include "debug/printf.h"
 #undef printf
+#include <wchar.h>
 
 size_t Print::write(const uint8_t *buffer, size_t size)
 {
@@ -50,19 +51,8 @@ size_t Print::write(const uint8_t *buffer, size_t size)
 
 size_t Print::print(const String &s)
 {
-	uint8_t buffer[33];
-	size_t count = 0;
-	unsigned int index = 0;
-	unsigned int len = s.length();
-	while (len > 0) {
-		s.getBytes(buffer, sizeof(buffer), index);
-		unsigned int nbytes = len;
-		if (nbytes > sizeof(buffer)-1) nbytes = sizeof(buffer)-1;
-		index += nbytes;
-		len -= nbytes;
-		count += write(buffer, nbytes);
-	}
-	return count;
+	// one write of the whole string, rather than 32 byte pieces
+	return write((const uint8_t *)s.c_str(), s.length());
 }
 
 size_t Print::print(long n)
@@ -97,38 +87,532 @@ int _write(int file, char *ptr, int len)
 }
 }
 
+// printf formatting done here rather than by the C library's vdprintf, so
+// no heap or stdio is used.  Output collects in a small buffer on the
+// stack and goes to write() in chunks, rather than a few bytes at a time.
+
+namespace {
+class printf_output
+{
+public:
+	printf_output(Print *p) : print(p), count(0), len(0) {}
+	void put(char c) {
+		buf[len++] = c;
+		if (len >= sizeof(buf)) send();
+	}
+	void put(const char *s, size_t n) {
+		while (n > 0) {
+			size_t avail = sizeof(buf) - len;
+			if (avail > n) avail = n;
+			memcpy(buf + len, s, avail);
+			len += avail;
+			s += avail;
+			n -= avail;
+			if (len >= sizeof(buf)) send();
+		}
+	}
+	void pad(char c, int n) {
+		while (n-- > 0) put(c);
+	}
+	void send() {
+		if (len == 0) return;
+		count += print->write((const uint8_t *)buf, len);
+		len = 0;
+	}
+	size_t total() const { return count + len; }
+private:
+	Print *print;
+	size_t count;
+	size_t len;
+	char buf[64];
+};
+}
+
+#define PF_LEFT  0x01
+#define PF_PLUS  0x02
+#define PF_SPACE 0x04
+#define PF_ALT   0x08
+#define PF_ZERO  0x10
+#define PF_UPPER 0x20
+
+// sign or 0x prefix, then zeros or padding, then the digits
+static void printf_pad(printf_output &out, const char *prefix, int prefixlen,
+	const char *digits, int len, int zeros, int width, int flags)
+{
+	int padding = width - prefixlen - zeros - len;
+	if (padding < 0) padding = 0;
+	if (!(flags & PF_LEFT)) {
+		if (flags & PF_ZERO) {
+			zeros += padding;
+		} else {
+			out.pad(' ', padding);
+		}
+	}
+	out.put(prefix, prefixlen);
+	out.pad('0', zeros);
+	out.put(digits, len);
+	if (flags & PF_LEFT) out.pad(' ', padding);
+}
+
+static void printf_integer(printf_output &out, uint64_t n, char sign, int base,
+	int width, int precision, int flags)
+{
+	char buf[24];
+	char prefix[2];
+	int prefixlen = 0;
+	char *end = buf + sizeof(buf);
+	char *p = end;
+
+	if (n != 0 || precision != 0) {
+		p = (n > 0xFFFFFFFF) ? ulltoa_end(n, end, base) : ultoa_end(n, end, base);
+	}
+	if (base == 16 && !(flags & PF_UPPER)) {
+		for (char *q = p; q < end; q++) {
+			if (*q >= 'A') *q += 'a' - 'A';
+		}
+	}
+	int len = end - p;
+	int zeros = (precision > len) ? precision - len : 0;
+	if (sign) {
+		prefix[prefixlen++] = sign;
+	} else if (flags & PF_ALT) {
+		if (base == 8 && zeros == 0 && (len == 0 || *p != '0')) {
+			zeros = 1;
+		} else if (base == 16 && n != 0) {
+			prefix[prefixlen++] = '0';
+			prefix[prefixlen++] = (flags & PF_UPPER) ? 'X' : 'x';
+		}
+	}
+	if (precision >= 0) flags &= ~PF_ZERO;
+	printf_pad(out, prefix, prefixlen, p, len, zeros, width, flags);
+}
+
+// Float text comes from dtostrw, once to measure it and again to print it,
+// so any precision works without a buffer.  %g's trailing zeros are removed
+// and #'s decimal point is added as the text goes by.
+struct printf_float_text {
+	printf_output *out;	// nullptr while measuring
+	int len;		// chars so far
+	int sign;		// 1 if the text begins with a sign
+	bool number;		// not inf or nan
+	int dot;		// position of the '.', or -1
+	int keep;		// ddd.ddd without trailing zeros
+	int mantissa;		// position of the 'e', or the length
+	int exp;
+	int expsign;
+	int zeros;		// zero padding after the sign
+	bool adddot;
+};
+
+static void printf_float_write(void *arg, const char *s, size_t len)
+{
+	printf_float_text *t = (printf_float_text *)arg;
+
+	for (size_t i=0; i < len; i++, t->len++) {
+		char c = s[i];
+		if (t->out) {
+			if (t->len == t->sign) t->out->pad('0', t->zeros);
+			if (t->len < t->keep) {
+				t->out->put(c);
+			} else if (t->len >= t->mantissa) {
+				if (t->len == t->mantissa && t->adddot) t->out->put('.');
+				t->out->put(c);
+			}
+		} else {
+			if (t->len == 0) t->sign = (c == '-' || c == '+' || c == ' ');
+			if (t->len == t->sign) t->number = isdigit(c);
+			if (t->mantissa >= 0) {
+				if (c == '-') t->expsign = -1;
+				else if (isdigit(c)) t->exp = t->exp * 10 + c - '0';
+			} else if (c == 'e' || c == 'E') {
+				t->mantissa = t->len;
+			} else {
+				if (c == '.') t->dot = t->len;
+				if (c != '0') t->keep = t->len + 1;
+			}
+		}
+	}
+}
+
+static void printf_float_measure(printf_float_text &t, double n, int precision,
+	unsigned int dflags)
+{
+	t.out = nullptr;
+	t.len = 0;
+	t.sign = 0;
+	t.number = false;
+	t.dot = -1;
+	t.keep = 0;
+	t.mantissa = -1;
+	t.exp = 0;
+	t.expsign = 1;
+	dtostrw(n, precision, dflags, printf_float_write, &t);
+	if (t.mantissa < 0) t.mantissa = t.len;
+	t.exp *= t.expsign;
+}
+
+static void printf_float(printf_output &out, double n, char conv, int width,
+	int precision, int flags)
+{
+	printf_float_text t;
+	unsigned int dflags = 0;
+	bool strip = false;
+
+	if (precision < 0) precision = 6;
+	if (flags & PF_PLUS) dflags |= DTOSTR_PLUS_SIGN;
+	else if (flags & PF_SPACE) dflags |= DTOSTR_ALWAYS_SIGN;
+	if (flags & PF_UPPER) dflags |= DTOSTR_UPPERCASE;
+	if (conv == 'g') {
+		// %e if the exponent is below -4 or at least the precision
+		if (precision == 0) precision = 1;
+		printf_float_measure(t, n, precision - 1, dflags | DTOSTR_EXPONENT);
+		if (t.mantissa < t.len && t.exp >= -4 && t.exp < precision) {
+			precision = precision - 1 - t.exp;
+			printf_float_measure(t, n, precision, dflags);
+		} else {
+			precision = precision - 1;
+			dflags |= DTOSTR_EXPONENT;
+		}
+		strip = !(flags & PF_ALT);
+	} else {
+		if (conv == 'e') dflags |= DTOSTR_EXPONENT;
+		printf_float_measure(t, n, precision, dflags);
+	}
+	if (!strip || t.dot < 0) {
+		t.keep = t.mantissa;
+	} else if (t.keep == t.dot + 1) {
+		t.keep = t.dot;
+	}
+	t.adddot = (flags & PF_ALT) && t.dot < 0 && t.number;
+	if (!t.number) flags &= ~PF_ZERO;
+	int padding = width - (t.keep + t.len - t.mantissa + t.adddot);
+	if (padding < 0) padding = 0;
+	t.zeros = 0;
+	if (!(flags & PF_LEFT)) {
+		if (flags & PF_ZERO) {
+			t.zeros = padding;
+		} else {
+			out.pad(' ', padding);
+		}
+	}
+	t.out = &out;
+	t.len = 0;
+	dtostrw(n, precision, dflags, printf_float_write, &t);
+	if (t.adddot && t.mantissa == t.len) out.put('.');
+	if (flags & PF_LEFT) out.pad(' ', padding);
+}
+
+// %a: [-]0xh.hhhp[+-]d, the exact binary value in hex.  With a precision
+// the digits are rounded to nearest, ties to even, as the C library does.
+static void printf_hexfloat(printf_output &out, double d, int width,
+	int precision, int flags)
+{
+	union { double d; uint64_t u; } v;
+	const char *hex = (flags & PF_UPPER) ? "0123456789ABCDEF" : "0123456789abcdef";
+	char prefix[3];
+	int prefixlen = 0;
+	char mant[16];
+	int mlen = 0;
+	char expo[8];
+	int elen = 0;
+
+	v.d = d;
+	if (v.u >> 63) prefix[prefixlen++] = '-';
+	else if (flags & PF_PLUS) prefix[prefixlen++] = '+';
+	else if (flags & PF_SPACE) prefix[prefixlen++] = ' ';
+	int e = (v.u >> 52) & 0x7FF;
+	uint64_t all = v.u & 0xFFFFFFFFFFFFFull;
+	if (e == 0x7FF) {
+		const char *s = all ? "nan" : "inf";
+		if (flags & PF_UPPER) s = all ? "NAN" : "INF";
+		printf_pad(out, prefix, prefixlen, s, 3, 0, width, flags & ~PF_ZERO);
+		return;
+	}
+	prefix[prefixlen++] = '0';
+	prefix[prefixlen++] = (flags & PF_UPPER) ? 'X' : 'x';
+	if (e == 0) {
+		e = all ? -1022 : 0;	// subnormal, 0x0.hhh
+	} else {
+		all |= 1ull << 52;
+		e -= 1023;
+	}
+	// all holds the leading digit and 13 hex digits
+	int digits = 13;
+	if (precision < 0) {
+		while (digits > 0 && (all & 15) == 0) {
+			all >>= 4;
+			digits--;
+		}
+	} else if (precision < 13) {
+		int shift = (13 - precision) * 4;
+		uint64_t rem = all & ((1ull << shift) - 1);
+		uint64_t half = 1ull << (shift - 1);
+		all >>= shift;
+		if (rem > half || (rem == half && (all & 1))) all++;
+		digits = precision;
+	}
+	mant[mlen++] = hex[all >> (digits * 4)];
+	if (digits > 0 || precision > 0 || (flags & PF_ALT)) mant[mlen++] = '.';
+	for (int i = digits - 1; i >= 0; i--) mant[mlen++] = hex[(all >> (i * 4)) & 15];
+	int zeros = (precision > 13) ? precision - 13 : 0;
+	expo[elen++] = (flags & PF_UPPER) ? 'P' : 'p';
+	expo[elen++] = (e < 0) ? '-' : '+';
+	unsigned int ue = (e < 0) ? -e : e;
+	char *end = expo + sizeof(expo);
+	char *p = ultoa_end(ue, end, 10);
+	memmove(expo + elen, p, end - p);
+	elen += end - p;
+
+	int padding = width - prefixlen - mlen - zeros - elen;
+	if (padding < 0) padding = 0;
+	if (!(flags & (PF_LEFT | PF_ZERO))) out.pad(' ', padding);
+	out.put(prefix, prefixlen);
+	if (!(flags & PF_LEFT) && (flags & PF_ZERO)) out.pad('0', padding);
+	out.put(mant, mlen);
+	out.pad('0', zeros);
+	out.put(expo, elen);
+	if (flags & PF_LEFT) out.pad(' ', padding);
+}
+
+// Wide characters, from %lc and %ls, print as UTF-8
+static int printf_utf8(uint32_t c, char *buf)
+{
+	if (c < 0x80) {
+		buf[0] = c;
+		return 1;
+	}
+	if (c < 0x800) {
+		buf[0] = 0xC0 | (c >> 6);
+		buf[1] = 0x80 | (c & 0x3F);
+		return 2;
+	}
+	if ((c >= 0xD800 && c < 0xE000) || c > 0x10FFFF) c = 0xFFFD;
+	if (c < 0x10000) {
+		buf[0] = 0xE0 | (c >> 12);
+		buf[1] = 0x80 | ((c >> 6) & 0x3F);
+		buf[2] = 0x80 | (c & 0x3F);
+		return 3;
+	}
+	buf[0] = 0xF0 | (c >> 18);
+	buf[1] = 0x80 | ((c >> 12) & 0x3F);
+	buf[2] = 0x80 | ((c >> 6) & 0x3F);
+	buf[3] = 0x80 | (c & 0x3F);
+	return 4;
+}
+
+// Width and precision count bytes of UTF-8, and no character is cut short
+static void printf_wstring(printf_output &out, const wchar_t *s, int width,
+	int precision, int flags)
+{
+	char buf[4];
+	int len = 0;
+
+	if (s == nullptr) s = L"(null)";
+	for (const wchar_t *p = s; *p; p++) {
+		int n = printf_utf8(*p, buf);
+		if (precision >= 0 && len + n > precision) break;
+		len += n;
+	}
+	int padding = (width > len) ? width - len : 0;
+	if (!(flags & PF_LEFT)) out.pad(' ', padding);
+	for (int done = 0; done < len; s++) {
+		int n = printf_utf8(*s, buf);
+		out.put(buf, n);
+		done += n;
+	}
+	if (flags & PF_LEFT) out.pad(' ', padding);
+}
+
+int Print::vprintf(const char *format, va_list ap)
+{
+	printf_output out(this);
+	const char *f = format;
+
+	if (format == nullptr) return 0;
+	while (1) {
+		const char *text = f;
+		while (*f && *f != '%') f++;
+		out.put(text, f - text);
+		if (*f == 0) break;
+		const char *spec = f++;
+
+		int flags = 0;
+		while (1) {
+			if (*f == '-') flags |= PF_LEFT;
+			else if (*f == '+') flags |= PF_PLUS;
+			else if (*f == ' ') flags |= PF_SPACE;
+			else if (*f == '#') flags |= PF_ALT;
+			else if (*f == '0') flags |= PF_ZERO;
+			else break;
+			f++;
+		}
+		int width = 0;
+		if (*f == '*') {
+			width = va_arg(ap, int);
+			if (width < 0) {
+				flags |= PF_LEFT;
+				width = -width;
+			}
+			f++;
+		} else {
+			while (isdigit(*f)) width = width * 10 + *f++ - '0';
+		}
+		int precision = -1;
+		if (*f == '.') {
+			f++;
+			precision = 0;
+			if (*f == '*') {
+				precision = va_arg(ap, int);
+				f++;
+			} else {
+				while (isdigit(*f)) precision = precision * 10 + *f++ - '0';
+			}
+		}
+		if (flags & PF_LEFT) flags &= ~PF_ZERO;
+		int size = sizeof(int);
+		int half = 0;
+		char ld = 0;
+		char wide = 0;
+		while (1) {
+			if (*f == 'h') half++;
+			else if (*f == 'l') {
+				size = (size == sizeof(long) && f[-1] == 'l') ? sizeof(long long) : sizeof(long);
+				wide = 1;
+			}
+			else if (*f == 'j') size = sizeof(intmax_t);
+			else if (*f == 'z') size = sizeof(size_t);
+			else if (*f == 't') size = sizeof(ptrdiff_t);
+			else if (*f == 'L') ld = 1;
+			else break;
+			f++;
+		}
+
+		char c = *f++;
+		uint64_t n;
+		switch (c) {
+		  case 'd':
+		  case 'i': {
+			int64_t i;
+			if (size == sizeof(long long)) i = va_arg(ap, long long);
+			else if (size == sizeof(long)) i = va_arg(ap, long);
+			else i = va_arg(ap, int);
+			if (half == 1) i = (short)i;
+			else if (half > 1) i = (signed char)i;
+			char sign = 0;
+			if (i < 0) sign = '-';
+			else if (flags & PF_PLUS) sign = '+';
+			else if (flags & PF_SPACE) sign = ' ';
+			n = (i < 0) ? 0 - (uint64_t)i : (uint64_t)i;
+			printf_integer(out, n, sign, 10, width, precision, flags);
+			break;
+		  }
+		  case 'X':
+			flags |= PF_UPPER;
+			// fall through
+		  case 'u':
+		  case 'o':
+		  case 'x':
+			if (size == sizeof(long long)) n = va_arg(ap, unsigned long long);
+			else if (size == sizeof(long)) n = va_arg(ap, unsigned long);
+			else n = va_arg(ap, unsigned int);
+			if (half == 1) n = (unsigned short)n;
+			else if (half > 1) n = (unsigned char)n;
+			printf_integer(out, n, 0, (c == 'u') ? 10 : (c == 'o') ? 8 : 16,
+				width, precision, flags);
+			break;
+		  case 'p':
+			n = (uintptr_t)va_arg(ap, void *);
+			if (n == 0) {
+				printf_pad(out, "0x", 2, "0", 1, 0, width, flags);
+				break;
+			}
+			printf_integer(out, n, 0, 16, width, precision, flags | PF_ALT);
+			break;
+		  case 'A':
+			flags |= PF_UPPER;
+			// fall through
+		  case 'a': {
+			double d = ld ? (double)va_arg(ap, long double) : va_arg(ap, double);
+			printf_hexfloat(out, d, width, precision, flags);
+			break;
+		  }
+		  case 'E':
+		  case 'F':
+		  case 'G':
+			flags |= PF_UPPER;
+			c += 'a' - 'A';
+			// fall through
+		  case 'e':
+		  case 'f':
+		  case 'g': {
+			double d = ld ? (double)va_arg(ap, long double) : va_arg(ap, double);
+			printf_float(out, d, c, width, precision, flags);
+			break;
+		  }
+		  case 'C':
+			wide = 1;
+			// fall through
+		  case 'c': {
+			char ch[4];
+			int len = 1;
+			if (wide) len = printf_utf8(va_arg(ap, wint_t), ch);
+			else ch[0] = va_arg(ap, int);
+			printf_pad(out, nullptr, 0, ch, len, 0, width, flags & ~PF_ZERO);
+			break;
+		  }
+		  case 'S':
+			wide = 1;
+			// fall through
+		  case 's': {
+			if (wide) {
+				printf_wstring(out, va_arg(ap, const wchar_t *), width, precision, flags);
+				break;
+			}
+			const char *s = va_arg(ap, const char *);
+			if (s == nullptr) s = "(null)";
+			size_t len = (precision >= 0) ? strnlen(s, precision) : strlen(s);
+			printf_pad(out, nullptr, 0, s, len, 0, width, flags & ~PF_ZERO);
+			break;
+		  }
+		  case 'n':
+			*va_arg(ap, int *) = out.total();
+			break;
+		  case '%':
+			out.put('%');
+			break;
+		  default:
+			// unknown conversion, print as-is.  Its argument type is
+			// unknown, so none is taken and the rest may be misaligned.
+			if (c == 0) f--;
+			out.put(spec, f - spec);
+		}
+	}
+	out.send();
+	return out.total();
+}
+
 int Print::printf(const char *format, ...)
 {
 	va_list ap;
 	va_start(ap, format);
-#ifdef __STRICT_ANSI__
-	va_end(ap);
-	return 0;  // TODO: make this work with -std=c++0x
-#else
-	int retval = vdprintf((int)this, format, ap);
+	int retval = vprintf(format, ap);
 	va_end(ap);
 	return retval;
-#endif
 }
 
 int Print::printf(const __FlashStringHelper *format, ...)
 {
 	va_list ap;
 	va_start(ap, format);
-#ifdef __STRICT_ANSI__
-	va_end(ap);
-	return 0;
-#else
-	int retval = vdprintf((int)this, (const char *)format, ap);
+	int retval = vprintf((const char *)format, ap);
 	va_end(ap);
 	return retval;
-#endif
 }
 
 size_t Print::printNumber(unsigned long n, uint8_t base, uint8_t sign)
 {
-	uint8_t buf[34];
-	uint8_t digit, i;
+	char buf[34];
+	char *p;
 
 	// TODO: make these checks as inline, since base is
 	// almost always a constant.  base = 0 (BYTE) should
@@ -138,99 +622,161 @@ size_t Print::printNumber(unsigned long n, uint8_t base, uint8_t sign)
 	} else if (base == 1) {
 		base = 10;
 	}
+	p = ultoa_end(n, buf + sizeof(buf), base);
+	if (sign) *--p = '-';
+	return write((uint8_t *)p, buf + sizeof(buf) - p);
+}
 
+size_t Print::printNumber64(uint64_t n, uint8_t base, uint8_t sign)
+{
+	char buf[66];
+	char *p;
+
+	if (base < 2) return 0;
+	p = ulltoa_end(n, buf + sizeof(buf), base);
+	if (sign) *--p = '-';
+	return write((uint8_t *)p, buf + sizeof(buf) - p);
+}
+
+size_t Print::printPadded(long n, int base, uint8_t width, char pad)
+{
+	if (base == 10 && n < 0) return printNumberPadded(0 - (unsigned long)n, base, 1, width, pad);
+	return printNumberPadded((unsigned long)n, base, 0, width, pad);
+}
 
-	if (n == 0) {
-		buf[sizeof(buf) - 1] = '0';
-		i = sizeof(buf) - 1;
+size_t Print::printPadded(int64_t n, int base, uint8_t width, char pad)
+{
+	if (base == 10 && n < 0) return printNumberPadded(0 - (uint64_t)n, base, 1, width, pad);
+	return printNumberPadded(n, base, 0, width, pad);
+}
+
+size_t Print::printNumberPadded(uint64_t n, uint8_t base, uint8_t sign, uint8_t width, char pad)
+{
+	char buf[66];
+	char *end = buf + sizeof(buf);
+	char *p;
+	int len = width;
+
+	if (base < 2) base = 10;
+	if (len > (int)sizeof(buf) - 1) len = sizeof(buf) - 1;
+	if (n > 0xFFFFFFFF) {
+		p = ulltoa_end(n, end, base);
 	} else {
-		i = sizeof(buf) - 1;
-		while (1) {
-			digit = n % base;
-			buf[i] = ((digit < 10) ? '0' + digit : 'A' + digit - 10);
-			n /= base;
-			if (n == 0) break;
-			i--;
-		}
-	}
-	if (sign) {
-		i--;
-		buf[i] = '-';
+		p = ultoa_end(n, end, base);
 	}
-	return write(buf + i, sizeof(buf) - i);
+	// zeros go between the sign and digits, other padding before the sign
+	if (sign && pad == '0') len--;
+	if (sign && pad != '0') *--p = '-';
+	while (end - p < len) *--p = pad;
+	if (sign && pad == '0') *--p = '-';
+	return write((uint8_t *)p, end - p);
 }
 
-size_t Print::printNumber64(uint64_t n, uint8_t base, uint8_t sign)
+size_t Print::formatInteger(uint64_t n, bool negative, char type, uint8_t width, char fill, char align)
 {
-	uint8_t buf[66];
-	uint8_t digit, i;
+	char buf[66];
+	char *end = buf + sizeof(buf);
+	int base = 10;
 
-	if (base < 2) return 0;
-	if (n == 0) {
-		buf[sizeof(buf) - 1] = '0';
-		i = sizeof(buf) - 1;
-	} else {
-		i = sizeof(buf) - 1;
-		while (1) {
-			digit = n % base;
-			buf[i] = ((digit < 10) ? '0' + digit : 'A' + digit - 10);
-			n /= base;
-			if (n == 0) break;
-			i--;
+	if (type == 'x' || type == 'X') base = 16;
+	else if (type == 'o') base = 8;
+	else if (type == 'b') base = 2;
+	char *p = (n > 0xFFFFFFFF) ? ulltoa_end(n, end, base) : ultoa_end(n, end, base);
+	if (type == 'x') {
+		for (char *q = p; q < end; q++) {
+			if (*q >= 'A') *q += 'a' - 'A';
 		}
 	}
-	if (sign) {
-		i--;
-		buf[i] = '-';
+	if (negative) *--p = '-';
+	if (width == 0) return write((uint8_t *)p, end - p);
+	return formatPadded(p, end - p, negative, width, fill, align ? align : '>');
+}
+
+struct print_float_output {
+	Print *print;
+	size_t count;
+};
+
+static void print_float_write(void *arg, const char *s, size_t len)
+{
+	print_float_output *out = (print_float_output *)arg;
+	out->count += out->print->write((const uint8_t *)s, len);
+}
+
+size_t Print::formatFloat(double n, char type, int precision, uint8_t width, char fill, char align, unsigned int flags)
+{
+	print_float_output out = { this, 0 };
+	char head[2];
+
+	if (type == 'e' || type == 'E') flags |= DTOSTR_EXPONENT;
+	if (type == 'E') flags |= DTOSTR_UPPERCASE;
+	if (type && precision < 0) precision = 6; // like printf, {} gives the shortest
+	if (width == 0) {
+		dtostrw(n, precision, flags, print_float_write, &out);
+		return out.count;
+	}
+	// any precision may be given, so the text is streamed rather than padded
+	// from a buffer, with only its length and first char known beforehand
+	size_t len = dtostrn(n, head, sizeof(head), precision, flags);
+	size_t pad = (width > len) ? width - len : 0;
+	if (head[0] != '-' && !isdigit(head[0])) fill = ' '; // inf, nan
+	if (align == 0) align = '>';
+	if (align == '=' && head[0] == '-') {
+		// zeros go after the sign
+		out.count += write('-');
+		n = -n;
 	}
-	return write(buf + i, sizeof(buf) - i);
+	if (align != '<') out.count += formatFill(fill, pad);
+	dtostrw(n, precision, flags, print_float_write, &out);
+	if (align == '<') out.count += formatFill(fill, pad);
+	return out.count;
 }
 
-size_t Print::printFloat(double number, uint8_t digits) 
+size_t Print::formatText(const char *s, size_t len, uint8_t width, char fill, char align)
 {
-	uint8_t sign=0;
-	size_t count=0;
-
-	if (isnan(number)) return print("nan");
-    	if (isinf(number)) return print("inf");
-    	if (number > 4294967040.0f) return print("ovf");  // constant determined empirically
-    	if (number <-4294967040.0f) return print("ovf");  // constant determined empirically
-	
-	// Handle negative numbers
-	if (number < 0.0) {
-		sign = 1;
-		number = -number;
-	}
-
-	// Round correctly so that print(1.999, 2) prints as "2.00"
-	double rounding = 0.5;
-	for (uint8_t i=0; i<digits; ++i) {
-		rounding *= 0.1;
-	}
-	number += rounding;
-
-	// Extract the integer part of the number and print it
-	unsigned long int_part = (unsigned long)number;
-	double remainder = number - (double)int_part;
-	count += printNumber(int_part, 10, sign);
-
-	// Print the decimal point, but only if there are digits beyond
-	if (digits > 0) {
-		uint8_t n, buf[16], count=1;
-		buf[0] = '.';
-
-		// Extract digits from the remainder one at a time
-		if (digits > sizeof(buf) - 1) digits = sizeof(buf) - 1;
-
-		while (digits-- > 0) {
-			remainder *= 10.0;
-			n = (uint8_t)(remainder);
-			buf[count++] = '0' + n;
-			remainder -= n; 
-		}
-		count += write(buf, count);
+	return formatPadded(s, len, 0, width, fill, align ? align : '<');
+}
+
+size_t Print::formatPadded(const char *s, size_t len, size_t signlen, uint8_t width, char fill, char align)
+{
+	size_t count = 0;
+	size_t pad = (width > len) ? width - len : 0;
+
+	if (align == '=') {
+		// zeros go after the sign
+		count += write((const uint8_t *)s, signlen);
+		s += signlen;
+		len -= signlen;
 	}
+	if (align != '<') count += formatFill(fill, pad);
+	count += write((const uint8_t *)s, len);
+	if (align == '<') count += formatFill(fill, pad);
 	return count;
 }
 
+size_t Print::formatFill(char fill, size_t n)
+{
+	char buf[32];
+	size_t count = 0;
+
+	memset(buf, fill, (n < sizeof(buf)) ? n : sizeof(buf));
+	while (n > 0) {
+		size_t chunk = (n < sizeof(buf)) ? n : sizeof(buf);
+		count += write((const uint8_t *)buf, chunk);
+		n -= chunk;
+	}
+	return count;
+}
+
+size_t Print::printFloat(double number, int digits, unsigned int flags)
+{
+	print_float_output out = { this, 0 };
+
+	// ddd.ddd is too long for 1e40 and larger
+	if (number >= 1e40 || number <= -1e40) flags |= DTOSTR_EXPONENT;
+	// digits < 0 prints the shortest text which reads back as the same number
+	dtostrw(number, digits, flags, print_float_write, &out);
+	return out.count;
+}
+
 
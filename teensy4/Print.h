@@ -37,6 +37,7 @@
 #include "core_id.h"
 #include "WString.h"
 #include "Printable.h"
+#include "PrintFormat.h"
 
 #define DEC 10
 #define HEX 16
@@ -64,6 +65,8 @@ class Print
 	size_t write(const char *buffer, size_t size)	{ return write((const uint8_t *)buffer, size); }
 	// Print a string
 	size_t print(const String &s);
+	// Print a string view
+	size_t print(const StringView &s)		{ return write((const uint8_t *)s.data(), s.length()); }
 	// Print a single character
 	size_t print(char c)				{ return write((uint8_t)c); }
 	// Print a string
@@ -100,14 +103,27 @@ class Print
 	// Print a number in any number base (eg, BIN, HEX, OCT)
 	size_t print(uint64_t n, int base)		{ return printNumber64(n, base, 0); }
 
+	// Print a number with at least "width" characters, padded on the left with zeros or "pad"
+	size_t printPadded(unsigned long n, int base, uint8_t width, char pad = '0') { return printNumberPadded(n, base, 0, width, pad); }
+	size_t printPadded(long n, int base, uint8_t width, char pad = '0');
+	size_t printPadded(unsigned int n, int base, uint8_t width, char pad = '0') { return printNumberPadded(n, base, 0, width, pad); }
+	size_t printPadded(int n, int base, uint8_t width, char pad = '0') { return printPadded((long)n, base, width, pad); }
+	size_t printPadded(uint64_t n, int base, uint8_t width, char pad = '0') { return printNumberPadded(n, base, 0, width, pad); }
+	size_t printPadded(int64_t n, int base, uint8_t width, char pad = '0');
+
 	// Print a floating point (decimal) number
 	size_t print(double n, int digits = 2)		{ return printFloat(n, digits); }
+	// Print a floating point number in scientific notation, eg 6.022e+23.  Negative digits
+	// prints the fewest digits which read back as the same number.
+	size_t printScientific(double n, int digits = -1) { return printFloat(n, digits, DTOSTR_EXPONENT); }
 	// Print an object instance in human readable format
 	size_t print(const Printable &obj)		{ return obj.printTo(*this); }
 	// Print a newline
 	size_t println(void);
 	// Print a string and newline
 	size_t println(const String &s)			{ return print(s) + println(); }
+	// Print a string view and newline
+	size_t println(const StringView &s)		{ return print(s) + println(); }
 	// Print a single character and newline
 	size_t println(char c)				{ return print(c) + println(); }
 	// Print a string and newline
@@ -157,7 +173,16 @@ class Print
 	// printf is a C standard function which allows you to print any number of variables using a somewhat cryptic format string
 	int printf(const __FlashStringHelper *format, ...);
 	// vprintf is a C standard function that allows you to print a variable argument list with a format string
-	int vprintf(const char *format, va_list ap) { return vdprintf((int)this, format, ap); }
+	int vprintf(const char *format, va_list ap);
+
+	// Print using a format parsed and checked at compile time, see PrintFormat.h
+	//   Serial.format(FMT("x={} y={:08x}\n"), x, y);
+	template <typename F, typename... Args>
+	size_t format(F, const Args &... args) {
+		static_assert(print_format::parsed<F>::args == sizeof...(Args),
+			"number of arguments does not match the {} in the format");
+		return formatItems<F>(std::make_index_sequence<print_format::parsed<F>::count>(), args...);
+	}
 
 	// format warnings are too pedantic - disable until newer toolchain offers better...
 	// https://forum.pjrc.com/threads/62473?p=256873&viewfull=1#post256873
@@ -167,9 +192,78 @@ class Print
 	void setWriteError(int err = 1) { write_error = err; }
   private:
 	int write_error;
-	size_t printFloat(double n, uint8_t digits);
+	size_t printFloat(double n, int digits, unsigned int flags = 0);
 	size_t printNumber(unsigned long n, uint8_t base, uint8_t sign);
 	size_t printNumber64(uint64_t n, uint8_t base, uint8_t sign);
+	size_t printNumberPadded(uint64_t n, uint8_t base, uint8_t sign, uint8_t width, char pad);
+	size_t formatInteger(uint64_t n, bool negative, char type, uint8_t width, char fill, char align);
+	size_t formatFloat(double n, char type, int precision, uint8_t width, char fill, char align, unsigned int flags = 0);
+	size_t formatText(const char *s, size_t len, uint8_t width, char fill, char align);
+	size_t formatPadded(const char *s, size_t len, size_t signlen, uint8_t width, char fill, char align);
+	size_t formatFill(char fill, size_t n);
+	template <typename F, size_t... I, typename... Args>
+	size_t formatItems(std::index_sequence<I...>, const Args &... args) {
+		// comma fold, so the items print left to right
+		size_t n = 0;
+		((n += formatItem<F, I>(args...)), ...);
+		return n;
+	}
+	template <typename F, size_t I, typename... Args>
+	size_t formatItem(const Args &... args) {
+		constexpr print_format::item it = print_format::parsed<F>::items.list[I];
+		if constexpr (it.len > 0) {
+			return write((const uint8_t *)F::str() + it.start, it.len);
+		} else {
+			return formatArg<F, I>(print_format::nth<it.arg>(args...));
+		}
+	}
+	template <typename F, size_t I, typename T>
+	size_t formatArg(const T &value) {
+		constexpr print_format::item it = print_format::parsed<F>::items.list[I];
+		constexpr bool number = std::is_arithmetic<T>::value || std::is_enum<T>::value;
+		constexpr bool text = std::is_convertible<const T &, const char *>::value
+			|| std::is_same<T, String>::value || std::is_same<T, StringView>::value;
+		if constexpr (it.type == 'f' || it.type == 'e' || it.type == 'E') {
+			static_assert(number, "{:f} and {:e} need a number");
+			return formatFloat(value, it.type, it.precision, it.width, it.fill, it.align,
+				std::is_same<T, float>::value ? DTOSTR_FLOAT : 0);
+		} else if constexpr (it.type == 's' || (it.type == 0 && text)) {
+			static_assert(text, "{:s} needs a string");
+			if constexpr (std::is_same<T, String>::value) {
+				return formatText(value.c_str(), value.length(), it.width, it.fill, it.align);
+			} else if constexpr (std::is_same<T, StringView>::value) {
+				return formatText(value.data(), value.length(), it.width, it.fill, it.align);
+			} else {
+				const char *s = value;
+				if (it.width == 0) return write(s);
+				return formatText(s, (s ? strlen(s) : 0), it.width, it.fill, it.align);
+			}
+		} else if constexpr (it.type == 'c' || (it.type == 0 && std::is_same<T, char>::value)) {
+			// plain char prints as a char, {:d} or {:x} print its number
+			static_assert(std::is_integral<T>::value, "{:c} needs a char or integer");
+			char c = value;
+			return formatText(&c, 1, it.width, it.fill, it.align);
+		} else if constexpr (it.type != 0 || std::is_integral<T>::value || std::is_enum<T>::value) {
+			static_assert(std::is_integral<T>::value || std::is_enum<T>::value,
+				"{:d} {:x} {:X} {:o} and {:b} need an integer");
+			if constexpr (std::is_same<T, bool>::value || std::is_enum<T>::value) {
+				return formatInteger((uint64_t)value, false, it.type, it.width, it.fill, it.align);
+			} else if constexpr (std::is_signed<T>::value) {
+				bool neg = (value < 0) && (it.type == 0 || it.type == 'd');
+				uint64_t n = neg ? 0 - (uint64_t)(int64_t)value : (uint64_t)(typename std::make_unsigned<T>::type)value;
+				return formatInteger(n, neg, it.type, it.width, it.fill, it.align);
+			} else {
+				return formatInteger(value, false, it.type, it.width, it.fill, it.align);
+			}
+		} else if constexpr (std::is_floating_point<T>::value) {
+			// a float's shortest digits, so 0.1f prints 0.1
+			return formatFloat(value, it.type, it.precision, it.width, it.fill, it.align,
+				std::is_same<T, float>::value ? DTOSTR_FLOAT : 0);
+		} else {
+			static_assert(it.width == 0, "width only works with numbers and strings");
+			return print(value);
+		}
+	}
 };
 
 
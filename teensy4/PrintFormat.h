@@ -0,0 +1,189 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef PrintFormat_h
+#define PrintFormat_h
+#ifdef __cplusplus
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+
+// Format strings for Print::format(), parsed and checked at compile time.
+//
+//   Serial.format(FMT("x={} y={:08x} v={:.3f}\n"), x, y, v);
+//
+// Each {} prints the next argument.  Inside the braces, after a colon:
+//   [[fill]align][0][width][.precision][type]
+//   align: < left, > right
+//   0: pad numbers with zeros after the sign
+//   type: d x X o b c (integers), f e E (numbers), s (strings)
+// With no type, a char prints as a character and a float or double with
+// the fewest digits which read back as the same number.
+// {{ and }} print a single brace.  An unknown spec, a width above 255, a
+// precision above 127, a wrong type for an argument, or a different number
+// of arguments than {} is a compile error.
+
+#define FMT(s) ([] { \
+	struct print_format_string { static constexpr const char *str() { return s; } }; \
+	return print_format_string(); }())
+
+namespace print_format {
+
+struct item {
+	uint16_t start;		// text: offset in the format string
+	uint16_t len;		// text: length, or 0 for an argument
+	uint8_t arg;		// argument number
+	char type;		// 0 for default
+	char fill;
+	char align;		// '<', '>', or '=' for zeros after the sign
+	uint8_t width;
+	int8_t precision;	// -1 for default
+};
+
+// Not constexpr, so reaching these while parsing is a compile error which
+// names the problem.
+void error_unmatched_brace_in_format();
+void error_unknown_spec_in_format();
+void error_width_above_255_in_format();
+void error_precision_above_127_in_format();
+
+constexpr bool is_type(char c)
+{
+	return c == 'd' || c == 'x' || c == 'X' || c == 'o' || c == 'b' || c == 'c'
+		|| c == 'f' || c == 'e' || c == 'E' || c == 's';
+}
+
+// Split the format into text and argument items.  Returns the number of
+// items, storing them if out isn't null.
+constexpr size_t parse(const char *f, item *out, uint8_t *args = nullptr)
+{
+	size_t n = 0, i = 0, text = 0;
+	uint8_t arg = 0;
+
+	while (1) {
+		char c = f[i];
+		if (c == 0 || c == '{' || c == '}') {
+			size_t end = i;
+			if (c != 0 && f[i + 1] == c) end++; // {{ or }}
+			if (end > text) {
+				if (out) out[n] = item{(uint16_t)text, (uint16_t)(end - text), 0, 0, 0, 0, 0, 0};
+				n++;
+			}
+			if (c == 0) break;
+			if (end > i) {
+				i += 2;
+				text = i;
+				continue;
+			}
+			if (c == '}') error_unmatched_brace_in_format();
+			item it{0, 0, arg++, 0, ' ', 0, 0, -1};
+			i++;
+			if (f[i] == ':') {
+				i++;
+				if (f[i] && f[i] != '}' && (f[i + 1] == '<' || f[i + 1] == '>')) {
+					it.fill = f[i];
+					it.align = f[i + 1];
+					i += 2;
+				} else if (f[i] == '<' || f[i] == '>') {
+					it.align = f[i++];
+				}
+				if (f[i] == '0') {
+					it.fill = '0';
+					if (it.align == 0) it.align = '=';
+					i++;
+				}
+				unsigned int width = 0;
+				while (f[i] >= '0' && f[i] <= '9') {
+					width = width * 10 + f[i++] - '0';
+					if (width > 255) error_width_above_255_in_format();
+				}
+				it.width = width;
+				if (f[i] == '.') {
+					i++;
+					unsigned int precision = 0;
+					while (f[i] >= '0' && f[i] <= '9') {
+						precision = precision * 10 + f[i++] - '0';
+						if (precision > 127) error_precision_above_127_in_format();
+					}
+					it.precision = precision;
+				}
+				if (is_type(f[i])) it.type = f[i++];
+			}
+			if (f[i] != '}') error_unknown_spec_in_format();
+			i++;
+			if (out) out[n] = it;
+			n++;
+			text = i;
+			continue;
+		}
+		i++;
+	}
+	if (args) *args = arg;
+	return n;
+}
+
+constexpr uint8_t count_args(const char *f)
+{
+	uint8_t args = 0;
+	parse(f, nullptr, &args);
+	return args;
+}
+
+template <typename F>
+struct parsed {
+	static constexpr size_t count = parse(F::str(), nullptr);
+	static constexpr uint8_t args = count_args(F::str());
+	struct table {
+		item list[count ? count : 1];
+	};
+	static constexpr table make() {
+		table t{};
+		parse(F::str(), t.list);
+		return t;
+	}
+	static constexpr table items = make();
+};
+
+template <size_t I, typename T, typename... Rest>
+constexpr const auto & nth(const T &first, const Rest &... rest)
+{
+	if constexpr (I == 0) {
+		return first;
+	} else {
+		return nth<I - 1>(rest...);
+	}
+}
+
+} // namespace print_format
+
+#endif // __cplusplus
+#endif
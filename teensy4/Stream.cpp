@@ -21,10 +21,31 @@
  */
 
 #include <Arduino.h>
+#include "EventResponder.h"
+#include <errno.h>
+#include <limits.h>
 
-#define PARSE_TIMEOUT 1000  // default number of milli-seconds to wait
 #define NO_SKIP_CHAR  1  // a magic char not found in a valid ASCII numeric field
 
+// wait for more data until the timeout, counted from startMillis.  Streams
+// which signal arriving data let the CPU sleep, others are polled with yield().
+// Returns false once the timeout has elapsed.
+bool Stream::waitForData(unsigned long startMillis)
+{
+  unsigned long elapsed = millis() - startMillis;
+  if (elapsed >= _timeout) return false;
+  EventResponder event;
+  if (setReadEvent(&event)) {
+    unsigned long wait = _timeout - elapsed;
+    // data which arrived before the event was set has not triggered it
+    if (available() <= 0) event.waitForEvent(event, (wait < INT_MAX) ? wait : INT_MAX);
+    setReadEvent(nullptr);
+  } else {
+    yield();
+  }
+  return true;
+}
+
 // private method to read stream with timeout
 int Stream::timedRead()
 {
@@ -33,8 +54,7 @@ int Stream::timedRead()
   do {
     c = read();
     if (c >= 0) return c;
-    yield();
-  } while(millis() - startMillis < _timeout);
+  } while(waitForData(startMillis));
   return -1;     // -1 indicates timeout
 }
 
@@ -46,8 +66,7 @@ int Stream::timedPeek()
   do {
     c = peek();
     if (c >= 0) return c;
-    yield();
-  } while(millis() - startMillis < _timeout);
+  } while(waitForData(startMillis));
   return -1;     // -1 indicates timeout
 }
 
@@ -92,39 +111,307 @@ bool  Stream::findUntil(const char *target, const char *terminator)
   return findUntil(target, strlen(target), terminator, tlen);
 }
 
+// read for find, without the timeout overhead while data is already buffered
+int Stream::findRead(int &avail)
+{
+	if (avail > 0 || (avail = available()) > 0) {
+		avail--;
+		int c = read();
+		if (c >= 0) return c;
+		avail = 0;
+	}
+	return timedRead();
+}
+
+namespace {
+
+#define FIND_TABLE_SIZE 64
+
+// Knuth-Morris-Pratt matcher, so a mismatch never needs to re-read input.
+// Patterns longer than FIND_TABLE_SIZE compute the rest of their fallbacks
+// when needed rather than using more stack.
+class find_matcher {
+public:
+	find_matcher(const char *pattern, size_t length) : pat(pattern), len(length), index(0) {
+		size_t n = (len < FIND_TABLE_SIZE) ? len : FIND_TABLE_SIZE;
+		size_t k = 0;
+		if (n > 0) fail[0] = 0;
+		for (size_t i = 1; i < n; i++) {
+			while (k > 0 && pat[i] != pat[k]) k = fail[k - 1];
+			if (pat[i] == pat[k]) k++;
+			fail[i] = k;
+		}
+	}
+	// returns true when the whole pattern has been matched
+	bool match(char c) {
+		while (index > 0 && c != pat[index]) index = border(index);
+		if (c == pat[index]) index++;
+		return index >= len;
+	}
+private:
+	// length of the longest proper prefix of pat[0..i) which is also its suffix
+	size_t border(size_t i) {
+		if (i <= FIND_TABLE_SIZE) return fail[i - 1];
+		for (size_t k = i - 1; k > 0; k--) {
+			if (memcmp(pat, pat + i - k, k) == 0) return k;
+		}
+		return 0;
+	}
+	const char *pat;
+	size_t len;
+	size_t index;
+	uint8_t fail[FIND_TABLE_SIZE];
+};
+
+} // anonymous namespace
+
 // reads data from the stream until the target string of the given length is found
 // search terminated if the terminator string is found
 // returns true if target string is found, false if terminated or timed out
 bool Stream::findUntil(const char *target, size_t targetLen, const char *terminator, size_t termLen)
 {
-  size_t index = 0;  // maximum target string length is 64k bytes!
-  size_t termIndex = 0;
-  int c;
+	if (target == nullptr || targetLen == 0) return true;
+	if (terminator == nullptr) termLen = 0;
+	find_matcher t(target, targetLen);
+	find_matcher term(terminator, termLen);
+	int avail = 0;
+	int c;
 
-  if( target == nullptr) return true;
-  if( *target == 0) return true;   // return true if target is a null string
-  if (terminator == nullptr) termLen = 0;
+	while ((c = findRead(avail)) > 0) {
+		if (t.match(c)) return true;
+		// return false if terminate string found before target string
+		if (termLen > 0 && term.match(c)) return false;
+	}
+	return false;
+}
 
-  while( (c = timedRead()) > 0){
-    if( c == target[index]){
-    //////Serial.print("found "); Serial.write(c); Serial.print("index now"); Serial.println(index+1);
-      if(++index >= targetLen){ // return true if all chars in the target match
-        return true;
-      }
-    }
-    else{
-      index = 0;  // reset index if any char does not match
-    }
-    if(termLen > 0 && c == terminator[termIndex]){
-       if(++termIndex >= termLen)
-         return false;       // return false if terminate string found before target string
-    }
-    else
-        termIndex = 0;
-  }
-  return false;
+// reads data from the stream until any of the targets is found, using an
+// Aho-Corasick automaton so all of them are matched in a single pass.
+// returns the index of the target found, or -1 if timed out.  The targets
+// may add up to FIND_ANY_MAX_LENGTH characters.
+int Stream::findAny(const char * const *targets, size_t count)
+{
+	const int maxnodes = FIND_ANY_MAX_LENGTH + 1;
+	uint8_t ch[maxnodes], child[maxnodes], sibling[maxnodes], fail[maxnodes], found[maxnodes];
+	int nodes = 1;
+
+	// node 0 is the root, a child or sibling of 0 means none
+	ch[0] = child[0] = sibling[0] = fail[0] = found[0] = 0;
+	auto next = [&](int node, char c) -> int {
+		for (int n = child[node]; n; n = sibling[n]) {
+			if (ch[n] == (uint8_t)c) return n;
+		}
+		return 0;
+	};
+	if (targets == nullptr || count == 0 || count > 255) return -1;
+	for (size_t i = 0; i < count; i++) {
+		const char *p = targets[i];
+		if (p == nullptr || *p == 0) return i;
+		int node = 0;
+		for (; *p; p++) {
+			int n = next(node, *p);
+			if (n == 0) {
+				if (nodes >= maxnodes) return -1;
+				n = nodes++;
+				ch[n] = *p;
+				child[n] = found[n] = 0;
+				sibling[n] = child[node];
+				child[node] = n;
+			}
+			node = n;
+		}
+		if (found[node] == 0) found[node] = i + 1;
+	}
+	// breadth first, so each fallback is complete before it is used
+	uint8_t queue[maxnodes];
+	int head = 0, tail = 0;
+	for (int n = child[0]; n; n = sibling[n]) {
+		fail[n] = 0;
+		queue[tail++] = n;
+	}
+	while (head < tail) {
+		int node = queue[head++];
+		for (int n = child[node]; n; n = sibling[n]) {
+			int f = fail[node];
+			while (f && !next(f, ch[n])) f = fail[f];
+			fail[n] = next(f, ch[n]);
+			// a shorter target ending here counts as found too
+			if (found[n] == 0) found[n] = found[fail[n]];
+			queue[tail++] = n;
+		}
+	}
+
+	int node = 0;
+	int avail = 0;
+	int c;
+	while ((c = findRead(avail)) > 0) {
+		while (node && !next(node, c)) node = fail[node];
+		node = next(node, c);
+		if (found[node]) return found[node] - 1;
+	}
+	return -1;
+}
+
+namespace {
+
+// decimal digits gathered while parsing a number, as m * 10^e10
+struct decimal_digits {
+	uint64_t m = 0;
+	int e10 = 0;
+	uint8_t count = 0;
+	bool truncated = false;
+	void add(int digit, bool fraction) {
+		if (count < 19) {
+			m = m * 10 + digit;
+			if (m) count++;
+			if (fraction) e10--;
+		} else {
+			if (!fraction) e10++;
+			if (digit) truncated = true;
+		}
+	}
+};
+
+// m * 10^e10 rounded correctly, exact arithmetic when both fit in the
+// significand, otherwise strtof / strtod do the rounding
+char * decimal_text(char *end, uint64_t m, int e10)
+{
+	*--end = 0;
+	char *p = ultoa_end((e10 < 0) ? -e10 : e10, end, 10);
+	if (e10 < 0) *--p = '-';
+	*--p = 'e';
+	return ulltoa_end(m, p, 10);
 }
 
+float decimal_to_float(uint64_t m, int e10)
+{
+	static const float pow10[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+	if (m == 0) return 0.0f;
+	if (m <= (1ul << 24) && e10 >= -10 && e10 <= 10) {
+		return (e10 < 0) ? (float)m / pow10[-e10] : (float)m * pow10[e10];
+	}
+	char buf[40];
+	return strtof(decimal_text(buf + sizeof(buf), m, e10), nullptr);
+}
+
+double decimal_to_double(uint64_t m, int e10)
+{
+	static const double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+	if (m == 0) return 0.0;
+	if (m <= (1ull << 53) && e10 >= -22 && e10 <= 22) {
+		return (e10 < 0) ? (double)m / pow10[-e10] : (double)m * pow10[e10];
+	}
+	char buf[40];
+	return strtod(decimal_text(buf + sizeof(buf), m, e10), nullptr);
+}
+
+bool is_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+// parse a whole token as [-+]digits[.digits][e[-+]digits], other forms
+// (inf, nan, hex) and numbers of more than 19 digits go to strtod
+int parse_token_float(const char *s, double *value, bool single)
+{
+	const char *p = s;
+	bool negative = false;
+	bool any = false, fraction = false;
+	decimal_digits d;
+
+	while (is_space(*p)) p++;
+	if (*p == '-' || *p == '+') negative = (*p++ == '-');
+	for (;; p++) {
+		if (*p >= '0' && *p <= '9') {
+			d.add(*p - '0', fraction);
+			any = true;
+		} else if (*p == '.' && !fraction) {
+			fraction = true;
+		} else {
+			break;
+		}
+	}
+	if (any && (*p == 'e' || *p == 'E')) {
+		p++;
+		bool eneg = false;
+		if (*p == '-' || *p == '+') eneg = (*p++ == '-');
+		if (*p < '0' || *p > '9') any = false;
+		int e = 0;
+		for (; *p >= '0' && *p <= '9'; p++) {
+			if (e < 10000) e = e * 10 + *p - '0';
+		}
+		d.e10 += eneg ? -e : e;
+	}
+	while (is_space(*p)) p++;
+	if (!any || *p || d.truncated) {
+		char *end;
+		errno = 0;
+		*value = single ? strtof(s, &end) : strtod(s, &end);
+		while (is_space(*end)) end++;
+		if (end == s || *end) return PARSE_INVALID;
+		return (errno == ERANGE) ? PARSE_RANGE : PARSE_OK;
+	}
+	double v = single ? decimal_to_float(d.m, d.e10) : decimal_to_double(d.m, d.e10);
+	*value = negative ? -v : v;
+	return isinf(v) ? PARSE_RANGE : PARSE_OK;
+}
+
+// parse a whole token as a decimal integer, clamping if out of range
+int parse_token_long(const char *s, long *value, long min, long max)
+{
+	const char *p = s;
+	bool negative = false;
+	unsigned long n = 0, limit;
+	int err = PARSE_OK;
+
+	while (is_space(*p)) p++;
+	if (*p == '-' || *p == '+') negative = (*p++ == '-');
+	limit = negative ? 0 - (unsigned long)min : (unsigned long)max;
+	if (*p < '0' || *p > '9') return PARSE_INVALID;
+	for (; *p >= '0' && *p <= '9'; p++) {
+		unsigned int digit = *p - '0';
+		if (n > (limit - digit) / 10) {
+			n = limit;
+			err = PARSE_RANGE;
+		} else {
+			n = n * 10 + digit;
+		}
+	}
+	while (is_space(*p)) p++;
+	if (*p) return PARSE_INVALID;
+	*value = negative ? (long)(0 - n) : (long)n;
+	return err;
+}
+
+int store_long(const char *token, void *values, size_t index)
+{
+	return parse_token_long(token, (long *)values + index, LONG_MIN, LONG_MAX);
+}
+
+int store_int(const char *token, void *values, size_t index)
+{
+	long n = 0;
+	int err = parse_token_long(token, &n, INT_MIN, INT_MAX);
+	((int *)values)[index] = n;
+	return err;
+}
+
+int store_float(const char *token, void *values, size_t index)
+{
+	double n = 0;
+	int err = parse_token_float(token, &n, true);
+	((float *)values)[index] = n;
+	return err;
+}
+
+int store_double(const char *token, void *values, size_t index)
+{
+	return parse_token_float(token, (double *)values + index, false);
+}
+
+} // anonymous namespace
+
 // returns the first valid (long) integer value from the current position.
 // lookahead determines how parseInt looks ahead in the stream.
 // See LookaheadMode enumeration at the top of the file.
@@ -163,9 +450,8 @@ float Stream::parseFloat(LookaheadMode lookahead, char ignore)
 {
   bool isNegative = false;
   bool isFraction = false;
-  long value = 0;
+  decimal_digits digits;
   int c;
-  float fraction = 1.0f;
 
   c = peekNextDigit(lookahead, true);
     // ignore non numeric leading characters
@@ -180,21 +466,122 @@ float Stream::parseFloat(LookaheadMode lookahead, char ignore)
     else if (c == '.')
       isFraction = true;
     else if(c >= '0' && c <= '9')  {      // is c a digit?
-      value = value * 10 + c - '0';
-      if(isFraction)
-         fraction *= 0.1;
+      digits.add(c - '0', isFraction);
     }
     read();  // consume the character we got with peek
     c = timedPeek();
   }
   while( (c >= '0' && c <= '9')  || (c == '.' && !isFraction) || c == ignore );
 
-  if(isNegative)
+  // scaled once at the end, rather than by 0.1 per digit, so it rounds correctly
+  float value = decimal_to_float(digits.m, digits.e10);
+  if(isNegative && value != 0)
     value = -value;
-  if(isFraction)
-    return value * fraction;
-  else
-    return value;
+  return value;
+}
+
+// parses a line of numbers, any of the separators between them, until the
+// terminator.  Each number is given to store() as a null terminated token.
+// Reading continues to the end of the line after errors, so the next call
+// starts on the following line.
+int Stream::parseTokens(void *values, size_t count, const char *separators, char terminator,
+	int (*store)(const char *token, void *values, size_t index))
+{
+	uint8_t buf[64];
+	char token[PARSE_TOKEN_SIZE];
+	size_t len = 0, stored = 0;
+	bool done = false, stop = false;
+	int err = PARSE_OK;
+
+	if (separators == nullptr) separators = "";
+	unsigned long startMillis = millis();
+	while (!done) {
+		int n = readUntil(terminator, buf, sizeof(buf));
+		if (n <= 0) {
+			if (waitForData(startMillis)) continue;
+			err = err ? err : PARSE_TIMEOUT;
+			done = true; // the last number may still be waiting in token
+		} else {
+			startMillis = millis();
+		}
+		for (int i = 0; i <= n; i++) {
+			char c = 0;
+			if (i < n) {
+				c = buf[i];
+				if (c == terminator) {
+					done = true;
+				} else if (c == 0 || !strchr(separators, c)) {
+					if (len < sizeof(token)) token[len++] = c;
+					continue;
+				}
+			} else if (!done) {
+				break;
+			}
+			// end of a number
+			if (len > 0 && !stop) {
+				int e = PARSE_INVALID;
+				if (stored >= count) {
+					e = PARSE_TOO_MANY;
+				} else if (len < sizeof(token)) {
+					token[len] = 0;
+					e = store(token, values, stored);
+				}
+				if (e == PARSE_OK || e == PARSE_RANGE) stored++;
+				if (e != PARSE_OK && err == PARSE_OK) err = e;
+				if (e != PARSE_OK && e != PARSE_RANGE) stop = true;
+			}
+			len = 0;
+			if (done) break;
+		}
+	}
+	if (err) setReadError(err);
+	return stored;
+}
+
+int Stream::parseArray(long *values, size_t count, const char *separators, char terminator)
+{
+	return parseTokens(values, count, separators, terminator, store_long);
+}
+
+int Stream::parseArray(int *values, size_t count, const char *separators, char terminator)
+{
+	return parseTokens(values, count, separators, terminator, store_int);
+}
+
+int Stream::parseArray(float *values, size_t count, const char *separators, char terminator)
+{
+	return parseTokens(values, count, separators, terminator, store_float);
+}
+
+int Stream::parseArray(double *values, size_t count, const char *separators, char terminator)
+{
+	return parseTokens(values, count, separators, terminator, store_double);
+}
+
+// default read of already received bytes, for streams without their own
+int Stream::read(uint8_t *buffer, size_t length)
+{
+	size_t count = 0;
+	int avail = available();
+	while (count < length && avail-- > 0) {
+		int c = read();
+		if (c < 0) break;
+		buffer[count++] = c;
+	}
+	return count;
+}
+
+int Stream::readUntil(char terminator, uint8_t *buffer, size_t length)
+{
+	size_t count = 0;
+	int avail = available();
+	while (count < length && avail-- > 0) {
+		int c = read();
+		if (c < 0) break;
+		buffer[count++] = c;
+		if (c == (uint8_t)terminator) break;
+	}
+	return count;
 }
 
 // read characters from stream into buffer
@@ -206,14 +593,16 @@ size_t Stream::readBytes(char *buffer, size_t length)
 {
 	if (buffer == nullptr) return 0;
 	size_t count = 0;
+	unsigned long startMillis = millis();
 	while (count < length) {
-		int c = timedRead();
-		if (c < 0) {
+		int n = read((uint8_t *)buffer + count, length - count);
+		if (n > 0) {
+			count += n;
+			startMillis = millis();
+		} else if (!waitForData(startMillis)) {
 			setReadError();
 			break;
 		}
-		*buffer++ = (char)c;
-		count++;
 	}
 	return count;
 }
@@ -229,17 +618,22 @@ size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length)
 	if (length < 1) return 0;
 	length--;
 	size_t index = 0;
+	unsigned long startMillis = millis();
 	while (index < length) {
-		int c = timedRead();
-		if (c == terminator) break;
-		if (c < 0) {
+		int n = readUntil(terminator, (uint8_t *)buffer + index, length - index);
+		if (n > 0) {
+			index += n;
+			if (buffer[index - 1] == terminator) {
+				index--;
+				break;
+			}
+			startMillis = millis();
+		} else if (!waitForData(startMillis)) {
 			setReadError();
 			break;
 		}
-		*buffer++ = (char)c;
-		index++;
 	}
-	*buffer = 0;
+	buffer[index] = 0;
 	return index; // return number of characters, not including null terminator
 }
 
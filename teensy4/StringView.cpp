@@ -0,0 +1,212 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "WString.h"
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+
+#define STRINGVIEW_NUMBER_SIZE 40
+
+int StringView::indexOf(char ch, unsigned int fromIndex) const
+{
+	if (fromIndex >= len) return -1;
+	const char *p = (const char *)memchr(ptr + fromIndex, ch, len - fromIndex);
+	if (p == NULL) return -1;
+	return p - ptr;
+}
+
+int StringView::indexOf(const StringView &str, unsigned int fromIndex) const
+{
+	if (fromIndex > len || str.len > len - fromIndex) return -1;
+	if (str.len == 0) return fromIndex;
+	const char *p = ptr + fromIndex;
+	const char *last = ptr + len - str.len;
+	while (p <= last) {
+		p = (const char *)memchr(p, str.ptr[0], last - p + 1);
+		if (p == NULL) return -1;
+		if (memcmp(p, str.ptr, str.len) == 0) return p - ptr;
+		p++;
+	}
+	return -1;
+}
+
+int StringView::lastIndexOf(char ch) const
+{
+	for (size_t i = len; i > 0; i--) {
+		if (ptr[i - 1] == ch) return i - 1;
+	}
+	return -1;
+}
+
+int StringView::lastIndexOf(const StringView &str) const
+{
+	if (str.len > len) return -1;
+	for (size_t i = len - str.len + 1; i > 0; i--) {
+		if (memcmp(ptr + i - 1, str.ptr, str.len) == 0) return i - 1;
+	}
+	return -1;
+}
+
+StringView StringView::substring(unsigned int left, unsigned int right) const
+{
+	if (left > right) {
+		unsigned int temp = right;
+		right = left;
+		left = temp;
+	}
+	if (left > len) return StringView(ptr + len, 0);
+	if (right > len) right = len;
+	return StringView(ptr + left, right - left);
+}
+
+StringView StringView::trim() const
+{
+	const char *begin = ptr;
+	const char *end = ptr + len;
+	while (begin < end && isspace(*begin)) begin++;
+	while (end > begin && isspace(*(end - 1))) end--;
+	return StringView(begin, end - begin);
+}
+
+StringView StringView::split(char separator)
+{
+	int index = indexOf(separator);
+	if (index < 0) {
+		StringView field = *this;
+		ptr += len;
+		len = 0;
+		return field;
+	}
+	StringView field(ptr, index);
+	ptr += index + 1;
+	len -= index + 1;
+	return field;
+}
+
+static bool is_separator(char c, const char *separators)
+{
+	return c != 0 && strchr(separators, c) != NULL;
+}
+
+StringView StringView::token(const char *separators)
+{
+	const char *end = ptr + len;
+	const char *begin = ptr;
+	while (begin < end && is_separator(*begin, separators)) begin++;
+	const char *p = begin;
+	while (p < end && !is_separator(*p, separators)) p++;
+	ptr = p;
+	len = end - p;
+	return StringView(begin, p - begin);
+}
+
+int StringView::compareTo(const StringView &str) const
+{
+	size_t n = (len < str.len) ? len : str.len;
+	int cmp = memcmp(ptr, str.ptr, n);
+	if (cmp != 0) return cmp;
+	if (len < str.len) return 0 - (unsigned char)str.ptr[n];
+	if (len > str.len) return (unsigned char)ptr[n];
+	return 0;
+}
+
+bool StringView::equalsIgnoreCase(const StringView &str) const
+{
+	if (len != str.len) return false;
+	for (size_t i = 0; i < len; i++) {
+		if (tolower(ptr[i]) != tolower(str.ptr[i])) return false;
+	}
+	return true;
+}
+
+long StringView::toInt() const
+{
+	StringView s = trim();
+	const char *p = s.ptr;
+	const char *end = s.ptr + s.len;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+	unsigned long value = 0;
+	while (p < end && *p >= '0' && *p <= '9') {
+		value = value * 10 + (*p++ - '0');
+	}
+	return negative ? -(long)value : (long)value;
+}
+
+double StringView::toDouble() const
+{
+	char buf[STRINGVIEW_NUMBER_SIZE];
+	StringView s = trim();
+	size_t n = (s.len < sizeof(buf) - 1) ? s.len : sizeof(buf) - 1;
+	memcpy(buf, s.ptr, n);
+	buf[n] = 0;
+	return strtod(buf, NULL);
+}
+
+// copy the whole view to a null terminated buffer, for strtol & strtod
+static bool number_text(const StringView &s, char *buf, size_t size)
+{
+	if (s.length() == 0 || s.length() >= size || isspace(s[0])) return false;
+	memcpy(buf, s.data(), s.length());
+	buf[s.length()] = 0;
+	errno = 0;
+	return true;
+}
+
+bool StringView::toInt(long &value, int base) const
+{
+	char buf[STRINGVIEW_NUMBER_SIZE], *end;
+	if (!number_text(*this, buf, sizeof(buf))) return false;
+	long n = strtol(buf, &end, base);
+	if (end != buf + len || errno == ERANGE) return false;
+	value = n;
+	return true;
+}
+
+bool StringView::toDouble(double &value) const
+{
+	char buf[STRINGVIEW_NUMBER_SIZE], *end;
+	if (!number_text(*this, buf, sizeof(buf))) return false;
+	double n = strtod(buf, &end);
+	if (end != buf + len || errno == ERANGE) return false;
+	value = n;
+	return true;
+}
+
+bool StringView::toFloat(float &value) const
+{
+	char buf[STRINGVIEW_NUMBER_SIZE], *end;
+	if (!number_text(*this, buf, sizeof(buf))) return false;
+	float n = strtof(buf, &end);
+	if (end != buf + len || errno == ERANGE) return false;
+	value = n;
+	return true;
+}
@@ -66,8 +66,14 @@
 #include "WCharacter.h"
 #include "WString.h"
 #include "elapsedMillis.h"
+#include "BufferedPrint.h"
+#include "BinaryStream.h"
+#include "StringBuilder.h"
 #include "IntervalTimer.h"
+#include "MicrosTimer.h"
 #include "CrashReport.h"
+#include "block_pool.h"
+#include "heap_profile.h"
 
 uint16_t makeWord(uint16_t w);
 uint16_t makeWord(byte h, byte l);
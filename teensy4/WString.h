@@ -27,6 +27,7 @@
 #include <string.h>
 #include <ctype.h>
 #include "avr_functions.h"
+#include "StringView.h"
 
 // Not needed here, but some libs assume WString.h or Print.h
 // gives them PROGMEM and other AVR stuff.
@@ -38,6 +39,12 @@
 //     -felide-constructors
 //     -std=c++0x
 
+// Strings shorter than STRING_SSO_SIZE are stored inside the String object,
+// in the space the heap pointer and capacity take for longer ones
+#ifndef STRING_SSO_SIZE
+#define STRING_SSO_SIZE (sizeof(char *) + sizeof(unsigned int))
+#endif
+
 // Brian Cook's "no overhead" Flash String type (message on Dec 14, 2010)
 // modified by Mikal Hart for his FlashString library
 class __FlashStringHelper;
@@ -56,6 +63,7 @@ public:
 	// constructors
 	String(const char *cstr = (const char *)NULL);
 	String(const __FlashStringHelper *pgmstr);
+	explicit String(const StringView &str);
 	String(const String &str);
 	#if __cplusplus >= 201103L || defined(__GXX_EXPERIMENTAL_CXX0X__)
 	String(String &&rval);
@@ -75,6 +83,7 @@ public:
 
 	// memory management
 	unsigned char reserve(unsigned int size);
+	void shrink_to_fit(void);
 	inline unsigned int length(void) const {return len;}
 
 	// copy and move
@@ -89,11 +98,13 @@ public:
 	String & operator = (StringSumHelper &&rval);
 	#endif
 	String & operator = (char c);
+	String & operator = (const StringView &str)	{return copy(str.data(), str.length());}
 
 	// append
 	String & append(const String &str);
 	String & append(const char *cstr);
 	String & append(const __FlashStringHelper *s)	{return append((const char *)s, strlen((const char *)s)); }
+	String & append(const StringView &str)		{return append(str.data(), str.length());}
 	String & append(char c);
 	String & append(unsigned char c)		{return append((int)c);}
 	String & append(int num);
@@ -107,6 +118,7 @@ public:
 	String & operator += (const String &rhs)	{return append(rhs);}
 	String & operator += (const char *cstr)		{return append(cstr);}
 	String & operator += (const __FlashStringHelper *pgmstr) {return append(pgmstr);}
+	String & operator += (const StringView &str)	{return append(str);}
 	String & operator += (char c)			{return append(c);}
 	String & operator += (unsigned char c)		{return append((int)c);}
 	String & operator += (int num)			{return append(num);}
@@ -122,6 +134,7 @@ public:
 	friend StringSumHelper & operator + (const StringSumHelper &lhs, const String &rhs);
 	friend StringSumHelper & operator + (const StringSumHelper &lhs, const char *cstr);
 	friend StringSumHelper & operator + (const StringSumHelper &lhs, const __FlashStringHelper *pgmstr);
+	friend StringSumHelper & operator + (const StringSumHelper &lhs, const StringView &str);
 	friend StringSumHelper & operator + (const StringSumHelper &lhs, char c);
 	friend StringSumHelper & operator + (const StringSumHelper &lhs, unsigned char c);
 	friend StringSumHelper & operator + (const StringSumHelper &lhs, int num);
@@ -135,6 +148,7 @@ public:
 	String & concat(const String &str)		{return append(str);}
 	String & concat(const char *cstr)		{return append(cstr);}
 	String & concat(const __FlashStringHelper *pgmstr) {return append(pgmstr);}
+	String & concat(const StringView &str)		{return append(str);}
 	String & concat(char c)				{return append(c);}
 	String & concat(unsigned char c)		{return append((int)c);}
 	String & concat(int num)			{return append(num);}
@@ -173,12 +187,12 @@ public:
 	void toCharArray(char *buf, unsigned int bufsize, unsigned int index=0) const
 		{getBytes((unsigned char *)buf, bufsize, index);}
 	const char * c_str() const {
-		if (!buffer) return &zerotermination; // https://forum.pjrc.com/threads/63842
-		return buffer;
+		if (!buffer()) return &zerotermination; // https://forum.pjrc.com/threads/63842
+		return buffer();
 	}
 	char * begin() {
-		if (!buffer) reserve(20);
-		return buffer;
+		if (!buffer()) reserve(20);
+		return buffer();
 	}
 	char * end() { return begin() + length(); }
 	const char * begin() const { return c_str(); }
@@ -195,6 +209,11 @@ public:
 	int lastIndexOf( const String &str, unsigned int fromIndex ) const;
 	String substring( unsigned int beginIndex ) const;
 	String substring( unsigned int beginIndex, unsigned int endIndex ) const;
+	// a StringView is valid only until this String is changed
+	StringView view() const { return StringView(c_str(), len); }
+	StringView view( unsigned int beginIndex ) const { return view().substring(beginIndex); }
+	StringView view( unsigned int beginIndex, unsigned int endIndex ) const
+		{ return view().substring(beginIndex, endIndex); }
 
 	// modification
 	String & replace(char find, char replace);
@@ -210,14 +229,30 @@ public:
 	float toFloat(void) const;
 
 protected:
-	char *buffer;	        // the actual char array
-	unsigned int capacity;  // the array length minus one (for the '\0')
-	unsigned int len;       // the String length (not counting the '\0')
-	//unsigned char flags;    // unused, for future features
+	// the actual char array, NULL if the String never held data
+	char *buffer(void) const { return isInline ? (char *)sso : heap.buffer; }
+	// the array length minus one (for the '\0')
+	unsigned int capacity(void) const { return isInline ? sizeof(sso) - 1 : heap.capacity; }
+	union {
+		struct {
+			char *buffer;
+			unsigned int capacity;
+		} heap;
+		char sso[STRING_SSO_SIZE]; // inline storage for short strings
+	};
+	unsigned int len : 31;       // the String length (not counting the '\0')
+	unsigned int isInline : 1;   // the chars are in sso[], not on the heap
 protected:
 	void init(void);
 	unsigned char changeBuffer(unsigned int maxStrLen);
+	unsigned char grow(unsigned int size);
 	String & append(const char *cstr, unsigned int length);
+	void appendFloat(float num, int digits);
+	static void appendFloatWrite(void *arg, const char *s, size_t len);
+	#ifdef STRING_DEBUG
+public:
+	static unsigned int reallocCount;  // number of calls to realloc()
+	#endif
 private:
 	// allow for "if (s)" without the complications of an operator bool().
 	// for more information http://www.artima.com/cppsource/safebool.html
@@ -225,7 +260,7 @@ private:
 	void StringIfHelper() const {}
 	static const char zerotermination;
 public:
-	operator StringIfHelperType() const { return buffer ? &String::StringIfHelper : 0; }
+	operator StringIfHelperType() const { return buffer() ? &String::StringIfHelper : 0; }
 };
 
 class StringSumHelper : public String
@@ -244,5 +279,7 @@ public:
 	StringSumHelper(unsigned long long num) : String(num, 10) {}
 };
 
+inline StringView::StringView(const String &str) : ptr(str.c_str()), len(str.length()) {}
+
 #endif  // __cplusplus
 #endif  // String_class_h
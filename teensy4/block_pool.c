@@ -0,0 +1,114 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "block_pool.h"
+#include <string.h>
+#include "arm_math.h"	// __LDREXW, __STREXW, __CLREX
+
+void block_pool_init(block_pool_t *pool, void *memory, uint32_t size, uint32_t count, uint32_t *in_use)
+{
+	uintptr_t addr = ((uintptr_t)memory + BLOCK_POOL_ALIGN - 1) & ~(uintptr_t)(BLOCK_POOL_ALIGN - 1);
+
+	memset(in_use, 0, BLOCK_POOL_MASKS(count) * sizeof(uint32_t));
+	pool->memory = (uint8_t *)addr;
+	pool->block_size = BLOCK_POOL_BLOCK_SIZE(size);
+	pool->count = count;
+	pool->in_use = in_use;
+	pool->used = 0;
+	pool->peak = 0;
+	pool->allocs = 0;
+	pool->failures = 0;
+}
+
+static inline void block_pool_add(volatile uint32_t *n, int32_t amount)
+{
+	do {
+		uint32_t val = __LDREXW(n);
+		if (__STREXW(val + amount, n) == 0) break;
+	} while (1);
+}
+
+// Any interrupt between LDREX and STREX makes STREX fail, so each bitmap
+// word is updated atomically without disabling interrupts.
+void * block_pool_alloc(block_pool_t *pool)
+{
+	uint32_t words = BLOCK_POOL_MASKS(pool->count);
+	uint32_t i, index, mask, unused, used, peak;
+
+	for (i=0; i < words; i++) {
+		volatile uint32_t *p = pool->in_use + i;
+		// bits past the last block are never allocated
+		unused = (i == words - 1 && (pool->count & 31)) ? 0xFFFFFFFF >> (pool->count & 31) : 0;
+		do {
+			mask = __LDREXW(p);
+			if ((mask | unused) == 0xFFFFFFFF) {
+				__CLREX();
+				break;
+			}
+			index = __builtin_clz(~(mask | unused));
+		} while (__STREXW(mask | (0x80000000 >> index), p));
+		if ((mask | unused) == 0xFFFFFFFF) continue;
+		block_pool_add(&pool->allocs, 1);
+		do {
+			used = __LDREXW(&pool->used) + 1;
+		} while (__STREXW(used, &pool->used));
+		do {
+			peak = __LDREXW(&pool->peak);
+			if (used <= peak) {
+				__CLREX();
+				break;
+			}
+		} while (__STREXW(used, &pool->peak));
+		return pool->memory + (i * 32 + index) * pool->block_size;
+	}
+	block_pool_add(&pool->failures, 1);
+	return NULL;
+}
+
+void block_pool_free(block_pool_t *pool, void *block)
+{
+	uint32_t offset, index, bit, mask;
+	volatile uint32_t *p;
+
+	if ((uint8_t *)block < pool->memory) return;
+	offset = (uint8_t *)block - pool->memory;
+	index = offset / pool->block_size;
+	if (index >= pool->count || offset % pool->block_size) return;
+	p = pool->in_use + (index >> 5);
+	bit = 0x80000000 >> (index & 31);
+	do {
+		mask = __LDREXW(p);
+		if (!(mask & bit)) {
+			__CLREX();	// already free
+			return;
+		}
+	} while (__STREXW(mask & ~bit, p));
+	block_pool_add(&pool->used, -1);
+}
@@ -0,0 +1,98 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef block_pool_h_
+#define block_pool_h_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Fixed size block pools, safe to use from interrupts.  Unlike malloc()
+// and extmem_malloc(), block_pool_alloc() and block_pool_free() never
+// disable interrupts or wait, so DMA and USB callbacks can get buffers on
+// demand.  Each pool has a bitmap of which blocks are in use, updated
+// with LDREX & STREX, the same bitmap technique as AudioStream::allocate.
+//
+// BLOCK_POOL() creates a pool, ready to use, in any memory region.  The
+// blocks are aligned to 32 byte cache rows, so arm_dcache_delete() or
+// arm_dcache_flush() on one block never touches another.
+//
+//   BLOCK_POOL(rxpool, 512, 24, DMAMEM);	// 24 blocks of 512 bytes
+//
+//   void dma_isr() {
+//     uint8_t *buf = (uint8_t *)block_pool_alloc(&rxpool);
+//     if (buf) ...	// NULL if all 24 are in use
+//   }
+//   block_pool_free(&rxpool, buf);
+//
+// Pools may also be created at runtime, for example in memory from
+// extmem_malloc(), with block_pool_init().
+
+#define BLOCK_POOL_ALIGN 32
+#define BLOCK_POOL_BLOCK_SIZE(size) (((size) + BLOCK_POOL_ALIGN - 1) & ~(BLOCK_POOL_ALIGN - 1))
+#define BLOCK_POOL_MASKS(count) (((count) + 31) / 32)
+
+typedef struct {
+	uint8_t *memory;		// first block
+	uint32_t block_size;		// bytes per block
+	uint32_t count;			// number of blocks
+	volatile uint32_t *in_use;	// 1 bit per block, MSB first
+	volatile uint32_t used;		// blocks allocated now
+	volatile uint32_t peak;		// most blocks ever allocated at once
+	volatile uint32_t allocs;	// successful block_pool_alloc() calls
+	volatile uint32_t failures;	// block_pool_alloc() calls which returned NULL
+} block_pool_t;
+
+#define BLOCK_POOL(name, size, count, region) \
+	static region uint8_t name##_memory[BLOCK_POOL_BLOCK_SIZE(size) * (count)] \
+		__attribute__ ((aligned(BLOCK_POOL_ALIGN))); \
+	static uint32_t name##_in_use[BLOCK_POOL_MASKS(count)]; \
+	block_pool_t name = { name##_memory, BLOCK_POOL_BLOCK_SIZE(size), (count), \
+		name##_in_use, 0, 0, 0, 0 }
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Create a pool of "count" blocks in "memory", which must hold at least
+// count * BLOCK_POOL_BLOCK_SIZE(size) bytes, plus up to 31 more if it
+// isn't 32 byte aligned.  "in_use" must have BLOCK_POOL_MASKS(count) words.
+void block_pool_init(block_pool_t *pool, void *memory, uint32_t size, uint32_t count, uint32_t *in_use);
+void * block_pool_alloc(block_pool_t *pool);
+void block_pool_free(block_pool_t *pool, void *block);
+static inline uint32_t block_pool_available(const block_pool_t *pool) {
+	return pool->count - pool->used;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -2422,6 +2422,18 @@ extern uint8_t yield_active_check_flags;
 #define YIELD_CHECK_USB_SERIALUSB1  0x08  // Check for SerialUSB1
 #define YIELD_CHECK_USB_SERIALUSB2  0x10  // Check for SerialUSB2
 
+// Trigger an EventResponder from C code, eg a driver signalling received data
+void event_responder_trigger(void *event);
+
+// Counters to measure the overhead of yield().  Cycles are only counted
+// when yield() has something to check.
+struct yield_statistics_struct {
+	uint32_t calls;          // number of times yield() was called
+	uint32_t serial_events;  // serialEvent functions run for hardware serial
+	uint32_t cycles;         // total ARM_DWT_CYCCNT cycles spent in yield()
+};
+extern struct yield_statistics_struct yield_statistics;
+
 // Allow other functions to run.  Typically these will be serial event handlers
 // and functions call by certain libraries when lengthy operations complete.
 void yield(void);
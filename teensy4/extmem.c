@@ -2,7 +2,7 @@
 // but automatically fall back to internal RAM if external RAM can't be used.
 
 #include <stdlib.h>
-#include "smalloc.h"
+#include "smalloc_i.h"	// SM_TAG_CALLER
 #include "wiring.h"
 
 #if defined(ARDUINO_TEENSY41)
@@ -16,6 +16,7 @@ void *extmem_malloc(size_t size)
 {
 #ifdef HAS_EXTRAM
 	void *ptr = sm_malloc_pool(&extmem_smalloc_pool, size);
+	SM_TAG_CALLER(ptr);
 	if (ptr) return ptr;
 #endif
 	return malloc(size);
@@ -37,6 +38,7 @@ void *extmem_calloc(size_t nmemb, size_t size)
 #ifdef HAS_EXTRAM
 	// Note: It is assumed that the pool was created with do_zero set to true
 	void *ptr = sm_malloc_pool(&extmem_smalloc_pool, nmemb*size);
+	SM_TAG_CALLER(ptr);
 	if (ptr) return ptr;
 #endif
 	return calloc(nmemb, size);
@@ -46,7 +48,9 @@ void *extmem_realloc(void *ptr, size_t size)
 {
 #ifdef HAS_EXTRAM
 	if (IS_EXTMEM(ptr) || ptr == NULL) {
-		return sm_realloc_pool(&extmem_smalloc_pool, ptr, size);
+		ptr = sm_realloc_pool(&extmem_smalloc_pool, ptr, size);
+		SM_TAG_CALLER(ptr);
+		return ptr;
 	}
 #endif
 	return realloc(ptr, size);
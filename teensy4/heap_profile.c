@@ -0,0 +1,90 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "heap_profile.h"
+#include <string.h>
+#include <reent.h>
+
+// from the linker script and _sbrk() in startup.c
+extern unsigned long _heap_start;
+extern unsigned long _heap_end;
+extern char *__brkval;
+extern char *__brkval_peak;
+// newlib's lock around malloc's data, held while the chunks are walked
+extern void __malloc_lock(struct _reent *);
+extern void __malloc_unlock(struct _reent *);
+
+// newlib's malloc keeps each block (chunk) after a 2 word header.  The
+// second word is the chunk size, with bit 0 set if the previous chunk is
+// in use.  The last chunk, which ends at __brkval, is always free.
+#define CHUNK_SIZE(p) (((size_t *)(p))[1] & ~(size_t)3)
+#define CHUNK_PREV_INUSE(p) (((size_t *)(p))[1] & 1)
+#define CHUNK_MIN (4 * sizeof(size_t))
+
+int heap_profile_malloc(heap_profile_t *prof)
+{
+	char *start = (char *)(((uintptr_t)&_heap_start + 7) & ~(uintptr_t)7);
+	char *brk, *p, *next;
+	size_t chunk, tail;
+
+	memset(prof, 0, sizeof(heap_profile_t));
+	__malloc_lock(_REENT);
+	brk = __brkval;
+	prof->total = (char *)&_heap_end - (char *)&_heap_start;
+	prof->peak = __brkval_peak - (char *)&_heap_start;
+	// memory malloc hasn't yet requested from _sbrk() is free, after the top chunk
+	tail = (char *)&_heap_end - brk;
+	for (p = start; p + CHUNK_MIN <= brk; p = next) {
+		chunk = CHUNK_SIZE(p);
+		if (chunk < CHUNK_MIN || chunk > (size_t)(brk - p)) break;
+		next = p + chunk;
+		if (next + 2 * sizeof(size_t) <= brk && CHUNK_PREV_INUSE(next)) {
+			prof->used += chunk;
+			prof->used_blocks++;
+			prof->used_count[heap_profile_class(chunk - sizeof(size_t))]++;
+			continue;
+		}
+		if (next >= brk) {
+			chunk += tail;
+			tail = 0;
+		}
+		prof->free_blocks++;
+		prof->free_count[heap_profile_class(chunk)]++;
+		if (chunk > prof->largest_free) prof->largest_free = chunk;
+	}
+	__malloc_unlock(_REENT);
+	if (tail > 0) {
+		prof->free_blocks++;
+		prof->free_count[heap_profile_class(tail)]++;
+		if (tail > prof->largest_free) prof->largest_free = tail;
+	}
+	prof->free = prof->total - prof->used;
+	return prof->used_blocks ? 1 : 0;
+}
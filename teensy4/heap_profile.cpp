@@ -0,0 +1,70 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "heap_profile.h"
+#include "Print.h"
+#include "smalloc.h"
+
+void heap_profile_print(Print &out, const char *name, const heap_profile_t *prof)
+{
+	out.printf("%s: %u bytes, %u used, %u free, largest free %u, peak %u\n",
+		name, (unsigned)prof->total, (unsigned)prof->used, (unsigned)prof->free,
+		(unsigned)prof->largest_free, (unsigned)prof->peak);
+	out.printf("  %u used blocks, %u free blocks\n",
+		(unsigned)prof->used_blocks, (unsigned)prof->free_blocks);
+	out.println("  size        used    free   allocs");
+	for (int i=0; i < HEAP_PROFILE_CLASSES; i++) {
+		if (!prof->used_count[i] && !prof->free_count[i] && !prof->allocs[i]) continue;
+		if (i == 0) {
+			out.print("  <32     ");
+		} else {
+			out.printf("  %-8u%s", 16u << i, i == HEAP_PROFILE_CLASSES - 1 ? "+" : " ");
+		}
+		out.printf("%8u%8u%9u\n", (unsigned)prof->used_count[i],
+			(unsigned)prof->free_count[i], (unsigned)prof->allocs[i]);
+	}
+	for (int i=0; i < HEAP_PROFILE_CALLERS && prof->callers[i].blocks; i++) {
+		out.printf("  caller %08X: %u bytes in %u blocks\n", (unsigned)(uintptr_t)prof->callers[i].caller,
+			(unsigned)prof->callers[i].bytes, (unsigned)prof->callers[i].blocks);
+	}
+}
+
+void heap_report(Print &out)
+{
+	heap_profile_t prof;
+
+	heap_profile_malloc(&prof);
+	heap_profile_print(out, "malloc", &prof);
+#ifdef ARDUINO_TEENSY41
+	if (sm_profile_pool(&extmem_smalloc_pool, &prof) >= 0) {
+		heap_profile_print(out, "extmem", &prof);
+	}
+#endif
+}
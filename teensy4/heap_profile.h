@@ -0,0 +1,103 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef heap_profile_h_
+#define heap_profile_h_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Heap profiler, to watch for fragmentation while a program runs.  The
+// heap is walked block by block, so no memory or time is used until a
+// profile is requested.  Each profile reports how much memory is used &
+// free, the largest free block (the biggest malloc which can succeed),
+// and how many used and free blocks there are in each size class.
+//
+//   heap_report(Serial);			// malloc() heap and EXTMEM
+//
+//   heap_profile_t prof;
+//   heap_profile_malloc(&prof);
+//   if (prof.largest_free < 4096) ...	// too fragmented
+//
+// The smalloc pools (extmem_malloc) also count allocations by size class
+// and peak usage.  Build with SMALLOC_CALLER defined to also record the
+// address of the code which allocated each block, and report the callers
+// holding the most memory.  This adds 8 bytes to each block.
+
+#define HEAP_PROFILE_CLASSES 16	// <32, 32-63, 64-127, ... 512K and larger
+#define HEAP_PROFILE_CALLERS 8
+
+typedef struct {
+	size_t total;			// bytes the heap may use
+	size_t used;			// bytes in allocated blocks, with overhead
+	size_t free;			// bytes not allocated
+	size_t largest_free;		// largest block malloc can return
+	size_t peak;			// most bytes ever used
+	uint32_t used_blocks;
+	uint32_t free_blocks;
+	uint32_t used_count[HEAP_PROFILE_CLASSES];	// used blocks by size
+	uint32_t free_count[HEAP_PROFILE_CLASSES];	// free blocks by size
+	uint32_t allocs[HEAP_PROFILE_CLASSES];		// all allocations, smalloc only
+	struct {
+		void *caller;		// address which called malloc
+		size_t bytes;
+		uint32_t blocks;
+	} callers[HEAP_PROFILE_CALLERS];	// SMALLOC_CALLER only, most bytes first
+} heap_profile_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline unsigned int heap_profile_class(size_t size)
+{
+	unsigned int c;
+	if (size < 32) return 0;
+	c = 27 - __builtin_clz(size);
+	return c < HEAP_PROFILE_CLASSES ? c : HEAP_PROFILE_CLASSES - 1;
+}
+
+// Profile the malloc() heap in RAM2.  On Teensy 4, peak is the highest
+// address the heap has ever grown to, used or not.
+int heap_profile_malloc(heap_profile_t *prof);
+
+// Profile a smalloc pool, like extmem_smalloc_pool (Teensy 4.1 EXTMEM)
+struct smalloc_pool;
+int sm_profile_pool(struct smalloc_pool *spool, heap_profile_t *prof);
+
+#ifdef __cplusplus
+}
+
+class Print;
+void heap_profile_print(Print &out, const char *name, const heap_profile_t *prof);
+void heap_report(Print &out);
+#endif
+
+#endif
@@ -34,25 +34,115 @@
 #include <math.h>
 
 
-char * ultoa(unsigned long val, char *buf, int radix)
+static const char digits_hex[] = "0123456789ABCDEF";
+
+static const char digit_pairs[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+// Two decimal digits per step.  Division by the constant 100 compiles to
+// a multiply by its reciprocal, so no divide instruction is needed.
+static char * utoa_dec_end(uint32_t val, char *p)
+{
+	while (val >= 100) {
+		uint32_t q = val / 100;
+		const char *d = digit_pairs + (val - q * 100) * 2;
+		*--p = d[1];
+		*--p = d[0];
+		val = q;
+	}
+	if (val >= 10) {
+		const char *d = digit_pairs + val * 2;
+		*--p = d[1];
+		*--p = d[0];
+	} else {
+		*--p = '0' + val;
+	}
+	return p;
+}
+
+char * ultoa_end(unsigned long val, char *end, int radix)
 {
-	unsigned digit;
-	int i=0, j;
-	char t;
+	char *p = end;
 
-	while (1) {
-		digit = val % radix;
-		buf[i] = ((digit < 10) ? '0' + digit : 'A' + digit - 10);
+	if (radix == 10 || radix < 2 || radix > 36) {
+		return utoa_dec_end(val, p);
+	}
+	if ((radix & (radix - 1)) == 0) {
+		int shift = __builtin_ctz(radix);
+		do {
+			*--p = digits_hex[val & (radix - 1)];
+			val >>= shift;
+		} while (val);
+		return p;
+	}
+	do {
+		unsigned digit = val % radix;
+		*--p = ((digit < 10) ? '0' + digit : 'A' + digit - 10);
 		val /= radix;
-		if (val == 0) break;
-		i++;
+	} while (val);
+	return p;
+}
+
+char * ulltoa_end(unsigned long long val, char *end, int radix)
+{
+	char *p = end;
+
+	if (radix == 10 || radix < 2 || radix > 36) {
+		// 9 digits at a time using 32 bit math, so at most 2 of
+		// the slow 64 bit divisions for even the largest numbers
+		while (val > 0xFFFFFFFF) {
+			unsigned long long q = val / 1000000000;
+			char *stop = p - 9;
+			p = utoa_dec_end(val - q * 1000000000, p);
+			while (p > stop) *--p = '0';
+			val = q;
+		}
+		return utoa_dec_end(val, p);
+	}
+	if (radix == 16 && val > 0xFFFFFFFF) {
+		// low 32 bits are always 8 hex digits
+		uint32_t low = val;
+		char *stop = p - 8;
+		while (p > stop) {
+			*--p = digits_hex[low & 15];
+			low >>= 4;
+		}
+		return ultoa_end(val >> 32, p, 16);
 	}
-	buf[i + 1] = 0;
-	for (j=0; j < i; j++, i--) {
-		t = buf[j];
-		buf[j] = buf[i];
-		buf[i] = t;
+	if (val <= 0xFFFFFFFF) return ultoa_end(val, p, radix);
+	if ((radix & (radix - 1)) == 0) {
+		int shift = __builtin_ctz(radix);
+		do {
+			*--p = digits_hex[val & (radix - 1)];
+			val >>= shift;
+		} while (val);
+		return p;
 	}
+	do {
+		unsigned digit = val % radix;
+		*--p = ((digit < 10) ? '0' + digit : 'A' + digit - 10);
+		val /= radix;
+	} while (val);
+	return p;
+}
+
+char * ultoa(unsigned long val, char *buf, int radix)
+{
+	char tmp[32];
+	char *end = tmp + sizeof(tmp);
+	char *p = ultoa_end(val, end, radix);
+
+	memcpy(buf, p, end - p);
+	buf[end - p] = 0;
 	return buf;
 }
 
@@ -69,23 +159,12 @@ char * ltoa(long val, char *buf, int radix)
 
 char * ulltoa(unsigned long long val, char *buf, int radix)
 {
-	unsigned digit;
-	int i=0, j;
-	char t;
+	char tmp[64];
+	char *end = tmp + sizeof(tmp);
+	char *p = ulltoa_end(val, end, radix);
 
-	while (1) {
-		digit = val % radix;
-		buf[i] = ((digit < 10) ? '0' + digit : 'A' + digit - 10);
-		val /= radix;
-		if (val == 0) break;
-		i++;
-	}
-	buf[i + 1] = 0;
-	for (j=0; j < i; j++, i--) {
-		t = buf[j];
-		buf[j] = buf[i];
-		buf[i] = t;
-	}
+	memcpy(buf, p, end - p);
+	buf[end - p] = 0;
 	return buf;
 }
 
@@ -100,153 +179,538 @@ char * lltoa(long long val, char *buf, int radix)
 	}
 }
 
-#define DTOA_UPPER 0x04
+// Shortest round trip float to decimal conversion, using Florian Loitsch's
+// Grisu2 algorithm, "Printing Floating-Point Numbers Quickly and Accurately
+// with Integers" (PLDI 2010).  The digits always read back as exactly the
+// same number, and are the shortest possible in nearly all cases.  Only 64
+// bit integer math is used, so it's fast even without a double precision FPU.
 
-char * fcvtf(float, int, int *, int *);
-int isnanf (float x);
-int isinff (float x);
+typedef struct {
+	uint64_t f;
+	int e;
+} diyfp_t;
 
-char * dtostrf(float val, int width, unsigned int precision, char *buf)
+// normalized 10^k for k = -348, -340, ... 340
+static const uint64_t pow10_f[87] = {
+	0xFA8FD5A0081C0288ULL, 0xBAAEE17FA23EBF76ULL, 0x8B16FB203055AC76ULL,
+	0xCF42894A5DCE35EAULL, 0x9A6BB0AA55653B2DULL, 0xE61ACF033D1A45DFULL,
+	0xAB70FE17C79AC6CAULL, 0xFF77B1FCBEBCDC4FULL, 0xBE5691EF416BD60CULL,
+	0x8DD01FAD907FFC3CULL, 0xD3515C2831559A83ULL, 0x9D71AC8FADA6C9B5ULL,
+	0xEA9C227723EE8BCBULL, 0xAECC49914078536DULL, 0x823C12795DB6CE57ULL,
+	0xC21094364DFB5637ULL, 0x9096EA6F3848984FULL, 0xD77485CB25823AC7ULL,
+	0xA086CFCD97BF97F4ULL, 0xEF340A98172AACE5ULL, 0xB23867FB2A35B28EULL,
+	0x84C8D4DFD2C63F3BULL, 0xC5DD44271AD3CDBAULL, 0x936B9FCEBB25C996ULL,
+	0xDBAC6C247D62A584ULL, 0xA3AB66580D5FDAF6ULL, 0xF3E2F893DEC3F126ULL,
+	0xB5B5ADA8AAFF80B8ULL, 0x87625F056C7C4A8BULL, 0xC9BCFF6034C13053ULL,
+	0x964E858C91BA2655ULL, 0xDFF9772470297EBDULL, 0xA6DFBD9FB8E5B88FULL,
+	0xF8A95FCF88747D94ULL, 0xB94470938FA89BCFULL, 0x8A08F0F8BF0F156BULL,
+	0xCDB02555653131B6ULL, 0x993FE2C6D07B7FACULL, 0xE45C10C42A2B3B06ULL,
+	0xAA242499697392D3ULL, 0xFD87B5F28300CA0EULL, 0xBCE5086492111AEBULL,
+	0x8CBCCC096F5088CCULL, 0xD1B71758E219652CULL, 0x9C40000000000000ULL,
+	0xE8D4A51000000000ULL, 0xAD78EBC5AC620000ULL, 0x813F3978F8940984ULL,
+	0xC097CE7BC90715B3ULL, 0x8F7E32CE7BEA5C70ULL, 0xD5D238A4ABE98068ULL,
+	0x9F4F2726179A2245ULL, 0xED63A231D4C4FB27ULL, 0xB0DE65388CC8ADA8ULL,
+	0x83C7088E1AAB65DBULL, 0xC45D1DF942711D9AULL, 0x924D692CA61BE758ULL,
+	0xDA01EE641A708DEAULL, 0xA26DA3999AEF774AULL, 0xF209787BB47D6B85ULL,
+	0xB454E4A179DD1877ULL, 0x865B86925B9BC5C2ULL, 0xC83553C5C8965D3DULL,
+	0x952AB45CFA97A0B3ULL, 0xDE469FBD99A05FE3ULL, 0xA59BC234DB398C25ULL,
+	0xF6C69A72A3989F5CULL, 0xB7DCBF5354E9BECEULL, 0x88FCF317F22241E2ULL,
+	0xCC20CE9BD35C78A5ULL, 0x98165AF37B2153DFULL, 0xE2A0B5DC971F303AULL,
+	0xA8D9D1535CE3B396ULL, 0xFB9B7CD9A4A7443CULL, 0xBB764C4CA7A44410ULL,
+	0x8BAB8EEFB6409C1AULL, 0xD01FEF10A657842CULL, 0x9B10A4E5E9913129ULL,
+	0xE7109BFBA19C0C9DULL, 0xAC2820D9623BF429ULL, 0x80444B5E7AA7CF85ULL,
+	0xBF21E44003ACDD2DULL, 0x8E679C2F5E44FF8FULL, 0xD433179D9C8CB841ULL,
+	0x9E19DB92B4E31BA9ULL, 0xEB96BF6EBADF77D9ULL, 0xAF87023B9BF0EE6BULL,
+};
+static const int16_t pow10_e[87] = {
+	-1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+	-901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+	-582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+	-263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+	56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+	375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+	694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+	1013, 1039, 1066,
+};
+
+static diyfp_t diyfp_mul(diyfp_t x, diyfp_t y)
 {
-	int decpt, sign, reqd, pad;
-	const char *s, *e;
-	char *p;
-
-	int awidth = abs(width);
-	if (isnanf(val)) {
-		int ndigs = (val<0) ? 4 : 3;
-		awidth = (awidth > ndigs) ? awidth - ndigs : 0;
-		if (width<0) {
-			while (awidth) {
-				*buf++ = ' ';
-				awidth--;
-			}
-		}
-		if (copysignf(1.0f, val)<0) *buf++ = '-';
-		if (DTOA_UPPER) {
-			*buf++ = 'N';  *buf++ = 'A';  *buf++ = 'N';
-		} else {
-			*buf++ = 'n';  *buf++ = 'a';  *buf++ = 'n';
-		}
-		while (awidth) {
-			*buf++ = ' ';
-			awidth--;
-		}
-		*buf = 0;
-		return buf;
+	uint64_t a = x.f >> 32, b = x.f & 0xFFFFFFFF;
+	uint64_t c = y.f >> 32, d = y.f & 0xFFFFFFFF;
+	uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+	uint64_t tmp = (bd >> 32) + (ad & 0xFFFFFFFF) + (bc & 0xFFFFFFFF);
+	tmp += 1U << 31; // round
+	diyfp_t r = { ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64 };
+	return r;
+}
+
+static diyfp_t diyfp_norm(uint64_t f, int e)
+{
+	int shift = __builtin_clzll(f);
+	diyfp_t r = { f << shift, e - shift };
+	return r;
+}
+
+static void grisu_round(char *digits, int len, uint64_t delta, uint64_t rest,
+	uint64_t ten_kappa, uint64_t wp_w)
+{
+	while (rest < wp_w && delta - rest >= ten_kappa &&
+	  (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+		digits[len - 1]--;
+		rest += ten_kappa;
 	}
-	if (isinff(val)) {
-		int ndigs = (val<0) ? 4 : 3;
-		awidth = (awidth > ndigs) ? awidth - ndigs : 0;
-		if (width<0) {
-			while (awidth) {
-				*buf++ = ' ';
-				awidth--;
-			}
-		}
-		if (val<0) *buf++ = '-';
-		if (DTOA_UPPER) {
-			*buf++ = 'I';  *buf++ = 'N';  *buf++ = 'F';
-		} else {
-			*buf++ = 'i';  *buf++ = 'n';  *buf++ = 'f';
+}
+
+// Value f * 2^e, f non-zero.  Writes up to 17 digits and returns the count,
+// with *K set so the value is digits * 10^K.
+static int grisu2(uint64_t f, int e, int lower_closer, char *digits, int *K)
+{
+	static const uint32_t pow10[] = {
+		1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+	};
+	diyfp_t w = diyfp_norm(f, e);
+	diyfp_t mp = diyfp_norm((f << 1) + 1, e - 1);
+	diyfp_t mm;
+	if (lower_closer) {
+		mm.f = (f << 2) - 1;
+		mm.e = e - 2;
+	} else {
+		mm.f = (f << 1) - 1;
+		mm.e = e - 1;
+	}
+	mm.f <<= mm.e - mp.e;
+	mm.e = mp.e;
+
+	// cached power bringing the upper boundary's exponent to -61 .. -32,
+	// k = ceil((-61 - e) * log10(2)), computed with integers
+	int64_t t = (int64_t)(-61 - mp.e) * 1292913987; // log10(2) * 2^32
+	int k = ((t >= 0) ? (int)((t + 0xFFFFFFFF) >> 32) : -(int)((-t) >> 32)) + 347;
+	int index = (k >> 3) + 1;
+	diyfp_t c = { pow10_f[index], pow10_e[index] };
+	*K = 348 - index * 8;
+
+	w = diyfp_mul(w, c);
+	mp = diyfp_mul(mp, c);
+	mm = diyfp_mul(mm, c);
+	mm.f++;
+	mp.f--;
+	uint64_t delta = mp.f - mm.f;
+	uint64_t wp_w = mp.f - w.f;
+
+	// generate digits of the upper boundary, stopping once within delta
+	int shift = -mp.e;
+	uint64_t one = (uint64_t)1 << shift;
+	uint32_t p1 = mp.f >> shift;
+	uint64_t p2 = mp.f & (one - 1);
+	int kappa = 10;
+	int len = 0;
+	while (kappa > 0 && p1 < pow10[kappa - 1]) kappa--;
+	while (kappa > 0) {
+		uint32_t d = p1 / pow10[kappa - 1];
+		p1 -= d * pow10[kappa - 1];
+		if (d || len) digits[len++] = '0' + d;
+		kappa--;
+		uint64_t rest = ((uint64_t)p1 << shift) + p2;
+		if (rest <= delta) {
+			*K += kappa;
+			grisu_round(digits, len, delta, rest, (uint64_t)pow10[kappa] << shift, wp_w);
+			return len;
 		}
-		while (awidth) {
-			*buf++ = ' ';
-			awidth--;
+	}
+	while (1) {
+		p2 *= 10;
+		delta *= 10;
+		char d = p2 >> shift;
+		if (d || len) digits[len++] = '0' + d;
+		p2 &= one - 1;
+		kappa--;
+		if (p2 < delta) {
+			*K += kappa;
+			grisu_round(digits, len, delta, p2, one, (-kappa < 9) ? wp_w * pow10[-kappa] : 0);
+			return len;
 		}
-		*buf = 0;
-		return buf;
 	}
+}
 
-	s = fcvtf(val, precision, &decpt, &sign);
+static int shortest_digits(uint64_t f, int e, int lower_closer, char *digits, int *decpt)
+{
+	int K, len;
 
-	// if only 1 digit in output
-	if (precision == 0 && decpt == 0) {
-		// round and move decimal point
-		s = (*s < '5') ? "0" : "1";
-		decpt++;
+	if (f == 0) {
+		*decpt = 0;
+		return 0;
 	}
-
-	// if all zeros, limit to precision
-	if (-decpt  > (int)precision) {
-		s = "0";
-		decpt = -precision;
+	len = grisu2(f, e, lower_closer, digits, &K);
+	while (len > 1 && digits[len - 1] == '0') {
+		len--;
+		K++;
 	}
+	*decpt = K + len;
+	return len;
+}
 
-	reqd = strlen(s);
+// Exact conversion, used when a precision is given.  The value is held as
+// the fraction R/S of two big integers and digits are made one at a time,
+// so the result is always correctly rounded, with ties to even like glibc.
+// 36 words holds the largest R or S, for the smallest subnormal.
 
-	// add 1 for decimal point
-	if (reqd > decpt) reqd++;
+#define BIGNUM_WORDS 36
 
-	// add 1 for zero in front of decimal point
-	if (decpt == 0) reqd++;
+typedef struct {
+	int n;
+	uint32_t w[BIGNUM_WORDS];
+} bignum_t;
 
-	// if leading zeros after decimal point
-	if (decpt < 0 && precision > 0) {
-		// ensure enough trailing zeros, add 2 for '0.'
-		reqd = precision + 2;
+static void bignum_set(bignum_t *a, uint64_t v)
+{
+	a->w[0] = v;
+	a->w[1] = v >> 32;
+	a->n = a->w[1] ? 2 : (a->w[0] ? 1 : 0);
+}
 
-		if (strlen(s) > precision + decpt) {
-			// bug in fcvtf. e.g. 0.012, precision 2 should return 1 instead of 12.
-			// However, 1.2, precision 0 returns correct value. So shift values so
-			// that decimal point is after the first digit, then convert again
+static void bignum_mul(bignum_t *a, uint32_t m)
+{
+	uint64_t carry = 0;
+	int i;
 
-			int newPrecision = precision;
-			int newDecimalPoint;
+	for (i=0; i < a->n; i++) {
+		carry += (uint64_t)a->w[i] * m;
+		a->w[i] = carry;
+		carry >>= 32;
+	}
+	if (carry) a->w[a->n++] = carry;
+}
 
-			// shift decimal point
-			while (newPrecision > 0) {
-				val *= 10.0f;
-				newPrecision--;
-			}
+static void bignum_mul_pow10(bignum_t *a, int k)
+{
+	for (; k >= 9; k -= 9) bignum_mul(a, 1000000000);
+	for (; k > 0; k--) bignum_mul(a, 10);
+}
 
-			// round after accounting for leading 0's
-			s = fcvtf(val, newPrecision, &newDecimalPoint, &sign);
+static void bignum_shl(bignum_t *a, int bits)
+{
+	int words = bits >> 5, i;
 
-			// if rounded up to new digit (e.g. 0.09 to 0.1), move decimal point
-			if (newDecimalPoint - decpt == precision + 1) decpt++;
+	bits &= 31;
+	if (a->n == 0) return;
+	if (bits) {
+		uint32_t top = a->w[a->n - 1] >> (32 - bits);
+		for (i = a->n - 1; i > 0; i--) {
+			a->w[i] = (a->w[i] << bits) | (a->w[i - 1] >> (32 - bits));
 		}
+		a->w[0] <<= bits;
+		if (top) a->w[a->n++] = top;
+	}
+	if (words) {
+		memmove(a->w + words, a->w, a->n * sizeof(uint32_t));
+		memset(a->w, 0, words * sizeof(uint32_t));
+		a->n += words;
+	}
+}
+
+static int bignum_cmp(const bignum_t *a, const bignum_t *b)
+{
+	int i;
+
+	if (a->n != b->n) return (a->n > b->n) ? 1 : -1;
+	for (i = a->n - 1; i >= 0; i--) {
+		if (a->w[i] != b->w[i]) return (a->w[i] > b->w[i]) ? 1 : -1;
+	}
+	return 0;
+}
+
+// a -= b, where a >= b
+static void bignum_sub(bignum_t *a, const bignum_t *b)
+{
+	uint32_t borrow = 0;
+	int i;
+
+	for (i=0; i < a->n; i++) {
+		uint64_t d = (uint64_t)a->w[i] - ((i < b->n) ? b->w[i] : 0) - borrow;
+		a->w[i] = d;
+		borrow = (d >> 32) & 1;
+	}
+	while (a->n > 0 && a->w[a->n - 1] == 0) a->n--;
+}
+
+// Next digit of R/S, where R < S
+static int bignum_digit(bignum_t *r, const bignum_t *s)
+{
+	int d = 0;
+
+	bignum_mul(r, 10);
+	while (bignum_cmp(r, s) >= 0) {
+		bignum_sub(r, s);
+		d++;
 	}
+	return d;
+}
 
-	// add 1 for sign if negative
-	if (sign) reqd++;
+// Text is collected in a small buffer and passed to the write function
+// in pieces, so there's no limit to its length.
+typedef struct {
+	dtostr_write_t write;
+	void *arg;
+	size_t n;
+	unsigned int len;
+	char buf[32];
+} dtostr_output_t;
 
-	p = buf;
-	e = p + reqd;
-	pad = width - reqd;
-	if (pad > 0) {
-		e += pad;
-		while (pad-- > 0) *p++ = ' ';
+static void dtostr_put(dtostr_output_t *out, char c)
+{
+	out->buf[out->len++] = c;
+	out->n++;
+	if (out->len >= sizeof(out->buf)) {
+		out->write(out->arg, out->buf, out->len);
+		out->len = 0;
+	}
+}
+
+#define PUT(c) dtostr_put(out, (c))
+
+static void dtostr_exp(dtostr_output_t *out, int exp, unsigned int flags)
+{
+	PUT((flags & DTOSTR_UPPERCASE) ? 'E' : 'e');
+	if (exp < 0) {
+		PUT('-');
+		exp = -exp;
+	} else {
+		PUT('+');
+	}
+	if (exp >= 100) PUT('0' + exp / 100);
+	PUT('0' + exp / 10 % 10);
+	PUT('0' + exp % 10);
+}
+
+// In ddd.ddd form "place" is the place value of the digit, counting down.
+// In d.ddde+xx form it counts digits up, and a digit past the precision
+// (after rounding carried into a new leading 1) is dropped.
+static void dtostr_digit(dtostr_output_t *out, int d, int *place, int precision, unsigned int flags)
+{
+	if (flags & DTOSTR_EXPONENT) {
+		if (*place > precision) return;
+		PUT('0' + d);
+		if (*place == 0 && precision > 0) PUT('.');
+		(*place)++;
+	} else {
+		PUT('0' + d);
+		if (*place == 0 && precision > 0) PUT('.');
+		(*place)--;
 	}
-	if (sign) *p++ = '-';
-	if (decpt == 0 && precision > 0) {
-		*p++ = '0';
-		*p++ = '.';
+}
+
+// Write the held back digit, plus 1 when rounding carries into it.  The 0
+// held before the first digit is only written when it becomes a 1.
+static void dtostr_pending(dtostr_output_t *out, int pending, int up, int *place, int precision, unsigned int flags)
+{
+	if (pending >= 0) {
+		dtostr_digit(out, pending + up, place, precision, flags);
+	} else if (up) {
+		dtostr_digit(out, 1, place, precision, flags);
+	} else if (!(flags & DTOSTR_EXPONENT)) {
+		(*place)--;
 	}
-	else if (decpt < 0 && precision > 0) {
-		*p++ = '0';
-		*p++ = '.';
-		// print leading zeros
-		while ( decpt < 0 ) {
+}
+
+// Value f * 2^e, with "precision" digits after the decimal point.  A digit
+// is held back until the next one isn't 9, so rounding can carry into it.
+// Before the first digit a 0 is held, which becomes the new leading 1 when
+// rounding carries all the way up.
+static void dtostr_exact(uint64_t f, int e, int precision, unsigned int flags, dtostr_output_t *out)
+{
+	bignum_t r, s;
+	int decpt, count, place, top, n, i, d, pending = -1, nines = 0, up = 0;
+
+	bignum_set(&r, f);
+	bignum_set(&s, 1);
+	decpt = 1;
+	if (f) {
+		if (e >= 0) {
+			bignum_shl(&r, e);
+		} else {
+			bignum_shl(&s, -e);
+		}
+		// floor(log10(2) * exponent) + 1, which may be 1 too low
+		int b = e + 63 - __builtin_clzll(f);
+		int64_t t = (int64_t)b * 1292913986; // log10(2) * 2^32
+		decpt = ((t >= 0) ? (int)(t >> 32) : -(int)((-t + 0xFFFFFFFF) >> 32)) + 1;
+		if (decpt > 0) {
+			bignum_mul_pow10(&s, decpt);
+		} else {
+			bignum_mul_pow10(&r, -decpt);
+		}
+		if (bignum_cmp(&r, &s) >= 0) {
+			bignum_mul(&s, 10);
 			decpt++;
-			*p++ = '0';
 		}
 	}
-	// print digits
-	while (p < e) {
-		*p++ = *s++;
-		if (p == e) break;
-		if (--decpt == 0) *p++ = '.';
+	// now R/S is 0.ddd, the value is R/S * 10^decpt
+	if (flags & DTOSTR_EXPONENT) {
+		count = precision + 1;
+		place = 0;
+	} else {
+		count = decpt + precision;
+		place = (decpt > 1) ? decpt : 1;
+	}
+	top = place;
+	n = (flags & DTOSTR_EXPONENT) ? count : top + precision;
+	for (i=0; i < n; i++) {
+		// leading zeros of 0.000ddd are digits too, rounding may carry into them
+		if (!(flags & DTOSTR_EXPONENT) && top - 1 - i >= decpt) {
+			d = 0;
+		} else {
+			d = bignum_digit(&r, &s);
+		}
+		if (d == 9) {
+			nines++;
+			continue;
+		}
+		dtostr_pending(out, pending, 0, &place, precision, flags);
+		for (; nines > 0; nines--) dtostr_digit(out, 9, &place, precision, flags);
+		pending = d;
+	}
+	if (count >= 0) {
+		// round half to even
+		bignum_shl(&r, 1);
+		int c = bignum_cmp(&r, &s);
+		up = c > 0 || (c == 0 && (nines > 0 || (pending > 0 && (pending & 1))));
+	}
+	if (up && pending < 0) decpt++;
+	dtostr_pending(out, pending, up, &place, precision, flags);
+	for (; nines > 0; nines--) dtostr_digit(out, up ? 0 : 9, &place, precision, flags);
+	if (flags & DTOSTR_EXPONENT) dtostr_exp(out, decpt - 1, flags);
+}
+
+static void dtostr(double val, int precision, unsigned int flags, dtostr_output_t *out)
+{
+	char digits[18];
+	int len, decpt, neg, e, lower_closer, i;
+	uint64_t f;
+	const char *s = NULL;
+
+	if (flags & DTOSTR_FLOAT) {
+		union { float f; uint32_t u; } u = { .f = val };
+		int be = (u.u >> 23) & 0xFF;
+		f = u.u & 0x7FFFFF;
+		neg = u.u >> 31;
+		if (be == 0xFF) s = f ? "nan" : "inf";
+		lower_closer = f == 0 && be > 1;
+		if (be) {
+			f |= 0x800000;
+			e = be - 150;
+		} else {
+			e = -149;
+		}
+	} else {
+		union { double d; uint64_t u; } u = { .d = val };
+		int be = (u.u >> 52) & 0x7FF;
+		f = u.u & 0xFFFFFFFFFFFFFull;
+		neg = u.u >> 63;
+		if (be == 0x7FF) s = f ? "nan" : "inf";
+		lower_closer = f == 0 && be > 1;
+		if (be) {
+			f |= 0x10000000000000ull;
+			e = be - 1075;
+		} else {
+			e = -1074;
+		}
+	}
+	if (neg) {
+		PUT('-');
+	} else if (flags & DTOSTR_PLUS_SIGN) {
+		PUT('+');
+	} else if (flags & DTOSTR_ALWAYS_SIGN) {
+		PUT(' ');
 	}
-	if (width < 0) {
-		pad = (reqd + width) * -1;
-		while (pad-- > 0) *p++ = ' ';
+	if (s) {
+		while (*s) PUT((flags & DTOSTR_UPPERCASE) ? *s++ - 'a' + 'A' : *s++);
+		return;
+	}
+	if (precision >= 0) {
+		dtostr_exact(f, e, precision, flags, out);
+		return;
+	}
+	len = shortest_digits(f, e, lower_closer, digits, &decpt);
+	if (flags & DTOSTR_EXPONENT) {
+		// d.ddde+xx
+		PUT(len ? digits[0] : '0');
+		if (len > 1) PUT('.');
+		for (i=1; i < len; i++) PUT(digits[i]);
+		dtostr_exp(out, len ? decpt - 1 : 0, flags);
+	} else {
+		// ddd.ddd
+		if (len == 0) decpt = 1;
+		if (decpt <= 0) {
+			PUT('0');
+		} else {
+			for (i=0; i < decpt; i++) PUT((i < len) ? digits[i] : '0');
+		}
+		if (len > decpt) PUT('.');
+		for (i=decpt; i < len; i++) PUT((i >= 0) ? digits[i] : '0');
+	}
+}
+
+#undef PUT
+
+size_t dtostrw(double val, int precision, unsigned int flags, dtostr_write_t write, void *arg)
+{
+	dtostr_output_t out;
+
+	out.write = write;
+	out.arg = arg;
+	out.n = 0;
+	out.len = 0;
+	dtostr(val, precision, flags, &out);
+	if (out.len > 0) write(arg, out.buf, out.len);
+	return out.n;
+}
+
+typedef struct {
+	char *buf;
+	size_t size;
+	size_t n;
+} dtostrn_buffer_t;
+
+static void dtostrn_write(void *arg, const char *s, size_t len)
+{
+	dtostrn_buffer_t *b = (dtostrn_buffer_t *)arg;
+
+	if (b->n + 1 < b->size) {
+		size_t room = b->size - 1 - b->n;
+		memcpy(b->buf + b->n, s, (len < room) ? len : room);
 	}
-	*p = 0;
+	b->n += len;
+}
+
+int dtostrn(double val, char *buf, size_t size, int precision, unsigned int flags)
+{
+	dtostrn_buffer_t b = { buf, size, 0 };
 
-	//char format[20];
-	//sprintf(format, "%%%d.%df", width, precision);
-	//sprintf(buf, format, val);
+	dtostrw(val, precision, flags, dtostrn_write, &b);
+	if (size > 0) buf[(b.n < size) ? b.n : size - 1] = 0;
+	return b.n;
+}
+
+char * dtostre(double val, char *buf, unsigned char precision, unsigned char flags)
+{
+	dtostrn(val, buf, (size_t)-1, precision, flags | DTOSTR_EXPONENT);
 	return buf;
 }
 
+char * dtostrf(float val, int width, unsigned int precision, char *buf)
+{
+	int len = dtostrn(val, buf, (size_t)-1, precision, DTOSTR_FLOAT | DTOSTR_UPPERCASE);
+
+	if (width > len) {
+		// right justify
+		int pad = width - len;
+		memmove(buf + pad, buf, len + 1);
+		memset(buf, ' ', pad);
+	} else if (-width > len) {
+		// left justify
+		int pad = -width - len;
+		memset(buf + len, ' ', pad);
+		buf[len + pad] = 0;
+	}
+	return buf;
+}
@@ -10,7 +10,7 @@ int sm_alloc_valid_pool(struct smalloc_pool *spool, const void *p)
 {
 	struct smalloc_hdr *shdr;
 
-	if (!smalloc_verify_pool(spool)) {
+	if (!smalloc_get_ctl(spool)) {
 		errno = EINVAL;
 		return 0;
 	}
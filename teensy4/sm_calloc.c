@@ -8,10 +8,14 @@
 
 void *sm_calloc_pool(struct smalloc_pool *spool, size_t x, size_t y)
 {
-	return sm_zalloc_pool(spool, x * y);
+	void *r = sm_zalloc_pool(spool, x * y);
+	SM_TAG_CALLER(r);
+	return r;
 }
 
 void *sm_calloc(size_t x, size_t y)
 {
-	return sm_calloc_pool(&smalloc_curr_pool, x, y);
+	void *r = sm_calloc_pool(&smalloc_curr_pool, x, y);
+	SM_TAG_CALLER(r);
+	return r;
 }
@@ -8,10 +8,11 @@
 
 void sm_free_pool(struct smalloc_pool *spool, void *p)
 {
+	struct smalloc_ctl *ctl;
 	struct smalloc_hdr *shdr;
-	char *s;
 
-	if (!smalloc_verify_pool(spool)) {
+	ctl = smalloc_get_ctl(spool);
+	if (!ctl) {
 		errno = EINVAL;
 		return;
 	}
@@ -21,11 +22,11 @@ void sm_free_pool(struct smalloc_pool *spool, void *p)
 	shdr = USER_TO_HEADER(p);
 	if (smalloc_is_alloc(spool, shdr)) {
 		if (spool->do_zero) memset(p, 0, shdr->rsz);
-		s = CHAR_PTR(p);
-		s += shdr->usz;
-		memset(s, 0, HEADER_SZ);
-		if (spool->do_zero) memset(s+HEADER_SZ, 0, shdr->rsz - shdr->usz);
-		memset(shdr, 0, HEADER_SZ);
+		smalloc_count_used(ctl, HEADER_SZ + shdr->rsz, 0);
+		shdr->rsz |= SM_FREE_BIT;
+		shdr->usz = 0;
+		shdr->tag = 0;
+		smalloc_insert_free(ctl, smalloc_merge_free(ctl, shdr));
 		return;
 	}
 
@@ -8,10 +8,12 @@
 
 int sm_malloc_stats_pool(struct smalloc_pool *spool, size_t *total, size_t *user, size_t *free, int *nr_blocks)
 {
-	struct smalloc_hdr *shdr, *basehdr;
+	struct smalloc_ctl *ctl;
+	struct smalloc_hdr *shdr;
 	int r = 0;
 
-	if (!smalloc_verify_pool(spool)) {
+	ctl = smalloc_get_ctl(spool);
+	if (!ctl) {
 		errno = EINVAL;
 		return -1;
 	}
@@ -23,20 +25,17 @@ int sm_malloc_stats_pool(struct smalloc_pool *spool, size_t *total, size_t *user
 	if (free) *free = 0;
 	if (nr_blocks) *nr_blocks = 0;
 
-	shdr = basehdr = spool->pool;
-	while (CHAR_PTR(shdr)-CHAR_PTR(basehdr) < spool->pool_size) {
-		if (smalloc_is_alloc(spool, shdr)) {
-			if (total) *total += HEADER_SZ + shdr->rsz + HEADER_SZ;
+	for (shdr = FIRST_BLOCK(ctl); shdr->rsz != 0; shdr = NEXT_BLOCK(shdr)) {
+		if (BLOCK_IS_FREE(shdr)) {
+			if (free) *free += BLOCK_SIZE(shdr);
+		} else {
+			if (total) *total += HEADER_SZ + shdr->rsz;
 			if (user) *user += shdr->usz;
 			if (nr_blocks) *nr_blocks += 1;
 			r = 1;
 		}
-
-		shdr++;
 	}
 
-	*free = spool->pool_size - *total;
-
 	return r;
 }
 
@@ -15,6 +15,59 @@ int smalloc_verify_pool(struct smalloc_pool *spool)
 	return 1;
 }
 
+struct smalloc_hdr *smalloc_end_block(struct smalloc_pool *spool, size_t pool_size)
+{
+	uintptr_t end = PTR_UINT(spool->pool) + pool_size - HEADER_SZ;
+	return HEADER_PTR((end & ~(SM_ALIGN - 1)));
+}
+
+/* set up an empty pool: one big free block followed by the end marker */
+struct smalloc_ctl *smalloc_init_ctl(struct smalloc_pool *spool)
+{
+	struct smalloc_ctl *ctl = POOL_CTL(spool);
+	struct smalloc_hdr *shdr, *end;
+
+	if (spool->pool_size < MIN_POOL_SZ || spool->pool_size > SM_MAX_SIZE) return NULL;
+	memset(ctl, 0, sizeof(struct smalloc_ctl));
+	shdr = FIRST_BLOCK(ctl);
+	end = smalloc_end_block(spool, spool->pool_size);
+	memset(shdr, 0, HEADER_SZ);
+	shdr->rsz = (CHAR_PTR(end) - CHAR_PTR(HEADER_TO_USER(shdr))) | SM_FREE_BIT;
+	memset(end, 0, HEADER_SZ);
+	end->prev = shdr;
+	smalloc_insert_free(ctl, shdr);
+	ctl->size = spool->pool_size;
+	ctl->magic = SM_MAGIC ^ PTR_UINT(ctl);
+	return ctl;
+}
+
+/* the oom handler made the pool larger, add the new space as a free block */
+static void smalloc_extend_ctl(struct smalloc_pool *spool, struct smalloc_ctl *ctl)
+{
+	struct smalloc_hdr *shdr, *end;
+
+	if (spool->pool_size > SM_MAX_SIZE) return;
+	shdr = smalloc_end_block(spool, ctl->size);
+	end = smalloc_end_block(spool, spool->pool_size);
+	if (CHAR_PTR(end) - CHAR_PTR(shdr) < (ptrdiff_t)(HEADER_SZ + SM_MIN_BLOCK)) return;
+	shdr->rsz = (CHAR_PTR(end) - CHAR_PTR(HEADER_TO_USER(shdr))) | SM_FREE_BIT;
+	memset(end, 0, HEADER_SZ);
+	end->prev = shdr;
+	smalloc_insert_free(ctl, smalloc_merge_free(ctl, shdr));
+	ctl->size = spool->pool_size;
+}
+
+struct smalloc_ctl *smalloc_get_ctl(struct smalloc_pool *spool)
+{
+	struct smalloc_ctl *ctl;
+
+	if (!smalloc_verify_pool(spool)) return NULL;
+	ctl = POOL_CTL(spool);
+	if (ctl->magic != (SM_MAGIC ^ PTR_UINT(ctl))) return smalloc_init_ctl(spool);
+	if (ctl->size < spool->pool_size) smalloc_extend_ctl(spool, ctl);
+	return ctl;
+}
+
 int sm_align_pool(struct smalloc_pool *spool)
 {
 	size_t x;
@@ -59,6 +112,11 @@ int sm_set_pool(struct smalloc_pool *spool, void *new_pool, size_t new_pool_size
 		memset(spool->pool, 0, spool->pool_size);
 	}
 
+	if (!smalloc_init_ctl(spool)) {
+		errno = ENOSPC;
+		return 0;
+	}
+
 	return 1;
 }
 
@@ -0,0 +1,82 @@
+/*
+ * This file is a part of SMalloc.
+ * SMalloc is MIT licensed.
+ * Copyright (c) 2017 Andrey Rys.
+ */
+
+#include "smalloc_i.h"
+
+#ifdef SMALLOC_CALLER
+/* keep the callers holding the most bytes, a caller not in a full table replaces the smallest */
+static void smalloc_add_caller(heap_profile_t *prof, void *caller, size_t bytes)
+{
+	int i, min = 0;
+
+	for (i = 0; i < HEAP_PROFILE_CALLERS; i++) {
+		if (prof->callers[i].caller == caller || !prof->callers[i].blocks) break;
+		if (prof->callers[i].bytes < prof->callers[min].bytes) min = i;
+	}
+	if (i == HEAP_PROFILE_CALLERS) {
+		if (prof->callers[min].bytes >= bytes) return;
+		i = min;
+		prof->callers[i].bytes = 0;
+		prof->callers[i].blocks = 0;
+	}
+	prof->callers[i].caller = caller;
+	prof->callers[i].bytes += bytes;
+	prof->callers[i].blocks++;
+}
+#endif
+
+int sm_profile_pool(struct smalloc_pool *spool, heap_profile_t *prof)
+{
+	struct smalloc_ctl *ctl;
+	struct smalloc_hdr *shdr;
+	size_t sz;
+
+	if (!prof) {
+		errno = EINVAL;
+		return -1;
+	}
+	memset(prof, 0, sizeof(heap_profile_t));
+	ctl = smalloc_get_ctl(spool);
+	if (!ctl) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	prof->total = CHAR_PTR(smalloc_end_block(spool, ctl->size)) - CHAR_PTR(FIRST_BLOCK(ctl));
+	prof->used = ctl->used;
+	prof->peak = ctl->peak;
+	memcpy(prof->allocs, ctl->allocs, sizeof(prof->allocs));
+	for (shdr = FIRST_BLOCK(ctl); shdr->rsz != 0; shdr = NEXT_BLOCK(shdr)) {
+		sz = BLOCK_SIZE(shdr);
+		if (BLOCK_IS_FREE(shdr)) {
+			prof->free_blocks++;
+			prof->free_count[heap_profile_class(sz)]++;
+			if (sz > prof->largest_free) prof->largest_free = sz;
+		} else {
+			prof->used_blocks++;
+			prof->used_count[heap_profile_class(shdr->usz)]++;
+#ifdef SMALLOC_CALLER
+			smalloc_add_caller(prof, shdr->caller, HEADER_SZ + sz);
+#endif
+		}
+	}
+	prof->free = prof->total - prof->used;
+
+#ifdef SMALLOC_CALLER
+	{
+		/* sort, most bytes first */
+		int i, j;
+		for (i = 1; i < HEAP_PROFILE_CALLERS; i++) {
+			for (j = i; j > 0 && prof->callers[j].bytes > prof->callers[j-1].bytes; j--) {
+				__typeof__(prof->callers[0]) t = prof->callers[j];
+				prof->callers[j] = prof->callers[j-1];
+				prof->callers[j-1] = t;
+			}
+		}
+	}
+#endif
+	return prof->used_blocks ? 1 : 0;
+}
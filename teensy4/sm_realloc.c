@@ -8,10 +8,14 @@
 
 void *sm_realloc_pool(struct smalloc_pool *spool, void *p, size_t n)
 {
-	return sm_realloc_pool_i(spool, p, n, 0);
+	void *r = sm_realloc_pool_i(spool, p, n, 0);
+	SM_TAG_CALLER(r);
+	return r;
 }
 
 void *sm_realloc(void *p, size_t n)
 {
-	return sm_realloc_pool_i(&smalloc_curr_pool, p, n, 0);
+	void *r = sm_realloc_pool_i(&smalloc_curr_pool, p, n, 0);
+	SM_TAG_CALLER(r);
+	return r;
 }
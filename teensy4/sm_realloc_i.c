@@ -13,14 +13,13 @@
  */
 void *sm_realloc_pool_i(struct smalloc_pool *spool, void *p, size_t n, int nomove)
 {
-	struct smalloc_hdr *basehdr, *shdr, *dhdr;
+	struct smalloc_ctl *ctl;
+	struct smalloc_hdr *shdr, *next;
 	void *r;
-	char *s;
-	int found;
-	size_t rsz, usz, x;
-	uintptr_t tag;
+	size_t usz, rsz, x;
 
-	if (!smalloc_verify_pool(spool)) {
+	ctl = smalloc_get_ctl(spool);
+	if (!ctl) {
 		errno = EINVAL;
 		return NULL;
 	}
@@ -33,84 +32,35 @@ void *sm_realloc_pool_i(struct smalloc_pool *spool, void *p, size_t n, int nomov
 
 	/* determine user size */
 	shdr = USER_TO_HEADER(p);
-	if (!smalloc_is_alloc(spool, shdr)) smalloc_UB(spool, p);
+	if (!smalloc_is_alloc(spool, shdr)) {
+		smalloc_UB(spool, p);
+		return NULL;
+	}
 	usz = shdr->usz;
 	rsz = shdr->rsz;
+	if (n > SM_MAX_SIZE) goto allocblock;
+	x = SM_ROUNDUP(n);
+	if (x < SM_MIN_BLOCK) x = SM_MIN_BLOCK;
 
-	/* newsize is lesser than allocated - truncate */
-	if (n <= usz) {
-		if (spool->do_zero) memset(p + n, 0, shdr->rsz - n);
-		s = CHAR_PTR(HEADER_TO_USER(shdr));
-		s += usz;
-		memset(s, 0, HEADER_SZ);
-		if (spool->do_zero) memset(s+HEADER_SZ, 0, rsz - usz);
-		shdr->rsz = (n%HEADER_SZ)?(((n/HEADER_SZ)+1)*HEADER_SZ):n;
-		shdr->usz = n;
-		shdr->tag = tag = smalloc_mktag(shdr);
-		s = CHAR_PTR(HEADER_TO_USER(shdr));
-		s += shdr->usz;
-		for (x = 0; x < sizeof(struct smalloc_hdr); x += sizeof(uintptr_t)) {
-			tag = smalloc_uinthash(tag);
-			memcpy(s+x, &tag, sizeof(uintptr_t));
-		}
-		memset(s+x, 0xff, shdr->rsz - shdr->usz);
-		return p;
-	}
-
-	/* newsize is bigger than allocated, but there is free room - modify */
-	if (n > usz && n <= rsz) {
-		if (spool->do_zero) {
-			s = CHAR_PTR(HEADER_TO_USER(shdr));
-			s += usz;
-			memset(s, 0, HEADER_SZ);
-		}
-		shdr->usz = n;
-		shdr->tag = tag = smalloc_mktag(shdr);
-		s = CHAR_PTR(HEADER_TO_USER(shdr));
-		s += shdr->usz;
-		for (x = 0; x < sizeof(struct smalloc_hdr); x += sizeof(uintptr_t)) {
-			tag = smalloc_uinthash(tag);
-			memcpy(s+x, &tag, sizeof(uintptr_t));
-		}
-		memset(s+x, 0xff, shdr->rsz - shdr->usz);
-		return p;
-	}
-
-	/* newsize is bigger, larger than rsz but there are free blocks beyond - extend */
-	basehdr = spool->pool; dhdr = shdr+(rsz/HEADER_SZ); found = 0;
-	while (CHAR_PTR(dhdr)-CHAR_PTR(basehdr) < spool->pool_size) {
-		x = CHAR_PTR(dhdr)-CHAR_PTR(shdr);
-		if (smalloc_is_alloc(spool, dhdr))
-			goto allocblock;
-		if (n + HEADER_SZ <= x) {
-			x -= HEADER_SZ;
-			found = 1;
-			goto outfound;
-		}
-		dhdr++;
+	/* newsize is bigger, larger than rsz but the next block is free - extend */
+	if (x > shdr->rsz) {
+		next = NEXT_BLOCK(shdr);
+		if (!BLOCK_IS_FREE(next)
+		|| shdr->rsz + HEADER_SZ + BLOCK_SIZE(next) < x) goto allocblock;
+		smalloc_remove_free(ctl, next);
+		shdr->rsz += HEADER_SZ + BLOCK_SIZE(next);
+		NEXT_BLOCK(shdr)->prev = shdr;
 	}
 
-outfound:
-	/* write new numbers of same allocation */
-	if (found) {
-		if (spool->do_zero) {
-			s = CHAR_PTR(HEADER_TO_USER(shdr));
-			s += usz;
-			memset(s, 0, HEADER_SZ);
-			memset(s+HEADER_SZ, 0, rsz - usz);
-		}
-		shdr->rsz = x;
-		shdr->usz = n;
-		shdr->tag = tag = smalloc_mktag(shdr);
-		s = CHAR_PTR(HEADER_TO_USER(shdr));
-		s += shdr->usz;
-		for (x = 0; x < sizeof(struct smalloc_hdr); x += sizeof(uintptr_t)) {
-			tag = smalloc_uinthash(tag);
-			memcpy(s+x, &tag, sizeof(uintptr_t));
-		}
-		memset(s+x, 0xff, shdr->rsz - shdr->usz);
-		return p;
+	/* truncate or extend in place, any space left over becomes free */
+	if (spool->do_zero) {
+		if (n < usz) memset(CHAR_PTR(p) + n, 0, usz - n);
+		else memset(CHAR_PTR(p) + usz, 0, n - usz);
 	}
+	smalloc_split(ctl, shdr, x);
+	smalloc_set_alloc(shdr, n);
+	smalloc_count_used(ctl, rsz, shdr->rsz);
+	return p;
 
 allocblock:
 	/* newsize is bigger than allocated and no free space - move */
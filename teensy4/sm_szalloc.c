@@ -10,7 +10,7 @@ size_t sm_szalloc_pool(struct smalloc_pool *spool, const void *p)
 {
 	struct smalloc_hdr *shdr;
 
-	if (!smalloc_verify_pool(spool)) {
+	if (!smalloc_get_ctl(spool)) {
 		errno = EINVAL;
 		return ((size_t)-1);
 	}
@@ -0,0 +1,158 @@
+/*
+ * This file is a part of SMalloc.
+ * SMalloc is MIT licensed.
+ * Copyright (c) 2017 Andrey Rys.
+ */
+
+#include "smalloc_i.h"
+
+/*
+ * Free lists are indexed by size: fl is the power of 2 range, sl one of
+ * SM_SL_COUNT equal steps within it.  Sizes below 1 << SM_FL_SHIFT all
+ * go in fl 0, in steps of 8 bytes.
+ */
+static inline int smalloc_fls(size_t n)
+{
+	return 31 - __builtin_clz((unsigned int)n);
+}
+
+static inline void smalloc_mapping(size_t size, int *fl, int *sl)
+{
+	if (size < ((size_t)1 << SM_FL_SHIFT)) {
+		*fl = 0;
+		*sl = size >> (SM_FL_SHIFT - SM_SL_LOG2);
+	} else {
+		int f = smalloc_fls(size);
+		*sl = (size >> (f - SM_SL_LOG2)) ^ SM_SL_COUNT;
+		*fl = f - SM_FL_SHIFT + 1;
+	}
+}
+
+void smalloc_insert_free(struct smalloc_ctl *ctl, struct smalloc_hdr *shdr)
+{
+	struct smalloc_hdr *head;
+	int fl, sl;
+
+	smalloc_mapping(BLOCK_SIZE(shdr), &fl, &sl);
+	head = ctl->blocks[fl][sl];
+	FREE_LINKS(shdr)->next = head;
+	FREE_LINKS(shdr)->prev = NULL;
+	if (head) FREE_LINKS(head)->prev = shdr;
+	ctl->blocks[fl][sl] = shdr;
+	ctl->fl_bitmap |= 1U << fl;
+	ctl->sl_bitmap[fl] |= 1U << sl;
+}
+
+void smalloc_remove_free(struct smalloc_ctl *ctl, struct smalloc_hdr *shdr)
+{
+	struct smalloc_hdr *next = FREE_LINKS(shdr)->next;
+	struct smalloc_hdr *prev = FREE_LINKS(shdr)->prev;
+	int fl, sl;
+
+	smalloc_mapping(BLOCK_SIZE(shdr), &fl, &sl);
+	if (next) FREE_LINKS(next)->prev = prev;
+	if (prev) {
+		FREE_LINKS(prev)->next = next;
+	} else {
+		ctl->blocks[fl][sl] = next;
+		if (!next) {
+			ctl->sl_bitmap[fl] &= ~(1U << sl);
+			if (!ctl->sl_bitmap[fl]) ctl->fl_bitmap &= ~(1U << fl);
+		}
+	}
+}
+
+/*
+ * Find and remove a free block of at least size bytes.  The size is
+ * rounded up to the next list, so any block on that list is large enough.
+ */
+struct smalloc_hdr *smalloc_find_free(struct smalloc_ctl *ctl, size_t size)
+{
+	struct smalloc_hdr *shdr;
+	size_t search = size;
+	unsigned int map = 0;
+	int fl, sl;
+
+	if (size >= ((size_t)1 << SM_FL_SHIFT)) {
+		search += ((size_t)1 << (smalloc_fls(size) - SM_SL_LOG2)) - 1;
+	}
+	if (search <= SM_MAX_SIZE) {
+		smalloc_mapping(search, &fl, &sl);
+		map = ctl->sl_bitmap[fl] & (~0U << sl);
+		if (!map && fl + 1 < SM_FL_COUNT) {
+			map = ctl->fl_bitmap & (~0U << (fl + 1));
+			if (map) {
+				fl = __builtin_ctz(map);
+				map = ctl->sl_bitmap[fl];
+			}
+		}
+	}
+	if (map) {
+		sl = __builtin_ctz(map);
+		shdr = ctl->blocks[fl][sl];
+	} else {
+		/* nothing certain to fit, but a block on size's own list might */
+		smalloc_mapping(size, &fl, &sl);
+		shdr = ctl->blocks[fl][sl];
+		while (shdr && BLOCK_SIZE(shdr) < size) shdr = FREE_LINKS(shdr)->next;
+		if (!shdr) return NULL;
+	}
+	smalloc_remove_free(ctl, shdr);
+	return shdr;
+}
+
+/* join a newly free block with free neighbours, returns the joined block */
+struct smalloc_hdr *smalloc_merge_free(struct smalloc_ctl *ctl, struct smalloc_hdr *shdr)
+{
+	struct smalloc_hdr *next = NEXT_BLOCK(shdr);
+	struct smalloc_hdr *prev = shdr->prev;
+
+	if (BLOCK_IS_FREE(next)) {
+		smalloc_remove_free(ctl, next);
+		shdr->rsz += HEADER_SZ + BLOCK_SIZE(next);
+		NEXT_BLOCK(shdr)->prev = shdr;
+	}
+	if (prev && BLOCK_IS_FREE(prev)) {
+		smalloc_remove_free(ctl, prev);
+		prev->rsz += HEADER_SZ + BLOCK_SIZE(shdr);
+		NEXT_BLOCK(prev)->prev = prev;
+		shdr = prev;
+	}
+	return shdr;
+}
+
+/*
+ * Make shdr an allocated block of exactly size bytes, if the rest is
+ * large enough to be a block of its own.  The rest is made free.
+ */
+void smalloc_split(struct smalloc_ctl *ctl, struct smalloc_hdr *shdr, size_t size)
+{
+	struct smalloc_hdr *rest;
+	size_t rsz = BLOCK_SIZE(shdr);
+
+	if (rsz < size + HEADER_SZ + SM_MIN_BLOCK) {
+		shdr->rsz = rsz;
+		return;
+	}
+	shdr->rsz = size;
+	rest = NEXT_BLOCK(shdr);
+	rest->prev = shdr;
+	rest->rsz = (rsz - size - HEADER_SZ) | SM_FREE_BIT;
+	rest->usz = 0;
+	rest->tag = 0;
+	NEXT_BLOCK(rest)->prev = rest;
+	smalloc_insert_free(ctl, smalloc_merge_free(ctl, rest));
+}
+
+void smalloc_set_alloc(struct smalloc_hdr *shdr, size_t n)
+{
+	shdr->usz = n;
+	shdr->tag = smalloc_mktag(shdr);
+}
+
+/* track bytes in use as a block is allocated (oldsz 0), resized or freed (newsz 0) */
+void smalloc_count_used(struct smalloc_ctl *ctl, size_t oldsz, size_t newsz)
+{
+	ctl->used += newsz - oldsz;
+	if (ctl->used > ctl->peak) ctl->peak = ctl->used;
+}
@@ -8,33 +8,14 @@
 
 static int smalloc_check_bounds(struct smalloc_pool *spool, struct smalloc_hdr *shdr)
 {
-	if (!spool) return 0;
-	if (CHAR_PTR(shdr) >= CHAR_PTR(spool->pool)
-	&& CHAR_PTR(shdr) <= (CHAR_PTR(spool->pool)+spool->pool_size))
-		return 1;
-	return 0;
-}
+	struct smalloc_ctl *ctl;
 
-static int smalloc_valid_tag(struct smalloc_hdr *shdr)
-{
-	char *s;
-	uintptr_t r = smalloc_mktag(shdr);
-	size_t x;
-
-	if (shdr->tag == r) {
-		s = CHAR_PTR(HEADER_TO_USER(shdr));
-		s += shdr->usz;
-		for (x = 0; x < sizeof(struct smalloc_hdr); x += sizeof(uintptr_t)) {
-			r = smalloc_uinthash(r);
-			if (memcmp(s+x, &r, sizeof(uintptr_t)) != 0) return 0;
-		}
-		s += x; x = 0;
-		while (x < shdr->rsz - shdr->usz) {
-			if (s[x] != '\xFF') return 0;
-			x++;
-		}
+	if (!spool) return 0;
+	ctl = POOL_CTL(spool);
+	if (CHAR_PTR(shdr) >= CHAR_PTR(FIRST_BLOCK(ctl))
+	&& CHAR_PTR(shdr) < CHAR_PTR(smalloc_end_block(spool, ctl->size))
+	&& (PTR_UINT(shdr) % SM_ALIGN) == 0)
 		return 1;
-	}
 	return 0;
 }
 
@@ -56,10 +37,11 @@ int smalloc_is_alloc(struct smalloc_pool *spool, struct smalloc_hdr *shdr)
 {
 	if (!smalloc_check_bounds(spool, shdr)) return 0;
 	if (shdr->rsz == 0) return 0;
-	if (shdr->rsz > SIZE_MAX) return 0;
-	if (shdr->usz > SIZE_MAX) return 0;
+	if (BLOCK_IS_FREE(shdr)) return 0;
+	if (shdr->rsz % SM_ALIGN) return 0;
+	if (shdr->rsz > (size_t)(CHAR_PTR(smalloc_end_block(spool, POOL_CTL(spool)->size))
+		- CHAR_PTR(HEADER_TO_USER(shdr)))) return 0;
 	if (shdr->usz > shdr->rsz) return 0;
-	if (shdr->rsz % HEADER_SZ) return 0;
-	if (!smalloc_valid_tag(shdr)) return 0;
+	if (shdr->tag != smalloc_mktag(shdr)) return 0;
 	return 1;
 }
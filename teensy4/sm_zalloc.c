@@ -10,10 +10,13 @@ void *sm_zalloc_pool(struct smalloc_pool *spool, size_t n)
 {
 	void *r = sm_malloc_pool(spool, n);
 	if (r) memset(r, 0, n);
+	SM_TAG_CALLER(r);
 	return r;
 }
 
 void *sm_zalloc(size_t n)
 {
-	return sm_zalloc_pool(&smalloc_curr_pool, n);
+	void *r = sm_zalloc_pool(&smalloc_curr_pool, n);
+	SM_TAG_CALLER(r);
+	return r;
 }
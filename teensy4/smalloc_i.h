@@ -8,6 +8,7 @@
 #define _SMALLOC_I_H
 
 #include "smalloc.h"
+#include "heap_profile.h"
 #include <string.h>
 #include <limits.h>
 #include <errno.h>
@@ -16,14 +17,54 @@
 extern "C" {
 #endif
 
+/*
+ * Blocks are kept TLSF style (two level segregated fit): free blocks are
+ * on lists by size, found through two levels of bitmaps, so malloc and
+ * free take the same time no matter how large the pool is.  The pool
+ * starts with struct smalloc_ctl, then the blocks, then a zero size
+ * block which marks the end.
+ */
 struct smalloc_hdr {
-	size_t rsz; /* real allocated size with overhead (if any) */
+	struct smalloc_hdr *prev; /* previous block in the pool, NULL for the first */
+	size_t rsz; /* real allocated size without header, SM_FREE_BIT when free */
 	size_t usz; /* exact user size as reported by s_szalloc */
 	uintptr_t tag; /* sum of all the above, hashed value */
+#ifdef SMALLOC_CALLER
+	void *caller; /* return address of the malloc call */
+#endif
+} __attribute__((aligned(2*sizeof(void *))));
+
+/* free blocks keep their list links where the user data would be */
+struct smalloc_free {
+	struct smalloc_hdr *next;
+	struct smalloc_hdr *prev;
 };
 
+#define SM_ALIGN (2*sizeof(void *)) /* all block sizes are multiples of this */
+#define SM_FREE_BIT ((size_t)1)
+#define SM_MIN_BLOCK (sizeof(struct smalloc_free))
+#define SM_SL_LOG2 4 /* each power of 2 range is split into 16 lists */
+#define SM_SL_COUNT (1 << SM_SL_LOG2)
+#define SM_FL_SHIFT (SM_SL_LOG2 + 3) /* sizes below 128 use linear lists */
+#define SM_FL_MAX 30 /* largest block is just under 1 GByte */
+#define SM_FL_COUNT (SM_FL_MAX - SM_FL_SHIFT + 1)
+#define SM_MAX_SIZE (((size_t)1 << SM_FL_MAX) - 1)
+
+struct smalloc_ctl {
+	uintptr_t magic; /* SM_MAGIC ^ address, once initialised */
+	size_t size; /* pool_size the blocks were set up for */
+	size_t used; /* bytes in allocated blocks, with headers */
+	size_t peak; /* most bytes ever used */
+	unsigned int allocs[HEAP_PROFILE_CLASSES]; /* allocations by size class */
+	unsigned int fl_bitmap;
+	unsigned int sl_bitmap[SM_FL_COUNT];
+	struct smalloc_hdr *blocks[SM_FL_COUNT][SM_SL_COUNT];
+};
+
+#define SM_MAGIC ((uintptr_t)0x534D414CUL)
+
 #define HEADER_SZ (sizeof(struct smalloc_hdr))
-#define MIN_POOL_SZ (HEADER_SZ*20)
+#define MIN_POOL_SZ (sizeof(struct smalloc_ctl) + SM_ALIGN + HEADER_SZ*20)
 
 #define VOID_PTR(p) ((void *)p)
 #define CHAR_PTR(p) ((char *)p)
@@ -31,6 +72,19 @@ struct smalloc_hdr {
 #define HEADER_PTR(p) ((struct smalloc_hdr *)p)
 #define USER_TO_HEADER(p) (HEADER_PTR((CHAR_PTR(p)-HEADER_SZ)))
 #define HEADER_TO_USER(p) (VOID_PTR((CHAR_PTR(p)+HEADER_SZ)))
+#define FREE_LINKS(p) ((struct smalloc_free *)HEADER_TO_USER(p))
+#define BLOCK_SIZE(p) ((p)->rsz & ~SM_FREE_BIT)
+#define BLOCK_IS_FREE(p) ((p)->rsz & SM_FREE_BIT)
+#define NEXT_BLOCK(p) (HEADER_PTR((CHAR_PTR(HEADER_TO_USER(p)) + BLOCK_SIZE(p))))
+#define SM_ROUNDUP(n) (((n) + SM_ALIGN - 1) & ~(SM_ALIGN - 1))
+#define POOL_CTL(spool) ((struct smalloc_ctl *)SM_ROUNDUP(PTR_UINT((spool)->pool)))
+#define FIRST_BLOCK(ctl) (HEADER_PTR(SM_ROUNDUP(PTR_UINT(((ctl) + 1)))))
+
+#ifdef SMALLOC_CALLER
+#define SM_TAG_CALLER(p) do { if (p) USER_TO_HEADER(p)->caller = __builtin_return_address(0); } while (0)
+#else
+#define SM_TAG_CALLER(p) do { } while (0)
+#endif
 
 extern smalloc_ub_handler smalloc_UB;
 
@@ -39,6 +93,17 @@ uintptr_t smalloc_mktag(struct smalloc_hdr *shdr);
 int smalloc_verify_pool(struct smalloc_pool *spool);
 int smalloc_is_alloc(struct smalloc_pool *spool, struct smalloc_hdr *shdr);
 
+struct smalloc_ctl *smalloc_get_ctl(struct smalloc_pool *spool);
+struct smalloc_ctl *smalloc_init_ctl(struct smalloc_pool *spool);
+struct smalloc_hdr *smalloc_end_block(struct smalloc_pool *spool, size_t pool_size);
+struct smalloc_hdr *smalloc_find_free(struct smalloc_ctl *ctl, size_t size);
+void smalloc_insert_free(struct smalloc_ctl *ctl, struct smalloc_hdr *shdr);
+void smalloc_remove_free(struct smalloc_ctl *ctl, struct smalloc_hdr *shdr);
+void smalloc_split(struct smalloc_ctl *ctl, struct smalloc_hdr *shdr, size_t size);
+struct smalloc_hdr *smalloc_merge_free(struct smalloc_ctl *ctl, struct smalloc_hdr *shdr);
+void smalloc_set_alloc(struct smalloc_hdr *shdr, size_t n);
+void smalloc_count_used(struct smalloc_ctl *ctl, size_t oldsz, size_t newsz);
+
 void *sm_realloc_pool_i(struct smalloc_pool *spool, void *p, size_t n, int nomove);
 
 #ifdef __cplusplus
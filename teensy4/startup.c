@@ -715,6 +715,7 @@ extern unsigned long _heap_start;
 extern unsigned long _heap_end;
 
 char *__brkval = (char *)&_heap_start;
+char *__brkval_peak = (char *)&_heap_start; // for heap_profile_malloc()
 
 __attribute__((weak))
 void * _sbrk(int incr)
@@ -726,6 +727,7 @@ void * _sbrk(int incr)
                         return (void *)-1;
                 }
                 __brkval = prev + incr;
+                if (__brkval > __brkval_peak) __brkval_peak = __brkval;
         }
         return prev;
 }
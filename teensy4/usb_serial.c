@@ -85,6 +85,7 @@ static volatile uint8_t rx_head;
 static volatile uint8_t rx_tail;
 static uint8_t rx_list[RX_NUM + 1];
 static volatile uint32_t rx_available;
+void * volatile usb_serial_rx_event = NULL;
 static void rx_queue_transfer(int i);
 static void rx_event(transfer_t *t);
 
@@ -161,6 +162,7 @@ static void rx_event(transfer_t *t)
 				rx_count[ii] = count + len;
 				rx_available += len;
 				rx_queue_transfer(i);
+				if (usb_serial_rx_event) event_responder_trigger(usb_serial_rx_event);
 				// TODO: trigger serialEvent
 				return;
 			}
@@ -172,6 +174,7 @@ static void rx_event(transfer_t *t)
 		rx_list[head] = i;
 		rx_head = head;
 		rx_available += len;
+		if (usb_serial_rx_event) event_responder_trigger(usb_serial_rx_event);
 		// TODO: trigger serialEvent
 	} else {
 		// received a zero length packet
@@ -183,6 +186,13 @@ static void rx_event(transfer_t *t)
 
 // read a block of bytes to a buffer
 int usb_serial_read(void *buffer, uint32_t size)
+{
+	return usb_serial_read_until(buffer, size, -1);
+}
+
+// read a block of bytes to a buffer, stopping after the terminator
+// when it is 0 to 255
+int usb_serial_read_until(void *buffer, uint32_t size, int terminator)
 {
 	uint8_t *p = (uint8_t *)buffer;
 	uint32_t count=0;
@@ -196,6 +206,14 @@ int usb_serial_read(void *buffer, uint32_t size)
 		uint32_t i = rx_list[tail];
 		uint32_t len = size - count;
 		uint32_t avail = rx_count[i] - rx_index[i];
+		if (terminator >= 0) {
+			const uint8_t *data = rx_buffer + i * CDC_RX_SIZE_480 + rx_index[i];
+			const uint8_t *t = memchr(data, terminator, (avail < len) ? avail : len);
+			if (t) {
+				len = t - data + 1;
+				size = count + len;
+			}
+		}
 		 //printf("usb_serial_read, count=%d, size=%d, i=%d, index=%d, len=%d, avail=%d, c=%c\n",
 		  //count, size, i, rx_index[i], len, avail, rx_buffer[i * CDC_RX_SIZE_480]);
 		if (avail > len) {
@@ -47,6 +47,8 @@ int usb_serial_getchar(void);
 int usb_serial_peekchar(void);
 int usb_serial_available(void);
 int usb_serial_read(void *buffer, uint32_t size);
+int usb_serial_read_until(void *buffer, uint32_t size, int terminator);
+extern void * volatile usb_serial_rx_event;
 void usb_serial_flush_input(void);
 int usb_serial_putchar(uint8_t c);
 int usb_serial_write(const void *buffer, uint32_t size);
@@ -100,6 +102,9 @@ public:
 	// Reads the next received byte, or returns -1 if nothing has been received
 	// from your PC.
         virtual int read() { return usb_serial_getchar(); }
+	// Reads up to length bytes which have already been received, without
+	// waiting.  Returns the number of bytes read, zero if none.
+        virtual int read(uint8_t *buffer, size_t length) { return usb_serial_read(buffer, length); }
 	// Returns the next received byte, but does not remove it from the receive
 	// buffer.  Returns -1 if nothing has been received from your PC.
         virtual int peek() { return usb_serial_peekchar(); }
@@ -183,6 +188,14 @@ public:
 		return count;
 	}
 
+protected:
+	virtual int readUntil(char terminator, uint8_t *buffer, size_t length) {
+		return usb_serial_read_until(buffer, length, (uint8_t)terminator);
+	}
+	virtual bool setReadEvent(EventResponder *event) {
+		usb_serial_rx_event = event;
+		return true;
+	}
 };
 // Serial provides USB Virtual Serial communication with your computer.
 extern usb_serial_class Serial;
@@ -201,6 +214,7 @@ public:
         void end() { };
         virtual int available() { return 0; }
         virtual int read() { return -1; }
+        virtual int read(uint8_t *buffer, size_t length) { return 0; }
         virtual int peek() { return -1; }
         virtual void flush() { }
         virtual void clear() { }
@@ -243,6 +257,8 @@ int usb_serial2_getchar(void);
 int usb_serial2_peekchar(void);
 int usb_serial2_available(void);
 int usb_serial2_read(void *buffer, uint32_t size);
+int usb_serial2_read_until(void *buffer, uint32_t size, int terminator);
+extern void * volatile usb_serial2_rx_event;
 void usb_serial2_flush_input(void);
 int usb_serial2_putchar(uint8_t c);
 int usb_serial2_write(const void *buffer, uint32_t size);
@@ -280,6 +296,7 @@ public:
         void end() { /* TODO: flush output and shut down USB port */ };
         virtual int available() { return usb_serial2_available(); }
         virtual int read() { return usb_serial2_getchar(); }
+        virtual int read(uint8_t *buffer, size_t length) { return usb_serial2_read(buffer, length); }
         virtual int peek() { return usb_serial2_peekchar(); }
         virtual void flush() { usb_serial2_flush_output(); }  // TODO: actually wait for data to leave USB...
         virtual void clear(void) { usb_serial2_flush_input(); }
@@ -314,6 +331,14 @@ public:
                 return count;
         }
 
+protected:
+	virtual int readUntil(char terminator, uint8_t *buffer, size_t length) {
+		return usb_serial2_read_until(buffer, length, (uint8_t)terminator);
+	}
+	virtual bool setReadEvent(EventResponder *event) {
+		usb_serial2_rx_event = event;
+		return true;
+	}
 };
 extern usb_serial2_class SerialUSB1;
 #endif // __cplusplus
@@ -333,6 +358,8 @@ int usb_serial3_getchar(void);
 int usb_serial3_peekchar(void);
 int usb_serial3_available(void);
 int usb_serial3_read(void *buffer, uint32_t size);
+int usb_serial3_read_until(void *buffer, uint32_t size, int terminator);
+extern void * volatile usb_serial3_rx_event;
 void usb_serial3_flush_input(void);
 int usb_serial3_putchar(uint8_t c);
 int usb_serial3_write(const void *buffer, uint32_t size);
@@ -370,6 +397,7 @@ public:
         void end() { /* TODO: flush output and shut down USB port */ };
         virtual int available() { return usb_serial3_available(); }
         virtual int read() { return usb_serial3_getchar(); }
+        virtual int read(uint8_t *buffer, size_t length) { return usb_serial3_read(buffer, length); }
         virtual int peek() { return usb_serial3_peekchar(); }
         virtual void flush() { usb_serial3_flush_output(); }  // TODO: actually wait for data to leave USB...
         virtual void clear(void) { usb_serial3_flush_input(); }
@@ -404,6 +432,14 @@ public:
                 return count;
         }
 
+protected:
+	virtual int readUntil(char terminator, uint8_t *buffer, size_t length) {
+		return usb_serial3_read_until(buffer, length, (uint8_t)terminator);
+	}
+	virtual bool setReadEvent(EventResponder *event) {
+		usb_serial3_rx_event = event;
+		return true;
+	}
 };
 extern usb_serial3_class SerialUSB2;
 #endif // __cplusplus
@@ -35,6 +35,7 @@
 #define _UTIL_CRC16_H_
 
 #include <stdint.h>
+#include <stddef.h>
 
 static inline uint16_t _crc16_update(uint16_t crc, uint8_t data) __attribute__((always_inline, unused));
 static inline uint16_t _crc16_update(uint16_t crc, uint8_t data)
@@ -94,5 +95,68 @@ static inline uint8_t _crc_ibutton_update(uint8_t crc, uint8_t data)
 	return crc;
 }
 
+static inline uint32_t _crc32_update(uint32_t crc, uint8_t data) __attribute__((always_inline, unused));
+static inline uint32_t _crc32_update(uint32_t crc, uint8_t data)
+{
+	unsigned int i;
+
+	crc = crc ^ data;
+	for (i = 0; i < 8; i++) {
+		if (crc & 1) {
+			crc = (crc >> 1) ^ 0xEDB88320;
+		} else {
+			crc >>= 1;
+		}
+	}
+	return crc;
+}
+
+static inline uint32_t _crc32c_update(uint32_t crc, uint8_t data) __attribute__((always_inline, unused));
+static inline uint32_t _crc32c_update(uint32_t crc, uint8_t data)
+{
+	unsigned int i;
+
+	crc = crc ^ data;
+	for (i = 0; i < 8; i++) {
+		if (crc & 1) {
+			crc = (crc >> 1) ^ 0x82F63B78;
+		} else {
+			crc >>= 1;
+		}
+	}
+	return crc;
+}
+
+// Table driven versions for whole buffers, several times faster than the
+// functions above.  Each gives the same result as calling its per byte
+// function for every byte, so the initial value and final xor (eg, 0xFFFF
+// for Modbus, or 0xFFFFFFFF for both with CRC-32) are up to the caller.
+#ifdef __cplusplus
+extern "C" {
+#endif
+uint16_t crc16_update_block(uint16_t crc, const void *data, size_t len);
+uint16_t crc_xmodem_update_block(uint16_t crc, const void *data, size_t len);
+uint16_t crc_ccitt_update_block(uint16_t crc, const void *data, size_t len);
+uint32_t crc32_update_block(uint32_t crc, const void *data, size_t len);
+uint32_t crc32c_update_block(uint32_t crc, const void *data, size_t len);
+#ifdef __cplusplus
+}
+#endif
+
+// CRC-32 as used by zip, ethernet, etc, and CRC-32C (Castagnoli) as used by
+// iSCSI, ext4, etc.  To continue a CRC, pass the previous result as crc.
+// These are not named crc32() and crc32c(), which would clash with zlib.
+static inline uint32_t crc32_buffer(uint32_t crc, const void *data, size_t len) __attribute__((always_inline, unused));
+static inline uint32_t crc32_buffer(uint32_t crc, const void *data, size_t len)
+{
+	return ~crc32_update_block(~crc, data, len);
+}
+
+static inline uint32_t crc32c_buffer(uint32_t crc, const void *data, size_t len) __attribute__((always_inline, unused));
+static inline uint32_t crc32c_buffer(uint32_t crc, const void *data, size_t len)
+{
+	return ~crc32c_update_block(~crc, data, len);
+}
+
 #endif
 
@@ -32,11 +32,13 @@
 #include "EventResponder.h"
 
 uint8_t yield_active_check_flags = 0;
+struct yield_statistics_struct yield_statistics;
 
 
 void yield(void) __attribute__ ((weak));
 void yield(void)
 {
+	yield_statistics.calls++;
 	const uint8_t check_flags = yield_active_check_flags;
 	if (!check_flags) return;	// nothing to do
 
@@ -45,6 +47,7 @@ void yield(void)
 	static uint8_t running=0;
 	if (running) return; // TODO: does this need to be atomic?
 	running = 1;
+	const uint32_t begin_cycles = ARM_DWT_CYCCNT;
 
 	// USB Serial - Add hack to minimize impact...
 	if (check_flags & YIELD_CHECK_USB_SERIAL) {
@@ -71,4 +74,5 @@ void yield(void)
 	if (check_flags & YIELD_CHECK_EVENT_RESPONDER) {
 		EventResponder::runFromYield();
 	}
+	yield_statistics.cycles += ARM_DWT_CYCCNT - begin_cycles;
 };
@@ -0,0 +1,26 @@
+// Timing for the host benchmarks.  These run on the build machine, so
+// they compare algorithms and count operations; they are not Teensy
+// cycle counts.
+#pragma once
+#include <stdio.h>
+#include <time.h>
+
+static inline double bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Run f() n times, return nanoseconds per call
+template <typename F>
+double bench_ns(long n, F f)
+{
+	for (long i=0; i < n / 10; i++) f();	// warm up
+	double t = bench_now();
+	for (long i=0; i < n; i++) f();
+	return (bench_now() - t) * 1e9 / n;
+}
+
+// keep the compiler from removing a result
+static volatile long bench_sink;
@@ -0,0 +1,58 @@
+// BinaryWriter and BinaryReader throughput, with and without a buffer
+#include "Arduino.h"
+#include "BinaryStream.h"
+#include "bench.h"
+#include "memstream.h"
+
+// a small sensor sample, with its CRC
+static void record(BinaryWriter &w, uint32_t i)
+{
+	w.writeUInt32(i);
+	w.writeUInt16(i * 3);
+	w.writeFloat(i * 0.25f);
+	w.writeDouble(i * 1e-3);
+	w.writeVarint(i * 1000);
+	w.writeSignedVarint(-(int32_t)i);
+	w.writeUInt8(7);
+	w.writeCrc();
+}
+
+int main()
+{
+	const long n = 1000000;
+	MemStream s;
+	uint32_t i = 0;
+	uint8_t buf[256];
+
+	{
+		BinaryWriter w(s);
+		record(w, 1);
+	}
+	double size = s.out.size();
+	BinaryWriter unbuffered(s);
+	BinaryWriter buffered(s, buf, sizeof(buf));
+	s.out.reserve(n * 64);
+
+#define ROW(name, w) do { \
+	s.out.clear(); s.writes = 0; \
+	double t = bench_ns(n, [&]{ record(w, i++); w.resetCrc(); }); \
+	w.send(); \
+	printf("%-22s %6.1f ns/record %7.1f MB/s %6.2f writes/record\n", name, t, \
+		size * 1e3 / t, (double)s.writes / (n + n / 10)); \
+} while (0)
+
+	printf("records of %.0f bytes\n", size);
+	ROW("write, no buffer", unbuffered);
+	ROW("write, 256 byte buffer", buffered);
+
+	MemStream in(s.out);
+	BinaryReader r(in);
+	double t = bench_ns(n, [&]{
+		bench_sink += r.readUInt32() + r.readUInt16() + r.readFloat() + r.readDouble()
+			+ r.readVarint() + r.readSignedVarint() + r.readUInt8();
+		bench_sink += r.checkCrc();
+		r.resetCrc();
+	});
+	printf("%-22s %6.1f ns/record %7.1f MB/s\n", "read", t, size * 1e3 / t);
+	return 0;
+}
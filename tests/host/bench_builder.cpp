@@ -0,0 +1,35 @@
+// StringBuilder against String appends, and String::replace()
+#include "Arduino.h"
+#include "StringBuilder.h"
+#include "bench.h"
+
+int main()
+{
+	const long n = 20000;
+	const float temp = 21.5f;
+	const int id = 42;
+
+	double t = bench_ns(n, [&]{ String s = String("{\"temp\":") + String(temp, 1) + ",\"id\":" + id + '}';
+		bench_sink += s.length(); });
+	printf("%-36s %7.0f ns\n", "String + for a JSON record", t);
+	t = bench_ns(n, [&]{ String s; s.reserve(32); s += "{\"temp\":"; s += String(temp, 1);
+		s += ",\"id\":"; s += id; s += '}'; bench_sink += s.length(); });
+	printf("%-36s %7.0f ns\n", "String += after reserve", t);
+	t = bench_ns(n, [&]{ StringBuilder b(32); b.append("{\"temp\":").append(temp, 1)
+		.append(",\"id\":").append(id).append('}'); bench_sink += b.length(); });
+	printf("%-36s %7.0f ns\n", "StringBuilder", t);
+
+	String row;
+	for (int i=0; i < 3; i++) row += "<tr><td>$name</td><td>$value</td><td>$unit</td></tr>\n";
+	t = bench_ns(n, [&]{ String s = row; s.replace("$name", "temperature");
+		s.replace("$value", "21.5"); s.replace("$unit", "C"); bench_sink += s.length(); });
+	printf("%-36s %7.0f ns\n", "3 replace() on a 3 row template", t);
+
+	String many;
+	while (many.length() < 900) many += "ab,";
+	t = bench_ns(n / 10, [&]{ String s = many; s.replace(",", ";\n"); bench_sink += s.length(); });
+	printf("%-36s %7.0f ns\n", "replace() with 300 matches, longer", t);
+	t = bench_ns(n / 10, [&]{ String s = many; s.replace("ab,", "-"); bench_sink += s.length(); });
+	printf("%-36s %7.0f ns\n", "replace() with 300 matches, shorter", t);
+	return 0;
+}
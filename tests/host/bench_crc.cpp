@@ -0,0 +1,27 @@
+// util/crc16.h block functions compared with their per byte functions
+#include "Arduino.h"
+#include "util/crc16.h"
+#include "bench.h"
+
+int main()
+{
+	static uint8_t data[4096];
+	for (size_t i=0; i < sizeof(data); i++) data[i] = i * 7;
+	const long n = 20000;
+
+#define ROW(name, block, byte) do { \
+	double a = bench_ns(n, [&]{ bench_sink += block(bench_sink, data, sizeof(data)); }); \
+	double b = bench_ns(n / 10, [&]{ auto crc = block(bench_sink, data, 0); \
+		for (size_t i=0; i < sizeof(data); i++) crc = byte(crc, data[i]); \
+		bench_sink += crc; }); \
+	printf("%-8s %8.0f %8.0f MB/s\n", name, sizeof(data) * 1e3 / a, sizeof(data) * 1e3 / b); \
+} while (0)
+
+	printf("4 KB buffers    block  per byte\n");
+	ROW("crc16", crc16_update_block, _crc16_update);
+	ROW("xmodem", crc_xmodem_update_block, _crc_xmodem_update);
+	ROW("ccitt", crc_ccitt_update_block, _crc_ccitt_update);
+	ROW("crc32", crc32_update_block, _crc32_update);
+	ROW("crc32c", crc32c_update_block, _crc32c_update);
+	return 0;
+}
@@ -0,0 +1,30 @@
+// Stream find and findAny, time per byte searched
+#include "Arduino.h"
+#include <string>
+#include "bench.h"
+#include "memstream.h"
+
+int main()
+{
+	// worst case for a restarting search: many near misses
+	std::string text(65536, 'a');
+	MemStream s(text);
+	s.setTimeout(0);
+	const long n = 200;
+
+#define ROW(name, expr) do { \
+	double t = bench_ns(n, [&]{ s.pos = 0; bench_sink += (expr); }); \
+	printf("%-34s %6.2f ns/byte\n", name, t / text.size()); \
+} while (0)
+
+	std::string t8 = std::string(7, 'a') + "b";
+	std::string t64 = std::string(63, 'a') + "b";
+	std::string t200 = std::string(199, 'a') + "b";
+	const char * const four[] = {"aab", "aaab", "ba", "aaaaaab"};
+	ROW("find 8 char, no match", s.find(t8.c_str()));
+	ROW("find 64 char, no match", s.find(t64.c_str()));
+	ROW("find 200 char (memcmp), no match", s.find(t200.c_str()));
+	ROW("findUntil 8 char, no terminator", s.findUntil(t8.c_str(), "b"));
+	ROW("findAny 4 targets, no match", s.findAny(four));
+	return 0;
+}
@@ -0,0 +1,49 @@
+// Print::format compared with Print::printf and snprintf, for speed and
+// for the code each call adds.  "make bench" prints the use_ sizes.
+#include "Arduino.h"
+#include "bench.h"
+
+class Discard : public Print {
+public:
+	size_t write(uint8_t b) { bench_sink += b; return 1; }
+	size_t write(const uint8_t *b, size_t n) { bench_sink += n; return n; }
+};
+
+__attribute__((noinline)) void use_format(Print &p, int x, unsigned y, const char *s)
+{
+	p.format(FMT("x={} y={:08x} s={:<6}\n"), x, y, s);
+}
+
+__attribute__((noinline)) void use_printf(Print &p, int x, unsigned y, const char *s)
+{
+	p.printf("x=%d y=%08x s=%-6s\n", x, y, s);
+}
+
+__attribute__((noinline)) void use_format_float(Print &p, double v)
+{
+	p.format(FMT("v={:.3f}\n"), v);
+}
+
+__attribute__((noinline)) void use_printf_float(Print &p, double v)
+{
+	p.printf("v=%.3f\n", v);
+}
+
+int main()
+{
+	Discard out;
+	char buf[128];
+	const long n = 1000000;
+
+	printf("ns per call              format   printf  snprintf\n");
+	printf("%-22s %8.1f %8.1f %9.1f\n", "int, hex, string",
+		bench_ns(n, [&]{ use_format(out, 123456, 0xbeef, "abc"); }),
+		bench_ns(n, [&]{ use_printf(out, 123456, 0xbeef, "abc"); }),
+		bench_ns(n, [&]{ bench_sink += snprintf(buf, sizeof(buf),
+			"x=%d y=%08x s=%-6s\n", 123456, 0xbeef, "abc"); }));
+	printf("%-22s %8.1f %8.1f %9.1f\n", "float .3f",
+		bench_ns(n, [&]{ use_format_float(out, 3.14159); }),
+		bench_ns(n, [&]{ use_printf_float(out, 3.14159); }),
+		bench_ns(n, [&]{ bench_sink += snprintf(buf, sizeof(buf), "v=%.3f\n", 3.14159); }));
+	return 0;
+}
@@ -0,0 +1,42 @@
+// MicrosTimer with more and more timers waiting.  The queue is a sorted
+// list, so starting a timer, and restarting a repeating one after its
+// call, walk past the timers due sooner.
+#include "Arduino.h"
+#include "MicrosTimer.h"
+#include "imxrt.h"
+#include "bench.h"
+
+static const int N = 1000;
+static MicrosTimer timers[N + 1];
+
+int main()
+{
+	static const int waiting[] = {10, 100, 1000};
+	MicrosTimer::callback_t f = []{ bench_sink++; };
+
+	printf("%-36s", "ns per operation, waiting:");
+	for (int n : waiting) printf(" %8d", n);
+	printf("\n");
+
+	double start_ns[3], run_ns[3];
+	for (int k = 0; k < 3; k++) {
+		int n = waiting[k];
+		srand(1);
+		host_gpt2_cnt = 0;
+		for (int i = 0; i < n; i++) timers[i].begin(f, 1000 + rand() % 1000);
+
+		// start and end one more timer, with a deadline among the others
+		start_ns[k] = bench_ns(20000, [&]{ timers[N].beginOnce(f, 1500); timers[N].end(); });
+
+		// each interrupt: call the timer due, restart it
+		uint32_t next = GPT2_OCR1;
+		run_ns[k] = bench_ns(200000, [&]{ MicrosTimer::run(next, &next); });
+		for (int i = 0; i < n; i++) timers[i].end();
+	}
+	printf("%-36s", "beginOnce() and end()");
+	for (double t : start_ns) printf(" %8.1f", t);
+	printf("\n%-36s", "interrupt: call and restart one");
+	for (double t : run_ns) printf(" %8.1f", t);
+	printf("\n");
+	return 0;
+}
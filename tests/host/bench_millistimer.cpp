@@ -0,0 +1,60 @@
+// MillisTimer with 1000 timers: starting, ending and expiring, per timer
+#include "Arduino.h"
+#include "EventResponder.h"
+#include "bench.h"
+
+static const int N = 1000;
+static MillisTimer timers[N];
+static unsigned long ms[N];
+
+static void count(EventResponderRef event) { bench_sink++; }
+
+int main()
+{
+	EventResponder ev;
+	ev.attachImmediate(count);
+	srand(1);
+	for (int i = 0; i < N; i++) ms[i] = 100 + rand() % 5000;
+
+	// each phase timed separately, over 200 rounds
+	double insert = 0, place = 0, cancel = 0;
+	for (int round = 0; round < 220; round++) {
+		double t0 = bench_now();
+		for (int i = 0; i < N; i++) timers[i].begin(ms[i], ev);
+		double t1 = bench_now();
+		MillisTimer::runFromTimer();
+		double t2 = bench_now();
+		for (int i = 0; i < N; i++) timers[i].end();
+		double t3 = bench_now();
+		if (round < 20) continue;	// warm up
+		insert += t1 - t0;
+		place += t2 - t1;
+		cancel += t3 - t2;
+	}
+	printf("%-40s %6.1f ns\n", "begin(), 100-5100 ms", insert * 1e9 / 200 / N);
+	printf("%-40s %6.1f ns\n", "the tick placing them in the wheel", place * 1e9 / 200 / N);
+	printf("%-40s %6.1f ns\n", "end() from the wheel", cancel * 1e9 / 200 / N);
+
+	// all 1000 expiring in the same tick
+	double t = bench_ns(200, [&]{
+		for (int i = 0; i < N; i++) timers[i].begin(10, ev);
+		for (int k = 0; k < 10; k++) MillisTimer::runFromTimer();
+	});
+	printf("%-40s %6.1f ns\n", "insert + expire, same tick", t / N);
+
+	// expiring at random times, each tick of 5100 ms
+	t = bench_ns(5, [&]{
+		for (int i = 0; i < N; i++) timers[i].begin(ms[i], ev);
+		for (int k = 0; k < 5100; k++) MillisTimer::runFromTimer();
+	});
+	printf("%-40s %6.1f ns\n", "insert + expire over 5100 ticks", t / N);
+	printf("%-40s %6.1f ns\n", "  of which empty ticks, per tick", bench_ns(100000,
+		[]{ MillisTimer::runFromTimer(); }));
+
+	// 1000 repeating timers, per tick
+	for (int i = 0; i < N; i++) timers[i].beginRepeating(ms[i], ev);
+	t = bench_ns(100000, []{ MillisTimer::runFromTimer(); });
+	printf("%-40s %6.1f ns\n", "tick with 1000 repeating timers", t);
+	for (int i = 0; i < N; i++) timers[i].end();
+	return 0;
+}
@@ -0,0 +1,31 @@
+// Stream::parseArray compared with parseInt/parseFloat and strtol/strtod
+#include "Arduino.h"
+#include <string>
+#include "bench.h"
+#include "memstream.h"
+
+int main()
+{
+	const long n = 200000;
+	MemStream ints("123,-4567,89,1000000,-2,33333,4,-55555\n");
+	MemStream floats("1.5,-0.0625,3.14159,2.5e3,-7,0.001,6.02e23,42.75\n");
+
+#define ROW(name, s, expr) do { \
+	double t = bench_ns(n, [&]{ s.pos = 0; expr; }); \
+	printf("%-30s %8.1f ns per line of 8\n", name, t); \
+} while (0)
+
+	long lv[8];
+	double dv[8];
+	float fv[8];
+	ROW("parseArray(long)", ints, bench_sink += ints.parseArray(lv, 8));
+	ROW("parseInt x 8", ints, for (int i=0; i < 8; i++) bench_sink += ints.parseInt());
+	ROW("strtol x 8", ints, { const char *p = ints.in.c_str(); char *e;
+		for (int i=0; i < 8; i++) { bench_sink += strtol(p, &e, 10); p = e + 1; } });
+	ROW("parseArray(double)", floats, bench_sink += floats.parseArray(dv, 8));
+	ROW("parseArray(float)", floats, bench_sink += floats.parseArray(fv, 8));
+	ROW("parseFloat x 8", floats, for (int i=0; i < 8; i++) bench_sink += floats.parseFloat());
+	ROW("strtod x 8", floats, { const char *p = floats.in.c_str(); char *e;
+		for (int i=0; i < 8; i++) { bench_sink += strtod(p, &e); p = e + 1; } });
+	return 0;
+}
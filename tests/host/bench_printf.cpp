@@ -0,0 +1,39 @@
+// Print::printf compared with the C library's snprintf
+#include "Arduino.h"
+#include <wchar.h>
+#include <locale.h>
+#include "bench.h"
+
+class Discard : public Print {
+public:
+	size_t write(uint8_t b) { bench_sink += b; return 1; }
+	size_t write(const uint8_t *b, size_t n) { bench_sink += n; return n; }
+};
+
+int main()
+{
+	Discard out;
+	char buf[256];
+	const long n = 1000000;
+
+	setlocale(LC_ALL, "C.UTF-8");
+
+#define ROW(name, ...) do { \
+	double a = bench_ns(n, [&]{ out.printf(__VA_ARGS__); }); \
+	double b = bench_ns(n, [&]{ bench_sink += snprintf(buf, sizeof(buf), __VA_ARGS__); }); \
+	printf("%-22s %8.1f %10.1f\n", name, a, b); \
+} while (0)
+
+	printf("ns per call            Print::printf  snprintf\n");
+	ROW("text only", "hello, world\n");
+	ROW("%d", "%d", 123456);
+	ROW("%08x %5u", "%08x %5u", 0xbeefu, 42u);
+	ROW("%s %-10s", "%s %-10s", "abc", "defgh");
+	ROW("%.3f", "%.3f", 3.14159);
+	ROW("%g", "%g", 1234.5678);
+	ROW("%a", "%a", 3.14159);
+	ROW("%.2a", "%.2a", 3.14159);
+	ROW("%lc %ls", "%lc %ls", (wint_t)0xe9, L"h\xe9llo");
+	ROW("%p", "%p", (void *)0x20001234);
+	return 0;
+}
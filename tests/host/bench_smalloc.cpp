@@ -0,0 +1,43 @@
+// smalloc pool operations with more and more blocks allocated.  TLSF
+// should take the same time per operation however many there are.
+#include "Arduino.h"
+#include "smalloc.h"
+#include <vector>
+#include "bench.h"
+
+alignas(16) static char mem[8 << 20];
+
+int main()
+{
+	struct smalloc_pool pool;
+	static const int live[] = {100, 1000, 5000};
+
+	printf("%-28s", "ns per operation, live:");
+	for (int n : live) printf(" %8d", n);
+	printf("\n");
+
+#define ROW(name, body) do { \
+	printf("%-28s", name); \
+	for (int n : live) { \
+		std::vector<void *> v(n); \
+		sm_set_pool(&pool, mem, sizeof(mem), 0, NULL); \
+		srand(1); \
+		for (int i = 0; i < n; i++) v[i] = sm_malloc_pool(&pool, 16 + rand() % 1000); \
+		long ops = 0; \
+		double t = bench_ns(20, [&]{ for (int k = 0; k < 10000; k++) { body } ops++; }); \
+		printf(" %8.1f", t / 10000); \
+		for (void *p : v) sm_free_pool(&pool, p); \
+	} \
+	printf("\n"); \
+} while (0)
+
+	// free one of the live blocks and allocate again, same size class
+	ROW("rand() alone", { bench_sink += rand() % n; });
+	ROW("free + malloc 32 bytes", { int i = rand() % n; sm_free_pool(&pool, v[i]);
+		v[i] = sm_malloc_pool(&pool, 32); });
+	ROW("free + malloc 16..4096", { int i = rand() % n; sm_free_pool(&pool, v[i]);
+		v[i] = sm_malloc_pool(&pool, 16 + rand() % 4080); });
+	ROW("realloc 16..4096", { int i = rand() % n;
+		void *r = sm_realloc_pool(&pool, v[i], 16 + rand() % 4080); if (r) v[i] = r; });
+	return 0;
+}
@@ -0,0 +1,26 @@
+// Building Strings by appending: time and reallocs per String built
+#include "Arduino.h"
+#include "bench.h"
+
+int main()
+{
+	const long n = 2000;
+
+#define ROW(name, body) do { \
+	unsigned int before = String::reallocCount; \
+	double t = bench_ns(n, [&]{ body }); \
+	printf("%-32s %6.1f us %6.1f reallocs\n", name, t / 1000, \
+		(double)(String::reallocCount - before) / (n + n / 10)); \
+} while (0)
+
+	// what appending did before capacity grew geometrically
+	ROW("exact size, s += 'x' until 4096", { String s; while (s.length() < 4096) {
+		s.reserve(s.length() + 1); s += 'x'; } bench_sink += s.length(); });
+	ROW("s += 'x' until 4096", { String s; while (s.length() < 4096) s += 'x';
+		bench_sink += s.length(); });
+	ROW("s += \"{\\\"k\\\":\" 12345 \"},\"", { String s; while (s.length() < 4096) {
+		s += "{\"k\":"; s += 12345; s += "},"; } bench_sink += s.length(); });
+	ROW("reserve(4096) first", { String s; s.reserve(4096);
+		while (s.length() < 4096) s += 'x'; bench_sink += s.length(); });
+	return 0;
+}
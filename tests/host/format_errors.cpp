@@ -0,0 +1,22 @@
+// Each CASE must be a compile error which names the problem, and CASE 0
+// must compile.  The Makefile builds each one and checks the message.
+#include "Arduino.h"
+
+void format_errors(Print &p)
+{
+#if CASE == 0
+	p.format(FMT("{:255}{:.127f}"), 1, 1.0);
+#elif CASE == 1
+	p.format(FMT("{:256}"), 1);
+#elif CASE == 2
+	p.format(FMT("{:.128f}"), 1.0);
+#elif CASE == 3
+	p.format(FMT("{:99999999999}"), 1);
+#elif CASE == 4
+	p.format(FMT("{:q}"), 1);
+#elif CASE == 5
+	p.format(FMT("a}b"));
+#elif CASE == 6
+	p.format(FMT("{} {}"), 1);
+#endif
+}
@@ -0,0 +1,27 @@
+// A Stream reading from memory, for host tests of Stream's parsing code
+#pragma once
+#include "Arduino.h"
+#include <string>
+
+class MemStream : public Stream {
+public:
+	MemStream(const std::string &s = "") : in(s) { setTimeout(10); }
+	std::string in, out;
+	size_t pos = 0;
+	int reads = 0;		// calls to read(), byte or block
+	int writes = 0;		// calls to write(), byte or block
+	virtual int available() { return in.size() - pos; }
+	virtual int read() { reads++; return pos < in.size() ? (uint8_t)in[pos++] : -1; }
+	virtual int peek() { return pos < in.size() ? (uint8_t)in[pos] : -1; }
+	virtual int read(uint8_t *buffer, size_t length) {
+		reads++;
+		size_t n = in.size() - pos;
+		if (n > length) n = length;
+		memcpy(buffer, in.data() + pos, n);
+		pos += n;
+		return n;
+	}
+	virtual size_t write(uint8_t b) { writes++; out += (char)b; return 1; }
+	virtual size_t write(const uint8_t *b, size_t n) { writes++; out.append((const char *)b, n); return n; }
+	std::string rest() const { return in.substr(pos); }
+};
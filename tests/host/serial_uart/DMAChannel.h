@@ -0,0 +1,2 @@
+#pragma once
+extern "C" uint16_t dma_channel_allocated_mask;
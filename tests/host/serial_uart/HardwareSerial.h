@@ -0,0 +1,2 @@
+#pragma once
+#define SERIAL_HALF_DUPLEX 0x200
@@ -0,0 +1,12 @@
+#pragma once
+#include "kinetis.h"
+#define CORE_NUM_DIGITAL 64
+#define OUTPUT 1
+#define LOW 0
+extern volatile uint32_t sim_pcr[64];
+extern volatile uint8_t sim_out[64];
+#define portConfigRegister(pin) (&sim_pcr[(pin)])
+#define portOutputRegister(pin) (&sim_out[(pin)])
+static inline void pinMode(uint8_t, uint8_t) {}
+static inline void digitalWrite(uint8_t, uint8_t) {}
+extern "C" void yield(void);
@@ -0,0 +1,73 @@
+// host simulation stand-in for the Teensy 3 kinetis.h
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#define KINETISK
+struct Reg;
+uint8_t sim_reg_read(Reg *r);
+void sim_reg_write(Reg *r, uint8_t v);
+struct Reg {
+	uint8_t v;
+	operator uint8_t() volatile { return sim_reg_read((Reg *)this); }
+	volatile Reg & operator=(uint32_t n) volatile { sim_reg_write((Reg *)this, n); return *this; }
+	volatile Reg & operator|=(uint32_t n) volatile { sim_reg_write((Reg *)this, sim_reg_read((Reg *)this) | n); return *this; }
+	volatile Reg & operator&=(uint32_t n) volatile { sim_reg_write((Reg *)this, sim_reg_read((Reg *)this) & n); return *this; }
+};
+typedef struct {
+	Reg BDH, BDL, C1, C2, S1, S2, C3, D, MA1, MA2, C4, C5, ED, MODEM, IR, unused1,
+		PFIFO, CFIFO, SFIFO, TWFIFO, TCFIFO, RWFIFO, RCFIFO;
+} KINETISK_UART_t;
+#define UART_C1_LOOPS 0x80
+#define UART_C1_RSRC 0x20
+#define UART_C1_ILT 0x04
+#define UART_C2_TIE 0x80
+#define UART_C2_TCIE 0x40
+#define UART_C2_RIE 0x20
+#define UART_C2_ILIE 0x10
+#define UART_C2_TE 0x08
+#define UART_C2_RE 0x04
+#define UART_S1_TDRE 0x80
+#define UART_S1_TC 0x40
+#define UART_S1_RDRF 0x20
+#define UART_S1_IDLE 0x10
+#define UART_S1_OR 0x08
+#define UART_C3_ORIE 0x08
+#define UART_C5_TDMAS 0x80
+#define UART_C5_RDMAS 0x20
+#define UART_PFIFO_TXFE 0x80
+#define UART_PFIFO_RXFE 0x08
+#define UART_CFIFO_RXFLUSH 0x40
+#define UART_MODEM_TXCTSE 0x01
+#define UART_BDH_SBNS 0x20
+#define PORT_PCR_PE 2
+#define PORT_PCR_PS 1
+#define PORT_PCR_PFE 0x10
+#define PORT_PCR_SRE 4
+#define PORT_PCR_ODE 0x20
+#define PORT_PCR_DSE 0x40
+#define PORT_PCR_MUX(n) ((n) << 8)
+enum { IRQ_DMA_CH0 = 0, IRQ_UART0_STATUS = 40, IRQ_UART0_ERROR = 41, IRQ_UART2_STATUS = 44, IRQ_UART2_ERROR = 45 };
+#define DMA_NUM_CHANNELS 32
+extern uint64_t sim_nvic_enabled;
+#define NVIC_SET_PRIORITY(irq, p)
+#define NVIC_ENABLE_IRQ(irq) (sim_nvic_enabled |= (1ull << (irq)))
+#define NVIC_DISABLE_IRQ(irq) (sim_nvic_enabled &= ~(1ull << (irq)))
+#define __disable_irq()
+#define __enable_irq()
+static inline int nvic_execution_priority(void) { return 256; }
+extern void (*_VectorsRam[128])(void);
+extern volatile uint32_t SIM_SCGC4, SIM_SCGC6, SIM_SCGC7, DMA_CR, DMA_ERQ, DMA_INT;
+#define SIM_SCGC6_DMAMUX 2
+#define SIM_SCGC7_DMA 2
+#define DMA_CR_GRP1PRI 0x400
+#define DMA_CR_EMLM 0x80
+#define DMA_CR_EDBG 0x02
+extern Reg DMA_SERQ, DMA_CERQ, DMA_CERR, DMA_CEEI, DMA_CINT, DMA_CDNE;
+extern uint8_t sim_tcd[];
+#define DMA_TCD0_SADDR (*(volatile const void * volatile *)sim_tcd)
+extern volatile uint8_t sim_dmamux[32];
+#define DMAMUX0_CHCFG0 sim_dmamux[0]
+#define DMAMUX_ENABLE 128
+#define DMA_TCD_CSR_DONE 0x0080
+#define DMA_TCD_CSR_DREQ 0x0008
+#define DMA_TCD_CSR_INTMAJOR 0x0002
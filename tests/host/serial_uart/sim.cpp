@@ -0,0 +1,387 @@
+// Host simulation of teensy3/serial_uart.c: a UART with an 8 byte FIFO
+// (UART0) or none (UART2), the eDMA channels and the NVIC, enough to run
+// the driver at full line rate and count its interrupts.
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <deque>
+#include <vector>
+#include "kinetis.h"
+#include "serial_uart.h"
+
+uint64_t sim_nvic_enabled;
+void (*_VectorsRam[128])(void);
+volatile uint32_t SIM_SCGC4, SIM_SCGC6, SIM_SCGC7, DMA_CR, DMA_ERQ, DMA_INT;
+int sim_dma_stall;
+Reg DMA_SERQ, DMA_CERQ, DMA_CERR, DMA_CEEI, DMA_CINT, DMA_CDNE;
+typedef struct __attribute__((packed, aligned(4))) {
+	volatile const void * volatile SADDR;
+	int16_t SOFF; uint16_t ATTR; uint32_t NBYTES; int32_t SLAST;
+	volatile void * volatile DADDR;
+	int16_t DOFF; volatile uint16_t CITER; int32_t DLASTSGA;
+	volatile uint16_t CSR; volatile uint16_t BITER;
+} tcd_t;
+alignas(8) uint8_t sim_tcd[32 * sizeof(tcd_t)];
+#define TCD(ch) ((tcd_t *)sim_tcd + (ch))
+volatile uint8_t sim_dmamux[32];
+volatile uint32_t sim_pcr[64];
+volatile uint8_t sim_out[64];
+extern "C" { uint16_t dma_channel_allocated_mask; }
+
+struct HW {
+	KINETISK_UART_t u;
+	int fsize, irq, rxsrc, txsrc;
+	void (*isr)(void);
+	std::deque<uint8_t> tx, rx;
+	bool shifting, idle, rxseen, orflag, orread;
+	int irq_error;
+	uint8_t shift;
+	std::vector<uint8_t> sent;
+	long overrun, uart_irqs, dma_irqs, underrun;
+};
+HW hw[2];
+static int nhw = 2;
+
+static HW *owner(Reg *r)
+{
+	for (int i=0; i < nhw; i++) {
+		if ((char *)r >= (char *)&hw[i].u && (char *)r < (char *)(&hw[i].u + 1)) return &hw[i];
+	}
+	return nullptr;
+}
+static uint8_t s1(HW *h)
+{
+	KINETISK_UART_t &u = h->u;
+	uint8_t s = 0;
+	bool fifo = h->fsize > 1;
+	if (fifo ? (int)h->tx.size() <= u.TWFIFO.v : h->tx.empty()) s |= UART_S1_TDRE;
+	if (h->tx.empty() && !h->shifting) s |= UART_S1_TC;
+	int wm = fifo ? (u.RWFIFO.v ? u.RWFIFO.v : 1) : 1;
+	if ((int)h->rx.size() >= wm) s |= UART_S1_RDRF;
+	if (h->idle) s |= UART_S1_IDLE;
+	if (h->orflag) s |= UART_S1_OR;
+	return s;
+}
+uint8_t sim_reg_read(Reg *r)
+{
+	HW *h = owner(r);
+	if (!h) return r->v;
+	if (r == &h->u.S1) { h->orread = h->orflag; return s1(h); }
+	if (r == &h->u.D) {
+		h->idle = false;
+		if (h->orread) h->orflag = h->orread = false;
+		if (h->rx.empty()) { h->underrun++; return 0; }
+		uint8_t c = h->rx.front(); h->rx.pop_front(); return c;
+	}
+	if (r == &h->u.RCFIFO) return h->rx.size();
+	if (r == &h->u.TCFIFO) return h->tx.size();
+	return r->v;
+}
+void sim_reg_write(Reg *r, uint8_t v)
+{
+	HW *h = owner(r);
+	if (r == &DMA_SERQ) { DMA_ERQ |= 1u << v; return; }
+	if (r == &DMA_CERQ) { DMA_ERQ &= ~(1u << v); return; }
+	if (r == &DMA_CINT) { DMA_INT &= ~(1u << v); return; }
+	if (r == &DMA_CDNE) { TCD(v)->CSR &= ~DMA_TCD_CSR_DONE; return; }
+	if (!h) { r->v = v; return; }
+	if (r == &h->u.D) {
+		if ((int)h->tx.size() < h->fsize) h->tx.push_back(v);
+		else { fprintf(stderr, "tx fifo overflow\n"); exit(1); }
+		return;
+	}
+	if (r == &h->u.CFIFO) {
+		if (v & UART_CFIFO_RXFLUSH) { h->rx.clear(); h->idle = false; if (h->underrun) h->underrun--; } // flush recovers
+		return;
+	}
+	r->v = v;
+}
+
+static bool dma_request(int src)
+{
+	for (int i=0; i < nhw; i++) {
+		HW *h = &hw[i];
+		uint8_t c2 = h->u.C2.v, c5 = h->u.C5.v, s = s1(h);
+		if (src == h->txsrc) return (c5 & UART_C5_TDMAS) && (c2 & UART_C2_TIE) && (s & UART_S1_TDRE);
+		if (src == h->rxsrc) return (c5 & UART_C5_RDMAS) && (c2 & UART_C2_RIE) && (s & UART_S1_RDRF);
+	}
+	return false;
+}
+
+static bool dma_service(void)
+{
+	bool any = false;
+	if (sim_dma_stall) return false;
+	for (int ch=0; ch < 32; ch++) {
+		if (!(DMA_ERQ & (1u << ch))) continue;
+		if (!(sim_dmamux[ch] & DMAMUX_ENABLE)) continue;
+		if (!dma_request(sim_dmamux[ch] & 63)) continue;
+		tcd_t *t = TCD(ch);
+		Reg *sa = (Reg *)t->SADDR, *da = (Reg *)t->DADDR;
+		uint8_t b = owner(sa) ? sim_reg_read(sa) : *(volatile uint8_t *)t->SADDR;
+		if (owner(da)) sim_reg_write(da, b); else *(volatile uint8_t *)t->DADDR = b;
+		t->SADDR = (const char *)t->SADDR + t->SOFF;
+		t->DADDR = (char *)t->DADDR + t->DOFF;
+		if (--t->CITER == 0) {
+			t->SADDR = (const char *)t->SADDR + t->SLAST;
+			t->DADDR = (char *)t->DADDR + t->DLASTSGA;
+			t->CITER = t->BITER;
+			t->CSR |= DMA_TCD_CSR_DONE;
+			if (t->CSR & DMA_TCD_CSR_DREQ) DMA_ERQ &= ~(1u << ch);
+			if (t->CSR & DMA_TCD_CSR_INTMAJOR) DMA_INT |= 1u << ch;
+			if ((t->CSR & DMA_TCD_CSR_INTMAJOR) && (sim_nvic_enabled & (1ull << ch))) {
+				for (int i=0; i < nhw; i++) {
+					if (hw[i].txsrc == (sim_dmamux[ch] & 63)) hw[i].dma_irqs++;
+					if (hw[i].rxsrc == (sim_dmamux[ch] & 63)) hw[i].dma_irqs++;
+				}
+				_VectorsRam[ch + 16]();
+			}
+		}
+		any = true;
+	}
+	return any;
+}
+
+static bool uart_service(void)
+{
+	bool any = false;
+	for (int i=0; i < nhw; i++) {
+		HW *h = &hw[i];
+		if (!(sim_nvic_enabled & (1ull << h->irq))) continue;
+		uint8_t c2 = h->u.C2.v, c5 = h->u.C5.v, s = s1(h);
+		bool p = ((c2 & UART_C2_TIE) && !(c5 & UART_C5_TDMAS) && (s & UART_S1_TDRE))
+			|| ((c2 & UART_C2_TCIE) && (s & UART_S1_TC))
+			|| ((c2 & UART_C2_RIE) && !(c5 & UART_C5_RDMAS) && (s & UART_S1_RDRF))
+			|| ((c2 & UART_C2_ILIE) && (s & UART_S1_IDLE));
+		if ((h->u.C3.v & UART_C3_ORIE) && (s & UART_S1_OR) && (sim_nvic_enabled & (1ull << h->irq_error))) p = true;
+		if (p) { h->uart_irqs++; h->isr(); any = true; }
+	}
+	return any;
+}
+
+// incoming data, one byte per character time while rx_left > 0
+static const uint8_t *rx_src[2];
+static long rx_left[2], rx_pos[2];
+
+void tick(void)
+{
+	for (int n=0; n < 1000; n++) {
+		bool a = dma_service();
+		bool b = uart_service();
+		if (!a && !b) break;
+		if (n == 999) { fprintf(stderr, "interrupt storm\n"); exit(1); }
+	}
+	for (int i=0; i < nhw; i++) {
+		HW *h = &hw[i];
+		if (h->shifting) { h->sent.push_back(h->shift); h->shifting = false; }
+		if (!h->tx.empty() && (h->u.C2.v & UART_C2_TE)) {
+			h->shift = h->tx.front(); h->tx.pop_front(); h->shifting = true;
+		}
+		if (rx_left[i] > 0) {
+			uint8_t c = rx_src[i][rx_pos[i]++];
+			rx_left[i]--;
+			if (!h->orflag && (int)h->rx.size() < h->fsize) h->rx.push_back(c);
+			else { h->overrun++; h->orflag = true; }
+			h->rxseen = true;
+		} else if (h->rxseen) {
+			h->rxseen = false;
+			h->idle = true;
+		}
+	}
+}
+extern "C" void yield(void) { tick(); }
+
+// Two ports like Teensy 3.6: UART0 with FIFO (Serial1), UART2 without (Serial3)
+static volatile uint8_t txb[2][64], rxb[2][64];
+static serial_uart_state_t st[2];
+static const uint8_t pins[] = {0, 1};
+static void dma0(void);
+static void dma2(void);
+static void dmarx0(void);
+static void dmarx2(void);
+static const serial_uart_t port[2] = {
+	{ &hw[0].u, &SIM_SCGC4, 1 << 10, IRQ_UART0_STATUS, IRQ_UART0_ERROR, 64, 1, 2, 4, 0, 2, 2, 0,
+	  pins, pins, pins, 40, 24, rxb[0], txb[0], 64, 64, 2, 3, dmarx0, dma0, &st[0] },
+	{ &hw[1].u, &SIM_SCGC4, 1 << 12, IRQ_UART2_STATUS, IRQ_UART2_ERROR, 64, 0, 0, 0, 0, 2, 2, 0,
+	  pins, pins, pins, 40, 24, rxb[1], txb[1], 64, 64, 6, 7, dmarx2, dma2, &st[1] },
+};
+static void isr0(void) { serial_uart_isr(&port[0]); }
+static void isr2(void) { serial_uart_isr(&port[1]); }
+static void dma0(void) { serial_uart_dma_tx_isr(&port[0]); }
+static void dma2(void) { serial_uart_dma_tx_isr(&port[1]); }
+static void dmarx0(void) { serial_uart_dma_rx_isr(&port[0]); }
+static void dmarx2(void) { serial_uart_dma_rx_isr(&port[1]); }
+
+static void reset(void)
+{
+	for (int i=0; i < 2; i++) {
+		hw[i].tx.clear(); hw[i].rx.clear(); hw[i].sent.clear();
+		hw[i].shifting = hw[i].idle = hw[i].rxseen = hw[i].orflag = hw[i].orread = false;
+		hw[i].overrun = hw[i].uart_irqs = hw[i].dma_irqs = hw[i].underrun = 0;
+		rx_left[i] = rx_pos[i] = 0;
+	}
+}
+
+static void setup(void)
+{
+	static const int fsize[2] = {8, 1}, irq[2] = {IRQ_UART0_STATUS, IRQ_UART2_STATUS};
+	static const int irqe[2] = {IRQ_UART0_ERROR, IRQ_UART2_ERROR};
+	static void (*isr[2])(void) = {isr0, isr2};
+	for (int i=0; i < 2; i++) {
+		hw[i].fsize = fsize[i]; hw[i].irq = irq[i]; hw[i].irq_error = irqe[i]; hw[i].isr = isr[i];
+		hw[i].rxsrc = port[i].dma_rx_source; hw[i].txsrc = port[i].dma_tx_source;
+		st[i].rx_total_size = 64; st[i].tx_total_size = 64;
+		st[i].rts_low_watermark = 24; st[i].rts_high_watermark = 40;
+	}
+}
+
+static int failures;
+#define CHECK(c, ...) do { if (!(c)) { failures++; printf("FAIL: " __VA_ARGS__); printf("\n"); } } while (0)
+
+// Send and receive len bytes at once, reading every 'every' character times
+static void run(int p, int dma, long len, int chunk, int every, void *txmem, size_t txmemlen, int dir = 3)
+{
+	const serial_uart_t *s = &port[p];
+	HW *h = &hw[p];
+	std::vector<uint8_t> out(len), in(len), got;
+	for (long i=0; i < len; i++) { out[i] = rand(); in[i] = rand(); }
+	reset();
+	serial_uart_add_memory_for_write(s, txmem, txmemlen);
+	serial_uart_begin(s, 1000);
+	CHECK(serial_uart_set_dma(s, dma, dma) == 1, "set_dma");
+	long sent = 0, t = 0;
+	if (dir & 1) { rx_src[p] = in.data(); rx_left[p] = len; } else { in.clear(); }
+	if (!(dir & 2)) { out.clear(); sent = len; }
+	uint8_t buf[300];
+	while (got.size() < in.size() || st[p].transmitting || sent < len) {
+		if (sent < len) {
+			int n = (len - sent < chunk) ? len - sent : chunk;
+			int space = serial_uart_write_buffer_free(s);
+			if (n > space && space > 0) n = space;
+			if (space > 0) { serial_uart_write(s, out.data() + sent, n); sent += n; }
+		}
+		tick();
+		if (++t % every == 0) {
+			int n = serial_uart_read(s, buf, sizeof(buf));
+			got.insert(got.end(), buf, buf + n);
+		}
+		if (t > len * 20 + 1000) { printf("timeout\n"); break; }
+	}
+	serial_uart_flush(s);
+	uint32_t irqs, bytes;
+	serial_uart_interrupt_stats(s, &irqs, &bytes);
+	serial_uart_end(s);
+	serial_uart_set_dma(s, 0, 0);
+	serial_uart_add_memory_for_write(s, nullptr, 0);
+	CHECK(h->sent == out, "tx data port %d dma %d", p, dma);
+	CHECK(got == in, "rx data port %d dma %d (%zu of %ld)", p, dma, got.size(), len);
+	CHECK(h->overrun == 0 && h->underrun == 0, "overrun %ld underrun %ld", h->overrun, h->underrun);
+	CHECK(dma_channel_allocated_mask == 0, "channels leaked");
+	printf("%-8s %-4s %-5s chunk %3d read/%2d txmem %4zu: %6.1f irq/KB (uart %ld, dma %ld), driver %u irq %u bytes\n",
+		p ? "no FIFO" : "FIFO", dma ? "DMA" : "irq", dir == 1 ? "rx" : dir == 2 ? "tx" : "rx+tx",
+		chunk, every, txmemlen,
+		(h->uart_irqs + h->dma_irqs) * 1024.0 / ((dir == 3 ? 2 : 1) * len), h->uart_irqs, h->dma_irqs, irqs, bytes);
+}
+
+// Switch to and from DMA while received data waits in the buffer
+static void switch_test(int p)
+{
+	const serial_uart_t *s = &port[p];
+	std::vector<uint8_t> in(300), got;
+	uint8_t buf[300];
+	for (auto &c : in) c = rand();
+	reset();
+	serial_uart_begin(s, 1000);
+	rx_src[p] = in.data();
+	for (int step=0; step < 10; step++) {
+		rx_left[p] = 30;
+		for (int t=0; t < 40; t++) tick();
+		CHECK(serial_uart_set_dma(s, step % 3 != 2, step & 1) == 1, "set_dma");
+		serial_uart_write(s, "ab", 2);
+		for (int t=0; t < 5; t++) tick();
+		int n = serial_uart_read(s, buf, sizeof(buf));
+		got.insert(got.end(), buf, buf + n);
+	}
+	int n = serial_uart_read(s, buf, sizeof(buf));
+	got.insert(got.end(), buf, buf + n);
+	serial_uart_end(s);
+	serial_uart_set_dma(s, 0, 0);
+	for (size_t i=0; i < got.size(); i++) if (got[i] != in[i]) { printf("diverge at %zu\n", i); break; }
+	CHECK(got == in, "switch port %d (%zu)", p, got.size());
+	CHECK(hw[p].sent.size() == 20, "switch tx %zu", hw[p].sent.size());
+	CHECK(dma_channel_allocated_mask == 0, "channels leaked");
+}
+
+// Receive without reading: DMA laps over unread data, the driver keeps the
+// newest 63 bytes and counts the rest.  Then stall the DMA so the UART
+// overruns, and check the error interrupt restarts receiving.
+static void lap_test(int p)
+{
+	const serial_uart_t *s = &port[p];
+	std::vector<uint8_t> in(1000), got;
+	uint8_t buf[300];
+	uint32_t ov, dr;
+	for (auto &c : in) c = rand();
+	reset();
+	serial_uart_begin(s, 1000);
+	CHECK(serial_uart_set_dma(s, 1, 0) == 1, "set_dma");
+	rx_src[p] = in.data();
+	rx_left[p] = 20;
+	for (int t=0; t < 25; t++) tick();
+	int n = serial_uart_read(s, buf, 5);
+	got.assign(buf, buf + n);
+	rx_left[p] = 180;	// 15 unread + 180 > 63
+	for (int t=0; t < 200; t++) tick();
+	CHECK(serial_uart_available(s) == 63, "lap available %d", serial_uart_available(s));
+	serial_uart_rx_stats(s, &ov, &dr);
+	CHECK(ov == 0 && dr == 15 + 180 - 63, "lap dropped %u overruns %u", dr, ov);
+	n = serial_uart_read(s, buf, sizeof(buf));
+	CHECK(n == 63 && memcmp(buf, in.data() + 200 - 63, 63) == 0, "lap newest data %d", n);
+	// exactly a full buffer, then exactly one more
+	rx_left[p] = 63;
+	for (int t=0; t < 70; t++) tick();
+	n = serial_uart_read(s, buf, sizeof(buf));
+	CHECK(n == 63 && memcmp(buf, in.data() + 200, 63) == 0, "full buffer %d", n);
+	rx_left[p] = 64;
+	for (int t=0; t < 70; t++) tick();
+	n = serial_uart_read(s, buf, sizeof(buf));
+	serial_uart_rx_stats(s, &ov, &dr);
+	CHECK(n == 63 && memcmp(buf, in.data() + 264, 63) == 0 && dr == 15 + 180 - 63 + 1, "one over %d %u", n, dr);
+	// stall the DMA: the hardware overruns and stops receiving until cleared
+	sim_dma_stall = 1;
+	rx_left[p] = 20;
+	for (int t=0; t < 20; t++) tick();
+	sim_dma_stall = 0;
+	rx_left[p] = 30;
+	for (int t=0; t < 40; t++) tick();
+	serial_uart_rx_stats(s, &ov, &dr);
+	n = serial_uart_read(s, buf, sizeof(buf));
+	CHECK(ov >= 1, "overrun not counted");
+	CHECK(n >= 29 && memcmp(buf + n - 29, in.data() + 327 + 20 + 1, 29) == 0, "after overrun %d", n);
+	printf("%-8s lap and overrun: dropped %u, overruns %u, dma irqs %ld, uart irqs %ld\n",
+		p ? "no FIFO" : "FIFO", dr, ov, hw[p].dma_irqs, hw[p].uart_irqs);
+	serial_uart_end(s);
+	serial_uart_set_dma(s, 0, 0);
+	CHECK(dma_channel_allocated_mask == 0, "channels leaked");
+}
+
+int main()
+{
+	static uint8_t txmem[1000];
+	setup();
+	srand(1);
+	for (int p=0; p < 2; p++) {
+		for (int dma=0; dma < 2; dma++) {
+			run(p, dma, 65536, 256, 16, nullptr, 0, 1);
+			run(p, dma, 65536, 256, 48, nullptr, 0, 1);
+			run(p, dma, 65536, 256, 16, nullptr, 0, 2);
+			run(p, dma, 65536, 64, 64, nullptr, 0, 2);
+			run(p, dma, 65536, 256, 16, txmem, sizeof(txmem), 2);
+			run(p, dma, 65536, 7, 16, nullptr, 0, 3);
+		}
+	}
+	for (int p=0; p < 2; p++) switch_test(p);
+	for (int p=0; p < 2; p++) lap_test(p);
+	printf("failures %d\n", failures);
+	return failures != 0;
+}
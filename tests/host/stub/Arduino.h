@@ -0,0 +1,19 @@
+// Host stand-in for the Arduino.h which core .cpp files include
+#pragma once
+#include <string.h>
+#include <math.h>
+#include "Print.h"
+#include "Stream.h"
+
+// the core_pins.h and imxrt.h names EventResponder uses
+extern "C" uint8_t yield_active_check_flags;
+#define YIELD_CHECK_EVENT_RESPONDER 0x04
+extern "C" void (* _VectorsRam[])(void);
+extern volatile uint32_t SCB_SHPR3, SCB_ICSR, ARM_DWT_CYCCNT;
+#define SCB_ICSR_PENDSVSET ((uint32_t)(1<<28))
+
+class HostSerial : public Print {
+public:
+	virtual size_t write(uint8_t b) { return 1; }
+};
+extern HostSerial Serial;
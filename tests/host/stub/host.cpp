@@ -0,0 +1,45 @@
+// Host versions of the few functions core code calls from elsewhere
+#include "Arduino.h"
+
+HostSerial Serial;
+uint32_t host_us;
+uint32_t host_primask;
+uint32_t host_yields;
+uint32_t host_wfis;
+uint32_t host_sleep_us;
+uint32_t host_irq_at = UINT32_MAX;
+void (*host_irq)(void);
+volatile uint32_t SCB_SHPR3, SCB_ICSR, ARM_DWT_CYCCNT;
+uint8_t host_nvic_enabled[256], host_nvic_pending[256], host_nvic_priority[256];
+volatile uint32_t CCM_CCGR0, GPT2_CR, GPT2_PR, GPT2_SR, GPT2_IR, GPT2_OCR1;
+uint32_t host_gpt2_cnt, host_gpt2_step;
+
+static void host_advance(uint32_t us)
+{
+	host_us += us;
+	if (host_us >= host_irq_at) {
+		host_irq_at = UINT32_MAX;
+		if (host_irq) host_irq();
+	}
+}
+
+extern "C" {
+uint8_t yield_active_check_flags;
+void (* _VectorsRam[256])(void);
+volatile uint32_t systick_millis_count;
+volatile uint32_t systick_cycle_count;
+uint32_t systick_safe_read;
+uint32_t millis(void) { return host_us / 1000; }
+uint32_t micros(void) { return host_us; }
+void yield(void) { host_yields++; host_advance(1); }
+void host_wfi(void)
+{
+	uint32_t wake = (host_us / 1000 + 1) * 1000;
+	if (host_irq_at < wake) wake = host_irq_at;
+	host_wfis++;
+	host_sleep_us += wake - host_us;
+	host_advance(wake - host_us);
+}
+char * itoa(int val, char *buf, int radix) { return ltoa(val, buf, radix); }
+char * utoa(unsigned int val, char *buf, int radix) { return ultoa(val, buf, radix); }
+}
@@ -0,0 +1,39 @@
+// Included first in every host build of teensy4 code (gcc -include).
+// Print.h overloads both long and int64_t, which are different types on
+// ARM but the same type on 64 bit Linux, so the 64 bit types are made
+// long long here as they are on the Teensy.  newlib's itoa and utoa,
+// which glibc lacks, are in host.cpp.  Time only moves when code waits:
+// each yield() takes 1 us, and wfi sleeps until the next millisecond
+// (SysTick) or host_irq_at, when host_irq() is called as an interrupt.
+#include <stdint.h>
+#include <inttypes.h>
+#include <stddef.h>
+#ifdef __cplusplus
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#endif
+#define int64_t long long
+#define uint64_t unsigned long long
+#ifdef __cplusplus
+extern "C" {
+#endif
+char * itoa(int val, char *buf, int radix);
+char * utoa(unsigned int val, char *buf, int radix);
+uint32_t millis(void);
+uint32_t micros(void);
+void yield(void);
+extern uint32_t host_us;	// the time micros() returns
+extern uint32_t host_primask;	// 1 while interrupts are disabled
+extern uint32_t host_yields;	// number of yield() calls
+extern uint32_t host_wfis;	// number of times the CPU slept
+extern uint32_t host_sleep_us;	// total time asleep in wfi
+extern uint32_t host_irq_at;	// when host_irq() runs
+extern void (*host_irq)(void);
+void host_wfi(void);
+static inline void host_dsb(void) { }
+#define __disable_irq() (host_primask = 1)
+#define __enable_irq() (host_primask = 0)
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,29 @@
+// Host stand-in for imxrt.h, with the GPT2 and NVIC names MicrosTimer
+// uses.  The registers are plain variables.  Each read of GPT2_CNT moves
+// the count forward by host_gpt2_step, as the timer counts while code
+// runs.  NVIC state is one byte per IRQ number.
+#pragma once
+#include <stdint.h>
+
+enum IRQ_NUMBER_t { IRQ_GPT2 = 101 };
+extern "C" void (* _VectorsRam[])(void);
+static inline void attachInterruptVector(IRQ_NUMBER_t irq, void (*function)(void)) { _VectorsRam[irq + 16] = function; }
+
+extern uint8_t host_nvic_enabled[256], host_nvic_pending[256], host_nvic_priority[256];
+#define NVIC_ENABLE_IRQ(n)		(host_nvic_enabled[n] = 1)
+#define NVIC_SET_PENDING(n)		(host_nvic_pending[n] = 1)
+#define NVIC_SET_PRIORITY(n, p)		(host_nvic_priority[n] = (p))
+
+extern volatile uint32_t CCM_CCGR0;
+#define CCM_CCGR_ON			3
+#define CCM_CCGR0_GPT2_SERIAL(n)	((uint32_t)(((n) & 0x03) << 26))
+#define CCM_CCGR0_GPT2_BUS(n)		((uint32_t)(((n) & 0x03) << 24))
+
+extern volatile uint32_t GPT2_CR, GPT2_PR, GPT2_SR, GPT2_IR, GPT2_OCR1;
+extern uint32_t host_gpt2_cnt, host_gpt2_step;
+#define GPT2_CNT			(host_gpt2_cnt += host_gpt2_step)
+#define GPT_CR_FRR			((uint32_t)(1<<9))
+#define GPT_CR_CLKSRC(n)		((uint32_t)(((n) & 0x07) << 6))
+#define GPT_CR_EN			((uint32_t)(1<<0))
+#define GPT_SR_OF1			((uint32_t)(1<<0))
+#define GPT_IR_OF1IE			((uint32_t)(1<<0))
@@ -0,0 +1,8 @@
+// Minimal checks for the host tests: count failures, print each one
+#pragma once
+#include <stdio.h>
+
+static int test_failures;
+#define CHECK(c, ...) do { if (!(c)) { test_failures++; \
+	printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } } while (0)
+#define TEST_RESULT() (printf("%s\n", test_failures ? "FAILED" : "ok"), test_failures != 0)
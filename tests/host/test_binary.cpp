@@ -0,0 +1,152 @@
+// BinaryWriter and BinaryReader round trips, over a memory-backed Stream
+#include "Arduino.h"
+#include "BinaryStream.h"
+#include <string>
+#include <float.h>
+#include <limits.h>
+#include "test.h"
+#include "memstream.h"
+
+static const uint64_t varints[] = {0, 1, 127, 128, 16383, 16384, 0xFFFFFFFF,
+	0x100000000ULL, 0x7FFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL};
+static const int64_t svarints[] = {0, -1, 1, -64, 64, -65, INT32_MIN, INT64_MAX, INT64_MIN};
+
+static void write_record(BinaryWriter &w)
+{
+	w.writeUInt8(0xAB);
+	w.writeInt8(-2);
+	w.writeUInt16(0xBEEF);
+	w.writeInt16(-30000);
+	w.writeUInt32(0xDEADBEEF);
+	w.writeInt32(INT32_MIN);
+	w.writeUInt64(0x0123456789ABCDEFULL);
+	w.writeInt64(-5);
+	w.writeFloat(3.14159f);
+	w.writeFloat(-FLT_MAX);
+	w.writeDouble(2.718281828459045);
+	w.writeDouble(DBL_MIN);
+	for (uint64_t v : varints) w.writeVarint(v);
+	for (int64_t v : svarints) w.writeSignedVarint(v);
+	w.writeBlob("hello", 5);
+	w.writeBlob(nullptr, 3);
+	w.writeCrc();
+}
+
+static bool read_record(BinaryReader &r)
+{
+	bool ok = r.readUInt8() == 0xAB && r.readInt8() == -2 && r.readUInt16() == 0xBEEF
+		&& r.readInt16() == -30000 && r.readUInt32() == 0xDEADBEEF
+		&& r.readInt32() == INT32_MIN && r.readUInt64() == 0x0123456789ABCDEFULL
+		&& r.readInt64() == -5 && r.readFloat() == 3.14159f && r.readFloat() == -FLT_MAX
+		&& r.readDouble() == 2.718281828459045 && r.readDouble() == DBL_MIN;
+	for (uint64_t v : varints) if (r.readVarint() != v) ok = false;
+	for (int64_t v : svarints) if (r.readSignedVarint() != v) ok = false;
+	char blob[8] = {0};
+	if (r.readBlob(blob, sizeof(blob)) != 5 || strcmp(blob, "hello") != 0) ok = false;
+	if (r.readBlob(blob, sizeof(blob)) != 0) ok = false;
+	return ok && r.checkCrc() && !r.error();
+}
+
+int main()
+{
+	// round trip, unbuffered and through a buffer
+	MemStream unbuffered;
+	{
+		BinaryWriter w(unbuffered);
+		write_record(w);
+		CHECK(w.buffered() == 0 && w.send() == 0, "nothing buffered");
+	}
+	CHECK(unbuffered.writes > 30, "unbuffered writes %d", unbuffered.writes);
+	MemStream buffered;
+	uint8_t buf[256];
+	{
+		BinaryWriter w(buffered, buf, sizeof(buf));
+		write_record(w);
+		CHECK(buffered.writes == 0 && w.buffered() == unbuffered.out.size(), "buffered %zu",
+			w.buffered());
+		CHECK(w.send() == unbuffered.out.size() && buffered.writes == 1, "send");
+		w.resetCrc();
+		write_record(w);
+	}
+	CHECK(buffered.writes == 2, "destructor sends: %d writes", buffered.writes);
+	CHECK(buffered.out == unbuffered.out + unbuffered.out, "same bytes either way");
+	{
+		MemStream s(buffered.out);
+		BinaryReader r(s);
+		CHECK(read_record(r), "first record");
+		r.resetCrc();
+		CHECK(read_record(r), "second record");
+		CHECK(s.rest() == "", "all read");
+	}
+
+	// exact encodings: little endian, LEB128, zigzag, crc after the bytes
+	{
+		MemStream s;
+		BinaryWriter w(s);
+		w.writeUInt32(0x04030201);
+		w.writeVarint(300);
+		w.writeSignedVarint(-3);
+		w.writeCrc();
+		CHECK(s.out.substr(0, 7) == std::string("\x01\x02\x03\x04\xAC\x02\x05", 7),
+			"encoding");
+		// CRC-16/MODBUS of the 7 bytes, low byte first
+		uint16_t crc = 0xFFFF;
+		for (int i=0; i < 7; i++) {
+			crc ^= (uint8_t)s.out[i];
+			for (int b=0; b < 8; b++) crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+		}
+		CHECK((uint8_t)s.out[7] == (crc & 0xFF) && (uint8_t)s.out[8] == (crc >> 8), "crc");
+	}
+
+	// a writer buffer smaller than a record: full buffers and large
+	// blobs go out as they come, and the bytes are unchanged
+	{
+		MemStream s;
+		uint8_t small[8];
+		std::string big(100, 'b');
+		{
+			BinaryWriter w(s, small, sizeof(small));
+			write_record(w);
+			w.writeBlob(big.data(), big.size());
+		}
+		MemStream in(s.out);
+		BinaryReader r(in);
+		char blob[100];
+		CHECK(read_record(r) && r.readBlob(blob, sizeof(blob)) == 100
+			&& memcmp(blob, big.data(), 100) == 0 && !r.error(), "small buffer");
+		CHECK(s.writes < unbuffered.writes, "small buffer writes %d", s.writes);
+	}
+
+	// errors: corrupted data, short data, oversized blob, bad varint
+	{
+		for (size_t i=0; i < unbuffered.out.size(); i++) {
+			MemStream s(unbuffered.out);
+			s.in[i] ^= 0x10;
+			BinaryReader r(s);
+			CHECK(!read_record(r), "corrupt byte %zu not detected", i);
+		}
+		MemStream s(unbuffered.out.substr(0, 20));
+		BinaryReader r(s);
+		CHECK(!read_record(r) && r.error(), "short");
+		CHECK(r.readUInt32() == 0 && r.error(), "read past the end");
+		r.clearError();
+		CHECK(!r.error(), "clearError");
+
+		MemStream s2;
+		BinaryWriter w(s2);
+		w.writeBlob("0123456789", 10);
+		w.writeUInt8(42);
+		MemStream in(s2.out);
+		BinaryReader r2(in);
+		char blob[4];
+		CHECK(r2.readBlob(blob, 4) == 4 && memcmp(blob, "0123", 4) == 0 && r2.error(),
+			"oversized blob");
+		r2.clearError();
+		CHECK(r2.readUInt8() == 42 && !r2.error(), "rest of an oversized blob skipped");
+
+		MemStream s3(std::string(11, '\x80') + "\x01");
+		BinaryReader r3(s3);
+		CHECK(r3.readVarint() == 0 && r3.error(), "varint longer than 10 bytes");
+	}
+	return TEST_RESULT();
+}
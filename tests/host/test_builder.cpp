@@ -0,0 +1,122 @@
+// StringBuilder, and String::replace() against std::string
+#include "Arduino.h"
+#include "StringBuilder.h"
+#include <string>
+#include "test.h"
+
+// The test links with --wrap=malloc,--wrap=realloc, so an allocation can
+// be made to fail
+static bool alloc_fails;
+extern "C" void *__real_malloc(size_t size);
+extern "C" void *__real_realloc(void *ptr, size_t size);
+extern "C" void *__wrap_malloc(size_t size) { return alloc_fails ? NULL : __real_malloc(size); }
+extern "C" void *__wrap_realloc(void *ptr, size_t size) { return alloc_fails ? NULL : __real_realloc(ptr, size); }
+
+static std::string replaced(std::string s, const std::string &find, const std::string &with)
+{
+	if (find.empty()) return s;
+	for (size_t i = 0; (i = s.find(find, i)) != std::string::npos; i += with.size()) {
+		s.replace(i, find.size(), with);
+	}
+	return s;
+}
+
+// a String with the same bytes, NULs included
+static String S(const std::string &s)
+{
+	return String(StringView(s.data(), s.size()));
+}
+
+int main()
+{
+	// appending text and numbers, the same as String
+	{
+		StringBuilder b(64);
+		b.append("{\"temp\":").append(21.5f, 1).append(",\"id\":").append(42).append('}');
+		CHECK(b.str() == "{\"temp\":21.5,\"id\":42}", "append: %s", b.c_str());
+		b.append(255, HEX).append(' ').append(-7L).append(' ').append(4000000000UL);
+		CHECK(b.str().endsWith("}FF -7 4000000000"), "append formats: %s", b.c_str());
+		CHECK(b.length() == b.str().length() && !b.getWriteError(), "length");
+		b.printf("%d-%s", 3, "x");
+		CHECK(b.str().endsWith("3-x"), "printf: %s", b.c_str());
+	}
+
+	// release() moves the String out, leaving the builder empty
+	{
+		StringBuilder b;
+		b.append("a long enough text to be on the heap ").append(12345);
+		const char *p = b.c_str();
+		String s = b.release();
+		CHECK(s == "a long enough text to be on the heap 12345" && s.c_str() == p,
+			"release without copying");
+		CHECK(b.length() == 0 && b.c_str()[0] == 0, "empty after release");
+		b.append("again");
+		CHECK(b.str() == "again", "usable after release");
+		b.clear();
+		CHECK(b.length() == 0, "clear");
+	}
+
+	// when the String can not grow, write() returns 0 and sets the error,
+	// and the text already there is kept
+	{
+		StringBuilder b;
+		std::string full(STRING_SSO_SIZE - 1, 'k');	// fills the String's inline space
+		b.append(full.c_str());
+		alloc_fails = true;
+		size_t n = b.print("does not fit");
+		size_t c = b.write('!');
+		alloc_fails = false;
+		CHECK(n == 0 && c == 0 && b.getWriteError(), "out of memory: wrote %zu %zu", n, c);
+		CHECK(b.str() == full.c_str(), "out of memory keeps the text: %s", b.c_str());
+		b.clearWriteError();
+		CHECK(b.print("!") == 1 && b.str() == (full + "!").c_str() && !b.getWriteError(),
+			"after the error");
+
+		// lengths String can never hold; the data is not read
+		const uint8_t *nowhere = (const uint8_t *)1;
+		CHECK(b.write(nowhere, 0x80000000u) == 0 && b.getWriteError(), "2 GB write");
+		b.clearWriteError();
+		CHECK(b.write(nowhere, (unsigned int)-1) == 0 && b.getWriteError(), "length wraps");
+		CHECK(b.str() == (full + "!").c_str(), "unchanged: %s", b.c_str());
+		CHECK(b.write(nowhere, 0) == 0, "empty write");
+	}
+
+	// replace(), with more matches than the STRING_REPLACE_MATCHES it
+	// remembers, embedded NULs, and the String itself as an argument
+	{
+		String s;
+		for (int i=0; i < 40; i++) s += "<td>$v</td>";
+		std::string r(s.c_str());
+		s.replace("$v", "value");
+		CHECK(s == replaced(r, "$v", "value").c_str(), "40 matches, longer");
+		s.replace("value", "v");
+		CHECK(s == replaced(r, "$v", "v").c_str(), "40 matches, shorter");
+
+		String z = S(std::string("a\0b\0c", 5));
+		z.replace(S(std::string(1, 0)), "--");
+		CHECK(z.length() == 7 && memcmp(z.c_str(), "a--b--c", 7) == 0, "embedded NUL");
+
+		String t("abcab");
+		t.replace(t, "x");
+		CHECK(t == "x", "find is the String: %s", t.c_str());
+		t = "ab";
+		t.replace("b", t);
+		CHECK(t == "aab", "replacement is the String: %s", t.c_str());
+	}
+
+	// random replace() against std::string, with and without spare capacity
+	srand(2);
+	for (int n=0; n < 5000; n++) {
+		std::string r, find, with;
+		for (int i = rand() % 60; i > 0; i--) r += "ab\0c"[rand() % 4];
+		for (int i = 1 + rand() % 3; i > 0; i--) find += "ab\0c"[rand() % 4];
+		for (int i = rand() % 6; i > 0; i--) with += "xy\0"[rand() % 3];
+		String s = S(r);
+		if (rand() % 2) s.reserve(r.size() * 4);
+		s.replace(S(find), S(with));
+		std::string want = replaced(r, find, with);
+		CHECK(s.length() == want.size() && memcmp(s.c_str(), want.data(), want.size()) == 0
+			&& s.c_str()[want.size()] == 0, "random replace %d", n);
+	}
+	return TEST_RESULT();
+}
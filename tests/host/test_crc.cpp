@@ -0,0 +1,54 @@
+// util/crc16.h block functions: check values, and agreement with the
+// per byte functions at every alignment
+#include "Arduino.h"
+#include "util/crc16.h"
+#include "test.h"
+
+static const char check[] = "123456789";
+
+#define KAT(name, expr, want) do { \
+	uint32_t got = (expr); \
+	CHECK(got == (want), "%s: got %08X want %08X", name, got, (uint32_t)(want)); \
+} while (0)
+
+int main()
+{
+	// the standard check values, from the CRC catalogue
+	KAT("CRC-16/ARC", crc16_update_block(0, check, 9), 0xBB3D);
+	KAT("CRC-16/MODBUS", crc16_update_block(0xFFFF, check, 9), 0x4B37);
+	KAT("CRC-16/XMODEM", crc_xmodem_update_block(0, check, 9), 0x31C3);
+	KAT("CRC-16/KERMIT", crc_ccitt_update_block(0, check, 9), 0x2189);
+	KAT("CRC-16/MCRF4XX", crc_ccitt_update_block(0xFFFF, check, 9), 0x6F91);
+	KAT("CRC-32", crc32_buffer(0, check, 9), 0xCBF43926);
+	KAT("CRC-32C", crc32c_buffer(0, check, 9), 0xE3069283);
+	KAT("CRC-32 block", ~crc32_update_block(0xFFFFFFFF, check, 9), 0xCBF43926);
+	KAT("CRC-32C block", ~crc32c_update_block(0xFFFFFFFF, check, 9), 0xE3069283);
+	KAT("CRC-32 continued", crc32_buffer(crc32_buffer(0, check, 4), check + 4, 5), 0xCBF43926);
+	KAT("CRC-32C continued", crc32c_buffer(crc32c_buffer(0, check, 1), check + 1, 8), 0xE3069283);
+	KAT("CRC-32 empty", crc32_buffer(0, check, 0), 0);
+
+	// block functions match the per byte functions for every start
+	// alignment and length, so all three loops of each are covered
+	uint8_t data[300];
+	srand(1);
+	for (size_t i=0; i < sizeof(data); i++) data[i] = rand();
+	for (int off=0; off < 8; off++) {
+		for (size_t len=0; len < 40; len++) {
+			uint16_t a = 0x1234, b = 0x1234, c = 0x1234;
+			uint32_t d = 0x89ABCDEF, e = 0x89ABCDEF;
+			for (size_t i=0; i < len; i++) {
+				a = _crc16_update(a, data[off + i]);
+				b = _crc_xmodem_update(b, data[off + i]);
+				c = _crc_ccitt_update(c, data[off + i]);
+				d = _crc32_update(d, data[off + i]);
+				e = _crc32c_update(e, data[off + i]);
+			}
+			CHECK(crc16_update_block(0x1234, data + off, len) == a, "crc16 %d %zu", off, len);
+			CHECK(crc_xmodem_update_block(0x1234, data + off, len) == b, "xmodem %d %zu", off, len);
+			CHECK(crc_ccitt_update_block(0x1234, data + off, len) == c, "ccitt %d %zu", off, len);
+			CHECK(crc32_update_block(0x89ABCDEF, data + off, len) == d, "crc32 %d %zu", off, len);
+			CHECK(crc32c_update_block(0x89ABCDEF, data + off, len) == e, "crc32c %d %zu", off, len);
+		}
+	}
+	return TEST_RESULT();
+}
@@ -0,0 +1,119 @@
+// Stream find, findUntil and findAny, over a memory-backed Stream
+#include "Arduino.h"
+#include <string>
+#include "test.h"
+#include "memstream.h"
+
+// naive search for what find() should do: consume through the first match
+static bool reference(const std::string &in, const std::string &target, size_t &end)
+{
+	size_t i = in.find(target);
+	end = (i == std::string::npos) ? in.size() : i + target.size();
+	return i != std::string::npos;
+}
+
+static void FIND(const std::string &in, const std::string &t)
+{
+	MemStream s(in);
+	size_t end;
+	bool want = reference(in, t, end);
+	bool got = s.find(t.data(), t.size());
+	CHECK(got == want && s.pos == end, "find %.40s in %.40s: got %d at %zu, want %d at %zu",
+		t.c_str(), in.c_str(), got, s.pos, want, end);
+}
+
+#define UNTIL(in, target, term, want, left) do { \
+	MemStream s(in); \
+	bool got = s.findUntil(target, term); \
+	CHECK(got == want && s.rest() == left, "findUntil %s %s in %s: got %d rest [%s]", \
+		target, term, in, got, s.rest().c_str()); \
+} while (0)
+
+#define ANY(in, want, left, ...) do { \
+	MemStream s(in); \
+	const char * const targets[] = {__VA_ARGS__}; \
+	int got = s.findAny(targets); \
+	CHECK(got == want && s.rest() == left, "findAny in %s: got %d rest [%s]", \
+		in, got, s.rest().c_str()); \
+} while (0)
+
+int main()
+{
+	// overlapping prefixes, where a naive restart would miss the match
+	FIND("aaab", "aab");
+	FIND("ababab", "abab");
+	FIND("abababc", "ababc");
+	FIND("aabaabaaab", "aabaaab");
+	FIND("xyz", "xyzz");
+	FIND("", "a");
+	FIND("abc", "c");
+	FIND("abcabd", "abd");
+
+	// targets longer than the 64 entry failure table use memcmp
+	std::string a64(64, 'a');
+	FIND(a64 + "ab", a64 + "b");
+	FIND(std::string(200, 'a') + "b", std::string(130, 'a') + "b");
+	FIND(std::string(199, 'a'), std::string(130, 'a') + "b");
+	std::string period, text;
+	for (int i=0; i < 30; i++) period += "abcab";
+	for (int i=0; i < 3; i++) text += period.substr(0, 140) + "x";
+	text += period;
+	FIND(text, period);
+	FIND(text, period.substr(0, 141));
+	for (int len = 60; len < 70; len++) {
+		FIND(std::string(len * 2, 'a') + "b" + std::string(len, 'a'),
+			std::string(len, 'a') + "b");
+	}
+
+	// randomized against the naive search, small alphabet for many overlaps
+	srand(1);
+	for (int n=0; n < 2000; n++) {
+		std::string in, t;
+		int len = rand() % 200, tlen = 1 + rand() % ((n & 1) ? 100 : 6);
+		for (int i=0; i < len; i++) in += 'a' + rand() % 2;
+		for (int i=0; i < tlen; i++) t += 'a' + rand() % 2;
+		FIND(in, t);
+	}
+
+	// the terminator stops the search, and is consumed
+	UNTIL("abc;def", "def", ";", false, "def");
+	UNTIL("abdef;", "def", ";", true, ";");
+	UNTIL("ab\r\nOK", "OK", "\r\n", false, "OK");
+	UNTIL("aaXaab", "aab", "aX", false, "aab");
+	UNTIL("ab", "abc", "", false, "");
+	UNTIL("xxxx", "", ";", true, "xxxx");
+
+	// no match before the timeout, with nothing more arriving
+	{
+		MemStream s("abc");
+		uint32_t t = millis();
+		CHECK(!s.find("abd"), "no match");
+		CHECK(millis() - t == 10, "timeout took %u ms", millis() - t);
+	}
+
+	// findAny returns the first target to complete, stopping right after it
+	ANY("ushers", 1, "rs", "he", "she", "his", "hers");
+	ANY("ahishers", 2, "hers", "he", "she", "his", "hers");
+	ANY("xhexy", 1, "xy", "hexz", "he");
+	ANY("aaaab", 0, "", "aaab", "ab");
+	ANY("abcd", 1, "d", "bcde", "bc", "abcx");
+	ANY("abc", -1, "", "x", "y");
+	ANY("abc", 1, "abc", "x", "");
+	{
+		// limits: 255 targets, and FIND_ANY_MAX_LENGTH characters in total
+		MemStream s("abc");
+		static const char * many[256];
+		for (int i=0; i < 256; i++) many[i] = "zz";
+		CHECK(s.findAny(many, 256) == -1 && s.pos == 0, "more than 255 targets");
+		many[254] = "bc";
+		CHECK(s.findAny(many, 255) == 254, "255 targets");
+		std::string big(FIND_ANY_MAX_LENGTH + 1, 'q');
+		const char * const toolong[] = {"c", big.c_str()};
+		MemStream s2("abc");
+		CHECK(s2.findAny(toolong) == -1 && s2.pos == 0, "targets longer than the limit");
+		big.pop_back();
+		const char * const fits[] = {"c", big.c_str() + 1};
+		CHECK(s2.findAny(fits) == 0, "targets at the limit");
+	}
+	return TEST_RESULT();
+}
@@ -0,0 +1,48 @@
+// Print::format against printf with the same conversions
+#include "Arduino.h"
+#include <string>
+#include "test.h"
+
+class Capture : public Print {
+public:
+	std::string s;
+	size_t write(uint8_t b) { s += (char)b; return 1; }
+	size_t write(const uint8_t *b, size_t n) { s.append((const char *)b, n); return n; }
+};
+
+#define GIVES(want, ...) do { \
+	Capture c; \
+	size_t r = c.format(__VA_ARGS__); \
+	CHECK(c.s == (want) && r == c.s.size(), "%s: got [%s] want [%s]", \
+		#__VA_ARGS__, c.s.c_str(), std::string(want).c_str()); \
+} while (0)
+
+static std::string sp(const char *fmt, ...)
+{
+	char buf[600];
+	va_list ap;
+	va_start(ap, fmt);
+	vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+	return buf;
+}
+
+int main()
+{
+	GIVES("x=42 y=-7", FMT("x={} y={}"), 42, -7);
+	GIVES(sp("%08x|%-6d|%6d", 0xbeef, 12, -12), FMT("{:08x}|{:<6}|{:6}"), 0xbeef, 12, -12);
+	GIVES("-0012|**12|12**|ff|FF|17|101", FMT("{:05}|{:*>4}|{:*<4}|{:x}|{:X}|{:o}|{:b}"),
+		-12, 12, 12, 255, 255, 15, 5);
+	GIVES(sp("%.3f|%10.2f|%e", 3.14159, -2.5, 12345.678), FMT("{:.3f}|{:10.2f}|{:e}"),
+		3.14159, -2.5, 12345.678);
+	// strings align left unless asked
+	GIVES("abc|abc  |  abc|A|{}", FMT("{}|{:5}|{:>5}|{}|{{}}"), "abc", "abc", "abc", 'A');
+
+	// the largest width and precision the items can hold
+	{
+		Capture c;
+		c.format(FMT("{:255}|{:.127f}"), 1, 0.5);
+		CHECK(c.s == sp("%255d|%.127f", 1, 0.5), "width 255, precision 127");
+	}
+	return TEST_RESULT();
+}
@@ -0,0 +1,199 @@
+// MicrosTimer on a simulated GPT2: the compare interrupt runs when the
+// count reaches GPT2_OCR1, and each call is checked against the timer's
+// deadlines
+#include "Arduino.h"
+#include "MicrosTimer.h"
+#include "imxrt.h"
+#include <vector>
+#include "test.h"
+
+struct Call { int timer; uint32_t at; };
+static std::vector<Call> calls;
+
+static void gpt2_irq()
+{
+	host_nvic_pending[IRQ_GPT2] = 0;
+	_VectorsRam[IRQ_GPT2 + 16]();
+}
+
+// count up to "end", interrupting at each compare match on the way, or
+// at once when the interrupt was set pending
+static void run_to(uint32_t end)
+{
+	for (;;) {
+		if (host_nvic_pending[IRQ_GPT2]) {
+			gpt2_irq();
+			continue;
+		}
+		uint32_t ocr = GPT2_OCR1;
+		if ((int32_t)(ocr - host_gpt2_cnt) <= 0 || (int32_t)(ocr - end) > 0) break;
+		host_gpt2_cnt = ocr;
+		gpt2_irq();
+	}
+	if ((int32_t)(end - host_gpt2_cnt) > 0) host_gpt2_cnt = end;
+}
+
+static const int N = 50;
+static MicrosTimer timers[N];
+
+static MicrosTimer::callback_t record(int i)
+{
+	return [i]{ calls.push_back({i, host_gpt2_cnt}); };
+}
+
+// calls of one timer, at start + first, + period, + 2 period ...
+static bool called_at(int i, uint32_t start, uint32_t first, uint32_t period, uint32_t until)
+{
+	uint32_t t = start + first;
+	for (const Call &c : calls) {
+		if (c.timer != i) continue;
+		if (c.at != t) return false;
+		if (!period) return timers[i].callCount() == 1;
+		t += period;
+	}
+	return (int32_t)(t - until) > 0;
+}
+
+int main()
+{
+	// one repeating timer, integer and float microseconds
+	{
+		calls.clear();
+		host_gpt2_cnt = 1000;
+		CHECK(timers[0].begin(record(0), 10), "begin");
+		CHECK(host_nvic_enabled[IRQ_GPT2] && _VectorsRam[IRQ_GPT2 + 16], "GPT2 interrupt set up");
+		CHECK(timers[0].isActive() && GPT2_OCR1 == 1000 + 240, "compare at 10 us");
+		run_to(1000 + 2400);
+		CHECK(calls.size() == 10 && called_at(0, 1000, 240, 240, 1000 + 2400), "every 240 cycles");
+		CHECK(timers[0].callCount() == 10 && timers[0].lateMax() == 0
+			&& timers[0].missedCount() == 0, "no jitter");
+		calls.clear();
+		uint32_t t = host_gpt2_cnt;
+		timers[0].begin(record(0), 12.5f);
+		run_to(t + 3000);
+		CHECK(calls.size() == 10 && called_at(0, t, 300, 300, t + 3000), "12.5 us is 300 cycles");
+		timers[0].end();
+		CHECK(!timers[0].isActive(), "ended");
+		run_to(host_gpt2_cnt + 10000);
+		CHECK(calls.size() == 10, "no calls after end()");
+	}
+
+	// periods out of range are refused
+	{
+		CHECK(!timers[1].begin(record(1), 0) && !timers[1].begin(record(1), 0.5f)
+			&& !timers[1].begin(record(1), -5) && !timers[1].begin(record(1), 90000000)
+			&& !timers[1].beginOnce(record(1), 0), "bad periods");
+		CHECK(timers[1].begin(record(1), 0.75f) && timers[1].isActive(), "18 cycles is enough");
+		timers[1].end();
+		CHECK(!timers[1].isActive(), "refused timers stay off");
+	}
+
+	// beginOnce() calls once, then is inactive
+	{
+		calls.clear();
+		uint32_t t = host_gpt2_cnt;
+		timers[2].clearStats();
+		timers[2].beginOnce(record(2), 100);
+		run_to(t + 100000);
+		CHECK(calls.size() == 1 && calls[0].at == t + 2400 && !timers[2].isActive()
+			&& timers[2].callCount() == 1, "once");
+	}
+
+	// many timers with random periods, across GPT2's wrap to 0
+	{
+		calls.clear();
+		host_gpt2_cnt = 0xFFF00000;
+		uint32_t start = host_gpt2_cnt;
+		uint32_t period[N];
+		srand(5);
+		for (int i = 0; i < N; i++) {
+			period[i] = 24 * (1 + rand() % 2000);
+			timers[i].clearStats();
+			timers[i].begin(record(i), period[i] / 24);
+		}
+		uint32_t until = start + 5000000;
+		run_to(until);
+		bool ok = true;
+		for (int i = 0; i < N; i++) {
+			ok = ok && called_at(i, start, period[i], period[i], until) && timers[i].lateMax() == 0;
+		}
+		for (size_t k = 1; k < calls.size(); k++) {
+			ok = ok && (int32_t)(calls[k].at - calls[k-1].at) >= 0;
+		}
+		CHECK(ok && calls.size() > 5000, "%zu calls of %d timers, in order and on time",
+			calls.size(), N);
+		for (int i = 0; i < N; i++) timers[i].end();
+	}
+
+	// timers due together run in the order they were started
+	{
+		calls.clear();
+		uint32_t t = host_gpt2_cnt;
+		for (int i = 0; i < 5; i++) timers[4 - i].beginOnce(record(4 - i), 50);
+		run_to(t + 1200);
+		CHECK(calls.size() == 5 && calls[0].timer == 4 && calls[4].timer == 0, "same deadline");
+	}
+
+	// a late interrupt: the calls it missed are counted, not made
+	{
+		calls.clear();
+		uint32_t t = host_gpt2_cnt;
+		timers[0].clearStats();
+		timers[0].begin(record(0), 10);
+		host_gpt2_cnt = t + 240 * 3 + 100;	// interrupts were blocked
+		gpt2_irq();
+		CHECK(calls.size() == 1 && timers[0].lateMax() == 240 * 2 + 100
+			&& timers[0].missedCount() == 2, "late by %u, missed %u", timers[0].lateMax(),
+			timers[0].missedCount());
+		CHECK(GPT2_OCR1 == t + 240 * 4, "back on the period");
+		timers[0].end();
+	}
+
+	// the count passing the next deadline while the interrupt sets the
+	// compare register: that timer runs in the same interrupt
+	{
+		calls.clear();
+		uint32_t t = host_gpt2_cnt;
+		timers[0].beginOnce(record(0), 1);
+		timers[1].beginOnce(record(1), 1.5f);
+		host_gpt2_step = 7;
+		host_gpt2_cnt = t + 24;
+		gpt2_irq();
+		host_gpt2_step = 0;
+		CHECK(calls.size() == 2 && calls[1].timer == 1, "both in one interrupt");
+	}
+
+	// starting with a deadline already passed sets the interrupt pending
+	{
+		calls.clear();
+		host_gpt2_step = 30;
+		timers[0].beginOnce(record(0), 1);
+		host_gpt2_step = 0;
+		CHECK(host_nvic_pending[IRQ_GPT2], "pending");
+		run_to(host_gpt2_cnt);
+		CHECK(calls.size() == 1, "called once pending");
+	}
+
+	// functions which end, restart or update timers
+	{
+		calls.clear();
+		uint32_t t = host_gpt2_cnt;
+		timers[1].begin(record(1), 10);
+		timers[2].begin(record(2), 10);
+		timers[0].begin([]{ calls.push_back({0, host_gpt2_cnt});
+			timers[0].end(); timers[2].end(); timers[3].beginOnce(record(3), 5); }, 5);
+		run_to(t + 240 * 3);
+		// 0 at +120 ends itself and 2, starts 3 for +240; 1 at +240, 3 at +240, 1 at +480
+		std::vector<int> order;
+		for (const Call &c : calls) order.push_back(c.timer);
+		CHECK(order == std::vector<int>({0, 1, 3, 1, 1}), "calls %zu", calls.size());
+		timers[1].update(20);
+		run_to(t + 240 * 3 + 240 + 480 * 2);
+		CHECK(calls.size() == 8 && calls[5].at == t + 240 * 4 && calls[6].at == t + 240 * 4 + 480,
+			"update() after the current interval");
+		timers[1].end();
+		uint32_t next;
+		CHECK(!MicrosTimer::run(host_gpt2_cnt, &next), "no timers waiting");
+	}
+	return TEST_RESULT();
+}
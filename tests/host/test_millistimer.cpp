@@ -0,0 +1,197 @@
+// MillisTimer's timing wheel, driven by calling runFromTimer() as SysTick
+// would, against a simple model of when each timer should fire
+#include "Arduino.h"
+#include "EventResponder.h"
+#include <vector>
+#include <algorithm>
+#include "test.h"
+
+static const int N = 1000;
+static MillisTimer timers[N];
+static unsigned long tick;		// runFromTimer() calls so far
+static std::vector<int> fired;		// timers fired this tick
+static void (*on_fire)(int i);
+
+static void record(EventResponderRef event)
+{
+	int i = (MillisTimer *)event.getData() - timers;
+	fired.push_back(i);
+	if (on_fire) on_fire(i);
+}
+
+// the model: the tick each timer fires next, 0 when off
+static unsigned long due[N], reload[N], next_due = 1;
+static bool in_tick;			// inside runFromTimer()
+static std::vector<int> want;		// timers which should fire this tick
+
+// a timer ended from an event function doesn't fire later in the tick
+static void cancel(int i)
+{
+	if (in_tick && std::find(fired.begin(), fired.end(), i) == fired.end()) {
+		want.erase(std::remove(want.begin(), want.end(), i), want.end());
+	}
+}
+
+static void start(int i, unsigned long ms, bool repeat, EventResponder &ev)
+{
+	cancel(i);
+	if (repeat) timers[i].beginRepeating(ms, ev);
+	else timers[i].begin(ms, ev);
+	// begin() between ticks fires ms ticks later, but not before the 2nd
+	// tick.  From an event function, the tick it runs in is the first.
+	due[i] = ms ? tick - in_tick + (ms > 2 ? ms : 2) : 0;
+	reload[i] = repeat ? ms : 0;
+	if (due[i] && due[i] < next_due) next_due = due[i];
+}
+
+static void stop(int i)
+{
+	cancel(i);
+	timers[i].end();
+	due[i] = 0;
+}
+
+// one tick: the timers which fired, against the model
+static bool run_tick(const char *what)
+{
+	tick++;
+	fired.clear();
+	want.clear();
+	if (tick >= next_due) {
+		next_due = ~0ul;
+		for (int i = 0; i < N; i++) {
+			if (due[i] == tick) {
+				want.push_back(i);
+				due[i] = reload[i] ? tick + reload[i] : 0;
+			}
+			if (due[i] && due[i] < next_due) next_due = due[i];
+		}
+	}
+	in_tick = true;
+	MillisTimer::runFromTimer();
+	in_tick = false;
+	std::sort(fired.begin(), fired.end());
+	if (fired == want) return true;
+	CHECK(false, "%s: tick %lu fired %zu timers (first %d), expected %zu (first %d)", what,
+		tick, fired.size(), fired.empty() ? -1 : fired[0], want.size(), want.empty() ? -1 : want[0]);
+	return false;
+}
+
+static bool run_until(unsigned long end, const char *what)
+{
+	while (tick < end) {
+		if (!run_tick(what)) return false;
+	}
+	return true;
+}
+
+static void stop_all()
+{
+	for (int i = 0; i < N; i++) stop(i);
+}
+
+// for cancelling from an event function
+static int victim, restart;
+static EventResponder *event;
+static void end_victim(int i)
+{
+	if (i == 0) {
+		stop(victim);
+		if (restart >= 0) start(restart, 5, false, *event);
+	}
+}
+
+int main()
+{
+	EventResponder ev;
+	ev.attachImmediate(record);
+	event = &ev;
+	const unsigned long span = 1ul << (MILLISTIMER_WHEEL_BITS * MILLISTIMER_WHEEL_LEVELS);
+
+	// delays on each side of every level boundary, and past the wheel's
+	// span, started at several points in the low level's cycle
+	{
+		std::vector<unsigned long> ms = {1, 2, 3, 10};
+		for (unsigned long b = MILLISTIMER_WHEEL_SLOTS; b <= span; b <<= MILLISTIMER_WHEEL_BITS) {
+			ms.push_back(b - 2);
+			ms.push_back(b - 1);
+			ms.push_back(b);
+			ms.push_back(b + 1);
+			ms.push_back(b + MILLISTIMER_WHEEL_SLOTS + 3);
+		}
+		ms.push_back(span * 2 + 12345);
+		unsigned long last = 0;
+		for (int phase = 0; phase < 6; phase++) {
+			for (size_t k = 0; k < ms.size(); k++) {
+				int i = phase * ms.size() + k;
+				start(i, ms[k], false, ev);
+				last = std::max(last, due[i]);
+			}
+			run_until(tick + 1 + phase * 7, "boundary start");
+		}
+		run_until(last + 1, "level boundaries");
+		int left = 0;
+		for (int i = 0; i < N; i++) left += due[i] != 0;
+		CHECK(left == 0, "%d boundary timers never fired", left);
+	}
+
+	// repeating timers keep their period across cascades
+	{
+		for (int i = 0; i < 50; i++) start(i, 1 + i * 97, true, ev);
+		run_until(tick + 20000, "repeating");
+		stop_all();
+		CHECK(run_until(tick + 5000, "after stopping"), "stopped timers stay stopped");
+	}
+
+	// restarting and ending timers which are waiting, active in level 0,
+	// or active in a higher level
+	{
+		start(0, 5, false, ev);
+		stop(0);
+		start(1, 5, false, ev);
+		start(1, 7, false, ev);
+		start(2, 300, false, ev);
+		run_until(tick + 3, "restart");
+		stop(2);
+		start(3, 10000, false, ev);
+		run_until(tick + 100, "restart");
+		start(3, 20, true, ev);
+		start(4, 0, false, ev);
+		run_until(tick + 12000, "restart and end");
+		stop_all();
+	}
+
+	// an event function ending timers which fire in the same tick, itself,
+	// or starting another
+	{
+		on_fire = end_victim;
+		victim = 1;
+		restart = 2;
+		start(0, 50, true, ev);
+		start(1, 50, false, ev);
+		run_until(tick + 50, "end a timer firing in the same tick");
+		CHECK(due[1] == 0 && due[2] != 0, "victim ended, other started");
+		run_until(tick + 10, "started from an event");
+		victim = 0;
+		restart = -1;
+		run_until(tick + 200, "end itself");
+		CHECK(due[0] == 0, "repeating timer ended from its own event");
+		on_fire = NULL;
+		stop_all();
+	}
+
+	// random use of all the timers against the model
+	srand(4);
+	for (int round = 0; round < 20; round++) {
+		for (int op = 0; op < 300; op++) {
+			int i = rand() % N;
+			int r = rand() % 10;
+			unsigned long ms = r < 5 ? rand() % 100 : r < 8 ? rand() % 10000 : rand() % 500000;
+			if (r == 9) stop(i);
+			else start(i, ms, rand() % 2, ev);
+		}
+		if (!run_until(tick + 1 + rand() % 3000, "random")) break;
+	}
+	stop_all();
+	return TEST_RESULT();
+}
@@ -0,0 +1,101 @@
+// Stream::parseArray over a memory-backed Stream
+#include "Arduino.h"
+#include <string>
+#include <limits.h>
+#include "test.h"
+#include "memstream.h"
+
+#define LONGS(in, want_n, want_err, left, ...) do { \
+	MemStream s(in); \
+	long v[4] = {-1, -1, -1, -1}; \
+	const long want[] = {__VA_ARGS__}; \
+	int n = s.parseArray(v, 4); \
+	bool same = true; \
+	for (int i=0; i < n && i < (int)(sizeof(want) / sizeof(long)); i++) if (v[i] != want[i]) same = false; \
+	CHECK(n == want_n && s.getReadError() == want_err && same && s.rest() == left, \
+		"parseArray [%s]: got %d err %d rest [%s]", in, n, s.getReadError(), s.rest().c_str()); \
+} while (0)
+
+int main()
+{
+	// separators, empty fields and the terminator
+	LONGS("1, 2,3\t4\nnext", 4, PARSE_OK, "next", 1, 2, 3, 4);
+	LONGS("  -7 ,, +8,\n", 2, PARSE_OK, "", -7, 8);
+	LONGS("\n5\n", 0, PARSE_OK, "5\n", 0);
+	LONGS("0\n", 1, PARSE_OK, "", 0);
+
+	// errors, which still read to the end of the line
+	LONGS("1,2,3,4,5,6\nx", 4, PARSE_TOO_MANY, "x", 1, 2, 3, 4);
+	LONGS("1,x,3\nx", 1, PARSE_INVALID, "x", 1);
+	LONGS("1,2-3,4\nx", 1, PARSE_INVALID, "x", 1);
+	LONGS("12345678901234567890123456789012345678901,2\n", 0, PARSE_INVALID, "", 0);
+	LONGS("99999999999999999999,-99999999999999999999,3\n", 3, PARSE_RANGE, "",
+		LONG_MAX, LONG_MIN, 3);
+	LONGS("1,2", 2, PARSE_TIMEOUT, "", 1, 2);
+	LONGS("", 0, PARSE_TIMEOUT, "", 0);
+
+	// a line longer than the 64 byte read buffer
+	{
+		std::string line;
+		for (int i=0; i < 4; i++) line += "      " + std::to_string(i * 1000003) + "        ,";
+		MemStream s(line + "\n");
+		long v[4];
+		int n = s.parseArray(v, 4);
+		CHECK(n == 4 && v[3] == 3000009 && s.getReadError() == 0 && s.rest() == "",
+			"long line: %d %ld", n, v[3]);
+	}
+
+	// int clamps to its own range, which differs from long here
+	{
+		MemStream s("2147483647,-2147483648,2147483648,-2147483649\n");
+		int v[4];
+		int n = s.parseArray(v, 4);
+		CHECK(n == 4 && v[0] == INT_MAX && v[1] == INT_MIN && v[2] == INT_MAX && v[3] == INT_MIN
+			&& s.getReadError() == PARSE_RANGE, "int range");
+		s.clearReadError();
+		CHECK(s.getReadError() == 0, "clearReadError");
+	}
+
+	// other separators and terminators, one line at a time
+	{
+		MemStream s("1;2;3\r4;5\r");
+		long v[3];
+		int n = s.parseArray(v, 3, ";", '\r');
+		CHECK(n == 3 && v[2] == 3, "custom separator");
+		n = s.parseArray(v, 3, ";", '\r');
+		CHECK(n == 2 && v[0] == 4 && v[1] == 5 && s.getReadError() == 0, "second line");
+		MemStream s2("1 2\n");
+		n = s2.parseArray(v, 3, nullptr);
+		CHECK(n == 0 && s2.getReadError() == PARSE_INVALID, "no separators");
+	}
+
+	// floating point, correctly rounded like strtod and strtof
+	{
+		MemStream s("1.5 -2e3\t.25,1e400,1e-400\n");
+		double v[5];
+		int n = s.parseArray(v, 5);
+		CHECK(n == 5 && v[0] == 1.5 && v[1] == -2000 && v[2] == 0.25 && isinf(v[3])
+			&& v[4] == 0 && s.getReadError() == PARSE_RANGE, "doubles: %d", n);
+		MemStream s2("1e39,3.4e38,0x10,nan\n");
+		float f[4];
+		n = s2.parseArray(f, 4);
+		CHECK(n == 4 && isinf(f[0]) && f[1] == 3.4e38f && f[2] == 16 && isnan(f[3])
+			&& s2.getReadError() == PARSE_RANGE, "floats: %d", n);
+		MemStream s3("1.2.3\n");
+		CHECK(s3.parseArray(v, 5) == 0 && s3.getReadError() == PARSE_INVALID, "1.2.3");
+	}
+	srand(1);
+	for (int i=0; i < 20000; i++) {
+		char buf[64];
+		double d = ldexp((double)rand() * rand(), rand() % 200 - 100);
+		int digits = 1 + rand() % 17;
+		snprintf(buf, sizeof(buf), "%.*g\n", digits, (i & 1) ? d : -d);
+		MemStream s(buf);
+		double v;
+		float f;
+		CHECK(s.parseArray(&v, 1) == 1 && v == strtod(buf, NULL), "double %s", buf);
+		s.pos = 0;
+		CHECK(s.parseArray(&f, 1) == 1 && f == strtof(buf, NULL), "float %s", buf);
+	}
+	return TEST_RESULT();
+}
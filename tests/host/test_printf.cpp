@@ -0,0 +1,89 @@
+// Print::printf against the C library's snprintf
+#include "Arduino.h"
+#include <string>
+#include <wchar.h>
+#include "test.h"
+
+class Capture : public Print {
+public:
+	std::string s;
+	int writes = 0;
+	size_t write(uint8_t b) { s += (char)b; writes++; return 1; }
+	size_t write(const uint8_t *b, size_t n) { s.append((const char *)b, n); writes++; return n; }
+};
+
+#define SAME(...) do { \
+	Capture c; \
+	int r = c.printf(__VA_ARGS__); \
+	char ref[512]; \
+	int rr = snprintf(ref, sizeof(ref), __VA_ARGS__); \
+	CHECK(c.s == ref && r == rr, "%s: got [%s] (%d) want [%s] (%d)", \
+		#__VA_ARGS__, c.s.c_str(), r, ref, rr); \
+} while (0)
+
+#define GIVES(want, ...) do { \
+	Capture c; \
+	c.printf(__VA_ARGS__); \
+	CHECK(c.s == want, "%s: got [%s] want [%s]", #__VA_ARGS__, c.s.c_str(), want); \
+} while (0)
+
+int main()
+{
+	// integers
+	SAME("%d %i %5d %-5d| %05d %+d % d", 42, -42, 42, 42, -42, 42, 42);
+	SAME("%x %X %#x %#o %o %08.3x|%.0d|", 255u, 255u, 255u, 8u, 0u, 10u, 0);
+	SAME("%ld %lld %lu %llx %hd %hhd %zu", -5L, -123456789012345LL, 7UL,
+		0xdeadbeefcafeULL, (int)70000, 300, (size_t)99);
+	SAME("%#x %#X %#5o", 0u, 0x1Au, 1u);
+	SAME("%-+6d|%+-6d|%hhu %hu", 5, 5, 257, 65537);
+	SAME("%*d %-*d %.*f %*.*f", 5, 1, 5, 2, 3, 1.23456, 8, 2, 3.14159);
+
+	// strings and characters
+	SAME("%s|%10s|%-10s|%.2s|%c|%-3c|", "abc", "abc", "abc", "abc", 'x', 'y');
+	SAME("%.3s|%.*s|%%|", "abcdef", -1, "xyz");
+
+	// floating point
+	SAME("%f %.2f %10.3f %-10.1f| %e %E %.3e %g %G %g %g %g", 3.14159, 2.5, -1.5,
+		2.0, 12345.678, 0.00012, 1.0, 0.0001, 1e-5, 123456.0, 1234567.0, 100.0);
+	SAME("%g %g %#g %.0f %#.0f %+f % f %08.2f %-8.2f|", 0.0, 1e100, 1.0, 3.0,
+		3.0, 1.0, 1.0, -3.14159, 3.14159);
+	SAME("%.2f %.2f %.3f %.1f", 9.995, 2.675, 1.0005, 0.05);
+	SAME("%f %F %e %010f %010e", 1.0/0.0, -1.0/0.0, 0.0/0.0, -1.0/0.0, 1.5);
+	SAME("%.10g %.17g %.1g %.3g %.0e %#.0e", 1.0/3, 0.1, 0.95, 99950.0, 12345.0, 12345.0);
+	SAME("%.20f|%.60f|%f", 0.1, 12345.0, 1e60);
+
+	// hex floating point, rounded to even like the C library
+	SAME("%a %A %a %a %a", 1.0, 1.0, 0.1, -2.5, 0.0);
+	SAME("%.0a %.1a %.3a %.13a %.20a", 1.5, 1.96875, 0.1, 0.1, 0.1);
+	SAME("%.0a %.0a %.1a", 2.5, 1.5, 1.03125);
+	SAME("%a %a %a %A", 4.9e-324, 2.2250738585072014e-308, 1e308, -1.0/0.0);
+	SAME("%20a|%-20a|%020a|%+a|% a|%#.0a", 1.0, 1.0, -1.0, 1.0, 1.0, 1.0);
+	SAME("%a %d", 0.0/0.0, 7);
+
+	// wide characters print as UTF-8, and take their argument
+	GIVES("x|   \xc3\xa9|\xe2\x82\xac|9", "%lc|%5lc|%-3lc|%d", (wint_t)'x',
+		(wint_t)0xe9, (wint_t)0x20ac, 9);
+	GIVES("abc|     h\xc3\xa9|\xe2\x82\xac     |a\xc3\xa9|a|5",
+		"%ls|%8ls|%-8ls|%.3ls|%.2ls|%d", L"abc", L"h\xe9", L"\x20ac", L"a\xe9" L"b",
+		L"a\xe9" L"b", 5);
+	GIVES("(null)|3", "%ls|%d", (wchar_t *)0, 3);
+	GIVES("Qrs1", "%C%S%d", (wint_t)'Q', L"rs", 1);
+	GIVES("\xf0\x9f\x98\x80|\xef\xbf\xbd", "%lc|%lc", (wint_t)0x1F600, (wint_t)0xD800);
+
+	// pointers, with NULL as 0x0
+	SAME("%p %d", (void *)0x1234, 5);
+	GIVES("0x0|  0x0|4", "%p|%5p|%d", (void *)0, (void *)0, 4);
+
+	// unknown conversions print as-is
+	GIVES("%y 7", "%y %d", 7);
+	GIVES("end %", "end %");
+
+	// output is collected and written in chunks
+	{
+		Capture c;
+		std::string a(100, 'a'), d(200, 'd');
+		c.printf("%s%s%s%s", a.c_str(), "b", "c", d.c_str());
+		CHECK(c.s.size() == 302 && c.writes <= 5, "%zu chars in %d writes", c.s.size(), c.writes);
+	}
+	return TEST_RESULT();
+}
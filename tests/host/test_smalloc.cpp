@@ -0,0 +1,265 @@
+// smalloc's TLSF pools: the block list and free lists are checked after
+// operations, and random use is compared with a record of each allocation
+#include "Arduino.h"
+#include "smalloc_i.h"
+#include <vector>
+#include "test.h"
+
+alignas(16) static char mem[1 << 20];
+
+static int ub_calls;
+static const void *ub_ptr;
+static void count_ub(struct smalloc_pool *spool, const void *p) { ub_calls++; ub_ptr = p; }
+
+// the list a free block of this size belongs on, as sm_tlsf.c maps it
+static void list_of(size_t size, int *fl, int *sl)
+{
+	if (size < ((size_t)1 << SM_FL_SHIFT)) {
+		*fl = 0;
+		*sl = size >> (SM_FL_SHIFT - SM_SL_LOG2);
+	} else {
+		int f = 31 - __builtin_clz((unsigned int)size);
+		*sl = (size >> (f - SM_SL_LOG2)) ^ SM_SL_COUNT;
+		*fl = f - SM_FL_SHIFT + 1;
+	}
+}
+
+// NULL if the pool is consistent, else what is wrong
+static const char *pool_error(struct smalloc_pool *spool, int *nfree = NULL)
+{
+	struct smalloc_ctl *ctl = POOL_CTL(spool);
+	struct smalloc_hdr *shdr, *prev = NULL;
+	size_t used = 0;
+	int blocks = 0, free_blocks = 0, listed = 0;
+
+	for (shdr = FIRST_BLOCK(ctl); shdr->rsz != 0; shdr = NEXT_BLOCK(shdr)) {
+		if (PTR_UINT(shdr) % SM_ALIGN || BLOCK_SIZE(shdr) % SM_ALIGN) return "misaligned block";
+		if (shdr->prev != prev) return "wrong prev link";
+		if (shdr > smalloc_end_block(spool, ctl->size)) return "block past the end";
+		if (BLOCK_IS_FREE(shdr)) {
+			if (prev && BLOCK_IS_FREE(prev)) return "two free blocks side by side";
+			if (BLOCK_SIZE(shdr) < SM_MIN_BLOCK) return "free block too small";
+			free_blocks++;
+		} else {
+			if (!smalloc_is_alloc(spool, shdr)) return "allocated block fails its tag";
+			used += HEADER_SZ + shdr->rsz;
+		}
+		prev = shdr;
+		if (++blocks > (int)(sizeof(mem) / HEADER_SZ)) return "block list loops";
+	}
+	if (shdr != smalloc_end_block(spool, ctl->size)) return "end block misplaced";
+	if (shdr->prev != prev) return "end block prev link";
+	if (used != ctl->used) return "used count";
+	if (ctl->peak < ctl->used) return "peak below used";
+
+	for (int fl = 0; fl < SM_FL_COUNT; fl++) {
+		if (!!(ctl->fl_bitmap & (1U << fl)) != !!ctl->sl_bitmap[fl]) return "first level bitmap";
+		for (int sl = 0; sl < SM_SL_COUNT; sl++) {
+			struct smalloc_hdr *b = ctl->blocks[fl][sl], *back = NULL;
+			if (!!(ctl->sl_bitmap[fl] & (1U << sl)) != !!b) return "second level bitmap";
+			for (; b; back = b, b = FREE_LINKS(b)->next) {
+				int f, s;
+				if (!BLOCK_IS_FREE(b)) return "allocated block on a free list";
+				list_of(BLOCK_SIZE(b), &f, &s);
+				if (f != fl || s != sl) return "free block on the wrong list";
+				if (FREE_LINKS(b)->prev != back) return "free list back link";
+				if (++listed > free_blocks) return "free list loops or holds extra blocks";
+			}
+		}
+	}
+	if (listed != free_blocks) return "free block missing from the lists";
+	if (nfree) *nfree = free_blocks;
+	return NULL;
+}
+
+#define POOL_OK(spool, what) do { const char *e = pool_error(spool); \
+	CHECK(!e, "%s: %s", what, e); } while (0)
+
+static size_t first_free_size(struct smalloc_pool *spool)
+{
+	return BLOCK_SIZE(FIRST_BLOCK(POOL_CTL(spool)));
+}
+
+// grows the pool by 64K at a time, up to all of mem[]
+static size_t grow_pool(struct smalloc_pool *spool, size_t n)
+{
+	size_t size = spool->pool_size + 65536;
+	return size <= sizeof(mem) ? size : 0;
+}
+
+int main()
+{
+	struct smalloc_pool pool;
+	sm_set_ub_handler(count_ub);
+
+	// setting up
+	memset(&pool, 0, sizeof(pool));
+	CHECK(!sm_set_pool(&pool, mem, 100, 0, NULL) && errno == ENOSPC, "tiny pool refused");
+	CHECK(sm_set_pool(&pool, mem, sizeof(mem), 0, NULL), "set pool");
+	POOL_OK(&pool, "new pool");
+	int nfree = 0;
+	pool_error(&pool, &nfree);
+	CHECK(nfree == 1, "a new pool is one free block, not %d", nfree);
+
+	// one block: alignment, exact size, valid pointers
+	{
+		char *p = (char *)sm_malloc_pool(&pool, 100);
+		CHECK(p && PTR_UINT(p) % SM_ALIGN == 0 && p > mem && p + 100 <= mem + sizeof(mem),
+			"malloc in the pool");
+		CHECK(sm_szalloc_pool(&pool, p) == 100, "szalloc %zu", sm_szalloc_pool(&pool, p));
+		CHECK(sm_alloc_valid_pool(&pool, p) && !sm_alloc_valid_pool(&pool, p + 16)
+			&& !sm_alloc_valid_pool(&pool, mem) && !sm_alloc_valid_pool(&pool, p + 1)
+			&& !sm_alloc_valid_pool(&pool, NULL), "alloc_valid");
+		CHECK(sm_malloc_pool(&pool, 0) != NULL, "malloc(0) succeeds");
+		POOL_OK(&pool, "two blocks");
+		CHECK(ub_calls == 0, "no UB yet");
+		sm_free_pool(&pool, p);
+		CHECK(ub_calls == 0, "free");
+		sm_free_pool(&pool, p);
+		CHECK(ub_calls == 1 && ub_ptr == p, "double free reaches the UB handler");
+		sm_free_pool(&pool, p + 16);
+		CHECK(ub_calls == 2, "bad pointer free reaches the UB handler");
+		CHECK(sm_szalloc_pool(&pool, p) == 0 && ub_calls == 3, "szalloc of a freed block");
+		POOL_OK(&pool, "after bad frees");
+		sm_free_pool(&pool, NULL);
+		CHECK(ub_calls == 3, "free(NULL)");
+	}
+
+	// filling the pool, then freeing merges it back into one block
+	{
+		CHECK(sm_set_pool(&pool, mem, sizeof(mem), 0, NULL), "reset pool");
+		size_t whole = first_free_size(&pool);
+		std::vector<void *> v;
+		void *p;
+		while ((p = sm_malloc_pool(&pool, 48))) v.push_back(p);
+		CHECK(errno == ENOMEM && v.size() > sizeof(mem) / (48 + HEADER_SZ) - 100,
+			"%zu blocks of 48", v.size());
+		POOL_OK(&pool, "full");
+		for (size_t i = 0; i < v.size(); i += 2) sm_free_pool(&pool, v[i]);
+		pool_error(&pool, &nfree);
+		CHECK(nfree >= (int)v.size() / 2, "every other block free: %d", nfree);
+		POOL_OK(&pool, "every other free");
+		for (size_t i = 1; i < v.size(); i += 2) sm_free_pool(&pool, v[i]);
+		pool_error(&pool, &nfree);
+		CHECK(nfree == 1 && first_free_size(&pool) == whole, "all merged: %d blocks", nfree);
+		POOL_OK(&pool, "all free");
+
+		// a request the exact size of the only free block finds it
+		p = sm_malloc_pool(&pool, whole);
+		CHECK(p && sm_szalloc_pool(&pool, p) == whole, "malloc of the whole pool");
+		CHECK(!sm_malloc_pool(&pool, 1), "then nothing is left");
+		sm_free_pool(&pool, p);
+		CHECK(!sm_malloc_pool(&pool, whole + 1), "larger than the pool");
+		POOL_OK(&pool, "whole pool");
+	}
+
+	// realloc grows into a free neighbour, shrinks in place, or moves
+	{
+		CHECK(sm_set_pool(&pool, mem, sizeof(mem), 0, NULL), "reset pool");
+		char *a = (char *)sm_malloc_pool(&pool, 100);
+		char *b = (char *)sm_malloc_pool(&pool, 100);
+		char *c = (char *)sm_malloc_pool(&pool, 100);
+		CHECK(sm_malloc_pool(&pool, 100) != NULL, "block after c");
+		memset(a, 'a', 100);
+		sm_free_pool(&pool, b);
+		CHECK(sm_realloc_pool(&pool, a, 200) == a && sm_szalloc_pool(&pool, a) == 200,
+			"grow into the free neighbour");
+		CHECK(a[0] == 'a' && a[99] == 'a', "contents kept");
+		CHECK(sm_realloc_pool(&pool, a, 50) == a, "shrink in place");
+		POOL_OK(&pool, "after shrink");
+		CHECK(!sm_realloc_move_pool(&pool, c, 100000) && errno == ERANGE,
+			"realloc_move fails rather than move");
+		char *d = (char *)sm_realloc_pool(&pool, a, 100000);
+		CHECK(d && d != a && d[0] == 'a' && d[49] == 'a', "realloc moves");
+		CHECK(!sm_alloc_valid_pool(&pool, a), "old block freed");
+		CHECK(sm_realloc_pool(&pool, d, 0) == NULL && !sm_alloc_valid_pool(&pool, d),
+			"realloc to 0 frees");
+		POOL_OK(&pool, "after realloc");
+	}
+
+	// do_zero pools hand out zeroed memory, also the bytes realloc adds
+	{
+		memset(mem, 0x55, sizeof(mem));
+		CHECK(sm_set_pool(&pool, mem, sizeof(mem), 1, NULL), "zeroed pool");
+		char *a = (char *)sm_malloc_pool(&pool, 64);
+		bool zero = true;
+		for (int i = 0; i < 64; i++) zero = zero && a[i] == 0;
+		memset(a, 1, 64);
+		a = (char *)sm_realloc_pool(&pool, a, 64 + 200);
+		for (int i = 64; i < 64 + 200; i++) zero = zero && a[i] == 0;
+		sm_free_pool(&pool, a);
+		a = (char *)sm_malloc_pool(&pool, 300);
+		for (int i = 0; i < 300; i++) zero = zero && a[i] == 0;
+		CHECK(zero, "zeroed allocations");
+		sm_set_pool(&pool, NULL, 0, 0, NULL);
+		CHECK(pool.pool == NULL && mem[100] == 0, "release zeroes the pool");
+	}
+
+	// a pool struct filled in by hand is set up on first use, and the OOM
+	// handler can grow it
+	{
+		memset(mem, 0, sizeof(mem));
+		pool.pool = mem;
+		pool.pool_size = 65536;
+		pool.do_zero = 0;
+		pool.oomfn = grow_pool;
+		void *p = sm_malloc_pool(&pool, 1000);
+		CHECK(p && pool.pool_size == 65536, "lazy setup");
+		std::vector<void *> v;
+		while ((p = sm_malloc_pool(&pool, 10000))) v.push_back(p);
+		CHECK(pool.pool_size == sizeof(mem) && v.size() > sizeof(mem) / 10100 - 2,
+			"OOM handler grew the pool to %zu, %zu blocks", pool.pool_size, v.size());
+		POOL_OK(&pool, "grown pool");
+
+		size_t total, user, free;
+		int nr;
+		CHECK(sm_malloc_stats_pool(&pool, &total, &user, &free, &nr) == 1
+			&& nr == (int)v.size() + 1 && user == v.size() * 10000 + 1000
+			&& total == POOL_CTL(&pool)->used, "stats: %d blocks, %zu user", nr, user);
+		heap_profile_t prof;
+		CHECK(sm_profile_pool(&pool, &prof) == 1 && prof.used == total
+			&& prof.used_blocks == (uint32_t)nr && prof.allocs[heap_profile_class(10000)] == v.size(),
+			"profile");
+	}
+
+	// random use, with each block's contents checked
+	for (int zero = 0; zero < 2; zero++) {
+		struct slot { unsigned char *p; size_t n; unsigned char fill; };
+		std::vector<slot> slots(400);
+		CHECK(sm_set_pool(&pool, mem, sizeof(mem), zero, NULL), "reset pool");
+		srand(3 + zero);
+		int failures = 0;
+		for (int op = 0; op < 200000 && !failures; op++) {
+			slot &s = slots[rand() % slots.size()];
+			size_t n = rand() % 4 ? 1 + rand() % 200 : 1 + rand() % 20000;
+			if (s.p) {
+				for (size_t i = 0; i < s.n; i++) failures += s.p[i] != s.fill;
+				if (sm_szalloc_pool(&pool, s.p) != s.n) failures++;
+			}
+			if (s.p && rand() % 2) {
+				sm_free_pool(&pool, s.p);
+				s.p = NULL;
+			} else if (s.p) {
+				unsigned char *r = (unsigned char *)sm_realloc_pool(&pool, s.p, n);
+				if (!r) continue;
+				for (size_t i = 0; i < n && i < s.n; i++) failures += r[i] != s.fill;
+				for (size_t i = s.n; zero && i < n; i++) failures += r[i] != 0;
+				s.p = r;
+				memset(s.p, s.fill, n);
+				s.n = n;
+			} else if ((s.p = (unsigned char *)sm_malloc_pool(&pool, n))) {
+				for (size_t i = 0; zero && i < n; i++) failures += s.p[i] != 0;
+				s.n = n;
+				s.fill = rand();
+				memset(s.p, s.fill, n);
+			}
+			if (op % 1000 == 0 && pool_error(&pool)) failures++;
+		}
+		CHECK(!failures && ub_calls == 3, "random use, do_zero %d", zero);
+		POOL_OK(&pool, "random use");
+		for (slot &s : slots) sm_free_pool(&pool, s.p);
+		pool_error(&pool, &nfree);
+		CHECK(nfree == 1 && POOL_CTL(&pool)->used == 0, "all freed after random use");
+	}
+	return TEST_RESULT();
+}
@@ -0,0 +1,150 @@
+// String growth, short Strings in sso[], and String operations against
+// std::string
+#include "Arduino.h"
+#include <string>
+#include "test.h"
+
+// String's capacity is protected
+struct Peek : public String {
+	static unsigned int cap(const String &s) { return static_cast<const Peek &>(s).capacity(); }
+};
+
+// true if the chars are stored inside the String object
+static bool inside(const String &s)
+{
+	const char *p = s.c_str();
+	return p >= (const char *)&s && p < (const char *)&s + sizeof(s);
+}
+
+static bool same(const String &s, const std::string &r)
+{
+	return s.length() == r.size() && memcmp(s.c_str(), r.data(), r.size()) == 0
+		&& s.c_str()[r.size()] == 0 && Peek::cap(s) >= s.length();
+}
+
+int main()
+{
+	// sso[] shares the space of the heap pointer and capacity, so String
+	// is 12 bytes on the Teensy, as before sso[].  On 64 bit hosts the
+	// pointer's alignment pads it to 24.
+	static_assert(STRING_SSO_SIZE <= sizeof(char *) + sizeof(unsigned int), "sso[] too large");
+	static_assert(sizeof(char *) != 4 || sizeof(String) == 12, "String grew");
+	const unsigned int sso = STRING_SSO_SIZE;
+
+	// short Strings never use the heap, however they are made
+	{
+		unsigned int before = String::reallocCount;
+		String a(12345), b("temp"), c = b + ":" + 7, d('x'), e(1.5f);
+		String f = c.substring(1, 4), g;
+		g += "ab";
+		g += 'c';
+		String h = std::move(g);
+		CHECK(a == "12345" && b == "temp" && c == "temp:7" && d == "x" && e == "1.50"
+			&& f == "emp" && h == "abc", "short values");
+		CHECK(inside(a) && inside(c) && inside(f) && inside(h), "short Strings inside");
+		CHECK(String::reallocCount == before, "short Strings: %u reallocs",
+			String::reallocCount - before);
+		CHECK(!g && g.length() == 0 && g.c_str()[0] == 0, "moved from String is empty");
+	}
+
+	// a String moves to the heap when it outgrows sso[], and back when
+	// shrunk to fit
+	{
+		String s;
+		CHECK(!s && s.c_str()[0] == 0, "a new String has no buffer");
+		String t;
+		CHECK(t.reserve(5) && t && inside(t) && t.c_str()[0] == 0, "reserve inside");
+		std::string r;
+		for (unsigned int i=0; i < sso + 2; i++) {
+			s += (char)('a' + i);
+			r += (char)('a' + i);
+			CHECK(same(s, r) && inside(s) == (i < sso - 1), "append %u", i);
+		}
+		s.remove(2);
+		r.erase(2);
+		CHECK(same(s, r) && !inside(s), "still on the heap after remove");
+		s.shrink_to_fit();
+		CHECK(same(s, r) && inside(s), "back inside after shrink_to_fit");
+		s.replace("ab", "0123456789abcdef");
+		CHECK(s == "0123456789abcdef" && !inside(s), "replace moves to the heap");
+
+		// move and copy between inline and heap Strings
+		String big(std::string(100, 'z').c_str()), small("hi");
+		String m = std::move(big);
+		CHECK(m.length() == 100 && !big && !inside(m), "move a heap String");
+		m = std::move(small);
+		CHECK(m == "hi" && inside(m) && !small, "move an inline String over a heap one");
+		big = m;
+		m = String(std::string(50, 'y').c_str());
+		CHECK(big == "hi" && m.length() == 50, "copy and move assignment");
+	}
+
+	// appending one char at a time grows geometrically
+	{
+		String s;
+		unsigned int before = String::reallocCount;
+		for (int i=0; i < 4096; i++) s += 'x';
+		unsigned int reallocs = String::reallocCount - before;
+		CHECK(s.length() == 4096 && reallocs <= 16, "4096 appends: %u reallocs", reallocs);
+		s.shrink_to_fit();
+		CHECK(Peek::cap(s) == 4096, "shrink_to_fit: capacity %u", Peek::cap(s));
+		s += "y";
+		CHECK(Peek::cap(s) >= 4096 + 4096 / 2, "grows 1.5x: capacity %u", Peek::cap(s));
+	}
+
+	// reserve() is exact, and appends within it do not realloc
+	{
+		String s;
+		CHECK(s.reserve(1000) && Peek::cap(s) == 1000, "reserve %u", Peek::cap(s));
+		unsigned int before = String::reallocCount;
+		for (int i=0; i < 100; i++) s += 1234567890;
+		CHECK(String::reallocCount == before && s.length() == 1000, "within reserve");
+		CHECK(s.reserve(10) && Peek::cap(s) == 1000, "reserve never shrinks");
+	}
+
+	// replace() growing the String
+	{
+		String s("a-b-c-d");
+		s.replace("-", "--------------------");
+		CHECK(s.length() == 4 + 3 * 20 && s.startsWith("a----") && s.endsWith("--d"),
+			"replace grow: %s", s.c_str());
+		s.replace("--------------------", "+");
+		CHECK(s == "a+b+c+d", "replace shrink: %s", s.c_str());
+	}
+
+	// random edits, compared with std::string
+	srand(1);
+	for (int n=0; n < 3000; n++) {
+		String s;
+		std::string r;
+		for (int op=0; op < 20; op++) {
+			int k = rand() % 8;
+			std::string piece(rand() % 40, 'a' + rand() % 4);
+			if (k <= 2) {
+				s += piece.c_str();
+				r += piece;
+			} else if (k == 3) {
+				s += (char)('0' + op % 10);
+				r += (char)('0' + op % 10);
+			} else if (k == 4 && r.size() > 0) {
+				unsigned int i = rand() % r.size(), c = rand() % 10;
+				s.remove(i, c);
+				r.erase(i, c);
+			} else if (k == 5) {
+				s.replace("ab", "xyz");
+				for (size_t i = 0; (i = r.find("ab", i)) != std::string::npos; i += 3) {
+					r.replace(i, 2, "xyz");
+				}
+			} else if (k == 6) {
+				String t = s;
+				s = t + piece.c_str();
+				r += piece;
+			} else {
+				s.shrink_to_fit();
+			}
+			if (!same(s, r)) break;
+		}
+		CHECK(same(s, r), "random edits %d: [%s] want [%s]", n, s.c_str(), r.c_str());
+	}
+	return TEST_RESULT();
+}
@@ -0,0 +1,103 @@
+// Stream::waitForData and EventResponder::waitForEvent, on the host's
+// simulated clock: how much of a wait is spent asleep, and how soon after
+// the receive interrupt the reader runs.
+#include "Arduino.h"
+#include "EventResponder.h"
+#include <string>
+#include "test.h"
+#include "memstream.h"
+
+// a stream whose "receive interrupt" triggers the read event, like
+// HardwareSerialIMXRT and the USB serial ports
+class EventStream : public MemStream {
+public:
+	EventResponder *event = nullptr;
+	int events_set = 0;
+	virtual bool setReadEvent(EventResponder *e) { event = e; if (e) events_set++; return true; }
+};
+
+static MemStream *rx_stream;
+static void rx_irq(void)
+{
+	rx_stream->in += 'x';
+	EventStream *es = (EventStream *)rx_stream;
+	if (es->event) es->event->triggerEvent();
+}
+
+static void reset(void)
+{
+	host_yields = host_wfis = host_sleep_us = 0;
+	host_irq_at = UINT32_MAX;
+}
+
+int main()
+{
+	// a stream which can't signal is polled: never asleep
+	{
+		MemStream s;
+		s.setTimeout(10);
+		reset();
+		uint32_t t = micros();
+		CHECK(s.read() == -1 && s.readBytes((char *)nullptr, 0) == 0, "empty");
+		char c;
+		CHECK(s.readBytes(&c, 1) == 0, "polled timeout");
+		uint32_t us = micros() - t;
+		printf("polled, 10 ms timeout:   %5u yields, %2u wfi, asleep %5u of %5u us\n",
+			host_yields, host_wfis, host_sleep_us, us);
+		CHECK(host_wfis == 0 && host_yields >= 9000, "polling");
+	}
+
+	// a signalling stream sleeps, waking once per SysTick
+	{
+		EventStream s;
+		s.setTimeout(10);
+		reset();
+		uint32_t t = micros();
+		char c;
+		CHECK(s.readBytes(&c, 1) == 0, "event timeout");
+		uint32_t us = micros() - t;
+		printf("event, 10 ms timeout:    %5u yields, %2u wfi, asleep %5u of %5u us\n",
+			host_yields, host_wfis, host_sleep_us, us);
+		CHECK(host_wfis <= 11 && host_sleep_us * 100 >= us * 99, "idle: asleep %u of %u us",
+			host_sleep_us, us);
+		CHECK(s.event == nullptr && s.events_set == 1, "event cleared after the wait");
+	}
+
+	// data arriving mid-millisecond wakes the reader at once
+	{
+		EventStream s;
+		s.setTimeout(1000);
+		rx_stream = &s;
+		host_irq = rx_irq;
+		reset();
+		uint32_t t = micros();
+		host_irq_at = t + 3456;
+		char buf[2];
+		CHECK(s.readBytes(buf, 1) == 1 && buf[0] == 'x', "event read");
+		uint32_t latency = micros() - (t + 3456);
+		printf("event, data after 3456 us: read %u us later, %u yields, %u wfi\n",
+			latency, host_yields, host_wfis);
+		CHECK(latency <= 1, "wake-up latency %u us", latency);
+
+		// data already received when the wait starts is read without waiting
+		s.in += "yz";
+		reset();
+		t = micros();
+		CHECK(s.readBytes(buf, 2) == 2 && micros() == t && host_wfis == 0, "buffered data");
+		host_irq = nullptr;
+	}
+
+	// waitForEvent on a list returns the triggered one, cleared
+	{
+		EventResponder ev[3];
+		reset();
+		CHECK(ev[0].waitForEvent(ev, 3, 5) == nullptr, "list timeout");
+		ev[2].triggerEvent();
+		CHECK(ev[0].waitForEvent(ev, 3, 0) == ev + 2 && !ev[2], "already triggered");
+		CHECK(ev[0].waitForEvent(ev, 3, 0) == nullptr, "cleared");
+		uint32_t t = micros();
+		CHECK(!ev[0].waitForEvent(ev[0], 0) && micros() == t, "zero timeout does not wait");
+		CHECK(host_primask == 0, "interrupts enabled after waiting");
+	}
+	return TEST_RESULT();
+}